@@ -0,0 +1,133 @@
+/* 
+*  ==================================================================
+*  smvp-alloc.c for smvp-toolbox
+*  Cache-line aligned, optionally huge page backed array allocation
+*  ==================================================================
+*/
+
+// Required for MAP_HUGETLB and MADV_HUGEPAGE
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <sys/mman.h>
+#include "smvp-internal.h"
+
+// Struct: _alloc_header_
+// Bookkeeping stored in the cache line immediately preceding every smvp_alloc() block
+typedef struct _alloc_header_
+{
+    void *base;    // Start of the underlying allocation/mapping
+    size_t mapLen; // Length of the mapping (MAP_HUGETLB only, zero otherwise)
+    size_t len;    // Usable length requested by the caller
+    int backing;   // SMVP_BACKING_* type actually obtained
+} AllocHeader;
+
+// Function: smvp_alloc
+// Allocates a cache-line aligned array, backed by huge pages when the SMVP_HUGE_* policy asks for them and
+// the array is large enough. Falls back from MAP_HUGETLB to transparent huge pages to plain aligned memory,
+// returns NULL if all of them fail
+void *smvp_alloc(size_t len, int huge)
+{
+    void *base = NULL;
+    size_t mapLen = 0;
+    size_t totalLen = len + SMVP_ALIGN;
+    size_t hugeLen = (totalLen + SMVP_HUGE_PAGE_SIZE - 1) & ~(SMVP_HUGE_PAGE_SIZE - 1);
+    int backing = SMVP_BACKING_ALIGNED;
+    AllocHeader *header;
+
+    // Explicit huge pages come from the preallocated pool (vm.nr_hugepages) and are never split by the kernel
+    if (huge == SMVP_HUGE_EXPLICIT && len >= SMVP_HUGE_THRESHOLD)
+    {
+        base = mmap(NULL, hugeLen, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (base == MAP_FAILED)
+        {
+            base = NULL;
+        }
+        else
+        {
+            mapLen = hugeLen;
+            backing = SMVP_BACKING_HUGETLB;
+        }
+    }
+
+    // Transparent huge pages need a 2 MiB aligned, 2 MiB multiple region to be eligible for promotion
+    if (base == NULL && huge != SMVP_HUGE_NONE && len >= SMVP_HUGE_THRESHOLD)
+    {
+        if (posix_memalign(&base, SMVP_HUGE_PAGE_SIZE, hugeLen) == 0)
+        {
+            if (madvise(base, hugeLen, MADV_HUGEPAGE) == 0)
+            {
+                backing = SMVP_BACKING_THP;
+            }
+        }
+        else
+        {
+            base = NULL;
+        }
+    }
+
+    if (base == NULL && posix_memalign(&base, SMVP_ALIGN, totalLen) != 0)
+    {
+        return NULL;
+    }
+
+    // Header occupies one full cache line so the returned pointer keeps the base alignment
+    header = (AllocHeader *)base;
+    header->base = base;
+    header->mapLen = mapLen;
+    header->len = len;
+    header->backing = backing;
+
+    return (char *)base + SMVP_ALIGN;
+}
+
+// Function: smvp_free
+// Releases an array obtained from smvp_alloc()
+void smvp_free(void *ptr)
+{
+    AllocHeader *header;
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    header = (AllocHeader *)((char *)ptr - SMVP_ALIGN);
+    if (header->backing == SMVP_BACKING_HUGETLB)
+    {
+        munmap(header->base, header->mapLen);
+    }
+    else
+    {
+        free(header->base);
+    }
+}
+
+// Function: smvp_alloc_backing
+// Returns the SMVP_BACKING_* type actually obtained for an array from smvp_alloc()
+int smvp_alloc_backing(const void *ptr)
+{
+    return ((const AllocHeader *)((const char *)ptr - SMVP_ALIGN))->backing;
+}
+
+// Function: smvpAllocSize
+// Returns the usable length of an array from smvp_alloc()
+size_t smvpAllocSize(const void *ptr)
+{
+    return ((const AllocHeader *)((const char *)ptr - SMVP_ALIGN))->len;
+}
+
+// Function: smvp_backing_name
+// Converts a SMVP_BACKING_* type into a printable name
+const char *smvp_backing_name(int backing)
+{
+    if (backing == SMVP_BACKING_HUGETLB)
+    {
+        return "explicit huge pages (MAP_HUGETLB)";
+    }
+    else if (backing == SMVP_BACKING_THP)
+    {
+        return "transparent huge pages (madvise)";
+    }
+    return "4 KiB pages, 64-byte aligned";
+}
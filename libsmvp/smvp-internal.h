@@ -0,0 +1,175 @@
+/* 
+*  ==================================================================
+*  smvp-internal.h for smvp-toolbox
+*  Private definitions shared by the libsmvp translation units
+*  ==================================================================
+*/
+
+#ifndef SMVP_INTERNAL_H
+#define SMVP_INTERNAL_H
+
+#include "smvp.h"
+
+// Every array is aligned to a cache line, arrays of at least one huge page may be backed by huge pages
+#define SMVP_ALIGN 64
+#define SMVP_HUGE_PAGE_SIZE (2UL * 1024 * 1024)
+#define SMVP_HUGE_THRESHOLD SMVP_HUGE_PAGE_SIZE
+// Prefetching kernels request the next val/col_ind lines once per cache line of doubles
+#define SMVP_PREFETCH_LINE_MASK (SMVP_ALIGN / 8 - 1)
+
+// Struct: _smvp_offsets_
+// An offset array into the non-zeros (row_ptr, col_ptr, start_pos). Matrices up to the index limit store
+// 32-bit entries for the bandwidth, larger ones 64-bit; exactly one pointer is set, the same one for every
+// offset array of a matrix
+typedef struct _smvp_offsets_
+{
+    int32_t *i32;
+    int64_t *i64;
+} SmvpOffsets;
+
+// Function: offsetAt
+// Reads entry i of an offset array of either width (conversions and setup, the kernels are instantiated per width)
+static inline int64_t offsetAt(SmvpOffsets offsets, int64_t i)
+{
+    return (offsets.i64 != NULL) ? offsets.i64[i] : (int64_t)offsets.i32[i];
+}
+
+// Function: offsetSet
+// Writes entry i of an offset array of either width
+static inline void offsetSet(SmvpOffsets offsets, int64_t i, int64_t value)
+{
+    if (offsets.i64 != NULL)
+    {
+        offsets.i64[i] = value;
+    }
+    else
+    {
+        offsets.i32[i] = (int32_t)value;
+    }
+}
+
+// Struct: _csr_data_
+// Provides a convenient structure for storing/manipulating CSR compressed data
+typedef struct _csr_data_
+{
+    SmvpOffsets row_ptr;
+    int *col_ind;
+    double *val;
+} CSRData;
+
+// Struct: _csc_data_
+// Provides a convenient structure for storing/manipulating CSC compressed data
+typedef struct _csc_data_
+{
+    SmvpOffsets col_ptr;
+    int *row_ind;
+    double *val;
+} CSCData;
+
+// Struct: _tjds_data_
+// Provides a convenient structure for storing/manipulating TJDS compressed data
+typedef struct _tjds_data_
+{
+    double *val;
+    int *row_ind;
+    SmvpOffsets start_pos; // num_tjdiag + 1 entries, start_pos[num_tjdiag] == nnz
+    int *perm;             // perm[k] = original column stored at slot k of every transpose jagged diagonal
+    int num_tjdiag;        // Number of transpose jagged diagonals (length of the longest column)
+} TJDSData;
+
+// Adaptive CSR row classes: the reported bins, with 2-4 split by exact length so each gets its own unrolled
+// loop, empty rows kept apart and the longest rows set aside to be split across the workers
+#define ACSR_EMPTY 0
+#define ACSR_LEN1 1
+#define ACSR_LEN2 2
+#define ACSR_LEN3 3
+#define ACSR_LEN4 4
+#define ACSR_MEDIUM 5 // 5-16 non-zeros
+#define ACSR_LARGE 6  // 17-64 non-zeros
+#define ACSR_LONG 7   // 65 non-zeros and more
+#define ACSR_SPLIT 8  // Long rows of at least the split threshold
+#define ACSR_CLASSES 9
+
+// Struct: _acsr_data_
+// Adaptive CSR: an ordering of the CSR rows by class, the kernels read the canonical CSR arrays through it
+typedef struct _acsr_data_
+{
+    int *rows;                   // Row indices grouped by class, ascending within each class
+    int start[ACSR_CLASSES + 1]; // Class c holds rows[start[c]] to rows[start[c + 1] - 1]
+    int64_t nnz[ACSR_CLASSES];
+    int *part;       // Bound matrices: nthreads + 1 slice boundaries in rows per class, balanced by non-zeros (NULL when serial)
+    double *partial; // nthreads partial sums per split row of a bound matrix (NULL when serial), rewritten by every product
+} ACSRData;
+
+// Struct: _tiled_data_
+// Column-tiled CSR: the columns are cut into tiles of tile_cols and every tile stores the rows with non-zeros in
+// it as row segments, a CSR block over just those rows. Segments of a tile are in ascending row order
+typedef struct _tiled_data_
+{
+    int tile_cols;          // Columns per tile (a multiple of 8, so no x cache line spans two tiles)
+    int num_tiles;
+    int cache_level;        // Cache level tile_cols was sized for (0 = width set directly)
+    size_t cache_bytes;     // Size of that cache (0 when set directly or unknown)
+    SmvpOffsets tile_start; // num_tiles + 1 offsets, tile t holds segments tile_start[t] to tile_start[t + 1] - 1
+    int *rows;              // Row of every segment
+    SmvpOffsets seg_ptr;    // segments + 1 offsets into col_ind and val
+    int *col_ind;
+    double *val;
+    int64_t segments;
+    int64_t x_lines;        // Distinct x cache lines read per multiply
+    int64_t *part;          // Bound matrices: nthreads + 1 segment boundaries per tile following A->part (NULL when serial)
+} TiledData;
+
+// Struct: _transpose_data_
+// Plan of the transpose products of a bound matrix, the CSR arrays are read as they are
+typedef struct _transpose_data_
+{
+    int mode;          // SMVP_TRANSPOSE_* used by smvp_multiply_transpose()
+    double *buffers;   // PRIVATE: nthreads private copies of y, cols entries each
+    int *col_part;     // nthreads + 1 column boundaries: reduction slices (PRIVATE) or owned ranges balanced by non-zeros (OWNER)
+    SmvpOffsets split; // OWNER: nthreads - 1 offsets per row, where workers 1 to nthreads - 1 start in it
+    size_t bytes;      // Scratch held by the plan
+} TransposeData;
+
+// Struct: smvp_matrix
+// Owns the canonical (row-major sorted, i.e. CSR) copy of a matrix and caches every format derived from it
+// Each derived format is built at most once via an O(nnz) pass and then only read by the kernels
+struct smvp_matrix
+{
+    int rows;
+    int cols;
+    int64_t nnz;
+    int index_bits; // 32 or 64, width of every offset array (64 only above the index limit)
+    int formats;    // SMVP_FORMAT_* bitmask of formats that are built
+    smvp_options_t opts; // Settings copied (and clamped) when the handle was created
+    CSRData csr; // Canonical representation, always present
+    CSCData csc;
+    TJDSData tjds;
+    ACSRData acsr;
+    TiledData tiled;
+    TransposeData transpose;
+    int csr_prefetch;  // Software prefetch distance of the CSR kernel in non-zeros (0 = plain kernel)
+    int tjds_prefetch; // Software prefetch distance of the TJDS kernel in non-zeros (0 = plain kernel)
+    size_t bytes;
+    size_t bytes_peak;
+    size_t tjds_build_peak;
+    size_t tjds_bytes;
+    smvp_pool_t *pool; // Bound by smvp_bind(), NULL runs every kernel serially
+    int nthreads;      // Workers of pool used by this matrix
+    int *part;         // nthreads + 1 row boundaries, balanced by non-zeros
+    int placed;        // SMVP_FORMAT_* bitmask of formats first-touched by the workers reading each part (cleared by unbind)
+    double **xrep;     // One copy of x per node (SMVP_NUMA_REPLICATE on multi-node pools only)
+};
+
+// Signature of a job run on every bound worker, tid in [0, nthreads)
+typedef void (*SmvpTask)(void *arg, int tid, int nthreads);
+
+size_t smvpAllocSize(const void *ptr);
+void smvpPoolRun(smvp_pool_t *pool, int nthreads, SmvpTask task, void *arg);
+void smvpPoolRun2(smvp_pool_t *pool, int nthreads, SmvpTask first, SmvpTask second, void *arg);
+int smvpPoolNodes(const smvp_pool_t *pool);
+int smvpPoolNuma(const smvp_pool_t *pool);
+int smvpPoolWorkerNode(const smvp_pool_t *pool, int tid);
+int smvpPoolNodeId(const smvp_pool_t *pool, int node);
+
+#endif
@@ -0,0 +1,675 @@
+/*
+*  ==================================================================
+*  smvp-panels.c for smvp-toolbox
+*  Out-of-core CSR: row panel files and the double-buffered streaming kernel
+*  ==================================================================
+*/
+
+// Required for O_DIRECT
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "smvp-internal.h"
+
+#define PANEL_ALIGN_UP(len, align) ((((size_t)(len)) + (align) - 1) & ~((size_t)(align) - 1))
+
+// Struct: smvp_panel_writer
+// Panel file under construction, written to path.tmp and renamed into place once complete
+struct smvp_panel_writer
+{
+    int fd;
+    char *path;
+    char *tmpPath;
+    smvp_panel_header_t header;
+    smvp_panel_entry_t *index;
+    char *written; // Per-panel flag set by smvp_panels_put()
+    int64_t end;   // Padded length of the finished file
+    int failed;
+};
+
+// Struct: smvp_panels
+// Open panel file and the two buffers panels are streamed through
+struct smvp_panels
+{
+    int fd;
+    int direct; // fd was opened with O_DIRECT
+    smvp_panel_header_t header;
+    smvp_panel_entry_t *index;
+    size_t bufferBytes; // Largest panel, padded to SMVP_PANEL_ALIGN
+    char *buffer[2];
+};
+
+// Struct: _stream_state_
+// Hand-off between the I/O thread and the computing caller during one multiply
+typedef struct _stream_state_
+{
+    smvp_panels_t *P;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int slot[2];      // Panel held by each buffer, -1 when the buffer is free
+    int failed;       // I/O thread gave up, the errno is in error
+    int error;
+    double ioSeconds; // Written by the I/O thread only
+    size_t bytesRead;
+} StreamState;
+
+// Function: panelColOffset
+// Byte offset of col_ind inside a panel
+static size_t panelColOffset(int nrows)
+{
+    return PANEL_ALIGN_UP(sizeof(int32_t) * ((size_t)nrows + 1), 8);
+}
+
+// Function: panelValOffset
+// Byte offset of val inside a panel
+static size_t panelValOffset(int nrows, int64_t nnz)
+{
+    return panelColOffset(nrows) + PANEL_ALIGN_UP(sizeof(int32_t) * (size_t)nnz, 8);
+}
+
+// Function: panelPayload
+// Payload length of a panel of nrows rows and nnz entries
+static size_t panelPayload(int nrows, int64_t nnz)
+{
+    return panelValOffset(nrows, nnz) + sizeof(double) * (size_t)nnz;
+}
+
+// Function: nowSeconds
+// Monotonic clock reading in seconds
+static double nowSeconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+// Function: writeAll
+// pwrite() that retries short writes
+static int writeAll(int fd, const void *data, size_t len, int64_t offset)
+{
+    const char *cursor = (const char *)data;
+    ssize_t done;
+
+    while (len > 0)
+    {
+        if ((done = pwrite(fd, cursor, len, (off_t)offset)) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        cursor += done;
+        offset += done;
+        len -= (size_t)done;
+    }
+    return 0;
+}
+
+// Function: readAll
+// pread() that retries short reads, running into the end of the file is an error
+static int readAll(int fd, void *data, size_t len, int64_t offset)
+{
+    char *cursor = (char *)data;
+    ssize_t done;
+
+    while (len > 0)
+    {
+        if ((done = pread(fd, cursor, len, (off_t)offset)) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        if (done == 0)
+        {
+            errno = EIO;
+            return -1;
+        }
+        cursor += done;
+        offset += done;
+        len -= (size_t)done;
+    }
+    return 0;
+}
+
+// Function: smvp_panels_begin
+// Plans consecutive row panels of at most panel_bytes each (a longer row gets a panel of its own)
+// from the per-row non-zero counts and creates the file they will be written to
+int smvp_panels_begin(smvp_panel_writer_t **W, const char *path, int rows, int cols, const int row_nnz[], size_t panel_bytes)
+{
+    smvp_panel_writer_t *writer;
+    int index, first, npanels;
+    int64_t nnz, panelNnz, offset;
+
+    if (W == NULL || path == NULL || rows < 0 || cols < 0 || (rows > 0 && row_nnz == NULL) || panel_bytes == 0)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    *W = NULL;
+
+    // 1. Count the panels so the index can be sized
+    npanels = 0;
+    nnz = 0;
+    for (first = 0; first < rows; npanels++)
+    {
+        for (panelNnz = 0, index = first; index < rows; index++)
+        {
+            if (row_nnz[index] < 0 || panelNnz + row_nnz[index] > INT_MAX)
+            {
+                return SMVP_ERR_INVALID;
+            }
+            if (index > first && panelPayload(index + 1 - first, panelNnz + row_nnz[index]) > panel_bytes)
+            {
+                break;
+            }
+            panelNnz += row_nnz[index];
+        }
+        nnz += panelNnz;
+        first = index;
+    }
+
+    if ((writer = (smvp_panel_writer_t *)calloc(1, sizeof(*writer))) == NULL)
+    {
+        return SMVP_ERR_ALLOC;
+    }
+    writer->index = (smvp_panel_entry_t *)calloc((size_t)npanels + 1, sizeof(smvp_panel_entry_t));
+    writer->written = (char *)calloc((size_t)npanels + 1, 1);
+    writer->path = strdup(path);
+    writer->tmpPath = (char *)malloc(strlen(path) + 5);
+    if (writer->index == NULL || writer->written == NULL || writer->path == NULL || writer->tmpPath == NULL)
+    {
+        writer->fd = -1;
+        writer->failed = 1;
+        smvp_panels_end(writer);
+        return SMVP_ERR_ALLOC;
+    }
+    memcpy(writer->header.magic, SMVP_PANEL_MAGIC, sizeof(writer->header.magic));
+    writer->header.rows = rows;
+    writer->header.cols = cols;
+    writer->header.nnz = nnz;
+    writer->header.panel_bytes = (int64_t)panel_bytes;
+    writer->header.npanels = npanels;
+
+    // 2. Lay the panels out after the header and index, each on an aligned offset
+    offset = (int64_t)PANEL_ALIGN_UP(sizeof(smvp_panel_header_t) + sizeof(smvp_panel_entry_t) * (size_t)npanels, SMVP_PANEL_ALIGN);
+    npanels = 0;
+    for (first = 0; first < rows; npanels++)
+    {
+        for (panelNnz = 0, index = first; index < rows; index++)
+        {
+            if (index > first && panelPayload(index + 1 - first, panelNnz + row_nnz[index]) > panel_bytes)
+            {
+                break;
+            }
+            panelNnz += row_nnz[index];
+        }
+        writer->index[npanels].first_row = first;
+        writer->index[npanels].nrows = index - first;
+        writer->index[npanels].nnz = panelNnz;
+        writer->index[npanels].offset = offset;
+        writer->index[npanels].bytes = (int64_t)panelPayload(index - first, panelNnz);
+        offset += (int64_t)PANEL_ALIGN_UP(writer->index[npanels].bytes, SMVP_PANEL_ALIGN);
+        first = index;
+    }
+    writer->end = offset;
+
+    sprintf(writer->tmpPath, "%s.tmp", path);
+    if ((writer->fd = open(writer->tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+    {
+        writer->failed = 1;
+        smvp_panels_end(writer);
+        return SMVP_ERR_SYSTEM;
+    }
+
+    *W = writer;
+    return SMVP_SUCCESS;
+}
+
+// Function: smvp_panels_count
+// Number of panels planned by smvp_panels_begin()
+int smvp_panels_count(const smvp_panel_writer_t *W)
+{
+    return (W != NULL) ? W->header.npanels : 0;
+}
+
+// Function: smvp_panels_span
+// Rows and non-zeros a panel must be given
+int smvp_panels_span(const smvp_panel_writer_t *W, int panel, int *first_row, int *nrows, long *nnz)
+{
+    if (W == NULL || panel < 0 || panel >= W->header.npanels)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    *first_row = W->index[panel].first_row;
+    *nrows = W->index[panel].nrows;
+    *nnz = (long)W->index[panel].nnz;
+    return SMVP_SUCCESS;
+}
+
+// Function: smvp_panels_put
+// Writes one panel given as CSR with a local, 0-based row_ptr
+int smvp_panels_put(smvp_panel_writer_t *W, int panel, const int row_ptr[], const int col_ind[], const double val[])
+{
+    const smvp_panel_entry_t *entry;
+    int index;
+
+    if (W == NULL || panel < 0 || panel >= W->header.npanels)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    entry = &W->index[panel];
+    if (row_ptr[0] != 0 || row_ptr[entry->nrows] != entry->nnz)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    for (index = 0; index < entry->nnz; index++)
+    {
+        if (col_ind[index] < 0 || col_ind[index] >= W->header.cols)
+        {
+            return SMVP_ERR_INVALID;
+        }
+    }
+
+    if (writeAll(W->fd, row_ptr, sizeof(int32_t) * ((size_t)entry->nrows + 1), entry->offset) != 0 ||
+        writeAll(W->fd, col_ind, sizeof(int32_t) * (size_t)entry->nnz, entry->offset + (int64_t)panelColOffset(entry->nrows)) != 0 ||
+        writeAll(W->fd, val, sizeof(double) * (size_t)entry->nnz, entry->offset + (int64_t)panelValOffset(entry->nrows, entry->nnz)) != 0)
+    {
+        W->failed = 1;
+        return SMVP_ERR_SYSTEM;
+    }
+    W->written[panel] = 1;
+    return SMVP_SUCCESS;
+}
+
+// Function: smvp_panels_end
+// Writes the header and index and moves the file into place, then frees the writer
+// Must be called even after a failure: an incomplete file is removed instead
+int smvp_panels_end(smvp_panel_writer_t *W)
+{
+    int index, status = SMVP_SUCCESS;
+
+    if (W == NULL)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    for (index = 0; index < W->header.npanels && !W->failed; index++)
+    {
+        if (!W->written[index])
+        {
+            status = SMVP_ERR_INVALID;
+            W->failed = 1;
+        }
+    }
+
+    if (W->fd >= 0)
+    {
+        if (!W->failed &&
+            (writeAll(W->fd, &W->header, sizeof(W->header), 0) != 0 ||
+             writeAll(W->fd, W->index, sizeof(smvp_panel_entry_t) * (size_t)W->header.npanels, sizeof(W->header)) != 0 ||
+             ftruncate(W->fd, (off_t)W->end) != 0 || fsync(W->fd) != 0))
+        {
+            W->failed = 1;
+        }
+        if (close(W->fd) != 0 || (!W->failed && rename(W->tmpPath, W->path) != 0))
+        {
+            W->failed = 1;
+        }
+        if (W->failed)
+        {
+            unlink(W->tmpPath);
+        }
+    }
+    if (W->failed && status == SMVP_SUCCESS)
+    {
+        status = SMVP_ERR_SYSTEM;
+    }
+
+    free(W->index);
+    free(W->written);
+    free(W->path);
+    free(W->tmpPath);
+    free(W);
+    return status;
+}
+
+// Function: loadIndex
+// Reads and checks the header and panel index, through an aligned bounce buffer so O_DIRECT accepts it
+static int loadIndex(smvp_panels_t *P, int64_t fileLen)
+{
+    char *bounce;
+    size_t len, maxBytes = 0;
+    int64_t nnz = 0;
+    int index, row = 0;
+
+    if (posix_memalign((void **)&bounce, SMVP_PANEL_ALIGN, SMVP_PANEL_ALIGN) != 0)
+    {
+        return SMVP_ERR_ALLOC;
+    }
+    if (fileLen < SMVP_PANEL_ALIGN || readAll(P->fd, bounce, SMVP_PANEL_ALIGN, 0) != 0)
+    {
+        free(bounce);
+        return (fileLen < SMVP_PANEL_ALIGN) ? SMVP_ERR_FORMAT : SMVP_ERR_SYSTEM;
+    }
+    memcpy(&P->header, bounce, sizeof(P->header));
+    free(bounce);
+    if (memcmp(P->header.magic, SMVP_PANEL_MAGIC, sizeof(P->header.magic)) != 0 || P->header.rows < 0 || P->header.cols < 0 ||
+        P->header.npanels < 0 || P->header.npanels > P->header.rows)
+    {
+        return SMVP_ERR_FORMAT;
+    }
+
+    len = PANEL_ALIGN_UP(sizeof(smvp_panel_header_t) + sizeof(smvp_panel_entry_t) * (size_t)P->header.npanels, SMVP_PANEL_ALIGN);
+    if ((int64_t)len > fileLen)
+    {
+        return SMVP_ERR_FORMAT;
+    }
+    if (posix_memalign((void **)&bounce, SMVP_PANEL_ALIGN, len) != 0)
+    {
+        return SMVP_ERR_ALLOC;
+    }
+    if ((P->index = (smvp_panel_entry_t *)malloc(sizeof(smvp_panel_entry_t) * ((size_t)P->header.npanels + 1))) == NULL)
+    {
+        free(bounce);
+        return SMVP_ERR_ALLOC;
+    }
+    if (readAll(P->fd, bounce, len, 0) != 0)
+    {
+        free(bounce);
+        return SMVP_ERR_SYSTEM;
+    }
+    memcpy(P->index, bounce + sizeof(smvp_panel_header_t), sizeof(smvp_panel_entry_t) * (size_t)P->header.npanels);
+    free(bounce);
+
+    // Panels must tile the rows in order and lie inside the file
+    for (index = 0; index < P->header.npanels; index++)
+    {
+        const smvp_panel_entry_t *entry = &P->index[index];
+
+        if (entry->first_row != row || entry->nrows < 1 || entry->nrows > P->header.rows - row || entry->nnz < 0 || entry->nnz > INT_MAX ||
+            entry->offset % SMVP_PANEL_ALIGN != 0 || entry->offset < (int64_t)len || entry->bytes != (int64_t)panelPayload(entry->nrows, entry->nnz) ||
+            entry->offset + (int64_t)PANEL_ALIGN_UP(entry->bytes, SMVP_PANEL_ALIGN) > fileLen)
+        {
+            return SMVP_ERR_FORMAT;
+        }
+        row += entry->nrows;
+        nnz += entry->nnz;
+        if (PANEL_ALIGN_UP(entry->bytes, SMVP_PANEL_ALIGN) > maxBytes)
+        {
+            maxBytes = PANEL_ALIGN_UP(entry->bytes, SMVP_PANEL_ALIGN);
+        }
+    }
+    if (row != P->header.rows || nnz != P->header.nnz)
+    {
+        return SMVP_ERR_FORMAT;
+    }
+    P->bufferBytes = (maxBytes > 0) ? maxBytes : SMVP_PANEL_ALIGN;
+    return SMVP_SUCCESS;
+}
+
+// Function: smvp_panels_open
+// Opens a panel file for streaming, bypassing the page cache with O_DIRECT where the file system allows it
+int smvp_panels_open(smvp_panels_t **P, const char *path)
+{
+    smvp_panels_t *panels;
+    struct stat info;
+    int status;
+
+    if (P == NULL || path == NULL)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    *P = NULL;
+    if ((panels = (smvp_panels_t *)calloc(1, sizeof(*panels))) == NULL)
+    {
+        return SMVP_ERR_ALLOC;
+    }
+
+    // tmpfs and some network file systems refuse O_DIRECT at open() or at the first read
+    panels->direct = 1;
+    if ((panels->fd = open(path, O_RDONLY | O_DIRECT)) < 0)
+    {
+        panels->direct = 0;
+        panels->fd = open(path, O_RDONLY);
+    }
+    if (panels->fd < 0 || fstat(panels->fd, &info) != 0)
+    {
+        smvp_panels_close(panels);
+        return SMVP_ERR_SYSTEM;
+    }
+    status = loadIndex(panels, (int64_t)info.st_size);
+    if (status == SMVP_ERR_SYSTEM && panels->direct && errno == EINVAL)
+    {
+        close(panels->fd);
+        free(panels->index);
+        panels->index = NULL;
+        panels->direct = 0;
+        panels->fd = open(path, O_RDONLY);
+        status = (panels->fd < 0) ? SMVP_ERR_SYSTEM : loadIndex(panels, (int64_t)info.st_size);
+    }
+    if (status != SMVP_SUCCESS)
+    {
+        smvp_panels_close(panels);
+        return status;
+    }
+    if (!panels->direct)
+    {
+        posix_fadvise(panels->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    if (posix_memalign((void **)&panels->buffer[0], SMVP_PANEL_ALIGN, panels->bufferBytes) != 0 ||
+        posix_memalign((void **)&panels->buffer[1], SMVP_PANEL_ALIGN, panels->bufferBytes) != 0)
+    {
+        smvp_panels_close(panels);
+        return SMVP_ERR_ALLOC;
+    }
+
+    *P = panels;
+    return SMVP_SUCCESS;
+}
+
+// Function: smvp_panels_header
+// Copies out the file header and the size of one streaming buffer (two are held)
+int smvp_panels_header(const smvp_panels_t *P, smvp_panel_header_t *header, size_t *max_panel_bytes)
+{
+    if (P == NULL)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    if (header != NULL)
+    {
+        *header = P->header;
+    }
+    if (max_panel_bytes != NULL)
+    {
+        *max_panel_bytes = P->bufferBytes;
+    }
+    return SMVP_SUCCESS;
+}
+
+// Function: streamReader
+// I/O thread: reads every panel in order into whichever buffer the kernel has released
+static void *streamReader(void *arg)
+{
+    StreamState *state = (StreamState *)arg;
+    smvp_panels_t *P = state->P;
+    const smvp_panel_entry_t *entry;
+    double start;
+    int panel, slot, failed;
+
+    for (panel = 0; panel < P->header.npanels; panel++)
+    {
+        slot = panel & 1;
+        entry = &P->index[panel];
+
+        pthread_mutex_lock(&state->lock);
+        while (state->slot[slot] != -1)
+        {
+            pthread_cond_wait(&state->changed, &state->lock);
+        }
+        pthread_mutex_unlock(&state->lock);
+
+        // Whole aligned blocks so O_DIRECT accepts the request, the file is padded to match
+        start = nowSeconds();
+        failed = readAll(P->fd, P->buffer[slot], PANEL_ALIGN_UP(entry->bytes, SMVP_PANEL_ALIGN), entry->offset);
+        state->ioSeconds += nowSeconds() - start;
+        state->bytesRead += (size_t)entry->bytes;
+
+        pthread_mutex_lock(&state->lock);
+        if (failed)
+        {
+            state->failed = 1;
+            state->error = errno;
+        }
+        else
+        {
+            state->slot[slot] = panel;
+        }
+        pthread_cond_broadcast(&state->changed);
+        pthread_mutex_unlock(&state->lock);
+        if (failed)
+        {
+            break;
+        }
+    }
+    return NULL;
+}
+
+// Function: panelRows
+// CSR kernel over the rows of one buffered panel
+static void panelRows(const char *panel, const smvp_panel_entry_t *entry, double alpha, const double *x, double beta, double *y)
+{
+    const int *ptr = (const int *)panel;
+    const int *ind = (const int *)(panel + panelColOffset(entry->nrows));
+    const double *val = (const double *)(panel + panelValOffset(entry->nrows, entry->nnz));
+    double sum;
+    int index, j;
+
+    for (index = 0; index < entry->nrows; index++)
+    {
+        sum = 0.0;
+        for (j = ptr[index]; j < ptr[index + 1]; j++)
+        {
+            sum += val[j] * x[ind[j]];
+        }
+        y[index] = (beta == 0.0) ? alpha * sum : alpha * sum + beta * y[index];
+    }
+}
+
+// Function: smvp_panels_multiply
+// y = alpha*A*x + beta*y, reading the file once while the previous panel is being multiplied
+int smvp_panels_multiply(smvp_panels_t *P, double alpha, const double x[], double beta, double y[], smvp_stream_stats_t *stats)
+{
+    StreamState state;
+    pthread_t reader;
+    const smvp_panel_entry_t *entry;
+    double wallStart, start, computeSeconds = 0, stallSeconds = 0;
+    int panel, slot, failed = 0;
+
+    if (P == NULL || (P->header.cols > 0 && x == NULL) || (P->header.rows > 0 && y == NULL))
+    {
+        return SMVP_ERR_INVALID;
+    }
+
+    // Without O_DIRECT, drop the file from the page cache so every pass measures the device
+    if (!P->direct)
+    {
+        posix_fadvise(P->fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+
+    memset(&state, 0, sizeof(state));
+    state.P = P;
+    state.slot[0] = -1;
+    state.slot[1] = -1;
+    pthread_mutex_init(&state.lock, NULL);
+    pthread_cond_init(&state.changed, NULL);
+
+    wallStart = nowSeconds();
+    if (pthread_create(&reader, NULL, streamReader, &state) != 0)
+    {
+        pthread_cond_destroy(&state.changed);
+        pthread_mutex_destroy(&state.lock);
+        return SMVP_ERR_SYSTEM;
+    }
+
+    for (panel = 0; panel < P->header.npanels; panel++)
+    {
+        slot = panel & 1;
+        entry = &P->index[panel];
+
+        start = nowSeconds();
+        pthread_mutex_lock(&state.lock);
+        while (state.slot[slot] != panel && !state.failed)
+        {
+            pthread_cond_wait(&state.changed, &state.lock);
+        }
+        failed = (state.slot[slot] != panel);
+        pthread_mutex_unlock(&state.lock);
+        stallSeconds += nowSeconds() - start;
+        if (failed)
+        {
+            break;
+        }
+
+        start = nowSeconds();
+        panelRows(P->buffer[slot], entry, alpha, x, beta, y + entry->first_row);
+        computeSeconds += nowSeconds() - start;
+
+        pthread_mutex_lock(&state.lock);
+        state.slot[slot] = -1;
+        pthread_cond_broadcast(&state.changed);
+        pthread_mutex_unlock(&state.lock);
+    }
+
+    pthread_join(reader, NULL);
+    pthread_cond_destroy(&state.changed);
+    pthread_mutex_destroy(&state.lock);
+
+    if (stats != NULL)
+    {
+        stats->panels = P->header.npanels;
+        stats->direct = P->direct;
+        stats->bytes_read = state.bytesRead;
+        stats->io_seconds = state.ioSeconds;
+        stats->compute_seconds = computeSeconds;
+        stats->stall_seconds = stallSeconds;
+        stats->wall_seconds = nowSeconds() - wallStart;
+    }
+    if (failed)
+    {
+        errno = state.error;
+        return SMVP_ERR_SYSTEM;
+    }
+    return SMVP_SUCCESS;
+}
+
+// Function: smvp_panels_close
+// Closes a panel file and frees its buffers
+void smvp_panels_close(smvp_panels_t *P)
+{
+    if (P == NULL)
+    {
+        return;
+    }
+    if (P->fd >= 0)
+    {
+        close(P->fd);
+    }
+    free(P->buffer[0]);
+    free(P->buffer[1]);
+    free(P->index);
+    free(P);
+}
@@ -0,0 +1,518 @@
+/*
+*  ==================================================================
+*  smvp-pool.c for smvp-toolbox
+*  Persistent worker pool, NUMA topology and cache sizes for the kernels
+*  ==================================================================
+*/
+
+// Required for sched_setaffinity() and CPU_* macros
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "smvp-internal.h"
+
+#define SMVP_MAX_NODES 64
+
+// Struct: _pool_worker_
+// Per-thread state, the worker index doubles as the partition index
+typedef struct _pool_worker_
+{
+    smvp_pool_t *pool;
+    pthread_t thread;
+    int tid;
+    int cpu;          // Pinned CPU, -1 when placement is off
+    int node;         // Index into pool->nodeId
+    int counterLocal; // perf fd counting node-local loads, -1 if unavailable
+    int counterRemote;
+} PoolWorker;
+
+// Struct: smvp_pool
+// Workers sleep between jobs; smvpPoolRun() publishes one job to the first n workers and waits for them,
+// smvpPoolRun2() publishes two back to back
+struct smvp_pool
+{
+    int nthreads;
+    int numa;   // SMVP_NUMA_* requested by the caller
+    int nnodes; // Nodes threads are spread across (1 disables placement)
+    int nodeId[SMVP_MAX_NODES];
+    PoolWorker *workers;
+    pthread_mutex_t runLock; // Serializes jobs from concurrent callers
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned long generation;
+    int active;
+    int pending;
+    int stop;
+    SmvpTask task;
+    void *arg;
+};
+
+// Function: parseCpuList
+// Parses a sysfs cpulist ("0-3,8-11") into a CPU set
+static void parseCpuList(const char *list, cpu_set_t *set)
+{
+    const char *cursor = list;
+    char *end;
+    long first, last, cpu;
+
+    CPU_ZERO(set);
+    while (*cursor != '\0' && *cursor != '\n')
+    {
+        first = strtol(cursor, &end, 10);
+        if (end == cursor)
+        {
+            break;
+        }
+        last = first;
+        if (*end == '-')
+        {
+            cursor = end + 1;
+            last = strtol(cursor, &end, 10);
+        }
+        for (cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+        {
+            CPU_SET(cpu, set);
+        }
+        cursor = (*end == ',') ? end + 1 : end;
+    }
+}
+
+// Function: readTopology
+// Groups the CPUs this process may run on by NUMA node using /sys/devices/system/node
+// Returns the number of nodes with at least one usable CPU (1 when sysfs is unavailable)
+static int readTopology(int nodeId[], cpu_set_t nodeCpus[])
+{
+    char path[96], list[4096];
+    cpu_set_t allowed;
+    FILE *file;
+    int node, nnodes = 0;
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        return 1;
+    }
+
+    for (node = 0; node < 1024 && nnodes < SMVP_MAX_NODES; node++)
+    {
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        if ((file = fopen(path, "r")) == NULL)
+        {
+            continue;
+        }
+        if (fgets(list, sizeof(list), file) != NULL)
+        {
+            parseCpuList(list, &nodeCpus[nnodes]);
+            CPU_AND(&nodeCpus[nnodes], &nodeCpus[nnodes], &allowed);
+            if (CPU_COUNT(&nodeCpus[nnodes]) > 0)
+            {
+                nodeId[nnodes++] = node;
+            }
+        }
+        fclose(file);
+    }
+
+    if (nnodes == 0)
+    {
+        nodeId[0] = 0;
+        nnodes = 1;
+    }
+
+    return nnodes;
+}
+
+// Function: readCacheField
+// Reads the first line of one attribute of /sys/devices/system/cpu/cpu0/cache/index<index>, newline stripped
+static int readCacheField(int index, const char *field, char *value, size_t len)
+{
+    char path[96];
+    FILE *file;
+    int found;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/%s", index, field);
+    if ((file = fopen(path, "r")) == NULL)
+    {
+        return 0;
+    }
+    found = (fgets(value, (int)len, file) != NULL);
+    fclose(file);
+    value[strcspn(value, "\n")] = '\0';
+    return found;
+}
+
+// Function: smvp_cache_size
+// Size of the level-N data or unified cache of the first CPU, as reported by sysfs ("48K", "2048K", "32M")
+// Returns SMVP_ERR_SYSTEM when the level is not reported (no sysfs, or no such cache)
+int smvp_cache_size(int level, size_t *bytes)
+{
+    char value[64], *unit;
+    unsigned long size;
+    int index;
+
+    if (bytes == NULL || level < 1)
+    {
+        return SMVP_ERR_INVALID;
+    }
+
+    for (index = 0; index < 16; index++)
+    {
+        if (!readCacheField(index, "level", value, sizeof(value)))
+        {
+            break;
+        }
+        if (atoi(value) != level || !readCacheField(index, "type", value, sizeof(value)) || strcmp(value, "Instruction") == 0 ||
+            !readCacheField(index, "size", value, sizeof(value)))
+        {
+            continue;
+        }
+        size = strtoul(value, &unit, 10);
+        size <<= (*unit == 'K') ? 10 : (*unit == 'M') ? 20 : (*unit == 'G') ? 30 : 0;
+        if (size > 0)
+        {
+            *bytes = (size_t)size;
+            return SMVP_SUCCESS;
+        }
+    }
+
+    return SMVP_ERR_SYSTEM;
+}
+
+// Function: openNodeCounter
+// Opens a per-thread hardware counter for node loads (result = ACCESS or MISS), -1 if unavailable
+static int openNodeCounter(int result)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_NODE | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (result << 16);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// Function: poolWorkerMain
+// Pins the worker (when placing), opens its counters, then runs published jobs until the pool stops
+static void *poolWorkerMain(void *arg)
+{
+    PoolWorker *worker = (PoolWorker *)arg;
+    smvp_pool_t *pool = worker->pool;
+    unsigned long seen = 0;
+    cpu_set_t set;
+
+    if (worker->cpu >= 0)
+    {
+        CPU_ZERO(&set);
+        CPU_SET(worker->cpu, &set);
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+    if (pool->nnodes > 1)
+    {
+        worker->counterLocal = openNodeCounter(PERF_COUNT_HW_CACHE_RESULT_ACCESS);
+        worker->counterRemote = openNodeCounter(PERF_COUNT_HW_CACHE_RESULT_MISS);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (pool->generation == seen && !pool->stop)
+        {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->stop)
+        {
+            break;
+        }
+        seen = pool->generation;
+        if (worker->tid >= pool->active)
+        {
+            continue;
+        }
+
+        pthread_mutex_unlock(&pool->lock);
+        pool->task(pool->arg, worker->tid, pool->active);
+        pthread_mutex_lock(&pool->lock);
+
+        if (--pool->pending == 0)
+        {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+// Function: smvp_pool_create
+// Starts nthreads workers. With SMVP_NUMA_AUTO/REPLICATE on a multi-node machine, contiguous ranges
+// of workers are pinned to each node so row partitions, and the memory they first touch, stay per node.
+// On a single node the NUMA mode is ignored and workers are left to the scheduler.
+int smvp_pool_create(smvp_pool_t **pool, int nthreads, int numa)
+{
+    cpu_set_t nodeCpus[SMVP_MAX_NODES];
+    smvp_pool_t *created;
+    PoolWorker *worker;
+    int index, node, nth, cpu, seen;
+
+    if (pool == NULL || nthreads < 1 || numa < SMVP_NUMA_OFF || numa > SMVP_NUMA_REPLICATE)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    if ((created = (smvp_pool_t *)calloc(1, sizeof(smvp_pool_t))) == NULL)
+    {
+        return SMVP_ERR_ALLOC;
+    }
+    if ((created->workers = (PoolWorker *)calloc((size_t)nthreads, sizeof(PoolWorker))) == NULL)
+    {
+        free(created);
+        return SMVP_ERR_ALLOC;
+    }
+
+    created->nthreads = nthreads;
+    created->numa = numa;
+    created->nnodes = 1;
+    created->nodeId[0] = 0;
+    if (numa != SMVP_NUMA_OFF)
+    {
+        created->nnodes = readTopology(created->nodeId, nodeCpus);
+    }
+    pthread_mutex_init(&created->runLock, NULL);
+    pthread_mutex_init(&created->lock, NULL);
+    pthread_cond_init(&created->start, NULL);
+    pthread_cond_init(&created->done, NULL);
+
+    for (index = 0; index < nthreads; index++)
+    {
+        worker = &created->workers[index];
+        worker->pool = created;
+        worker->tid = index;
+        worker->cpu = -1;
+        worker->node = 0;
+        worker->counterLocal = -1;
+        worker->counterRemote = -1;
+
+        if (created->nnodes > 1)
+        {
+            // Workers [node * n / nnodes, (node + 1) * n / nnodes) share a node, round robin over its CPUs
+            node = (int)((long)index * created->nnodes / nthreads);
+            nth = index - (int)(((long)node * nthreads + created->nnodes - 1) / created->nnodes);
+            nth %= CPU_COUNT(&nodeCpus[node]);
+            for (cpu = 0, seen = -1; cpu < CPU_SETSIZE; cpu++)
+            {
+                if (CPU_ISSET(cpu, &nodeCpus[node]) && ++seen == nth)
+                {
+                    break;
+                }
+            }
+            worker->node = node;
+            worker->cpu = cpu;
+        }
+    }
+
+    for (index = 0; index < nthreads; index++)
+    {
+        if (pthread_create(&created->workers[index].thread, NULL, poolWorkerMain, &created->workers[index]) != 0)
+        {
+            created->nthreads = index;
+            smvp_pool_destroy(created);
+            return SMVP_ERR_SYSTEM;
+        }
+    }
+
+    *pool = created;
+    return SMVP_SUCCESS;
+}
+
+// Function: smvp_pool_destroy
+// Stops and joins every worker
+void smvp_pool_destroy(smvp_pool_t *pool)
+{
+    int index;
+
+    if (pool == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (index = 0; index < pool->nthreads; index++)
+    {
+        pthread_join(pool->workers[index].thread, NULL);
+        if (pool->workers[index].counterLocal >= 0)
+        {
+            close(pool->workers[index].counterLocal);
+        }
+        if (pool->workers[index].counterRemote >= 0)
+        {
+            close(pool->workers[index].counterRemote);
+        }
+    }
+
+    pthread_mutex_destroy(&pool->runLock);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    free(pool->workers);
+    free(pool);
+}
+
+// Function: smvp_pool_size
+// Number of workers in the pool
+int smvp_pool_size(const smvp_pool_t *pool)
+{
+    return (pool == NULL) ? 0 : pool->nthreads;
+}
+
+// Function: smvp_pool_pin
+// Pins every worker not already placed on a node to its own CPU, round robin over the process's allowed CPUs
+// starting at first_cpu (--stable), so pooled kernels run as undisturbed as the pinned compute thread
+int smvp_pool_pin(smvp_pool_t *pool, int first_cpu)
+{
+    cpu_set_t allowed, set;
+    int index, cpu, status = SMVP_SUCCESS;
+
+    if (pool == NULL || first_cpu < 0 || first_cpu >= CPU_SETSIZE)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0)
+    {
+        return SMVP_ERR_SYSTEM;
+    }
+
+    cpu = first_cpu;
+    for (index = 0; index < pool->nthreads; index++)
+    {
+        if (pool->workers[index].cpu >= 0)
+        {
+            continue;
+        }
+        while (!CPU_ISSET(cpu, &allowed))
+        {
+            cpu = (cpu + 1) % CPU_SETSIZE;
+        }
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (pthread_setaffinity_np(pool->workers[index].thread, sizeof(set), &set) != 0)
+        {
+            status = SMVP_ERR_SYSTEM;
+        }
+        cpu = (cpu + 1) % CPU_SETSIZE;
+    }
+
+    return status;
+}
+
+// Function: smvp_pool_counters
+// Sums node-local and remote load counts over every worker since the pool started
+// Returns SMVP_ERR_SYSTEM when no worker could open the hardware counters (single node, VMs, perf_event_paranoid)
+int smvp_pool_counters(const smvp_pool_t *pool, long long *local, long long *remote)
+{
+    long long access, miss;
+    int index, valid = 0;
+
+    if (pool == NULL || local == NULL || remote == NULL)
+    {
+        return SMVP_ERR_INVALID;
+    }
+
+    *local = 0;
+    *remote = 0;
+    for (index = 0; index < pool->nthreads; index++)
+    {
+        if (pool->workers[index].counterLocal < 0 || pool->workers[index].counterRemote < 0)
+        {
+            continue;
+        }
+        if (read(pool->workers[index].counterLocal, &access, sizeof(access)) == sizeof(access) &&
+            read(pool->workers[index].counterRemote, &miss, sizeof(miss)) == sizeof(miss))
+        {
+            // The NODE cache event counts all node loads as accesses and remote ones as misses
+            *local += access - miss;
+            *remote += miss;
+            valid = 1;
+        }
+    }
+
+    return valid ? SMVP_SUCCESS : SMVP_ERR_SYSTEM;
+}
+
+// Function: poolDispatch
+// Publishes one job to workers 0..nthreads-1 and waits for all of them, the caller holds runLock
+static void poolDispatch(smvp_pool_t *pool, int nthreads, SmvpTask task, void *arg)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->arg = arg;
+    pool->active = nthreads;
+    pool->pending = nthreads;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    while (pool->pending > 0)
+    {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Function: smvpPoolRun
+// Runs task(arg, tid, nthreads) on workers 0..nthreads-1 and returns when all of them finished
+void smvpPoolRun(smvp_pool_t *pool, int nthreads, SmvpTask task, void *arg)
+{
+    pthread_mutex_lock(&pool->runLock);
+    poolDispatch(pool, nthreads, task, arg);
+    pthread_mutex_unlock(&pool->runLock);
+}
+
+// Function: smvpPoolRun2
+// Runs first, then second, on workers 0..nthreads-1 as one job: every worker has finished first before any starts
+// second, and no other caller's job runs in between, so second may read what first left in shared scratch
+void smvpPoolRun2(smvp_pool_t *pool, int nthreads, SmvpTask first, SmvpTask second, void *arg)
+{
+    pthread_mutex_lock(&pool->runLock);
+    poolDispatch(pool, nthreads, first, arg);
+    poolDispatch(pool, nthreads, second, arg);
+    pthread_mutex_unlock(&pool->runLock);
+}
+
+// Function: smvpPoolNodes
+// Number of nodes workers are placed on, 1 means placement is off
+int smvpPoolNodes(const smvp_pool_t *pool)
+{
+    return pool->nnodes;
+}
+
+// Function: smvpPoolNuma
+// SMVP_NUMA_* mode requested at creation
+int smvpPoolNuma(const smvp_pool_t *pool)
+{
+    return pool->numa;
+}
+
+// Function: smvpPoolWorkerNode
+// Node index (0..nodes-1) of a worker
+int smvpPoolWorkerNode(const smvp_pool_t *pool, int tid)
+{
+    return pool->workers[tid].node;
+}
+
+// Function: smvpPoolNodeId
+// Operating system id of a node index, as reported by move_pages()
+int smvpPoolNodeId(const smvp_pool_t *pool, int node)
+{
+    return pool->nodeId[node];
+}
@@ -0,0 +1,2362 @@
+/* 
+*  ==================================================================
+*  smvp.c for smvp-toolbox
+*  Matrix handle, format conversion and SMVP kernels
+*  ==================================================================
+*/
+
+// Required for SYS_move_pages
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "smvp-internal.h"
+
+// Function: matrixAlloc
+// Allocates an array owned by a matrix handle and accounts for it
+static void *matrixAlloc(smvp_matrix_t *A, size_t len)
+{
+    void *ptr = smvp_alloc(len, A->opts.hugepages);
+
+    if (ptr != NULL)
+    {
+        A->bytes += len;
+        if (A->bytes > A->bytes_peak)
+        {
+            A->bytes_peak = A->bytes;
+        }
+    }
+
+    return ptr;
+}
+
+// Function: matrixRelease
+// Frees an array owned by a matrix handle
+static void matrixRelease(smvp_matrix_t *A, void *ptr)
+{
+    if (ptr != NULL)
+    {
+        A->bytes -= smvpAllocSize(ptr);
+        smvp_free(ptr);
+    }
+}
+
+
+// Distances a prefetch tuning pass tries after the plain kernel, see smvp_tune_prefetch()
+static const int prefetchDistances[] = {8, 16, 32, 64, 128, 256, 512};
+
+// Timed rounds over all candidates, the batch length each candidate is timed for, and the gain a distance
+// needs over the plain kernel to be kept (smaller differences are within the run-to-run noise)
+#define PREFETCH_TUNE_ROUNDS 3
+#define PREFETCH_TUNE_SECONDS 0.002
+#define PREFETCH_TUNE_MIN_GAIN 1.02
+
+// Function: acsrStore
+// Writes one finished row of an adaptive CSR multiply
+static inline void acsrStore(double *y, int row, double sum, double alpha, double beta)
+{
+    y[row] = (beta == 0.0) ? alpha * sum : alpha * sum + beta * y[row];
+}
+
+// Offset-width dependent conversions and kernels, one instance per width
+#define SMVP_WIDTH_PASTE(name, bits) name##bits
+#define SMVP_WIDTH_NAME(name, bits) SMVP_WIDTH_PASTE(name, bits)
+
+#define SMVP_OFFSET int32_t
+#define SMVP_WIDTH(name) SMVP_WIDTH_NAME(name, 32)
+#include "smvp-width.inc"
+#undef SMVP_OFFSET
+#undef SMVP_WIDTH
+
+#define SMVP_OFFSET int64_t
+#define SMVP_WIDTH(name) SMVP_WIDTH_NAME(name, 64)
+#include "smvp-width.inc"
+#undef SMVP_OFFSET
+#undef SMVP_WIDTH
+
+// Function: offsetsAlloc
+// Allocates an offset array of len entries with the matrix's index width, both pointers stay NULL on failure
+static SmvpOffsets offsetsAlloc(smvp_matrix_t *A, size_t len)
+{
+    SmvpOffsets offsets = {NULL, NULL};
+
+    if (A->index_bits == 64)
+    {
+        offsets.i64 = (int64_t *)matrixAlloc(A, sizeof(int64_t) * len);
+    }
+    else
+    {
+        offsets.i32 = (int32_t *)matrixAlloc(A, sizeof(int32_t) * len);
+    }
+
+    return offsets;
+}
+
+// Function: offsetsData
+// Returns the array behind an offset array of either width (NULL if none is allocated)
+static void *offsetsData(SmvpOffsets offsets)
+{
+    return (offsets.i64 != NULL) ? (void *)offsets.i64 : (void *)offsets.i32;
+}
+
+// Function: offsetsRelease
+// Frees an offset array owned by a matrix handle
+static void offsetsRelease(smvp_matrix_t *A, SmvpOffsets offsets)
+{
+    matrixRelease(A, offsetsData(offsets));
+}
+
+// Function: transposeCompressed
+// Transposes CSR <-> CSC between offset arrays of the same width
+static void transposeCompressed(int nOuter, int nInner, SmvpOffsets ptr, const int *ind, const double *val, SmvpOffsets outPtr, int *outInd, double *outVal)
+{
+    if (ptr.i64 != NULL)
+    {
+        transposeCompressed64(nOuter, nInner, ptr.i64, ind, val, outPtr.i64, outInd, outVal);
+    }
+    else
+    {
+        transposeCompressed32(nOuter, nInner, ptr.i32, ind, val, outPtr.i32, outInd, outVal);
+    }
+}
+
+// Function: smvp_options_init
+// Fills handle options with the library defaults
+void smvp_options_init(smvp_options_t *opts)
+{
+    opts->hugepages = SMVP_HUGE_NONE;
+    opts->index_limit = SMVP_INDEX_LIMIT_DEFAULT;
+    opts->acsr_split = SMVP_ACSR_SPLIT_DEFAULT;
+    opts->tile_level = SMVP_TILE_LEVEL_DEFAULT;
+    opts->tile_cols = 0;
+    opts->transpose_mode = SMVP_TRANSPOSE_AUTO;
+}
+
+// Function: optionsClamp
+// Copies caller options (NULL = defaults) into a handle, replacing out-of-range fields
+// Lowering index_limit exercises the 64-bit kernels on small matrices; acsr_split stays at least 65 so only
+// rows of the long bin are split
+static void optionsClamp(smvp_options_t *dest, const smvp_options_t *opts)
+{
+    smvp_options_init(dest);
+    if (opts == NULL)
+    {
+        return;
+    }
+    if (opts->hugepages >= SMVP_HUGE_NONE && opts->hugepages <= SMVP_HUGE_EXPLICIT)
+    {
+        dest->hugepages = opts->hugepages;
+    }
+    dest->index_limit = (opts->index_limit < 0) ? 0 : (opts->index_limit > SMVP_INDEX_LIMIT_DEFAULT) ? SMVP_INDEX_LIMIT_DEFAULT : opts->index_limit;
+    dest->acsr_split = (opts->acsr_split < 65) ? 65 : opts->acsr_split;
+    if (opts->tile_level >= 1)
+    {
+        dest->tile_level = opts->tile_level;
+    }
+    dest->tile_cols = (opts->tile_cols < 0) ? 0 : opts->tile_cols;
+    if (opts->transpose_mode >= SMVP_TRANSPOSE_AUTO && opts->transpose_mode <= SMVP_TRANSPOSE_OWNER)
+    {
+        dest->transpose_mode = opts->transpose_mode;
+    }
+}
+
+// Function: matrixNew
+// Allocates an empty handle with room for the canonical CSR arrays, picking the index width from nnz
+static int matrixNew(smvp_matrix_t **A, int rows, int cols, int64_t nnz, const smvp_options_t *opts)
+{
+    smvp_matrix_t *matrix;
+
+    if (A == NULL || rows < 0 || cols < 0 || nnz < 0)
+    {
+        return SMVP_ERR_INVALID;
+    }
+
+    matrix = (smvp_matrix_t *)calloc(1, sizeof(smvp_matrix_t));
+    if (matrix == NULL)
+    {
+        return SMVP_ERR_ALLOC;
+    }
+    matrix->rows = rows;
+    matrix->cols = cols;
+    matrix->nnz = nnz;
+    optionsClamp(&matrix->opts, opts);
+    matrix->index_bits = (nnz > matrix->opts.index_limit) ? 64 : 32;
+    matrix->formats = SMVP_FORMAT_CSR;
+
+    matrix->csr.row_ptr = offsetsAlloc(matrix, (size_t)rows + 1);
+    matrix->csr.col_ind = (int *)matrixAlloc(matrix, sizeof(int) * (size_t)nnz);
+    matrix->csr.val = (double *)matrixAlloc(matrix, sizeof(double) * (size_t)nnz);
+    if (offsetsData(matrix->csr.row_ptr) == NULL || matrix->csr.col_ind == NULL || matrix->csr.val == NULL)
+    {
+        smvp_destroy(matrix);
+        return SMVP_ERR_ALLOC;
+    }
+
+    *A = matrix;
+    return SMVP_SUCCESS;
+}
+
+// Function: smvp_create_coo
+// Creates a matrix handle from unsorted 0-based coordinate data (copied, caller keeps ownership)
+// Sorting is done by two O(nnz) transposes (COO -> column buckets -> CSR) instead of a comparison sort
+int smvp_create_coo(smvp_matrix_t **A, int rows, int cols, int64_t nnz, const int row[], const int col[], const double val[],
+                    const smvp_options_t *opts)
+{
+    smvp_matrix_t *matrix;
+    SmvpOffsets bucketPtr;
+    int *bucketRow;
+    double *bucketVal;
+    int64_t index;
+    int status;
+
+    for (index = 0; index < nnz; index++)
+    {
+        if (row[index] < 0 || row[index] >= rows || col[index] < 0 || col[index] >= cols)
+        {
+            return SMVP_ERR_INVALID;
+        }
+    }
+
+    if ((status = matrixNew(&matrix, rows, cols, nnz, opts)) != SMVP_SUCCESS)
+    {
+        return status;
+    }
+
+    // 1. Bucket the entries by column (input order is preserved within each column)
+    bucketPtr = offsetsAlloc(matrix, (size_t)cols + 1);
+    bucketRow = (int *)matrixAlloc(matrix, sizeof(int) * (size_t)nnz);
+    bucketVal = (double *)matrixAlloc(matrix, sizeof(double) * (size_t)nnz);
+    if (offsetsData(bucketPtr) == NULL || bucketRow == NULL || bucketVal == NULL)
+    {
+        offsetsRelease(matrix, bucketPtr);
+        matrixRelease(matrix, bucketRow);
+        matrixRelease(matrix, bucketVal);
+        smvp_destroy(matrix);
+        return SMVP_ERR_ALLOC;
+    }
+    if (bucketPtr.i64 != NULL)
+    {
+        bucketCoo64(cols, nnz, row, col, val, bucketPtr.i64, bucketRow, bucketVal);
+    }
+    else
+    {
+        bucketCoo32(cols, nnz, row, col, val, bucketPtr.i32, bucketRow, bucketVal);
+    }
+
+    // 2. Transposing the column buckets yields rows whose column indices are already ascending
+    transposeCompressed(cols, rows, bucketPtr, bucketRow, bucketVal, matrix->csr.row_ptr, matrix->csr.col_ind, matrix->csr.val);
+
+    matrixRelease(matrix, bucketVal);
+    matrixRelease(matrix, bucketRow);
+    offsetsRelease(matrix, bucketPtr);
+
+    *A = matrix;
+    return SMVP_SUCCESS;
+}
+
+// Function: createCSR
+// Shared body of smvp_create_csr() and smvp_create_csr64(), rowPtr is only read
+// The arrays are copied as given and rows with unsorted column indices are then canonicalized in place
+// with a transpose round trip, so both steps run at the handle's own index width
+static int createCSR(smvp_matrix_t **A, int rows, int cols, SmvpOffsets rowPtr, const int col_ind[], const double val[],
+                     const smvp_options_t *opts)
+{
+    smvp_matrix_t *matrix;
+    CSCData tmp;
+    int64_t j, start, end;
+    int index, sorted = 1, status;
+
+    if (offsetsData(rowPtr) == NULL || rows < 0 || offsetAt(rowPtr, 0) != 0)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    for (index = 0, end = 0; index < rows; index++)
+    {
+        start = end;
+        end = offsetAt(rowPtr, index + 1);
+        if (end < start)
+        {
+            return SMVP_ERR_INVALID;
+        }
+        for (j = start; j < end; j++)
+        {
+            if (col_ind[j] < 0 || col_ind[j] >= cols)
+            {
+                return SMVP_ERR_INVALID;
+            }
+            if (j > start && col_ind[j] < col_ind[j - 1])
+            {
+                sorted = 0;
+            }
+        }
+    }
+
+    if ((status = matrixNew(&matrix, rows, cols, offsetAt(rowPtr, rows), opts)) != SMVP_SUCCESS)
+    {
+        return status;
+    }
+
+    for (index = 0; index <= rows; index++)
+    {
+        offsetSet(matrix->csr.row_ptr, index, offsetAt(rowPtr, index));
+    }
+    memcpy(matrix->csr.col_ind, col_ind, sizeof(int) * (size_t)matrix->nnz);
+    for (j = 0; j < matrix->nnz; j++)
+    {
+        matrix->csr.val[j] = (val != NULL) ? val[j] : 1.0;
+    }
+
+    if (!sorted)
+    {
+        tmp.col_ptr = offsetsAlloc(matrix, (size_t)cols + 1);
+        tmp.row_ind = (int *)matrixAlloc(matrix, sizeof(int) * (size_t)matrix->nnz);
+        tmp.val = (double *)matrixAlloc(matrix, sizeof(double) * (size_t)matrix->nnz);
+        if (offsetsData(tmp.col_ptr) == NULL || tmp.row_ind == NULL || tmp.val == NULL)
+        {
+            offsetsRelease(matrix, tmp.col_ptr);
+            matrixRelease(matrix, tmp.row_ind);
+            matrixRelease(matrix, tmp.val);
+            smvp_destroy(matrix);
+            return SMVP_ERR_ALLOC;
+        }
+        transposeCompressed(rows, cols, matrix->csr.row_ptr, matrix->csr.col_ind, matrix->csr.val, tmp.col_ptr, tmp.row_ind, tmp.val);
+        transposeCompressed(cols, rows, tmp.col_ptr, tmp.row_ind, tmp.val, matrix->csr.row_ptr, matrix->csr.col_ind, matrix->csr.val);
+        offsetsRelease(matrix, tmp.col_ptr);
+        matrixRelease(matrix, tmp.row_ind);
+        matrixRelease(matrix, tmp.val);
+    }
+
+    *A = matrix;
+    return SMVP_SUCCESS;
+}
+
+// Function: smvp_create_csr
+// Creates a matrix handle from 0-based CSR arrays with 32-bit row pointers (copied, caller keeps ownership)
+// Rows with unsorted column indices are canonicalized with a transpose round trip
+int smvp_create_csr(smvp_matrix_t **A, int rows, int cols, const int row_ptr[], const int col_ind[], const double val[],
+                    const smvp_options_t *opts)
+{
+    SmvpOffsets rowPtr = {(int32_t *)row_ptr, NULL};
+
+    return createCSR(A, rows, cols, rowPtr, col_ind, val, opts);
+}
+
+// Function: smvp_create_csr64
+// Creates a matrix handle from 0-based CSR arrays with 64-bit row pointers (copied, caller keeps ownership)
+// The handle still stores 32-bit offsets when the non-zeros fit under the index limit
+int smvp_create_csr64(smvp_matrix_t **A, int rows, int cols, const int64_t row_ptr[], const int col_ind[], const double val[],
+                      const smvp_options_t *opts)
+{
+    SmvpOffsets rowPtr = {NULL, (int64_t *)row_ptr};
+
+    return createCSR(A, rows, cols, rowPtr, col_ind, val, opts);
+}
+
+// Function: smvp_create_csr_fill
+// Creates a matrix handle from row pointers alone and returns its own column and value arrays
+// for the caller to fill in place (in-range columns, ascending within each row) before the
+// handle is analyzed or multiplied, so generated matrices never exist twice in memory
+int smvp_create_csr_fill(smvp_matrix_t **A, int rows, int cols, const int64_t row_ptr[], int **col_ind, double **val,
+                         const smvp_options_t *opts)
+{
+    smvp_matrix_t *matrix;
+    int index, status;
+
+    if (row_ptr == NULL || col_ind == NULL || val == NULL || rows < 0 || row_ptr[0] != 0)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    for (index = 0; index < rows; index++)
+    {
+        if (row_ptr[index + 1] < row_ptr[index])
+        {
+            return SMVP_ERR_INVALID;
+        }
+    }
+
+    if ((status = matrixNew(&matrix, rows, cols, row_ptr[rows], opts)) != SMVP_SUCCESS)
+    {
+        return status;
+    }
+    for (index = 0; index <= rows; index++)
+    {
+        offsetSet(matrix->csr.row_ptr, index, row_ptr[index]);
+    }
+    *col_ind = matrix->csr.col_ind;
+    *val = matrix->csr.val;
+
+    *A = matrix;
+    return SMVP_SUCCESS;
+}
+
+// Function: buildCSC
+// Derives CSC from the canonical CSR with one transpose
+static int buildCSC(smvp_matrix_t *A)
+{
+    A->csc.col_ptr = offsetsAlloc(A, (size_t)A->cols + 1);
+    A->csc.row_ind = (int *)matrixAlloc(A, sizeof(int) * (size_t)A->nnz);
+    A->csc.val = (double *)matrixAlloc(A, sizeof(double) * (size_t)A->nnz);
+    if (offsetsData(A->csc.col_ptr) == NULL || A->csc.row_ind == NULL || A->csc.val == NULL)
+    {
+        return SMVP_ERR_ALLOC;
+    }
+
+    transposeCompressed(A->rows, A->cols, A->csr.row_ptr, A->csr.col_ind, A->csr.val, A->csc.col_ptr, A->csc.row_ind, A->csc.val);
+    A->formats |= SMVP_FORMAT_CSC;
+
+    return SMVP_SUCCESS;
+}
+
+// Function: buildTJDS
+// Builds TJDS from a column-count pass straight into the final val/row_ind/start_pos arrays
+// The only scratch space is two ints per column (no CSC copy, no per-nonzero clone); uses CSC instead if it exists
+static int buildTJDS(smvp_matrix_t *A)
+{
+    TJDSData *tjds = &A->tjds;
+    int *colCount, *colRank;
+    int index, diag;
+    int64_t j, dest, running, diagLen, colStart;
+    size_t bytesBefore = A->bytes;
+    size_t peakBefore = A->bytes_peak;
+
+    // Measure the high-water mark of this conversion on its own
+    A->bytes_peak = bytesBefore;
+
+    // 1. Column lengths, and the longest one gives the number of transpose jagged diagonals
+    colCount = (int *)matrixAlloc(A, sizeof(int) * (size_t)A->cols);
+    colRank = (int *)matrixAlloc(A, sizeof(int) * (size_t)A->cols);
+    if ((colCount == NULL || colRank == NULL) && A->cols > 0)
+    {
+        matrixRelease(A, colCount);
+        matrixRelease(A, colRank);
+        return SMVP_ERR_ALLOC;
+    }
+    for (index = 0; index < A->cols; index++)
+    {
+        colCount[index] = 0;
+    }
+    for (j = 0; j < A->nnz; j++)
+    {
+        colCount[A->csr.col_ind[j]]++;
+    }
+    tjds->num_tjdiag = 0;
+    for (index = 0; index < A->cols; index++)
+    {
+        if (colCount[index] > tjds->num_tjdiag)
+        {
+            tjds->num_tjdiag = colCount[index];
+        }
+    }
+
+    // 2. Rank columns longest first (ties by original column) with a counting sort on length
+    // start_pos doubles as the length histogram: after the suffix sum, entry L is the first rank of length-L columns
+    tjds->start_pos = offsetsAlloc(A, (size_t)tjds->num_tjdiag + 1);
+    tjds->perm = (int *)matrixAlloc(A, sizeof(int) * (size_t)A->cols);
+    tjds->val = (double *)matrixAlloc(A, sizeof(double) * (size_t)A->nnz);
+    tjds->row_ind = (int *)matrixAlloc(A, sizeof(int) * (size_t)A->nnz);
+    if (offsetsData(tjds->start_pos) == NULL || tjds->perm == NULL || tjds->val == NULL || tjds->row_ind == NULL)
+    {
+        matrixRelease(A, colCount);
+        matrixRelease(A, colRank);
+        return SMVP_ERR_ALLOC;
+    }
+    for (diag = 0; diag <= tjds->num_tjdiag; diag++)
+    {
+        offsetSet(tjds->start_pos, diag, 0);
+    }
+    for (index = 0; index < A->cols; index++)
+    {
+        offsetSet(tjds->start_pos, colCount[index], offsetAt(tjds->start_pos, colCount[index]) + 1);
+    }
+    running = 0;
+    for (diag = tjds->num_tjdiag; diag >= 0; diag--)
+    {
+        diagLen = offsetAt(tjds->start_pos, diag);
+        offsetSet(tjds->start_pos, diag, running);
+        running += diagLen;
+    }
+    for (index = 0; index < A->cols; index++)
+    {
+        colRank[index] = (int)offsetAt(tjds->start_pos, colCount[index]);
+        offsetSet(tjds->start_pos, colCount[index], colRank[index] + 1);
+        tjds->perm[colRank[index]] = index;
+    }
+
+    // 3. Entry L now counts columns with length >= L, so diagonal k holds start_pos[k + 1] entries; prefix sum in place
+    running = 0;
+    for (diag = 0; diag < tjds->num_tjdiag; diag++)
+    {
+        diagLen = offsetAt(tjds->start_pos, diag + 1);
+        offsetSet(tjds->start_pos, diag, running);
+        running += diagLen;
+    }
+    offsetSet(tjds->start_pos, tjds->num_tjdiag, running);
+
+    // 4. The k-th entry of a column lands in diagonal k at the column's rank
+    if (A->formats & SMVP_FORMAT_CSC)
+    {
+        for (index = 0; index < A->cols; index++)
+        {
+            colStart = offsetAt(A->csc.col_ptr, index);
+            for (j = colStart; j < offsetAt(A->csc.col_ptr, index + 1); j++)
+            {
+                dest = offsetAt(tjds->start_pos, j - colStart) + colRank[index];
+                tjds->val[dest] = A->csc.val[j];
+                tjds->row_ind[dest] = A->csc.row_ind[j];
+            }
+        }
+    }
+    else
+    {
+        // Walking CSR in row order visits each column's entries top to bottom, colCount becomes the depth cursor
+        for (index = 0; index < A->cols; index++)
+        {
+            colCount[index] = 0;
+        }
+        for (index = 0; index < A->rows; index++)
+        {
+            for (j = offsetAt(A->csr.row_ptr, index); j < offsetAt(A->csr.row_ptr, index + 1); j++)
+            {
+                diag = colCount[A->csr.col_ind[j]]++;
+                dest = offsetAt(tjds->start_pos, diag) + colRank[A->csr.col_ind[j]];
+                tjds->val[dest] = A->csr.val[j];
+                tjds->row_ind[dest] = index;
+            }
+        }
+    }
+
+    matrixRelease(A, colRank);
+    matrixRelease(A, colCount);
+    A->formats |= SMVP_FORMAT_TJDS;
+
+    // Conversion peak is reported against the size of the finished format
+    A->tjds_build_peak = A->bytes_peak - bytesBefore;
+    A->tjds_bytes = sizeof(double) * (size_t)A->nnz + sizeof(int) * ((size_t)A->nnz + (size_t)A->cols) +
+                    (size_t)A->index_bits / 8 * ((size_t)tjds->num_tjdiag + 1);
+    if (peakBefore > A->bytes_peak)
+    {
+        A->bytes_peak = peakBefore;
+    }
+
+    return SMVP_SUCCESS;
+}
+
+// Function: acsrClassOf
+// Kernel class (ACSR_*) of a row with len non-zeros, rows of at least split non-zeros are split across the workers
+static int acsrClassOf(int64_t len, int split)
+{
+    if (len <= 4)
+    {
+        return (int)len; // ACSR_EMPTY to ACSR_LEN4
+    }
+    if (len <= 16)
+    {
+        return ACSR_MEDIUM;
+    }
+    if (len <= 64)
+    {
+        return ACSR_LARGE;
+    }
+    return (len >= split) ? ACSR_SPLIT : ACSR_LONG;
+}
+
+// Function: acsrSlice
+// Positions [first, last) in acsr.rows of the rows of class cls that worker tid of a bound matrix runs
+static void acsrSlice(const smvp_matrix_t *A, int cls, int tid, int *first, int *last)
+{
+    const int *bounds = A->acsr.part + (size_t)cls * (size_t)(A->nthreads + 1);
+
+    *first = bounds[tid];
+    *last = bounds[tid + 1];
+}
+
+// Function: acsrPartials
+// (Re)computes the per-worker slices of every class and sizes the partial sums of the split rows to the bound
+// worker count, none when serial. Slice t of a class starts at the first row whose prefix of the class's
+// non-zeros reaches t/nthreads of them (rows for the empty class), as A->part does for CSR, so a class mixing
+// 65 and 4000 non-zero rows does not leave one worker with most of its work. Worker t writes the contiguous
+// block partial[t * splitRows ...] of the partial sums, so no two workers share a cache line
+static int acsrPartials(smvp_matrix_t *A)
+{
+    const ACSRData *acsr = &A->acsr;
+    int *bounds, cls, index, worker, splitRows, nthreads = A->nthreads;
+    int64_t sum, total, len;
+
+    matrixRelease(A, A->acsr.partial);
+    matrixRelease(A, A->acsr.part);
+    A->acsr.partial = NULL;
+    A->acsr.part = NULL;
+    if (!(A->formats & SMVP_FORMAT_ACSR) || A->pool == NULL)
+    {
+        return SMVP_SUCCESS;
+    }
+    if ((A->acsr.part = (int *)matrixAlloc(A, sizeof(int) * ACSR_CLASSES * (size_t)(nthreads + 1))) == NULL)
+    {
+        return SMVP_ERR_ALLOC;
+    }
+    for (cls = 0; cls < ACSR_CLASSES; cls++)
+    {
+        bounds = A->acsr.part + (size_t)cls * (size_t)(nthreads + 1);
+        total = (cls == ACSR_EMPTY) ? acsr->start[cls + 1] - acsr->start[cls] : acsr->nnz[cls];
+        bounds[0] = acsr->start[cls];
+        worker = 1;
+        sum = 0;
+        for (index = acsr->start[cls]; index < acsr->start[cls + 1]; index++)
+        {
+            while (worker < nthreads && sum >= total * worker / nthreads)
+            {
+                bounds[worker++] = index;
+            }
+            len = offsetAt(A->csr.row_ptr, acsr->rows[index] + 1) - offsetAt(A->csr.row_ptr, acsr->rows[index]);
+            sum += (cls == ACSR_EMPTY) ? 1 : len;
+        }
+        while (worker <= nthreads)
+        {
+            bounds[worker++] = acsr->start[cls + 1];
+        }
+    }
+
+    splitRows = A->acsr.start[ACSR_SPLIT + 1] - A->acsr.start[ACSR_SPLIT];
+    if (splitRows == 0)
+    {
+        return SMVP_SUCCESS;
+    }
+    A->acsr.partial = (double *)matrixAlloc(A, sizeof(double) * (size_t)splitRows * (size_t)A->nthreads);
+    return (A->acsr.partial == NULL) ? SMVP_ERR_ALLOC : SMVP_SUCCESS;
+}
+
+// Function: buildACSR
+// Bins the rows by length with one counting pass, rows keep their order within a class
+static int buildACSR(smvp_matrix_t *A)
+{
+    ACSRData *acsr = &A->acsr;
+    int64_t len;
+    int index, cls, status;
+
+    if ((acsr->rows = (int *)matrixAlloc(A, sizeof(int) * (size_t)A->rows)) == NULL && A->rows > 0)
+    {
+        return SMVP_ERR_ALLOC;
+    }
+    memset(acsr->start, 0, sizeof(acsr->start));
+    memset(acsr->nnz, 0, sizeof(acsr->nnz));
+    for (index = 0; index < A->rows; index++)
+    {
+        len = offsetAt(A->csr.row_ptr, index + 1) - offsetAt(A->csr.row_ptr, index);
+        cls = acsrClassOf(len, A->opts.acsr_split);
+        acsr->start[cls + 1]++;
+        acsr->nnz[cls] += len;
+    }
+    for (cls = 0; cls < ACSR_CLASSES; cls++)
+    {
+        acsr->start[cls + 1] += acsr->start[cls];
+    }
+
+    // Scatter with start[c] as the cursor of class c, then shift the cursors back into start positions
+    for (index = 0; index < A->rows; index++)
+    {
+        cls = acsrClassOf(offsetAt(A->csr.row_ptr, index + 1) - offsetAt(A->csr.row_ptr, index), A->opts.acsr_split);
+        acsr->rows[acsr->start[cls]++] = index;
+    }
+    for (cls = ACSR_CLASSES; cls > 0; cls--)
+    {
+        acsr->start[cls] = acsr->start[cls - 1];
+    }
+    acsr->start[0] = 0;
+
+    A->formats |= SMVP_FORMAT_ACSR;
+    if ((status = acsrPartials(A)) != SMVP_SUCCESS)
+    {
+        A->formats &= ~SMVP_FORMAT_ACSR;
+        matrixRelease(A, acsr->rows);
+        acsr->rows = NULL;
+    }
+
+    return status;
+}
+
+// Function: smvp_get_acsr_bins
+// Reports how the rows and non-zeros of an adaptive CSR matrix fall into the row-length bins
+int smvp_get_acsr_bins(const smvp_matrix_t *A, smvp_acsr_bins_t *bins)
+{
+    static const int binOf[ACSR_CLASSES] = {-1, 0, 1, 1, 1, 2, 3, 4, 4};
+    int cls;
+
+    if (A == NULL || bins == NULL)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    if (!(A->formats & SMVP_FORMAT_ACSR))
+    {
+        return SMVP_ERR_NOT_ANALYZED;
+    }
+
+    memset(bins, 0, sizeof(*bins));
+    bins->empty_rows = A->acsr.start[ACSR_EMPTY + 1] - A->acsr.start[ACSR_EMPTY];
+    for (cls = ACSR_LEN1; cls < ACSR_CLASSES; cls++)
+    {
+        bins->rows[binOf[cls]] += A->acsr.start[cls + 1] - A->acsr.start[cls];
+        bins->nnz[binOf[cls]] += A->acsr.nnz[cls];
+    }
+    bins->split_rows = (A->pool != NULL && A->nthreads > 1) ? A->acsr.start[ACSR_SPLIT + 1] - A->acsr.start[ACSR_SPLIT] : 0;
+
+    return SMVP_SUCCESS;
+}
+
+// Function: tiledParts
+// (Re)computes where each bound worker's rows start in every tile, none when serial
+static int tiledParts(smvp_matrix_t *A)
+{
+    TiledData *tiled = &A->tiled;
+    int64_t lo, hi, mid, *bounds;
+    int tile, worker;
+
+    matrixRelease(A, tiled->part);
+    tiled->part = NULL;
+    if (!(A->formats & SMVP_FORMAT_TILED) || A->pool == NULL)
+    {
+        return SMVP_SUCCESS;
+    }
+    tiled->part = (int64_t *)matrixAlloc(A, sizeof(int64_t) * (size_t)tiled->num_tiles * (size_t)(A->nthreads + 1));
+    if (tiled->part == NULL && tiled->num_tiles > 0)
+    {
+        return SMVP_ERR_ALLOC;
+    }
+
+    // Segments of a tile ascend by row, so each worker's share is found by binary search on its first row
+    for (tile = 0; tile < tiled->num_tiles; tile++)
+    {
+        bounds = tiled->part + (size_t)tile * (size_t)(A->nthreads + 1);
+        bounds[0] = offsetAt(tiled->tile_start, tile);
+        bounds[A->nthreads] = offsetAt(tiled->tile_start, tile + 1);
+        for (worker = 1; worker < A->nthreads; worker++)
+        {
+            lo = bounds[worker - 1];
+            hi = bounds[A->nthreads];
+            while (lo < hi)
+            {
+                mid = lo + (hi - lo) / 2;
+                if (tiled->rows[mid] < A->part[worker])
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            bounds[worker] = lo;
+        }
+    }
+    return SMVP_SUCCESS;
+}
+
+// Function: releaseTiled
+// Frees the column-tiled arrays of a handle
+static void releaseTiled(smvp_matrix_t *A)
+{
+    TiledData *tiled = &A->tiled;
+
+    offsetsRelease(A, tiled->tile_start);
+    offsetsRelease(A, tiled->seg_ptr);
+    matrixRelease(A, tiled->rows);
+    matrixRelease(A, tiled->col_ind);
+    matrixRelease(A, tiled->val);
+    matrixRelease(A, tiled->part);
+    memset(tiled, 0, sizeof(*tiled));
+}
+
+// Function: buildTiled
+// Cuts the columns into tiles and copies every row's entries of each tile into a segment of that tile, with one
+// counting pass for the segment and non-zero totals per tile and one scatter pass. Half of the opts.tile_level
+// cache holds one tile's x slice unless opts.tile_cols fixes the width; widths are rounded down to a multiple
+// of 8 columns (one x cache line), at least 8
+static int buildTiled(smvp_matrix_t *A)
+{
+    TiledData *tiled = &A->tiled;
+    int64_t width, j, rowEnd, seg, dest, *segCursor, *nnzCursor;
+    unsigned char *lineSeen;
+    int row, tile, lastTile, col, status;
+
+    memset(tiled, 0, sizeof(*tiled));
+    if (A->opts.tile_cols > 0)
+    {
+        width = A->opts.tile_cols;
+    }
+    else
+    {
+        tiled->cache_level = A->opts.tile_level;
+        if (smvp_cache_size(A->opts.tile_level, &tiled->cache_bytes) != SMVP_SUCCESS)
+        {
+            tiled->cache_bytes = 0;
+        }
+        width = (int64_t)((tiled->cache_bytes > 0) ? tiled->cache_bytes : SMVP_TILE_CACHE_FALLBACK) / 2 / (int64_t)sizeof(double);
+    }
+    width = (width < 8) ? 8 : width & ~(int64_t)7;
+    width = (width > A->cols && A->cols > 0) ? ((int64_t)A->cols + 7) & ~(int64_t)7 : width;
+    tiled->tile_cols = (int)width;
+    tiled->num_tiles = (int)(((int64_t)A->cols + width - 1) / width);
+
+    // The cursors and line flags are held next to the tiled arrays, so they count towards bytes_peak too
+    segCursor = (int64_t *)matrixAlloc(A, sizeof(int64_t) * ((size_t)tiled->num_tiles + 1));
+    nnzCursor = (int64_t *)matrixAlloc(A, sizeof(int64_t) * ((size_t)tiled->num_tiles + 1));
+    lineSeen = (unsigned char *)matrixAlloc(A, (size_t)A->cols / 8 + 1);
+    if (segCursor == NULL || nnzCursor == NULL || lineSeen == NULL)
+    {
+        matrixRelease(A, segCursor);
+        matrixRelease(A, nnzCursor);
+        matrixRelease(A, lineSeen);
+        return SMVP_ERR_ALLOC;
+    }
+    memset(segCursor, 0, sizeof(int64_t) * ((size_t)tiled->num_tiles + 1));
+    memset(nnzCursor, 0, sizeof(int64_t) * ((size_t)tiled->num_tiles + 1));
+    memset(lineSeen, 0, (size_t)A->cols / 8 + 1);
+
+    // Count segments and non-zeros per tile (offset by one for the prefix sums) and the x lines read
+    for (row = 0; row < A->rows; row++)
+    {
+        lastTile = -1;
+        rowEnd = offsetAt(A->csr.row_ptr, row + 1);
+        for (j = offsetAt(A->csr.row_ptr, row); j < rowEnd; j++)
+        {
+            col = A->csr.col_ind[j];
+            tile = (int)(col / width);
+            if (tile != lastTile)
+            {
+                segCursor[tile + 1]++;
+                lastTile = tile;
+            }
+            nnzCursor[tile + 1]++;
+            if (!lineSeen[col / 8])
+            {
+                lineSeen[col / 8] = 1;
+                tiled->x_lines++;
+            }
+        }
+    }
+    for (tile = 0; tile < tiled->num_tiles; tile++)
+    {
+        segCursor[tile + 1] += segCursor[tile];
+        nnzCursor[tile + 1] += nnzCursor[tile];
+    }
+    tiled->segments = segCursor[tiled->num_tiles];
+
+    tiled->tile_start = offsetsAlloc(A, (size_t)tiled->num_tiles + 1);
+    tiled->seg_ptr = offsetsAlloc(A, (size_t)tiled->segments + 1);
+    tiled->rows = (int *)matrixAlloc(A, sizeof(int) * (size_t)tiled->segments);
+    tiled->col_ind = (int *)matrixAlloc(A, sizeof(int) * (size_t)A->nnz);
+    tiled->val = (double *)matrixAlloc(A, sizeof(double) * (size_t)A->nnz);
+    if (offsetsData(tiled->tile_start) == NULL || offsetsData(tiled->seg_ptr) == NULL || (tiled->rows == NULL && tiled->segments > 0) ||
+        (A->nnz > 0 && (tiled->col_ind == NULL || tiled->val == NULL)))
+    {
+        matrixRelease(A, segCursor);
+        matrixRelease(A, nnzCursor);
+        matrixRelease(A, lineSeen);
+        releaseTiled(A);
+        return SMVP_ERR_ALLOC;
+    }
+    for (tile = 0; tile <= tiled->num_tiles; tile++)
+    {
+        offsetSet(tiled->tile_start, tile, segCursor[tile]);
+    }
+
+    // Scatter with per-tile cursors; segments of a tile are laid out back to back, so each ends where the next begins
+    for (row = 0; row < A->rows; row++)
+    {
+        lastTile = -1;
+        rowEnd = offsetAt(A->csr.row_ptr, row + 1);
+        for (j = offsetAt(A->csr.row_ptr, row); j < rowEnd; j++)
+        {
+            tile = (int)(A->csr.col_ind[j] / width);
+            if (tile != lastTile)
+            {
+                seg = segCursor[tile]++;
+                tiled->rows[seg] = row;
+                offsetSet(tiled->seg_ptr, seg, nnzCursor[tile]);
+                lastTile = tile;
+            }
+            dest = nnzCursor[tile]++;
+            tiled->col_ind[dest] = A->csr.col_ind[j];
+            tiled->val[dest] = A->csr.val[j];
+        }
+    }
+    offsetSet(tiled->seg_ptr, tiled->segments, A->nnz);
+
+    matrixRelease(A, segCursor);
+    matrixRelease(A, nnzCursor);
+    matrixRelease(A, lineSeen);
+
+    A->formats |= SMVP_FORMAT_TILED;
+    if ((status = tiledParts(A)) != SMVP_SUCCESS)
+    {
+        A->formats &= ~SMVP_FORMAT_TILED;
+        releaseTiled(A);
+    }
+
+    return status;
+}
+
+// Function: smvp_get_tile_stats
+// Reports the tiling of a column-tiled CSR matrix and the reuse of the x lines it reads
+int smvp_get_tile_stats(const smvp_matrix_t *A, smvp_tile_stats_t *stats)
+{
+    if (A == NULL || stats == NULL)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    if (!(A->formats & SMVP_FORMAT_TILED))
+    {
+        return SMVP_ERR_NOT_ANALYZED;
+    }
+
+    stats->tile_cols = A->tiled.tile_cols;
+    stats->num_tiles = A->tiled.num_tiles;
+    stats->cache_level = A->tiled.cache_level;
+    stats->cache_bytes = A->tiled.cache_bytes;
+    stats->segments = A->tiled.segments;
+    stats->x_lines = A->tiled.x_lines;
+    stats->x_reuse = (A->tiled.x_lines > 0) ? (double)A->nnz / (double)A->tiled.x_lines : 0.0;
+
+    return SMVP_SUCCESS;
+}
+
+// Function: releaseTranspose
+// Frees the scratch of a transpose plan, leaving a serial plan
+static void releaseTranspose(smvp_matrix_t *A)
+{
+    TransposeData *plan = &A->transpose;
+
+    matrixRelease(A, plan->buffers);
+    matrixRelease(A, plan->col_part);
+    offsetsRelease(A, plan->split);
+    memset(plan, 0, sizeof(*plan));
+    plan->mode = SMVP_TRANSPOSE_SERIAL;
+}
+
+// Function: transposeSplits
+// Column ownership: balances the columns over the workers by non-zeros and finds where every worker's columns
+// start in each row (column indices ascend within a row, so a binary search does)
+static int transposeSplits(smvp_matrix_t *A)
+{
+    TransposeData *plan = &A->transpose;
+    int nthreads = A->nthreads, worker, col, row;
+    int64_t *colNnz, j, sum, lo, hi, mid;
+
+    if ((colNnz = (int64_t *)calloc((size_t)A->cols + 1, sizeof(int64_t))) == NULL)
+    {
+        return SMVP_ERR_ALLOC;
+    }
+    plan->split = offsetsAlloc(A, (size_t)A->rows * (size_t)(nthreads - 1));
+    if (offsetsData(plan->split) == NULL && A->rows > 0)
+    {
+        free(colNnz);
+        return SMVP_ERR_ALLOC;
+    }
+
+    // Worker t's columns start at the first column whose prefix of non-zeros reaches t/nthreads of them
+    for (j = 0; j < A->nnz; j++)
+    {
+        colNnz[A->csr.col_ind[j]]++;
+    }
+    plan->col_part[0] = 0;
+    worker = 1;
+    sum = 0;
+    for (col = 0; col < A->cols; col++)
+    {
+        while (worker < nthreads && sum >= A->nnz * worker / nthreads)
+        {
+            plan->col_part[worker++] = col;
+        }
+        sum += colNnz[col];
+    }
+    while (worker < nthreads)
+    {
+        plan->col_part[worker++] = A->cols;
+    }
+    plan->col_part[nthreads] = A->cols;
+    free(colNnz);
+
+    for (row = 0; row < A->rows; row++)
+    {
+        for (worker = 1; worker < nthreads; worker++)
+        {
+            lo = (worker == 1) ? offsetAt(A->csr.row_ptr, row) : offsetAt(plan->split, (size_t)row * (size_t)(nthreads - 1) + (size_t)(worker - 2));
+            hi = offsetAt(A->csr.row_ptr, row + 1);
+            while (lo < hi)
+            {
+                mid = lo + (hi - lo) / 2;
+                if (A->csr.col_ind[mid] < plan->col_part[worker])
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            offsetSet(plan->split, (size_t)row * (size_t)(nthreads - 1) + (size_t)(worker - 1), lo);
+        }
+    }
+    return SMVP_SUCCESS;
+}
+
+// Function: transposePlan
+// (Re)plans the transpose products of a bound matrix, serial ones need no scratch. Private buffers cost
+// 2 * nthreads * cols doubles of traffic per product (written by the scatter, read by the reduction), column
+// ownership makes every worker read x, a row pointer and a split offset for every row. Each cost adds the
+// scratch the plan holds, the cheaper one wins and ties go to column ownership. Neither plan may hold more
+// scratch than the handle's own bytes: the one that fits is used, and a matrix too sparse for both runs serially
+static int transposePlan(smvp_matrix_t *A)
+{
+    TransposeData *plan = &A->transpose;
+    double offsetBytes = (A->csr.row_ptr.i64 != NULL) ? sizeof(int64_t) : sizeof(int32_t);
+    double privateCost, ownerCost, privateBytes, ownerBytes;
+    int privateFits, ownerFits;
+    int nthreads = A->nthreads, worker, mode;
+
+    releaseTranspose(A);
+    if (!(A->formats & SMVP_FORMAT_TRANSPOSE) || A->pool == NULL || nthreads < 2)
+    {
+        return SMVP_SUCCESS;
+    }
+    mode = A->opts.transpose_mode;
+    if (mode == SMVP_TRANSPOSE_AUTO)
+    {
+        privateBytes = (double)nthreads * (double)A->cols * sizeof(double);
+        ownerBytes = (double)(nthreads - 1) * (double)A->rows * offsetBytes;
+        privateCost = 2.0 * privateBytes + privateBytes;
+        ownerCost = (double)nthreads * (double)A->rows * (sizeof(double) + 2.0 * offsetBytes) + ownerBytes;
+        privateFits = (privateBytes <= (double)A->bytes);
+        ownerFits = (ownerBytes <= (double)A->bytes);
+        if (privateFits && (!ownerFits || privateCost < ownerCost))
+        {
+            mode = SMVP_TRANSPOSE_PRIVATE;
+        }
+        else
+        {
+            mode = ownerFits ? SMVP_TRANSPOSE_OWNER : SMVP_TRANSPOSE_SERIAL;
+        }
+    }
+    if (mode == SMVP_TRANSPOSE_SERIAL)
+    {
+        return SMVP_SUCCESS;
+    }
+
+    if ((plan->col_part = (int *)matrixAlloc(A, sizeof(int) * (size_t)(nthreads + 1))) == NULL)
+    {
+        return SMVP_ERR_ALLOC;
+    }
+    if (mode == SMVP_TRANSPOSE_PRIVATE)
+    {
+        // The reduction splits y evenly, on cache line boundaries so no two workers write one line
+        for (worker = 0; worker <= nthreads; worker++)
+        {
+            plan->col_part[worker] = (worker == nthreads) ? A->cols : (int)(((int64_t)A->cols * worker / nthreads) & ~(int64_t)7);
+        }
+        plan->buffers = (double *)matrixAlloc(A, sizeof(double) * (size_t)nthreads * (size_t)A->cols);
+        if (plan->buffers == NULL && A->cols > 0)
+        {
+            releaseTranspose(A);
+            return SMVP_ERR_ALLOC;
+        }
+        plan->bytes = sizeof(double) * (size_t)nthreads * (size_t)A->cols;
+    }
+    else if (transposeSplits(A) != SMVP_SUCCESS)
+    {
+        releaseTranspose(A);
+        return SMVP_ERR_ALLOC;
+    }
+    else
+    {
+        plan->bytes = (size_t)offsetBytes * (size_t)A->rows * (size_t)(nthreads - 1);
+    }
+    plan->bytes += sizeof(int) * (size_t)(nthreads + 1);
+    plan->mode = mode;
+    return SMVP_SUCCESS;
+}
+
+// Function: buildTranspose
+// Transpose products read the CSR arrays as they are, only a bound matrix needs a plan
+static int buildTranspose(smvp_matrix_t *A)
+{
+    int status;
+
+    A->formats |= SMVP_FORMAT_TRANSPOSE;
+    if ((status = transposePlan(A)) != SMVP_SUCCESS)
+    {
+        A->formats &= ~SMVP_FORMAT_TRANSPOSE;
+    }
+    return status;
+}
+
+// Struct: _derived_task_
+// Fresh copies of the derived arrays a bound matrix's kernels read, each part filled by the worker that reads it
+typedef struct _derived_task_
+{
+    smvp_matrix_t *A;
+    int formats; // SMVP_FORMAT_ACSR, _TILED and _TRANSPOSE being placed
+    int *acsrRows;
+    SmvpOffsets segPtr;
+    int *segRows;
+    int *segCol;
+    double *segVal;
+} DerivedTask;
+
+// Function: derivedTask
+// First touch of the derived formats: each worker copies its slice of every ACSR class, its segments of every
+// tile and zeroes its own split-row partials and private transpose buffer
+static void derivedTask(void *arg, int tid, int nthreads)
+{
+    DerivedTask *task = (DerivedTask *)arg;
+    smvp_matrix_t *A = task->A;
+    const TiledData *tiled = &A->tiled;
+    size_t width = (size_t)A->index_bits / 8;
+    const int64_t *bounds;
+    int64_t segFirst, segLast, nzFirst, nzLast;
+    int cls, first, last, tile, splitRows;
+
+    if (task->formats & SMVP_FORMAT_ACSR)
+    {
+        for (cls = 0; cls < ACSR_CLASSES; cls++)
+        {
+            acsrSlice(A, cls, tid, &first, &last);
+            memcpy(task->acsrRows + first, A->acsr.rows + first, sizeof(int) * (size_t)(last - first));
+        }
+        splitRows = A->acsr.start[ACSR_SPLIT + 1] - A->acsr.start[ACSR_SPLIT];
+        if (A->acsr.partial != NULL)
+        {
+            memset(A->acsr.partial + (size_t)tid * (size_t)splitRows, 0, sizeof(double) * (size_t)splitRows);
+        }
+    }
+    if (task->formats & SMVP_FORMAT_TILED)
+    {
+        for (tile = 0; tile < tiled->num_tiles; tile++)
+        {
+            bounds = tiled->part + (size_t)tile * (size_t)(nthreads + 1);
+            segFirst = bounds[tid];
+            segLast = bounds[tid + 1];
+            nzFirst = offsetAt(tiled->seg_ptr, segFirst);
+            nzLast = offsetAt(tiled->seg_ptr, segLast);
+            memcpy((char *)offsetsData(task->segPtr) + width * (size_t)segFirst, (char *)offsetsData(tiled->seg_ptr) + width * (size_t)segFirst,
+                   width * (size_t)(segLast - segFirst));
+            memcpy(task->segRows + segFirst, tiled->rows + segFirst, sizeof(int) * (size_t)(segLast - segFirst));
+            memcpy(task->segCol + nzFirst, tiled->col_ind + nzFirst, sizeof(int) * (size_t)(nzLast - nzFirst));
+            memcpy(task->segVal + nzFirst, tiled->val + nzFirst, sizeof(double) * (size_t)(nzLast - nzFirst));
+        }
+    }
+    if ((task->formats & SMVP_FORMAT_TRANSPOSE) && A->transpose.buffers != NULL)
+    {
+        memset(A->transpose.buffers + (size_t)tid * (size_t)A->cols, 0, sizeof(double) * (size_t)A->cols);
+    }
+}
+
+// Function: placeDerived
+// On a pool spanning more than one node, moves the derived formats of a bound matrix that are not placed yet into
+// fresh memory first-touched by the workers that read each part, like smvp_bind() does for the CSR arrays.
+// Split-row partials and private transpose buffers are freshly allocated by every bind and are only touched
+static int placeDerived(smvp_matrix_t *A)
+{
+    DerivedTask task;
+    TiledData *tiled = &A->tiled;
+
+    memset(&task, 0, sizeof(task));
+    task.A = A;
+    task.formats = A->formats & (SMVP_FORMAT_ACSR | SMVP_FORMAT_TILED | SMVP_FORMAT_TRANSPOSE) & ~A->placed;
+    if (A->pool == NULL || smvpPoolNodes(A->pool) == 1 || task.formats == 0)
+    {
+        return SMVP_SUCCESS;
+    }
+
+    if (task.formats & SMVP_FORMAT_ACSR)
+    {
+        if ((task.acsrRows = (int *)matrixAlloc(A, sizeof(int) * (size_t)A->rows)) == NULL && A->rows > 0)
+        {
+            return SMVP_ERR_ALLOC;
+        }
+    }
+    if (task.formats & SMVP_FORMAT_TILED)
+    {
+        task.segPtr = offsetsAlloc(A, (size_t)tiled->segments + 1);
+        task.segRows = (int *)matrixAlloc(A, sizeof(int) * (size_t)tiled->segments);
+        task.segCol = (int *)matrixAlloc(A, sizeof(int) * (size_t)A->nnz);
+        task.segVal = (double *)matrixAlloc(A, sizeof(double) * (size_t)A->nnz);
+        if (offsetsData(task.segPtr) == NULL || (tiled->segments > 0 && task.segRows == NULL) ||
+            (A->nnz > 0 && (task.segCol == NULL || task.segVal == NULL)))
+        {
+            matrixRelease(A, task.acsrRows);
+            offsetsRelease(A, task.segPtr);
+            matrixRelease(A, task.segRows);
+            matrixRelease(A, task.segCol);
+            matrixRelease(A, task.segVal);
+            return SMVP_ERR_ALLOC;
+        }
+    }
+
+    smvpPoolRun(A->pool, A->nthreads, derivedTask, &task);
+
+    if (task.formats & SMVP_FORMAT_ACSR)
+    {
+        matrixRelease(A, A->acsr.rows);
+        A->acsr.rows = task.acsrRows;
+    }
+    if (task.formats & SMVP_FORMAT_TILED)
+    {
+        offsetSet(task.segPtr, (size_t)tiled->segments, offsetAt(tiled->seg_ptr, tiled->segments));
+        offsetsRelease(A, tiled->seg_ptr);
+        matrixRelease(A, tiled->rows);
+        matrixRelease(A, tiled->col_ind);
+        matrixRelease(A, tiled->val);
+        tiled->seg_ptr = task.segPtr;
+        tiled->rows = task.segRows;
+        tiled->col_ind = task.segCol;
+        tiled->val = task.segVal;
+    }
+    A->placed |= task.formats;
+    return SMVP_SUCCESS;
+}
+
+// Function: smvp_analyze
+// Inspector: builds every requested format (SMVP_FORMAT_* bitmask) that is not already cached
+int smvp_analyze(smvp_matrix_t *A, int formats)
+{
+    int status = SMVP_SUCCESS;
+
+    if (A == NULL || (formats & ~(SMVP_FORMAT_CSR | SMVP_FORMAT_CSC | SMVP_FORMAT_TJDS | SMVP_FORMAT_ACSR | SMVP_FORMAT_TILED | SMVP_FORMAT_TRANSPOSE)))
+    {
+        return SMVP_ERR_INVALID;
+    }
+
+    if ((formats & SMVP_FORMAT_CSC) && !(A->formats & SMVP_FORMAT_CSC))
+    {
+        status = buildCSC(A);
+    }
+    if (status == SMVP_SUCCESS && (formats & SMVP_FORMAT_TJDS) && !(A->formats & SMVP_FORMAT_TJDS))
+    {
+        status = buildTJDS(A);
+    }
+    if (status == SMVP_SUCCESS && (formats & SMVP_FORMAT_ACSR) && !(A->formats & SMVP_FORMAT_ACSR))
+    {
+        status = buildACSR(A);
+    }
+    if (status == SMVP_SUCCESS && (formats & SMVP_FORMAT_TILED) && !(A->formats & SMVP_FORMAT_TILED))
+    {
+        status = buildTiled(A);
+    }
+    if (status == SMVP_SUCCESS && (formats & SMVP_FORMAT_TRANSPOSE) && !(A->formats & SMVP_FORMAT_TRANSPOSE))
+    {
+        status = buildTranspose(A);
+    }
+    if (status == SMVP_SUCCESS)
+    {
+        status = placeDerived(A);
+    }
+
+    return status;
+}
+
+// Function: scaleOutput
+// Applies the beta * y term for kernels that scatter into y
+static void scaleOutput(int len, double beta, double *y)
+{
+    int index;
+
+    if (beta == 0.0)
+    {
+        // Overwrite rather than multiply so uninitialized (NaN) caller memory is never propagated
+        for (index = 0; index < len; index++)
+        {
+            y[index] = 0.0;
+        }
+    }
+    else if (beta != 1.0)
+    {
+        for (index = 0; index < len; index++)
+        {
+            y[index] *= beta;
+        }
+    }
+}
+
+// Struct: _csr_task_
+// Arguments shared by the workers of one parallel CSR multiply
+typedef struct _csr_task_
+{
+    const smvp_matrix_t *A;
+    double alpha;
+    double beta;
+    const double *x;
+    double *y;
+    int arrived; // Workers done with their split-row segments (adaptive CSR)
+} CSRTask;
+
+// Function: csrRows
+// CSR kernel over rows [first, last) at the matrix's index width
+static void csrRows(const smvp_matrix_t *A, int first, int last, double alpha, const double *x, double beta, double *y)
+{
+    if (A->csr_prefetch > 0 && A->csr.row_ptr.i64 != NULL)
+    {
+        csrRowsPrefetch64(A->csr.row_ptr.i64, A->csr.col_ind, A->csr.val, first, last, A->csr_prefetch, alpha, x, beta, y);
+    }
+    else if (A->csr_prefetch > 0)
+    {
+        csrRowsPrefetch32(A->csr.row_ptr.i32, A->csr.col_ind, A->csr.val, first, last, A->csr_prefetch, alpha, x, beta, y);
+    }
+    else if (A->csr.row_ptr.i64 != NULL)
+    {
+        csrRows64(A->csr.row_ptr.i64, A->csr.col_ind, A->csr.val, first, last, alpha, x, beta, y);
+    }
+    else
+    {
+        csrRows32(A->csr.row_ptr.i32, A->csr.col_ind, A->csr.val, first, last, alpha, x, beta, y);
+    }
+}
+
+// Function: csrTask
+// One worker's share of a parallel CSR multiply, reading x from its node's replica when there is one
+static void csrTask(void *arg, int tid, int nthreads)
+{
+    CSRTask *task = (CSRTask *)arg;
+    const smvp_matrix_t *A = task->A;
+    const double *x = (A->xrep != NULL) ? A->xrep[smvpPoolWorkerNode(A->pool, tid)] : task->x;
+
+    (void)nthreads;
+    csrRows(A, A->part[tid], A->part[tid + 1], task->alpha, x, task->beta, task->y);
+}
+
+// Function: nodeSlice
+// Splits [0, len) evenly over the workers sharing tid's node (workers of a node are contiguous)
+static void nodeSlice(const smvp_pool_t *pool, int tid, int nthreads, long len, long *first, long *last)
+{
+    int node = smvpPoolWorkerNode(pool, tid);
+    int lo = tid, hi = tid;
+
+    while (lo > 0 && smvpPoolWorkerNode(pool, lo - 1) == node)
+    {
+        lo--;
+    }
+    while (hi + 1 < nthreads && smvpPoolWorkerNode(pool, hi + 1) == node)
+    {
+        hi++;
+    }
+    *first = len * (tid - lo) / (hi - lo + 1);
+    *last = len * (tid - lo + 1) / (hi - lo + 1);
+}
+
+// Function: replicateTask
+// Refreshes the per-node copies of x, each node's workers copying a slice into their own replica
+static void replicateTask(void *arg, int tid, int nthreads)
+{
+    CSRTask *task = (CSRTask *)arg;
+    long first, last;
+
+    nodeSlice(task->A->pool, tid, nthreads, task->A->cols, &first, &last);
+    memcpy(task->A->xrep[smvpPoolWorkerNode(task->A->pool, tid)] + first, task->x + first, sizeof(double) * (size_t)(last - first));
+}
+
+// Function: acsrClass
+// Adaptive CSR kernel over rows[first, last) of class cls at the matrix's index width
+static void acsrClass(const smvp_matrix_t *A, int cls, int first, int last, double alpha, const double *x, double beta, double *y)
+{
+    if (A->csr.row_ptr.i64 != NULL)
+    {
+        acsrClass64(A->csr.row_ptr.i64, A->csr.col_ind, A->csr.val, A->acsr.rows, cls, first, last, alpha, x, beta, y);
+    }
+    else
+    {
+        acsrClass32(A->csr.row_ptr.i32, A->csr.col_ind, A->csr.val, A->acsr.rows, cls, first, last, alpha, x, beta, y);
+    }
+}
+
+// Function: acsrSegment
+// Partial sum of the share [tid/nthreads, (tid+1)/nthreads) of one split row
+static double acsrSegment(const smvp_matrix_t *A, int row, int tid, int nthreads, const double *x)
+{
+    int64_t start = offsetAt(A->csr.row_ptr, row), len = offsetAt(A->csr.row_ptr, row + 1) - start;
+    int64_t first = start + len * tid / nthreads, last = start + len * (tid + 1) / nthreads;
+
+    if (A->csr.row_ptr.i64 != NULL)
+    {
+        return acsrSpanWide64(A->csr.col_ind, A->csr.val, first, last, x);
+    }
+    return acsrSpanWide32(A->csr.col_ind, A->csr.val, (int32_t)first, (int32_t)last, x);
+}
+
+// Function: acsrTask
+// One worker's share of a parallel adaptive CSR multiply: a slice of every class holding an even share of its
+// non-zeros, and a slice of every split row whose partial sums the last worker to finish adds up
+static void acsrTask(void *arg, int tid, int nthreads)
+{
+    CSRTask *task = (CSRTask *)arg;
+    const smvp_matrix_t *A = task->A;
+    const ACSRData *acsr = &A->acsr;
+    const double *x = (A->xrep != NULL) ? A->xrep[smvpPoolWorkerNode(A->pool, tid)] : task->x;
+    int cls, count, index, worker, first, last;
+    double sum;
+
+    for (cls = 0; cls < ACSR_SPLIT; cls++)
+    {
+        acsrSlice(A, cls, tid, &first, &last);
+        acsrClass(A, cls, first, last, task->alpha, x, task->beta, task->y);
+    }
+
+    count = acsr->start[ACSR_SPLIT + 1] - acsr->start[ACSR_SPLIT];
+    if (count == 0)
+    {
+        return;
+    }
+    for (index = 0; index < count; index++)
+    {
+        acsr->partial[(size_t)tid * (size_t)count + (size_t)index] = acsrSegment(A, acsr->rows[acsr->start[ACSR_SPLIT] + index], tid, nthreads, x);
+    }
+
+    // The partials belong to the handle, not the product: they stay this product's only because the pool runs one
+    // job at a time. The run returns only after every worker, so the reduction needs no barrier, just one last arrival
+    if (__atomic_add_fetch(&task->arrived, 1, __ATOMIC_ACQ_REL) == nthreads)
+    {
+        for (index = 0; index < count; index++)
+        {
+            sum = 0.0;
+            for (worker = 0; worker < nthreads; worker++)
+            {
+                sum += acsr->partial[(size_t)worker * (size_t)count + (size_t)index];
+            }
+            acsrStore(task->y, acsr->rows[acsr->start[ACSR_SPLIT] + index], sum, task->alpha, task->beta);
+        }
+    }
+}
+
+// Function: tiledSegments
+// Column-tiled kernel over segments [first, last) at the matrix's index width
+static void tiledSegments(const smvp_matrix_t *A, int64_t first, int64_t last, double alpha, const double *x, double *y)
+{
+    if (A->tiled.seg_ptr.i64 != NULL)
+    {
+        tiledSegments64(&A->tiled, A->tiled.seg_ptr.i64, first, last, alpha, x, y);
+    }
+    else
+    {
+        tiledSegments32(&A->tiled, A->tiled.seg_ptr.i32, (int32_t)first, (int32_t)last, alpha, x, y);
+    }
+}
+
+// Function: tiledTask
+// One worker's share of a parallel column-tiled multiply: its own rows of y, tile after tile
+static void tiledTask(void *arg, int tid, int nthreads)
+{
+    CSRTask *task = (CSRTask *)arg;
+    const smvp_matrix_t *A = task->A;
+    const double *x = (A->xrep != NULL) ? A->xrep[smvpPoolWorkerNode(A->pool, tid)] : task->x;
+    const int64_t *bounds;
+    int tile;
+
+    scaleOutput(A->part[tid + 1] - A->part[tid], task->beta, task->y + A->part[tid]);
+    for (tile = 0; tile < A->tiled.num_tiles; tile++)
+    {
+        bounds = A->tiled.part + (size_t)tile * (size_t)(nthreads + 1);
+        tiledSegments(A, bounds[tid], bounds[tid + 1], task->alpha, x, task->y);
+    }
+}
+
+// Function: transposeRows
+// A^T * x scattered from CSR rows [first, last) into out (already scaled or zeroed) at the matrix's index width
+static void transposeRows(const smvp_matrix_t *A, int first, int last, double alpha, const double *x, double *out)
+{
+    if (A->csr.row_ptr.i64 != NULL)
+    {
+        cscColumns64(first, last, A->csr.row_ptr.i64, A->csr.col_ind, A->csr.val, alpha, x, out);
+    }
+    else
+    {
+        cscColumns32(first, last, A->csr.row_ptr.i32, A->csr.col_ind, A->csr.val, alpha, x, out);
+    }
+}
+
+// Function: transposeReduce
+// y[first, last) = beta * y + the sum of the workers' private buffers over that slice
+static void transposeReduce(const double *buffers, int cols, int nthreads, int first, int last, double beta, double *restrict y)
+{
+    const double *restrict buffer;
+    int index, worker;
+
+    scaleOutput(last - first, beta, y + first);
+    for (worker = 0; worker < nthreads; worker++)
+    {
+        buffer = buffers + (size_t)worker * (size_t)cols;
+        for (index = first; index < last; index++)
+        {
+            y[index] += buffer[index];
+        }
+    }
+}
+
+// Function: transposeAccumulateTask
+// One worker's first share of a transpose product with private buffers: its CSR rows scattered into its own buffer
+static void transposeAccumulateTask(void *arg, int tid, int nthreads)
+{
+    CSRTask *task = (CSRTask *)arg;
+    const smvp_matrix_t *A = task->A;
+    double *buffer = A->transpose.buffers + (size_t)tid * (size_t)A->cols;
+
+    (void)nthreads;
+    memset(buffer, 0, sizeof(double) * (size_t)A->cols);
+    transposeRows(A, A->part[tid], A->part[tid + 1], task->alpha, task->x, buffer);
+}
+
+// Function: transposeReduceTask
+// One worker's second share of a transpose product with private buffers: its slice of y reduced over every buffer
+static void transposeReduceTask(void *arg, int tid, int nthreads)
+{
+    CSRTask *task = (CSRTask *)arg;
+    const TransposeData *plan = &task->A->transpose;
+
+    transposeReduce(plan->buffers, task->A->cols, nthreads, plan->col_part[tid], plan->col_part[tid + 1], task->beta, task->y);
+}
+
+// Function: transposeOwnerTask
+// One worker's share of a transpose product with column ownership: the entries of every row in its columns
+static void transposeOwnerTask(void *arg, int tid, int nthreads)
+{
+    CSRTask *task = (CSRTask *)arg;
+    const smvp_matrix_t *A = task->A;
+    const TransposeData *plan = &A->transpose;
+
+    scaleOutput(plan->col_part[tid + 1] - plan->col_part[tid], task->beta, task->y + plan->col_part[tid]);
+    if (A->csr.row_ptr.i64 != NULL)
+    {
+        transposeOwned64(A->rows, A->csr.row_ptr.i64, plan->split.i64, tid, nthreads, A->csr.col_ind, A->csr.val, task->alpha, task->x, task->y);
+    }
+    else
+    {
+        transposeOwned32(A->rows, A->csr.row_ptr.i32, plan->split.i32, tid, nthreads, A->csr.col_ind, A->csr.val, task->alpha, task->x, task->y);
+    }
+}
+
+// Function: smvp_multiply
+// Executor: y = alpha * A * x + beta * y using an analyzed format, performs no allocation
+// Unbound handles are only read. Bound ones write shared plan scratch (adaptive CSR partials, per-node copies of x)
+// on every product, which is safe only because each product holds the pool for its whole run, so concurrent
+// multiplies on one bound handle are serialized rather than overlapped
+int smvp_multiply(const smvp_matrix_t *A, int format, double alpha, const double x[], double beta, double y[])
+{
+    CSRTask task;
+    SmvpTask kernel;
+    int cls, tile;
+
+    if (A == NULL || x == NULL || y == NULL || format == SMVP_FORMAT_TRANSPOSE)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    if (!(A->formats & format))
+    {
+        return (format == SMVP_FORMAT_CSC || format == SMVP_FORMAT_TJDS || format == SMVP_FORMAT_ACSR || format == SMVP_FORMAT_TILED) ? SMVP_ERR_NOT_ANALYZED : SMVP_ERR_INVALID;
+    }
+
+    if ((format == SMVP_FORMAT_CSR || format == SMVP_FORMAT_ACSR || format == SMVP_FORMAT_TILED) && A->pool != NULL)
+    {
+        task.A = A;
+        task.alpha = alpha;
+        task.beta = beta;
+        task.x = x;
+        task.y = y;
+        task.arrived = 0;
+        kernel = (format == SMVP_FORMAT_CSR) ? csrTask : (format == SMVP_FORMAT_ACSR) ? acsrTask : tiledTask;
+        if (A->xrep != NULL)
+        {
+            // One job, so no other product can replace the node copies of x before this one has read them
+            smvpPoolRun2(A->pool, A->nthreads, replicateTask, kernel, &task);
+        }
+        else
+        {
+            smvpPoolRun(A->pool, A->nthreads, kernel, &task);
+        }
+    }
+    else if (format == SMVP_FORMAT_TILED)
+    {
+        scaleOutput(A->rows, beta, y);
+        for (tile = 0; tile < A->tiled.num_tiles; tile++)
+        {
+            tiledSegments(A, offsetAt(A->tiled.tile_start, tile), offsetAt(A->tiled.tile_start, tile + 1), alpha, x, y);
+        }
+    }
+    else if (format == SMVP_FORMAT_ACSR)
+    {
+        for (cls = 0; cls < ACSR_CLASSES; cls++)
+        {
+            acsrClass(A, cls, A->acsr.start[cls], A->acsr.start[cls + 1], alpha, x, beta, y);
+        }
+    }
+    else if (format == SMVP_FORMAT_CSR)
+    {
+        csrRows(A, 0, A->rows, alpha, x, beta, y);
+    }
+    else if (format == SMVP_FORMAT_CSC)
+    {
+        scaleOutput(A->rows, beta, y);
+        if (A->csc.col_ptr.i64 != NULL)
+        {
+            cscColumns64(0, A->cols, A->csc.col_ptr.i64, A->csc.row_ind, A->csc.val, alpha, x, y);
+        }
+        else
+        {
+            cscColumns32(0, A->cols, A->csc.col_ptr.i32, A->csc.row_ind, A->csc.val, alpha, x, y);
+        }
+    }
+    else
+    {
+        scaleOutput(A->rows, beta, y);
+        if (A->tjds_prefetch > 0 && A->tjds.start_pos.i64 != NULL)
+        {
+            tjdsDiagonalsPrefetch64(&A->tjds, A->tjds.start_pos.i64, A->tjds_prefetch, alpha, x, y);
+        }
+        else if (A->tjds_prefetch > 0)
+        {
+            tjdsDiagonalsPrefetch32(&A->tjds, A->tjds.start_pos.i32, A->tjds_prefetch, alpha, x, y);
+        }
+        else if (A->tjds.start_pos.i64 != NULL)
+        {
+            tjdsDiagonals64(&A->tjds, A->tjds.start_pos.i64, alpha, x, y);
+        }
+        else
+        {
+            tjdsDiagonals32(&A->tjds, A->tjds.start_pos.i32, alpha, x, y);
+        }
+    }
+
+    return SMVP_SUCCESS;
+}
+
+// Function: smvp_multiply_transpose
+// Executor: y = alpha * A^T * x + beta * y from the CSR arrays (x has rows entries, y has cols), performs no
+// allocation; bound matrices run the plan made by the last smvp_analyze() or smvp_bind(), and a product with
+// private buffers holds the pool over both of its phases, so concurrent products never share the buffers
+int smvp_multiply_transpose(const smvp_matrix_t *A, double alpha, const double x[], double beta, double y[])
+{
+    CSRTask task;
+
+    if (A == NULL || x == NULL || y == NULL)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    if (!(A->formats & SMVP_FORMAT_TRANSPOSE))
+    {
+        return SMVP_ERR_NOT_ANALYZED;
+    }
+
+    if (A->transpose.mode == SMVP_TRANSPOSE_SERIAL)
+    {
+        scaleOutput(A->cols, beta, y);
+        transposeRows(A, 0, A->rows, alpha, x, y);
+        return SMVP_SUCCESS;
+    }
+
+    task.A = A;
+    task.alpha = alpha;
+    task.beta = beta;
+    task.x = x;
+    task.y = y;
+    task.arrived = 0;
+    if (A->transpose.mode == SMVP_TRANSPOSE_PRIVATE)
+    {
+        // One job of two phases: every buffer is complete before any slice is reduced, and no other product on
+        // the pool can refill the buffers in between
+        smvpPoolRun2(A->pool, A->nthreads, transposeAccumulateTask, transposeReduceTask, &task);
+    }
+    else
+    {
+        smvpPoolRun(A->pool, A->nthreads, transposeOwnerTask, &task);
+    }
+
+    return SMVP_SUCCESS;
+}
+
+// Function: smvp_set_prefetch
+// Sets the software prefetch distance (in non-zeros) of the CSR or TJDS kernel of one matrix, 0 restores the plain kernel
+int smvp_set_prefetch(smvp_matrix_t *A, int format, int distance)
+{
+    if (A == NULL || distance < 0 || distance > SMVP_PREFETCH_MAX)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    if (format == SMVP_FORMAT_CSR)
+    {
+        A->csr_prefetch = distance;
+    }
+    else if (format == SMVP_FORMAT_TJDS)
+    {
+        A->tjds_prefetch = distance;
+    }
+    else
+    {
+        return SMVP_ERR_INVALID;
+    }
+    return SMVP_SUCCESS;
+}
+
+// Function: nowSeconds
+// Monotonic clock reading in seconds
+static double nowSeconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+// Function: smvp_tune_prefetch
+// Calibration pass: times y = A * x with the plain kernel and every prefetch distance (the defaults when distances
+// is NULL), round-robin so clock drift hits every candidate alike, and keeps the fastest distance on the matrix.
+// Not safe against concurrent multiplies on the same handle; y is left holding A * x
+int smvp_tune_prefetch(smvp_matrix_t *A, int format, const int distances[], int count, const double x[], double y[], smvp_prefetch_tune_t *tune)
+{
+    int *slot, candidate, round, rep, reps, best = 0;
+    double start, once;
+
+    if (A == NULL || x == NULL || y == NULL || tune == NULL || (format != SMVP_FORMAT_CSR && format != SMVP_FORMAT_TJDS))
+    {
+        return SMVP_ERR_INVALID;
+    }
+    if (!(A->formats & format))
+    {
+        return SMVP_ERR_NOT_ANALYZED;
+    }
+    if (distances == NULL)
+    {
+        distances = prefetchDistances;
+        count = (int)(sizeof(prefetchDistances) / sizeof(prefetchDistances[0]));
+    }
+    if (count < 0 || count > SMVP_PREFETCH_CANDIDATES - 1)
+    {
+        return SMVP_ERR_INVALID;
+    }
+
+    memset(tune, 0, sizeof(*tune));
+    tune->candidates = count + 1;
+    for (candidate = 0; candidate < count; candidate++)
+    {
+        if (distances[candidate] <= 0 || distances[candidate] > SMVP_PREFETCH_MAX)
+        {
+            return SMVP_ERR_INVALID;
+        }
+        tune->tried[candidate + 1] = distances[candidate];
+    }
+    slot = (format == SMVP_FORMAT_CSR) ? &A->csr_prefetch : &A->tjds_prefetch;
+
+    // One plain multiply warms the caches and sizes the batches
+    *slot = 0;
+    start = nowSeconds();
+    smvp_multiply(A, format, 1.0, x, 0.0, y);
+    once = nowSeconds() - start;
+    reps = (once > 0.0 && once < PREFETCH_TUNE_SECONDS) ? (int)(PREFETCH_TUNE_SECONDS / once) : 1;
+    reps = (reps > 1000) ? 1000 : reps;
+
+    for (round = 0; round < PREFETCH_TUNE_ROUNDS; round++)
+    {
+        for (candidate = 0; candidate < tune->candidates; candidate++)
+        {
+            *slot = tune->tried[candidate];
+            start = nowSeconds();
+            for (rep = 0; rep < reps; rep++)
+            {
+                smvp_multiply(A, format, 1.0, x, 0.0, y);
+            }
+            once = (nowSeconds() - start) / reps;
+            if (round == 0 || once < tune->seconds[candidate])
+            {
+                tune->seconds[candidate] = once;
+            }
+        }
+    }
+
+    for (candidate = 1; candidate < tune->candidates; candidate++)
+    {
+        if (tune->seconds[candidate] < tune->seconds[best])
+        {
+            best = candidate;
+        }
+    }
+    if (best != 0 && tune->seconds[0] < PREFETCH_TUNE_MIN_GAIN * tune->seconds[best])
+    {
+        best = 0;
+    }
+    tune->distance = tune->tried[best];
+    tune->gain = (tune->seconds[best] > 0.0) ? tune->seconds[0] / tune->seconds[best] : 1.0;
+    *slot = tune->distance;
+
+    return SMVP_SUCCESS;
+}
+
+// Struct: _place_task_
+// Fresh (untouched) CSR arrays a bound matrix is copied into by the workers owning each partition
+typedef struct _place_task_
+{
+    smvp_matrix_t *A;
+    SmvpOffsets row_ptr;
+    int *col_ind;
+    double *val;
+    double **xrep;
+} PlaceTask;
+
+// Function: placeTask
+// First touch: each worker copies its rows, so the kernel allocates their pages on the worker's node
+static void placeTask(void *arg, int tid, int nthreads)
+{
+    PlaceTask *task = (PlaceTask *)arg;
+    smvp_matrix_t *A = task->A;
+    int first = A->part[tid], last = A->part[tid + 1];
+    int64_t nzFirst = offsetAt(A->csr.row_ptr, first), nzLast = offsetAt(A->csr.row_ptr, last);
+    size_t width = (size_t)A->index_bits / 8;
+    long xFirst, xLast;
+
+    memcpy((char *)offsetsData(task->row_ptr) + width * (size_t)first, (char *)offsetsData(A->csr.row_ptr) + width * (size_t)first,
+           width * (size_t)(last - first + (tid == nthreads - 1)));
+    memcpy(task->col_ind + nzFirst, A->csr.col_ind + nzFirst, sizeof(int) * (size_t)(nzLast - nzFirst));
+    memcpy(task->val + nzFirst, A->csr.val + nzFirst, sizeof(double) * (size_t)(nzLast - nzFirst));
+
+    if (task->xrep != NULL)
+    {
+        nodeSlice(A->pool, tid, nthreads, A->cols, &xFirst, &xLast);
+        memset(task->xrep[smvpPoolWorkerNode(A->pool, tid)] + xFirst, 0, sizeof(double) * (size_t)(xLast - xFirst));
+    }
+}
+
+// Function: unbind
+// Drops the partition and replicas of a bound matrix
+static void unbind(smvp_matrix_t *A)
+{
+    int node;
+
+    if (A->xrep != NULL)
+    {
+        for (node = 0; node < smvpPoolNodes(A->pool); node++)
+        {
+            matrixRelease(A, A->xrep[node]);
+        }
+        free(A->xrep);
+        A->xrep = NULL;
+    }
+    matrixRelease(A, A->part);
+    matrixRelease(A, A->acsr.partial);
+    matrixRelease(A, A->acsr.part);
+    matrixRelease(A, A->tiled.part);
+    releaseTranspose(A);
+    A->part = NULL;
+    A->acsr.partial = NULL;
+    A->acsr.part = NULL;
+    A->tiled.part = NULL;
+    A->pool = NULL;
+    A->nthreads = 0;
+    A->placed = 0;
+}
+
+// Function: smvp_bind
+// Runs CSR multiplies of A on the first nthreads workers of pool (pool NULL or nthreads 0 returns to serial)
+// Rows are split into contiguous partitions of roughly equal non-zeros. When the pool places workers on more
+// than one node, the CSR arrays are copied into fresh memory by the workers that own each partition so every
+// page lands on the node that reads it, and so are the derived formats already analyzed (placeDerived());
+// on a single node nothing is moved.
+int smvp_bind(smvp_matrix_t *A, smvp_pool_t *pool, int nthreads)
+{
+    PlaceTask task;
+    int index, lo, hi, mid, node, nodes;
+    int64_t target;
+
+    if (A == NULL || nthreads < 0 || (pool != NULL && nthreads > smvp_pool_size(pool)))
+    {
+        return SMVP_ERR_INVALID;
+    }
+
+    if (A->pool != NULL)
+    {
+        unbind(A);
+    }
+    if (pool == NULL || nthreads == 0)
+    {
+        return SMVP_SUCCESS;
+    }
+
+    if ((A->part = (int *)matrixAlloc(A, sizeof(int) * (size_t)(nthreads + 1))) == NULL)
+    {
+        return SMVP_ERR_ALLOC;
+    }
+
+    // Partition t starts at the first row whose row_ptr reaches t/nthreads of the non-zeros
+    A->part[0] = 0;
+    for (index = 1; index < nthreads; index++)
+    {
+        target = A->nnz * index / nthreads;
+        lo = A->part[index - 1];
+        hi = A->rows;
+        while (lo < hi)
+        {
+            mid = lo + (hi - lo) / 2;
+            if (offsetAt(A->csr.row_ptr, mid) < target)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        A->part[index] = lo;
+    }
+    A->part[nthreads] = A->rows;
+    A->pool = pool;
+    A->nthreads = nthreads;
+    if (acsrPartials(A) != SMVP_SUCCESS || tiledParts(A) != SMVP_SUCCESS || transposePlan(A) != SMVP_SUCCESS)
+    {
+        unbind(A);
+        return SMVP_ERR_ALLOC;
+    }
+
+    nodes = smvpPoolNodes(pool);
+    if (nodes == 1)
+    {
+        return SMVP_SUCCESS;
+    }
+
+    memset(&task, 0, sizeof(task));
+    task.A = A;
+    if (smvpPoolNuma(pool) == SMVP_NUMA_REPLICATE)
+    {
+        if ((A->xrep = (double **)calloc((size_t)nodes, sizeof(double *))) == NULL)
+        {
+            unbind(A);
+            return SMVP_ERR_ALLOC;
+        }
+        for (node = 0; node < nodes; node++)
+        {
+            if ((A->xrep[node] = (double *)matrixAlloc(A, sizeof(double) * (size_t)A->cols)) == NULL)
+            {
+                unbind(A);
+                return SMVP_ERR_ALLOC;
+            }
+        }
+        task.xrep = A->xrep;
+    }
+
+    task.row_ptr = offsetsAlloc(A, (size_t)A->rows + 1);
+    task.col_ind = (int *)matrixAlloc(A, sizeof(int) * (size_t)A->nnz);
+    task.val = (double *)matrixAlloc(A, sizeof(double) * (size_t)A->nnz);
+    if (offsetsData(task.row_ptr) == NULL || task.col_ind == NULL || task.val == NULL)
+    {
+        offsetsRelease(A, task.row_ptr);
+        matrixRelease(A, task.col_ind);
+        matrixRelease(A, task.val);
+        unbind(A);
+        return SMVP_ERR_ALLOC;
+    }
+
+    smvpPoolRun(pool, nthreads, placeTask, &task);
+
+    offsetsRelease(A, A->csr.row_ptr);
+    matrixRelease(A, A->csr.col_ind);
+    matrixRelease(A, A->csr.val);
+    A->csr.row_ptr = task.row_ptr;
+    A->csr.col_ind = task.col_ind;
+    A->csr.val = task.val;
+    A->placed = SMVP_FORMAT_CSR;
+
+    if (placeDerived(A) != SMVP_SUCCESS)
+    {
+        unbind(A);
+        return SMVP_ERR_ALLOC;
+    }
+    return SMVP_SUCCESS;
+}
+
+// Struct: _touch_task_
+// Output vector being placed by smvp_touch_rows()
+typedef struct _touch_task_
+{
+    const smvp_matrix_t *A;
+    double *y;
+} TouchTask;
+
+// Function: touchTask
+// Zeroes one partition of y from the worker that will write it during multiplies
+static void touchTask(void *arg, int tid, int nthreads)
+{
+    TouchTask *task = (TouchTask *)arg;
+    int first = task->A->part[tid], last = task->A->part[tid + 1];
+
+    (void)nthreads;
+    memset(task->y + first, 0, sizeof(double) * (size_t)(last - first));
+}
+
+// Function: smvp_touch_rows
+// Zeroes y (rows entries), writing each row partition from the worker that owns it so a freshly
+// allocated y is placed like the matrix rows; serial handles simply zero y
+int smvp_touch_rows(const smvp_matrix_t *A, double y[])
+{
+    TouchTask task;
+
+    if (A == NULL || y == NULL)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    if (A->pool == NULL)
+    {
+        memset(y, 0, sizeof(double) * (size_t)A->rows);
+        return SMVP_SUCCESS;
+    }
+
+    task.A = A;
+    task.y = y;
+    smvpPoolRun(A->pool, A->nthreads, touchTask, &task);
+
+    return SMVP_SUCCESS;
+}
+
+// Function: countPages
+// Queries the node of every page of [start, end) and compares it with the expected node
+// Returns -1 if move_pages() is unavailable
+static int countPages(const char *start, const char *end, int expected, long *local, long *remote)
+{
+    long pageSize = sysconf(_SC_PAGESIZE);
+    void *pages[256];
+    int status[256];
+    uintptr_t page, last;
+    int count, index;
+
+    if (end <= start)
+    {
+        return 0;
+    }
+
+    page = (uintptr_t)start & ~(uintptr_t)(pageSize - 1);
+    last = (uintptr_t)(end - 1) & ~(uintptr_t)(pageSize - 1);
+    while (page <= last)
+    {
+        for (count = 0; count < 256 && page <= last; count++, page += (uintptr_t)pageSize)
+        {
+            pages[count] = (void *)page;
+        }
+        // nodes == NULL only reports where each page currently lives
+        if (syscall(SYS_move_pages, 0, (unsigned long)count, pages, NULL, status, 0) != 0)
+        {
+            return -1;
+        }
+        for (index = 0; index < count; index++)
+        {
+            if (status[index] == expected)
+                (*local)++;
+            else if (status[index] >= 0)
+                (*remote)++;
+        }
+    }
+
+    return 0;
+}
+
+// Function: smvp_numa_stats
+// Reports the binding of A and, on multi-node pools, where the pages of each CSR partition actually live
+int smvp_numa_stats(const smvp_matrix_t *A, smvp_numa_t *stats)
+{
+    int tid, expected;
+    int64_t first, last;
+
+    if (A == NULL || stats == NULL)
+    {
+        return SMVP_ERR_INVALID;
+    }
+
+    stats->threads = A->nthreads;
+    stats->nodes = (A->pool != NULL) ? smvpPoolNodes(A->pool) : 1;
+    stats->placed = A->placed;
+    stats->replicated = (A->xrep != NULL);
+    stats->local_pages = -1;
+    stats->remote_pages = -1;
+    if (stats->nodes == 1)
+    {
+        return SMVP_SUCCESS;
+    }
+
+    stats->local_pages = 0;
+    stats->remote_pages = 0;
+    for (tid = 0; tid < A->nthreads; tid++)
+    {
+        expected = smvpPoolNodeId(A->pool, smvpPoolWorkerNode(A->pool, tid));
+        first = offsetAt(A->csr.row_ptr, A->part[tid]);
+        last = offsetAt(A->csr.row_ptr, A->part[tid + 1]);
+        if (countPages((const char *)(A->csr.val + first), (const char *)(A->csr.val + last), expected, &stats->local_pages, &stats->remote_pages) != 0 ||
+            countPages((const char *)(A->csr.col_ind + first), (const char *)(A->csr.col_ind + last), expected, &stats->local_pages, &stats->remote_pages) != 0)
+        {
+            stats->local_pages = -1;
+            stats->remote_pages = -1;
+            break;
+        }
+    }
+
+    return SMVP_SUCCESS;
+}
+
+// Function: lockArray
+// Locks an array into RAM and touches every page so later reads take no faults
+static int lockArray(void *ptr)
+{
+    volatile char *page = (volatile char *)ptr;
+    size_t len, offset;
+    long pageSize = sysconf(_SC_PAGESIZE);
+    int status = SMVP_SUCCESS;
+
+    if (ptr == NULL || (len = smvpAllocSize(ptr)) == 0)
+    {
+        return SMVP_SUCCESS;
+    }
+
+    // mlock() commonly fails under the default RLIMIT_MEMLOCK, prefaulting alone still removes first-touch cost
+    if (mlock(ptr, len) != 0)
+    {
+        status = SMVP_ERR_SYSTEM;
+    }
+
+    // Read and write back one byte per page so both the mapping and any copy-on-write fault are resolved now
+    for (offset = 0; offset < len; offset += (size_t)pageSize)
+    {
+        page[offset] = page[offset];
+    }
+    page[len - 1] = page[len - 1];
+
+    return status;
+}
+
+// Function: smvp_lock
+// Prefaults and mlocks every array held by the handle, bound plan scratch included, returns SMVP_ERR_SYSTEM if
+// locking failed (prefault still done). smvp_bind() and smvp_analyze() allocate fresh plan scratch, so call it
+// again after either
+int smvp_lock(smvp_matrix_t *A)
+{
+    int status = SMVP_SUCCESS;
+    void *arrays[24];
+    int index, node, count = 0;
+
+    if (A == NULL)
+    {
+        return SMVP_ERR_INVALID;
+    }
+
+    arrays[count++] = offsetsData(A->csr.row_ptr);
+    arrays[count++] = A->csr.col_ind;
+    arrays[count++] = A->csr.val;
+    if (A->formats & SMVP_FORMAT_CSC)
+    {
+        arrays[count++] = offsetsData(A->csc.col_ptr);
+        arrays[count++] = A->csc.row_ind;
+        arrays[count++] = A->csc.val;
+    }
+    if (A->formats & SMVP_FORMAT_TJDS)
+    {
+        arrays[count++] = A->tjds.val;
+        arrays[count++] = A->tjds.row_ind;
+        arrays[count++] = offsetsData(A->tjds.start_pos);
+        arrays[count++] = A->tjds.perm;
+    }
+    if (A->formats & SMVP_FORMAT_ACSR)
+    {
+        arrays[count++] = A->acsr.rows;
+    }
+    if (A->formats & SMVP_FORMAT_TILED)
+    {
+        arrays[count++] = offsetsData(A->tiled.tile_start);
+        arrays[count++] = A->tiled.rows;
+        arrays[count++] = offsetsData(A->tiled.seg_ptr);
+        arrays[count++] = A->tiled.col_ind;
+        arrays[count++] = A->tiled.val;
+    }
+    // Scratch of the bound plans, written or read by every threaded product (NULL entries are skipped)
+    arrays[count++] = A->part;
+    arrays[count++] = A->acsr.part;
+    arrays[count++] = A->acsr.partial;
+    arrays[count++] = A->tiled.part;
+    arrays[count++] = A->transpose.col_part;
+    arrays[count++] = A->transpose.buffers;
+    arrays[count++] = offsetsData(A->transpose.split);
+
+    for (index = 0; index < count; index++)
+    {
+        if (lockArray(arrays[index]) != SMVP_SUCCESS)
+        {
+            status = SMVP_ERR_SYSTEM;
+        }
+    }
+    for (node = 0; A->xrep != NULL && node < smvpPoolNodes(A->pool); node++)
+    {
+        if (lockArray(A->xrep[node]) != SMVP_SUCCESS)
+        {
+            status = SMVP_ERR_SYSTEM;
+        }
+    }
+
+    return status;
+}
+
+// Function: smvp_get_info
+// Fills an info structure describing the handle
+int smvp_get_info(const smvp_matrix_t *A, smvp_info_t *info)
+{
+    if (A == NULL || info == NULL)
+    {
+        return SMVP_ERR_INVALID;
+    }
+
+    info->rows = A->rows;
+    info->cols = A->cols;
+    info->nnz = A->nnz;
+    info->index_bits = A->index_bits;
+    info->formats = A->formats;
+    info->num_tjdiag = (A->formats & SMVP_FORMAT_TJDS) ? A->tjds.num_tjdiag : 0;
+    info->backing = smvp_alloc_backing(A->csr.val);
+    info->bytes = A->bytes;
+    info->bytes_peak = A->bytes_peak;
+    info->tjds_build_peak = A->tjds_build_peak;
+    info->tjds_bytes = A->tjds_bytes;
+    info->csr_prefetch = A->csr_prefetch;
+    info->tjds_prefetch = A->tjds_prefetch;
+    info->transpose_mode = A->transpose.mode;
+    info->transpose_bytes = A->transpose.bytes;
+    info->nthreads = A->nthreads;
+
+    return SMVP_SUCCESS;
+}
+
+// Function: smvp_get_csr
+// Exposes read-only views of the canonical CSR arrays, SMVP_ERR_WIDTH if the row pointers are 64-bit
+int smvp_get_csr(const smvp_matrix_t *A, const int **row_ptr, const int **col_ind, const double **val)
+{
+    if (A == NULL)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    if (A->index_bits != 32)
+    {
+        return SMVP_ERR_WIDTH;
+    }
+
+    *row_ptr = A->csr.row_ptr.i32;
+    *col_ind = A->csr.col_ind;
+    *val = A->csr.val;
+
+    return SMVP_SUCCESS;
+}
+
+// Function: smvp_get_csr64
+// Exposes read-only views of the canonical CSR arrays, SMVP_ERR_WIDTH if the row pointers are 32-bit
+int smvp_get_csr64(const smvp_matrix_t *A, const int64_t **row_ptr, const int **col_ind, const double **val)
+{
+    if (A == NULL)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    if (A->index_bits != 64)
+    {
+        return SMVP_ERR_WIDTH;
+    }
+
+    *row_ptr = A->csr.row_ptr.i64;
+    *col_ind = A->csr.col_ind;
+    *val = A->csr.val;
+
+    return SMVP_SUCCESS;
+}
+
+// Function: smvp_get_tjds
+// Exposes read-only views of the TJDS arrays, SMVP_ERR_WIDTH if the diagonal starts are 64-bit
+int smvp_get_tjds(const smvp_matrix_t *A, const double **val, const int **row_ind, const int **start_pos, const int **perm, int *num_tjdiag)
+{
+    if (A == NULL)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    if (!(A->formats & SMVP_FORMAT_TJDS))
+    {
+        return SMVP_ERR_NOT_ANALYZED;
+    }
+    if (A->index_bits != 32)
+    {
+        return SMVP_ERR_WIDTH;
+    }
+
+    *val = A->tjds.val;
+    *row_ind = A->tjds.row_ind;
+    *start_pos = A->tjds.start_pos.i32;
+    *perm = A->tjds.perm;
+    *num_tjdiag = A->tjds.num_tjdiag;
+
+    return SMVP_SUCCESS;
+}
+
+// Function: smvp_get_tjds64
+// Exposes read-only views of the TJDS arrays, SMVP_ERR_WIDTH if the diagonal starts are 32-bit
+int smvp_get_tjds64(const smvp_matrix_t *A, const double **val, const int **row_ind, const int64_t **start_pos, const int **perm, int *num_tjdiag)
+{
+    if (A == NULL)
+    {
+        return SMVP_ERR_INVALID;
+    }
+    if (!(A->formats & SMVP_FORMAT_TJDS))
+    {
+        return SMVP_ERR_NOT_ANALYZED;
+    }
+    if (A->index_bits != 64)
+    {
+        return SMVP_ERR_WIDTH;
+    }
+
+    *val = A->tjds.val;
+    *row_ind = A->tjds.row_ind;
+    *start_pos = A->tjds.start_pos.i64;
+    *perm = A->tjds.perm;
+    *num_tjdiag = A->tjds.num_tjdiag;
+
+    return SMVP_SUCCESS;
+}
+
+// Function: smvp_destroy
+// Releases a handle and every format it holds
+void smvp_destroy(smvp_matrix_t *A)
+{
+    if (A == NULL)
+    {
+        return;
+    }
+
+    if (A->pool != NULL)
+    {
+        unbind(A);
+    }
+    smvp_free(A->tjds.val);
+    smvp_free(A->tjds.row_ind);
+    smvp_free(offsetsData(A->tjds.start_pos));
+    smvp_free(A->tjds.perm);
+    smvp_free(A->acsr.rows);
+    smvp_free(offsetsData(A->tiled.tile_start));
+    smvp_free(offsetsData(A->tiled.seg_ptr));
+    smvp_free(A->tiled.rows);
+    smvp_free(A->tiled.col_ind);
+    smvp_free(A->tiled.val);
+    smvp_free(offsetsData(A->csc.col_ptr));
+    smvp_free(A->csc.row_ind);
+    smvp_free(A->csc.val);
+    smvp_free(offsetsData(A->csr.row_ptr));
+    smvp_free(A->csr.col_ind);
+    smvp_free(A->csr.val);
+    free(A);
+}
+
+// Function: smvp_strerror
+// Converts a status code into a printable message
+const char *smvp_strerror(int status)
+{
+    switch (status)
+    {
+    case SMVP_SUCCESS:
+        return "success";
+    case SMVP_ERR_ALLOC:
+        return "out of memory";
+    case SMVP_ERR_INVALID:
+        return "invalid argument";
+    case SMVP_ERR_NOT_ANALYZED:
+        return "format not analyzed";
+    case SMVP_ERR_SYSTEM:
+        return "system call failed";
+    case SMVP_ERR_FORMAT:
+        return "not a valid panel file";
+    case SMVP_ERR_WIDTH:
+        return "index width does not match the accessor";
+    default:
+        return "unknown error";
+    }
+}
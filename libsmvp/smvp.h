@@ -0,0 +1,371 @@
+/* 
+*  ==================================================================
+*  smvp.h for smvp-toolbox
+*  Sparse matrix-vector product library (inspector/executor API)
+*  ==================================================================
+*
+*  Usage:
+*      smvp_matrix_t *A;
+*      smvp_create_coo(&A, rows, cols, nnz, row, col, val, NULL); // copy in, default options
+*      smvp_analyze(A, SMVP_FORMAT_TJDS);                     // convert once
+*      for (...)
+*          smvp_multiply(A, SMVP_FORMAT_TJDS, 1.0, x, 0.0, y); // y = alpha*A*x + beta*y
+*      smvp_destroy(A);
+*
+*  All indices are 0-based. x must hold cols entries and y rows entries;
+*  both are owned by the caller. smvp_multiply() never allocates.
+*
+*  Parallel CSR:
+*      smvp_pool_t *P;
+*      smvp_pool_create(&P, 8, SMVP_NUMA_AUTO); // workers, pinned per node
+*      smvp_bind(A, P, 8);                      // partition rows, first touch
+*      smvp_touch_rows(A, y);                   // place y like the rows
+*      smvp_multiply(A, SMVP_FORMAT_CSR, ...);  // runs on the pool
+*
+*  A pool may be shared by several matrices and rebound with a different
+*  thread count. Multiplies through one pool are serialized, each one over
+*  all of its phases, so callers may share a bound handle.
+*
+*  Handle options:
+*      smvp_options_t opts;
+*      smvp_options_init(&opts);             // library defaults
+*      opts.hugepages = SMVP_HUGE_THP;       // huge page policy, index width, ACSR split,
+*      smvp_create_csr(&A, ..., &opts);      // tiling and transpose plan are per handle
+*
+*      The options are copied when the handle is created and never change
+*      afterwards, so handles on different threads do not affect each other.
+*
+*  Index width:
+*      Offset arrays are 32-bit for matrices of up to opts.index_limit
+*      non-zeros and 64-bit above, chosen when the handle is created.
+*      smvp_get_info() reports index_bits; smvp_get_csr() and smvp_get_tjds()
+*      return 32-bit views, smvp_get_csr64() and smvp_get_tjds64() 64-bit ones.
+*
+*  Adaptive CSR:
+*      smvp_analyze(A, SMVP_FORMAT_ACSR);    // bin rows by length, O(rows)
+*      smvp_get_acsr_bins(A, &bins);         // non-zeros per bin
+*      smvp_multiply(A, SMVP_FORMAT_ACSR, ...);
+*
+*      Rows of length 1 to 4 run fully unrolled loops, longer ones unrolled
+*      loops with independent partial sums. On a bound matrix the rows of
+*      every bin are shared out over the workers, and rows of at least
+*      opts.acsr_split non-zeros are split across all of them.
+*
+*  Column-tiled CSR (x larger than the cache):
+*      smvp_analyze(A, SMVP_FORMAT_TILED);   // tiles sized to opts.tile_level
+*      smvp_get_tile_stats(A, &stats);       // tile width and x reuse
+*      smvp_multiply(A, SMVP_FORMAT_TILED, ...);
+*
+*      The kernel runs tile by tile, so the x entries read stay in the
+*      target cache while every row of the tile uses them. Bound matrices
+*      give each worker its own rows in every tile.
+*
+*  Transpose products (y = alpha * A^T * x + beta * y, no transposed copy):
+*      smvp_analyze(A, SMVP_FORMAT_TRANSPOSE);          // plan, scratch for bound matrices
+*      smvp_multiply_transpose(A, 1.0, x, 0.0, y);     // x: rows entries, y: cols entries
+*
+*      Bound matrices either give every worker a private y, added up by a
+*      parallel reduction, or give every worker a column range of y. The
+*      plan picks the option that costs less in bytes moved per product
+*      plus scratch held, never with more scratch than the matrix itself
+*      (serial when neither fits), and is redone on every smvp_bind();
+*      smvp_get_info() reports it.
+*
+*  Software prefetch (CSR and TJDS):
+*      smvp_tune_prefetch(A, SMVP_FORMAT_CSR, NULL, 0, x, y, &tune); // time distances, keep the best
+*      smvp_set_prefetch(A, SMVP_FORMAT_TJDS, 32);                   // or set one directly
+*
+*      The kernels then request x (and y for TJDS) distance non-zeros
+*      ahead of the one being summed. tune.gain is the speedup of the
+*      chosen distance over the plain kernel, timed in the same pass.
+*
+*  Filling CSR in place (no staging copy):
+*      smvp_create_csr_fill(&A, rows, cols, row_ptr, &col_ind, &val, NULL);
+*      // write every row's columns (ascending) and values, from any threads
+*
+*  Out-of-core CSR (matrices larger than memory):
+*      smvp_panel_writer_t *W;
+*      smvp_panels_begin(&W, path, rows, cols, row_nnz, 64 << 20); // plan panels
+*      smvp_panels_put(W, p, row_ptr, col_ind, val);              // every panel, any order
+*      smvp_panels_end(W);
+*
+*      smvp_panels_t *P;
+*      smvp_panels_open(&P, path);
+*      smvp_panels_multiply(P, 1.0, x, 0.0, y, &stats); // streams the file once
+*      smvp_panels_close(P);
+*
+*  Only x and y are held in memory; panels are read into two alternating
+*  buffers so the read of panel k+1 overlaps the product over panel k.
+*/
+
+#ifndef SMVP_H
+#define SMVP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/********************* Status codes ***************************/
+
+#define SMVP_SUCCESS 0
+#define SMVP_ERR_ALLOC 1        /* out of memory */
+#define SMVP_ERR_INVALID 2      /* bad argument, dimension or index */
+#define SMVP_ERR_NOT_ANALYZED 3 /* format requested before smvp_analyze() */
+#define SMVP_ERR_SYSTEM 4       /* OS call failed, see errno */
+#define SMVP_ERR_FORMAT 5       /* file is not a panel file, or is truncated */
+#define SMVP_ERR_WIDTH 6        /* view of the other index width requested, see smvp_info_t.index_bits */
+
+/********************* Storage formats ***************************/
+
+#define SMVP_FORMAT_CSR (1 << 0)
+#define SMVP_FORMAT_CSC (1 << 1)
+#define SMVP_FORMAT_TJDS (1 << 2)
+#define SMVP_FORMAT_ACSR (1 << 3) /* adaptive CSR: rows binned by length, one specialized kernel per bin */
+#define SMVP_FORMAT_TILED (1 << 4) /* column-tiled CSR: one CSR block per tile of columns sized to a cache level */
+#define SMVP_FORMAT_TRANSPOSE (1 << 5) /* y = A^T * x straight from the CSR arrays, see smvp_multiply_transpose() */
+
+/********************* Transpose products ***************************/
+
+#define SMVP_TRANSPOSE_AUTO (-1)   /* pick by the cost heuristic, see smvp_options_t.transpose_mode */
+#define SMVP_TRANSPOSE_SERIAL 0    /* one thread (serial or single-worker matrices) */
+#define SMVP_TRANSPOSE_PRIVATE 1   /* every worker scatters its rows into a private y, a parallel reduction adds them up */
+#define SMVP_TRANSPOSE_OWNER 2     /* every worker owns a column range of y and walks its share of every row */
+
+/********************* Adaptive CSR ***************************/
+
+#define SMVP_ACSR_BINS 5            /* row lengths 1, 2-4, 5-16, 17-64 and 65 or more */
+#define SMVP_ACSR_SPLIT_DEFAULT 4096 /* long rows with at least this many non-zeros are split across the workers */
+
+/********************* Column-tiled CSR ***************************/
+
+#define SMVP_TILE_LEVEL_DEFAULT 2                /* cache level whose half holds the x slice of one tile */
+#define SMVP_TILE_CACHE_FALLBACK (256UL * 1024) /* cache size assumed when sysfs does not report the level */
+
+/********************* Software prefetch ***************************/
+
+#define SMVP_PREFETCH_OFF 0
+#define SMVP_PREFETCH_MAX 4096    /* longest distance accepted, in non-zeros */
+#define SMVP_PREFETCH_CANDIDATES 8 /* distances one tuning pass can time, the plain kernel included */
+
+/********************* Allocation policy ***************************/
+
+#define SMVP_HUGE_NONE 0     /* 64-byte aligned pages only */
+#define SMVP_HUGE_THP 1      /* madvise(MADV_HUGEPAGE) for large arrays */
+#define SMVP_HUGE_EXPLICIT 2 /* MAP_HUGETLB for large arrays, falls back to THP */
+
+/********************* Index width ***************************/
+
+/* Offset arrays (row_ptr, col_ptr, start_pos) are 32-bit up to this many non-zeros and 64-bit above it.
+   Row and column indices are always 32-bit. */
+#define SMVP_INDEX_LIMIT_DEFAULT INT32_MAX
+
+/********************* Threading and NUMA placement ***************************/
+
+#define SMVP_NUMA_OFF 0       /* threads are not pinned, memory is placed by whoever touches it */
+#define SMVP_NUMA_AUTO 1      /* pin workers per node and first-touch each row partition (multi-node only) */
+#define SMVP_NUMA_REPLICATE 2 /* SMVP_NUMA_AUTO plus a per-node copy of x refreshed on every multiply */
+
+#define SMVP_BACKING_ALIGNED 0
+#define SMVP_BACKING_THP 1
+#define SMVP_BACKING_HUGETLB 2
+
+/********************* Out-of-core panel files ***************************/
+
+#define SMVP_PANEL_MAGIC "SMVPPNL1"
+#define SMVP_PANEL_ALIGN 4096 /* panels start and end on this boundary (O_DIRECT) */
+
+typedef struct smvp_matrix smvp_matrix_t;
+typedef struct smvp_pool smvp_pool_t;
+typedef struct smvp_panel_writer smvp_panel_writer_t;
+typedef struct smvp_panels smvp_panels_t;
+
+// Struct: smvp_options
+// Per-handle settings, copied when the handle is created (smvp_options_init() fills the defaults)
+typedef struct smvp_options
+{
+    int hugepages;       // SMVP_HUGE_* policy of the handle's arrays
+    int64_t index_limit; // Non-zero count above which offsets are 64-bit (at most SMVP_INDEX_LIMIT_DEFAULT)
+    int acsr_split;      // Row length from which bound adaptive CSR splits rows across the workers (at least 65)
+    int tile_level;      // Cache level the column tiles are sized for
+    int tile_cols;       // Fixed tile width instead of tile_level (0 = size from the cache)
+    int transpose_mode;  // SMVP_TRANSPOSE_* plan of bound transpose products (AUTO = cost heuristic)
+} smvp_options_t;
+
+// Struct: smvp_info
+// Describes a matrix handle and the memory it holds
+typedef struct smvp_info
+{
+    int rows;
+    int cols;
+    int64_t nnz;
+    int index_bits;         // 32 or 64, width of the offset arrays
+    int formats;            // SMVP_FORMAT_* bitmask of analyzed formats
+    int num_tjdiag;         // Transpose jagged diagonals (0 until TJDS is analyzed)
+    int backing;            // SMVP_BACKING_* of the value array
+    size_t bytes;           // Bytes currently held by the handle
+    size_t bytes_peak;      // High-water mark of bytes
+    size_t tjds_build_peak; // Bytes held above the pre-conversion level while building TJDS
+    size_t tjds_bytes;      // Size of the finished TJDS arrays
+    int csr_prefetch;       // Software prefetch distance of the CSR kernel (0 = off)
+    int tjds_prefetch;      // Software prefetch distance of the TJDS kernel (0 = off)
+    int transpose_mode;     // SMVP_TRANSPOSE_* planned for transpose products (SERIAL until bound)
+    size_t transpose_bytes; // Scratch held for bound transpose products (private buffers or row splits)
+    int nthreads;           // Pool workers the matrix is bound to (0 = serial)
+} smvp_info_t;
+
+// Struct: smvp_acsr_bins
+// How the rows and non-zeros of an adaptive CSR matrix fall into the row-length bins
+typedef struct smvp_acsr_bins
+{
+    int rows[SMVP_ACSR_BINS];
+    int64_t nnz[SMVP_ACSR_BINS];
+    int empty_rows; // Rows without non-zeros, outside every bin
+    int split_rows; // Rows of the last bin that bound multiplies split across the workers
+} smvp_acsr_bins_t;
+
+// Struct: smvp_tile_stats
+// Shape of a column-tiled CSR matrix and how often each x entry it loads is reused
+typedef struct smvp_tile_stats
+{
+    int tile_cols;      // Columns per tile (the last tile may be narrower)
+    int num_tiles;
+    int cache_level;    // Cache level the tiles were sized for (0 = width set with smvp_options_t.tile_cols)
+    size_t cache_bytes; // Size of that cache as read from sysfs (0 when set directly or unknown)
+    int64_t segments;   // Row segments stored: per tile, the rows with non-zeros in it
+    int64_t x_lines;    // Distinct 64-byte x lines read per multiply, each once while its tile is resident
+    double x_reuse;     // Non-zeros (gathers) per x line read
+} smvp_tile_stats_t;
+
+// Struct: smvp_prefetch_tune
+// Result of a prefetch calibration pass: the time of one multiply at every distance tried
+typedef struct smvp_prefetch_tune
+{
+    int distance;                              // Chosen distance (0 = the plain kernel was fastest)
+    int candidates;                            // Entries of tried and seconds
+    int tried[SMVP_PREFETCH_CANDIDATES];       // tried[0] is always 0, the plain kernel
+    double seconds[SMVP_PREFETCH_CANDIDATES];  // Fastest multiply at each distance
+    double gain;                               // seconds[0] over the time of the chosen distance
+} smvp_prefetch_tune_t;
+
+// Struct: smvp_numa
+// Describes how a bound matrix is spread over the machine
+typedef struct smvp_numa
+{
+    int threads;       // Workers the matrix is bound to (0 = serial)
+    int nodes;         // Nodes the workers are placed on (1 = placement off)
+    int placed;        // SMVP_FORMAT_* bitmask of formats first-touched per partition (0 = none)
+    int replicated;    // x is copied per node on every multiply
+    long local_pages;  // CSR pages found on the node of the worker that owns them (-1 = unknown)
+    long remote_pages; // CSR pages found on another node (-1 = unknown)
+} smvp_numa_t;
+
+// Struct: smvp_panel_header
+// First bytes of a panel file, followed by npanels smvp_panel_entry records
+// Each panel holds a CSR block of consecutive rows with a 0-based local row_ptr:
+// row_ptr (nrows + 1 int32), col_ind (nnz int32), val (nnz double), each array 8-byte aligned
+typedef struct smvp_panel_header
+{
+    char magic[8]; // SMVP_PANEL_MAGIC
+    int32_t rows;
+    int32_t cols;
+    int64_t nnz;
+    int64_t panel_bytes; // Budget the panels were planned with
+    int32_t npanels;
+    int32_t reserved;
+} smvp_panel_header_t;
+
+// Struct: smvp_panel_entry
+// Locates one panel in a panel file
+typedef struct smvp_panel_entry
+{
+    int32_t first_row;
+    int32_t nrows;
+    int64_t nnz;
+    int64_t offset; // Multiple of SMVP_PANEL_ALIGN
+    int64_t bytes;  // Payload length, the file is padded to the next SMVP_PANEL_ALIGN
+} smvp_panel_entry_t;
+
+// Struct: smvp_stream_stats
+// Where the time of one streamed multiply went
+typedef struct smvp_stream_stats
+{
+    int panels;
+    int direct;             // Panels were read with O_DIRECT (otherwise the page cache was dropped first)
+    size_t bytes_read;      // Panel payload bytes
+    double io_seconds;      // Spent inside pread() on the I/O thread
+    double compute_seconds; // Spent in the kernel on the calling thread
+    double stall_seconds;   // Kernel waited for a panel that was not read yet
+    double wall_seconds;    // Whole multiply
+} smvp_stream_stats_t;
+
+/********************* Allocation ***************************/
+
+void *smvp_alloc(size_t len, int huge);
+void smvp_free(void *ptr);
+int smvp_alloc_backing(const void *ptr);
+const char *smvp_backing_name(int backing);
+
+/********************* Matrix handle ***************************/
+
+void smvp_options_init(smvp_options_t *opts);
+int smvp_create_coo(smvp_matrix_t **A, int rows, int cols, int64_t nnz,
+                    const int row[], const int col[], const double val[], const smvp_options_t *opts);
+int smvp_create_csr(smvp_matrix_t **A, int rows, int cols,
+                    const int row_ptr[], const int col_ind[], const double val[], const smvp_options_t *opts);
+int smvp_create_csr64(smvp_matrix_t **A, int rows, int cols,
+                      const int64_t row_ptr[], const int col_ind[], const double val[], const smvp_options_t *opts);
+int smvp_create_csr_fill(smvp_matrix_t **A, int rows, int cols, const int64_t row_ptr[],
+                         int **col_ind, double **val, const smvp_options_t *opts);
+int smvp_analyze(smvp_matrix_t *A, int formats);
+int smvp_get_acsr_bins(const smvp_matrix_t *A, smvp_acsr_bins_t *bins);
+int smvp_get_tile_stats(const smvp_matrix_t *A, smvp_tile_stats_t *stats);
+int smvp_multiply(const smvp_matrix_t *A, int format, double alpha,
+                  const double x[], double beta, double y[]);
+int smvp_multiply_transpose(const smvp_matrix_t *A, double alpha, const double x[],
+                            double beta, double y[]);
+int smvp_set_prefetch(smvp_matrix_t *A, int format, int distance);
+int smvp_tune_prefetch(smvp_matrix_t *A, int format, const int distances[], int count,
+                       const double x[], double y[], smvp_prefetch_tune_t *tune);
+int smvp_lock(smvp_matrix_t *A);
+int smvp_get_info(const smvp_matrix_t *A, smvp_info_t *info);
+void smvp_destroy(smvp_matrix_t *A);
+const char *smvp_strerror(int status);
+
+/********************* Worker pool ***************************/
+
+int smvp_pool_create(smvp_pool_t **pool, int nthreads, int numa);
+void smvp_pool_destroy(smvp_pool_t *pool);
+int smvp_pool_size(const smvp_pool_t *pool);
+int smvp_pool_pin(smvp_pool_t *pool, int first_cpu);
+int smvp_cache_size(int level, size_t *bytes);
+int smvp_pool_counters(const smvp_pool_t *pool, long long *local, long long *remote);
+int smvp_bind(smvp_matrix_t *A, smvp_pool_t *pool, int nthreads);
+int smvp_touch_rows(const smvp_matrix_t *A, double y[]);
+int smvp_numa_stats(const smvp_matrix_t *A, smvp_numa_t *stats);
+
+/********************* Out-of-core CSR ***************************/
+
+int smvp_panels_begin(smvp_panel_writer_t **W, const char *path, int rows, int cols,
+                      const int row_nnz[], size_t panel_bytes);
+int smvp_panels_count(const smvp_panel_writer_t *W);
+int smvp_panels_span(const smvp_panel_writer_t *W, int panel, int *first_row, int *nrows, long *nnz);
+int smvp_panels_put(smvp_panel_writer_t *W, int panel, const int row_ptr[],
+                    const int col_ind[], const double val[]);
+int smvp_panels_end(smvp_panel_writer_t *W);
+int smvp_panels_open(smvp_panels_t **P, const char *path);
+int smvp_panels_header(const smvp_panels_t *P, smvp_panel_header_t *header, size_t *max_panel_bytes);
+int smvp_panels_multiply(smvp_panels_t *P, double alpha, const double x[], double beta,
+                         double y[], smvp_stream_stats_t *stats);
+void smvp_panels_close(smvp_panels_t *P);
+
+/********************* Read-only format views ***************************/
+
+int smvp_get_csr(const smvp_matrix_t *A, const int **row_ptr,
+                 const int **col_ind, const double **val);
+int smvp_get_csr64(const smvp_matrix_t *A, const int64_t **row_ptr,
+                   const int **col_ind, const double **val);
+int smvp_get_tjds(const smvp_matrix_t *A, const double **val, const int **row_ind,
+                  const int **start_pos, const int **perm, int *num_tjdiag);
+int smvp_get_tjds64(const smvp_matrix_t *A, const double **val, const int **row_ind,
+                    const int64_t **start_pos, const int **perm, int *num_tjdiag);
+
+#endif
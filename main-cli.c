@@ -9,112 +9,146 @@
 #define REVISION_VER 4
 #define SMVP_CSR_DEBUG 1
 #define SMVP_TJDS_DEBUG 0
+#define SMVP_TJDS_LUTGEN 0
+
+// Required for sched_setaffinity(), sched_getcpu() and RUSAGE_THREAD (used by --stable)
+#define _GNU_SOURCE
 
 #include <math.h>
 #include <float.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <dirent.h>
+#include <pthread.h>
 #include <string.h>
 #include <ctype.h>
 #include <time.h>
 #include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 #include <popt.h>
 #include "mmio/mmio.h"
-
-// ANSI terminal color escape codes for making output BEAUTIFUL
-#define ANSI_COLOR_RED "\x1b[31m"
-#define ANSI_COLOR_GREEN "\x1b[32m"
-#define ANSI_COLOR_YELLOW "\x1b[33m"
-#define ANSI_COLOR_BLUE "\x1b[34m"
-#define ANSI_COLOR_MAGENTA "\x1b[35m"
-#define ANSI_COLOR_CYAN "\x1b[36m"
-#define ANSI_COLOR_RESET "\x1b[0m"
+#include "libsmvp/smvp.h"
+#include "smvp-cli.h"
+#include "smvp-server.h"
 
 #define ALG_ALL 256
 #define ALG_NONE 0
 #define ALG_CSR (1 << 1)
 #define ALG_TJDS (1 << 2)
 #define ALG_CISR (1 << 3)
+#define ALG_OOC (1 << 4)
+#define ALG_ACSR (1 << 5)
+#define ALG_TILED (1 << 6)
+#define ALG_CSRT (1 << 7)
 
-// Struct: _mm_raw_data_
-// Provides a convenient structure for importing/exporting Matrix Market file contents
-typedef struct _mm_raw_data_
-{
-    int row;
-    int col;
-    double val;
-} MMRawData;
-
-// Struct: _mm_data_plus_
-// Provides a sligktly larger structure than _mm_raw_data_for retaining row data for TJDS
-typedef struct _mm_data_plus_
+// Plain CSR multiplies timed as the reference for the column-tiled speedup
+#define TILED_REFERENCE_RUNS 10
+
+// --prefetch auto: calibrate the distance of every prefetching kernel per matrix (0 = off, > 0 = fixed distance)
+#define PREFETCH_AUTO (-1)
+
+// Struct: _stable_config_
+// Provides a convenient structure for carrying jitter-reduction (--stable) settings
+typedef struct _stable_config_
 {
-    int row;
-    int row_orig;
-    int col;
-    double val;
-} MMDataPlus;
-
-// Struct: _csr_data_
-// Provides a convenient structure for storing/manipulating CSR compressed data
-typedef struct _csr_data_
+    int enabled;  // Pin, lock and prefault before the atomic section
+    int cpu;      // CPU to pin the compute thread to (-1 = whichever CPU we start on)
+    int priority; // Attempt to raise scheduling priority
+} StableConfig;
+
+// Struct: _arena_block_
+// Tracks one buffer owned by a RunArena, idle blocks are handed out again to requests of the same length
+typedef struct _arena_block_
 {
-    int *row_ptr;
-    int *col_ind;
-    double *val;
-} CSRData;
-
-// Struct: _tjds_data_
-// Provides a convenient structure for storing/manipulating TJDS compressed data
-typedef struct _tjds_data_
+    void *ptr;
+    size_t len;
+    int inUse;
+    struct _arena_block_ *next;
+} ArenaBlock;
+
+// Struct: _run_arena_
+// Provides a per-run pool that every phase allocates its buffers from
+// Buffers are returned with arenaRelease() when their phase ends and everything is freed by arenaDestroy()
+typedef struct _run_arena_
 {
-    double *val;
-    int *row_ind;
-    int *start_pos;
-} TJDSData;
-
-// Struct: _transpose_table_
-// Provides a convenient structure for sorting TJDS compressed data
-typedef struct _transpose_table_
+    ArenaBlock *blocks;
+    size_t bytesLive;     // Bytes currently handed out
+    size_t bytesPeak;     // High-water mark of bytesLive
+    size_t bytesReserved; // Bytes held by the arena, in use or idle
+    long reuseCount;      // Requests satisfied by an idle block instead of a new allocation
+    int hugepages;        // SMVP_HUGE_* policy of new blocks
+} RunArena;
+
+#define BATCH_CSR 0
+#define BATCH_TJDS 1
+#define BATCH_ALGS 4
+
+// Struct: _batch_item_
+// One matrix of a batch run and the results recorded for it
+typedef struct _batch_item_
 {
-    int originCol;
-    int colLength;
-} TXTable;
-
-// Struct: _results_data_
-// Provides a convenient structure for storing/manipulating algorithm run results
-struct _time_data_
+    char *path;
+    smvp_matrix_t *matrix; // Handed over by the I/O thread, destroyed once benchmarked
+    int loaded;            // I/O thread is done with this item (matrix stays NULL on failure)
+    double loadMs;         // Parse and canonical CSR build, on the I/O thread
+    char error[128];
+    int rows;
+    int cols;
+    long long nnz;
+    int ran[BATCH_ALGS];
+    double convertMs[BATCH_ALGS]; // Format conversion on the compute thread (CSR needs none)
+    double avgMs[BATCH_ALGS];
+    double minMs[BATCH_ALGS];
+    double stdevMs[BATCH_ALGS];
+} BatchItem;
+
+// Struct: _batch_queue_
+// Hands loaded matrices from the I/O thread to the compute thread in order
+typedef struct _batch_queue_
 {
-    double time_total;
-    double time_avg;
-    double time_stdev;
-    double time_min;
-    double time_max;
-    double time_each[];
-};
-
-// Function: newResultsData
-// Initializes and returns a _time_data_ struct
-struct _time_data_ *newResultsData(struct _time_data_ *t, int num_runs)
+    BatchItem *items;
+    int count;
+    int maxResident; // Matrices allowed in memory at once, counting the one being benchmarked
+    int resident;    // Matrices loading or loaded and not yet destroyed
+    const smvp_options_t *options; // Handle options of every loaded matrix
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} BatchQueue;
+
+// Scaling sweep: a point saturates bandwidth once it reaches this fraction of the matrix's best GB/s
+#define SWEEP_SATURATION 0.9
+#define SWEEP_MAX_THREADS 1024
+
+// Struct: _sweep_result_
+// One matrix of a scaling sweep and its median time at every thread count of the grid
+typedef struct _sweep_result_
 {
-    t = (struct _time_data_ *)malloc(sizeof(*t) + (sizeof(double) * num_runs));
-
-    t->time_total = 0;
-    t->time_avg = 0;
-    t->time_stdev = 0;
-    t->time_min = 0;
-    t->time_max = 0;
-
-    return t;
-}
+    const char *path;
+    char error[128];
+    int rows;
+    int cols;
+    long long nnz;
+    int indexBits;    // Width of the row pointers the kernel streams
+    double *medianMs; // One per grid point, NULL when the matrix could not be loaded
+    int saturation;   // Fewest threads reaching SWEEP_SATURATION of the peak bandwidth
+} SweepResult;
 
 // Function: calcStDevDouble
 // Calculates standard deviation for an array of doubles
 double calcStDevDouble(double data[], int len)
 {
     int i;
-    double sum, mean, stdev;
+    double sum = 0, mean, stdev = 0;
 
     for (i = 0; i < len; ++i)
     {
@@ -139,6 +173,334 @@ void vectorInit(int vectorLen, double *outputVector, double val)
     }
 }
 
+// Function: arenaInit
+// Prepares an empty run arena whose blocks follow the SMVP_HUGE_* policy hugepages
+void arenaInit(RunArena *arena, int hugepages)
+{
+    arena->blocks = NULL;
+    arena->bytesLive = 0;
+    arena->bytesPeak = 0;
+    arena->bytesReserved = 0;
+    arena->reuseCount = 0;
+    arena->hugepages = hugepages;
+}
+
+// Function: arenaAcquire
+// Hands out an idle arena buffer of exactly the requested length, or allocates a new one via smvp_alloc()
+// Contents are undefined, callers initialize what they use
+void *arenaAcquire(RunArena *arena, size_t len)
+{
+    ArenaBlock *block;
+
+    for (block = arena->blocks; block != NULL; block = block->next)
+    {
+        if (!block->inUse && block->len == len)
+        {
+            arena->reuseCount++;
+            break;
+        }
+    }
+
+    if (block == NULL)
+    {
+        block = (ArenaBlock *)malloc(sizeof(ArenaBlock));
+        block->ptr = smvp_alloc(len, arena->hugepages);
+        if (block->ptr == NULL)
+        {
+            printf(ANSI_COLOR_RED "[ERROR]\tUnable to allocate %zu bytes of working memory.\n" ANSI_COLOR_RESET, len);
+            exit(1);
+        }
+        block->len = len;
+        block->next = arena->blocks;
+        arena->blocks = block;
+        arena->bytesReserved += len;
+    }
+
+    block->inUse = 1;
+    arena->bytesLive += len;
+    if (arena->bytesLive > arena->bytesPeak)
+    {
+        arena->bytesPeak = arena->bytesLive;
+    }
+
+    return block->ptr;
+}
+
+// Function: arenaStreamAlloc
+// StreamAlloc adapter so the compressed input pipeline stages into arena buffers
+void *arenaStreamAlloc(void *ctx, size_t len)
+{
+    return arenaAcquire((RunArena *)ctx, len);
+}
+
+// Function: arenaRelease
+// Ends the lifetime of an arena buffer, keeping the memory for reuse by a later phase
+void arenaRelease(RunArena *arena, void *ptr)
+{
+    ArenaBlock *block;
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    for (block = arena->blocks; block != NULL; block = block->next)
+    {
+        if (block->ptr == ptr && block->inUse)
+        {
+            block->inUse = 0;
+            arena->bytesLive -= block->len;
+            return;
+        }
+    }
+
+    printf(ANSI_COLOR_RED "[ERROR]\tAttempted to release a buffer not owned by the run arena.\n" ANSI_COLOR_RESET);
+    exit(1);
+}
+
+// Function: arenaDestroy
+// Frees every buffer owned by the arena regardless of lifetime
+void arenaDestroy(RunArena *arena)
+{
+    ArenaBlock *block;
+
+    while ((block = arena->blocks) != NULL)
+    {
+        arena->blocks = block->next;
+        smvp_free(block->ptr);
+        free(block);
+    }
+    arena->bytesLive = 0;
+    arena->bytesReserved = 0;
+}
+
+// Function: newResultsData
+// Initializes and returns a _time_data_ struct from the run arena, released with arenaRelease() once reported
+struct _time_data_ *newResultsData(RunArena *arena, int num_runs)
+{
+    struct _time_data_ *t = (struct _time_data_ *)arenaAcquire(arena, sizeof(*t) + (sizeof(double) * num_runs));
+
+    t->time_total = 0;
+    t->time_avg = 0;
+    t->time_stdev = 0;
+    t->time_min = 0;
+    t->time_max = 0;
+    t->stable = 0;
+    t->minor_faults = 0;
+    t->major_faults = 0;
+    t->vol_ctx_switches = 0;
+    t->invol_ctx_switches = 0;
+    t->migrations = 0;
+    t->backing = SMVP_BACKING_ALIGNED;
+    t->dtlb_valid = 0;
+    t->dtlb_misses = 0;
+    t->threads = 0;
+    t->numa_counters_valid = 0;
+    t->numa_local_loads = 0;
+    t->numa_remote_loads = 0;
+    memset(&t->stream, 0, sizeof(t->stream));
+    t->load_ms = 0;
+    t->convert_ms = 0;
+    t->prefetch = 0;
+    t->prefetch_gain = 0;
+
+    return t;
+}
+
+// Function: arenaTrim
+// Frees idle arena buffers, used between batch matrices whose buffer sizes never repeat
+void arenaTrim(RunArena *arena)
+{
+    ArenaBlock **link = &arena->blocks;
+    ArenaBlock *block;
+
+    while ((block = *link) != NULL)
+    {
+        if (block->inUse)
+        {
+            link = &block->next;
+            continue;
+        }
+        *link = block->next;
+        arena->bytesReserved -= block->len;
+        smvp_free(block->ptr);
+        free(block);
+    }
+}
+
+// Function: arenaReport
+// Displays arena usage and peak resident memory of the process
+void arenaReport(RunArena *arena)
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+    printf(ANSI_COLOR_CYAN "[DATA]\tRun arena peak usage: " ANSI_COLOR_RESET "%.2f MiB (%ld buffer reuses)\n", (double)arena->bytesPeak / (1024 * 1024), arena->reuseCount);
+    printf(ANSI_COLOR_CYAN "[DATA]\tPeak resident memory: " ANSI_COLOR_RESET "%.2f MiB\n", (double)usage.ru_maxrss / 1024);
+}
+
+// Function: dtlbCounterOpen
+// Opens a disabled per-thread hardware counter for dTLB load misses, returns -1 if unavailable (VMs, perf_event_paranoid)
+int dtlbCounterOpen(void)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// Function: dtlbCounterClose
+// Reads and closes a dTLB counter opened by dtlbCounterOpen(), storing the result in the time structure
+void dtlbCounterClose(int counterFd, struct _time_data_ *timeData, int compiter)
+{
+    long long count;
+
+    if (counterFd < 0)
+    {
+        printf(ANSI_COLOR_CYAN "[DATA]\tdTLB load misses: " ANSI_COLOR_RESET "unavailable (no hardware counter access)\n");
+        return;
+    }
+
+    ioctl(counterFd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(counterFd, &count, sizeof(count)) == sizeof(count))
+    {
+        timeData->dtlb_valid = 1;
+        timeData->dtlb_misses = count;
+        printf(ANSI_COLOR_CYAN "[DATA]\tdTLB load misses: " ANSI_COLOR_RESET "%lld total, %g per iteration\n", count, (double)count / compiter);
+    }
+    close(counterFd);
+}
+
+// Function: stableApplyAffinity
+// Pins the calling thread to a single CPU and optionally raises its scheduling priority (--stable)
+// Pool workers (pool may be NULL) are pinned to their own CPUs from the same one on
+void stableApplyAffinity(StableConfig *stable, smvp_pool_t *pool)
+{
+    cpu_set_t cpuMask;
+    struct sched_param schedParam;
+
+    if (!stable->enabled)
+    {
+        return;
+    }
+
+    // Default to the CPU we are already running on so the first iteration doesn't pay for a migration
+    if (stable->cpu < 0)
+    {
+        stable->cpu = sched_getcpu();
+    }
+
+    CPU_ZERO(&cpuMask);
+    CPU_SET(stable->cpu, &cpuMask);
+    if (sched_setaffinity(0, sizeof(cpuMask), &cpuMask) != 0)
+    {
+        printf(ANSI_COLOR_RED "[WARN]	Unable to pin compute thread to CPU %d (%s).\n" ANSI_COLOR_RESET, stable->cpu, strerror(errno));
+    }
+    else
+    {
+        printf(ANSI_COLOR_YELLOW "[INFO]	Stable mode: compute thread pinned to CPU %d.\n" ANSI_COLOR_RESET, stable->cpu);
+    }
+    if (pool != NULL && smvp_pool_pin(pool, stable->cpu) != SMVP_SUCCESS)
+    {
+        printf(ANSI_COLOR_RED "[WARN]	Unable to pin worker threads from CPU %d.\n" ANSI_COLOR_RESET, stable->cpu);
+    }
+    else if (pool != NULL)
+    {
+        printf(ANSI_COLOR_YELLOW "[INFO]	Stable mode: %d worker threads pinned from CPU %d on.\n" ANSI_COLOR_RESET, smvp_pool_size(pool), stable->cpu);
+    }
+
+    if (stable->priority)
+    {
+        // Prefer a real-time policy, fall back to the lowest nice value if we lack CAP_SYS_NICE for SCHED_FIFO
+        schedParam.sched_priority = sched_get_priority_min(SCHED_FIFO);
+        if (sched_setscheduler(0, SCHED_FIFO, &schedParam) == 0)
+        {
+            printf(ANSI_COLOR_YELLOW "[INFO]	Stable mode: scheduling policy raised to SCHED_FIFO (priority %d).\n" ANSI_COLOR_RESET, schedParam.sched_priority);
+        }
+        else if (setpriority(PRIO_PROCESS, 0, -20) == 0)
+        {
+            printf(ANSI_COLOR_YELLOW "[INFO]	Stable mode: nice value raised to -20.\n" ANSI_COLOR_RESET);
+        }
+        else
+        {
+            printf(ANSI_COLOR_RED "[WARN]	Unable to raise scheduling priority (%s).\n" ANSI_COLOR_RESET, strerror(errno));
+        }
+    }
+}
+
+// Function: stablePrefault
+// Locks a buffer into RAM and touches every page so no faults are taken inside the atomic section
+void stablePrefault(StableConfig *stable, void *buffer, size_t bufferLen)
+{
+    static int mlockWarned = 0;
+    volatile char *page;
+    long pageSize;
+    size_t offset;
+
+    if (!stable->enabled || buffer == NULL || bufferLen == 0)
+    {
+        return;
+    }
+
+    // mlock() commonly fails under the default RLIMIT_MEMLOCK, prefaulting alone still removes most first-touch cost
+    if (mlock(buffer, bufferLen) != 0 && !mlockWarned)
+    {
+        printf(ANSI_COLOR_RED "[WARN]	Unable to lock buffers into memory (%s), continuing with prefault only.\n" ANSI_COLOR_RESET, strerror(errno));
+        mlockWarned = 1;
+    }
+
+    // Read and write back one byte per page so both the mapping and any copy-on-write fault are resolved now
+    pageSize = sysconf(_SC_PAGESIZE);
+    page = (volatile char *)buffer;
+    for (offset = 0; offset < bufferLen; offset += (size_t)pageSize)
+    {
+        page[offset] = page[offset];
+    }
+    page[bufferLen - 1] = page[bufferLen - 1];
+}
+
+// Function: stableSampleBegin
+// Captures resource usage immediately before the atomic section: the compute thread's, or the whole
+// process's when pooled workers run the kernel
+void stableSampleBegin(StableConfig *stable, int pooled, struct rusage *usageStart)
+{
+    if (stable->enabled)
+    {
+        getrusage(pooled ? RUSAGE_SELF : RUSAGE_THREAD, usageStart);
+    }
+}
+
+// Function: stableSampleEnd
+// Records faults and context switches taken during the atomic section, sampled as by stableSampleBegin()
+void stableSampleEnd(StableConfig *stable, int pooled, struct rusage *usageStart, long migrations, struct _time_data_ *timeData)
+{
+    struct rusage usageEnd;
+
+    if (!stable->enabled)
+    {
+        return;
+    }
+
+    getrusage(pooled ? RUSAGE_SELF : RUSAGE_THREAD, &usageEnd);
+    timeData->stable = 1;
+    timeData->minor_faults = usageEnd.ru_minflt - usageStart->ru_minflt;
+    timeData->major_faults = usageEnd.ru_majflt - usageStart->ru_majflt;
+    timeData->vol_ctx_switches = usageEnd.ru_nvcsw - usageStart->ru_nvcsw;
+    timeData->invol_ctx_switches = usageEnd.ru_nivcsw - usageStart->ru_nivcsw;
+    timeData->migrations = migrations;
+
+    printf(ANSI_COLOR_CYAN "[DATA]	Timed loop page faults (minor/major): " ANSI_COLOR_RESET "%ld/%ld\n", timeData->minor_faults, timeData->major_faults);
+    printf(ANSI_COLOR_CYAN "[DATA]	Timed loop context switches (voluntary/involuntary): " ANSI_COLOR_RESET "%ld/%ld\n", timeData->vol_ctx_switches, timeData->invol_ctx_switches);
+    printf(ANSI_COLOR_CYAN "[DATA]	Timed loop CPU migrations: " ANSI_COLOR_RESET "%ld\n", timeData->migrations);
+}
+
 // Function: mmioErrorHandler
 // Provides a simple error handler for known error types (mmio.h)
 void mmioErrorHandler(int retcode)
@@ -158,6 +520,11 @@ void mmioErrorHandler(int retcode)
         printf(ANSI_COLOR_RED "[ERROR]\tCould not process specified Matrix Market input file. Matrix content description not parseable or is absent.\n" ANSI_COLOR_RESET);
         exit(1);
     }
+    else if (retcode == MM_TOO_LARGE)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tCould not process specified Matrix Market input file. Row or column count exceeds the supported maximum of 2^31-1.\n" ANSI_COLOR_RESET);
+        exit(1);
+    }
     else
     {
         printf(ANSI_COLOR_RED "[ERROR]\tCould not process specified Matrix Market input file. Unhandled exception occured during file loading .\n" ANSI_COLOR_RESET);
@@ -165,100 +532,47 @@ void mmioErrorHandler(int retcode)
     }
 }
 
-// Function: mmrd_comparator_row_col
-// Provides a comparitor function for MMRawData structs that matches the format expected by stdlib qsort()
-// Sorts data by row (lowest = leftmost), then by column (lowest = leftmost)
-int mmrd_comparator_row_col(const void *v1, const void *v2)
-{
-    const MMRawData *p1 = (MMRawData *)v1;
-    const MMRawData *p2 = (MMRawData *)v2;
-    if (p1->row < p2->row)
-        return -1;
-    else if (p1->row > p2->row)
-        return +1;
-    else if (p1->col < p2->col)
-        return -1;
-    else if (p1->col > p2->col)
-        return +1;
-    else
-        return 0;
-}
-
-// Function: mmrd_comparator_col_row
-// Provides a comparitor function for MMRawData structs that matches the format expected by stdlib qsort()
-// Sorts data by column (lowest = leftmost), then by row (lowest = leftmost)
-int mmrd_comparator_col_row(const void *v1, const void *v2)
-{
-    const MMRawData *p1 = (MMRawData *)v1;
-    const MMRawData *p2 = (MMRawData *)v2;
-    if (p1->col < p2->col)
-        return -1;
-    else if (p1->col > p2->col)
-        return +1;
-    else if (p1->row < p2->row)
-        return -1;
-    else if (p1->row > p2->row)
-        return +1;
-    else
-        return 0;
-}
-
-// Function: txtable_comparator_len
-// Provides a comparitor function for TXTable structs that matches the format expected by stdlib qsort()
-// Sorts data by colLength (highest = leftmost), then by originCol (lowest = leftmost)
-int txtable_comparator_len(const void *v1, const void *v2)
-{
-    const TXTable *p1 = (TXTable *)v1;
-    const TXTable *p2 = (TXTable *)v2;
-    if (p1->colLength > p2->colLength)
-        return -1;
-    else if (p1->colLength < p2->colLength)
-        return +1;
-    else if (p1->originCol < p2->originCol)
-        return -1;
-    else if (p1->originCol > p2->originCol)
-        return +1;
-    else
-        return 0;
-}
-
-// Function: mmdp_comparator_row_col
-// Provides a comparitor function for MMDataPlus structs that matches the format expected by stdlib qsort()
-// Sorts data by row (lowest = leftmost), then by column (lowest = leftmost)
-int mmdp_comparator_row_col(const void *v1, const void *v2)
+// Function: reportAlgName
+// Returns the name reports and records use for a single ALG_* flag
+const char *reportAlgName(int alg_mode)
 {
-    const MMDataPlus *p1 = (MMDataPlus *)v1;
-    const MMDataPlus *p2 = (MMDataPlus *)v2;
-    if (p1->row < p2->row)
-        return -1;
-    else if (p1->row > p2->row)
-        return +1;
-    else if (p1->col < p2->col)
-        return -1;
-    else if (p1->col > p2->col)
-        return +1;
-    else
-        return 0;
+    if (alg_mode & ALG_CSR)
+    {
+        return "CSR";
+    }
+    else if (alg_mode & ALG_TJDS)
+    {
+        return "TJDS";
+    }
+    else if (alg_mode & ALG_ACSR)
+    {
+        return "ACSR";
+    }
+    else if (alg_mode & ALG_TILED)
+    {
+        return "CSR-TILED";
+    }
+    else if (alg_mode & ALG_CSRT)
+    {
+        return "CSR-T";
+    }
+    return "CSR-OOC";
 }
 
 // Function: generateReportText
-// Generates a report file from calculation results
-void generateReportText(const char *inputFileName, char *reportPath, int alg_mode, int fInputNonZeros, int fInputRows, int iter, double *outputVector, struct _time_data_ *timeData)
+// Generates a report file from calculation results, the output vector goes inline or to a
+// .bin/.npy file next to the report depending on outputFormat (SMVP_OUTPUT_*)
+void generateReportText(const char *inputFileName, char *reportPath, int alg_mode, long long fInputNonZeros, int fInputRows, int iter, double *outputVector, struct _time_data_ *timeData, int outputFormat)
 {
 
-    int index, pathLen, filenameLen;
-    char *alg_name, *outputFileName, *outputFullPath, *dirDelimiter;
+    int pathLen, filenameLen;
+    const char *alg_name = reportAlgName(alg_mode);
+    char *outputFileName, *outputFullPath, *dirDelimiter, *vectorPath = NULL, vectorError[160];
     unsigned long outputFileTime;
     FILE *reportOutputFile;
-
-    if (alg_mode & ALG_CSR)
-    {
-        alg_name = "CSR";
-    }
-    else if (alg_mode & ALG_TJDS)
-    {
-        alg_name = "TJDS";
-    }
+    struct timespec writeStart, writeEnd;
+    long vectorBytes, reportBytes;
+    double writeMs;
 
     dirDelimiter = "/";
 
@@ -290,133 +604,249 @@ void generateReportText(const char *inputFileName, char *reportPath, int alg_mod
     printf(ANSI_COLOR_MAGENTA "[FILE]\tExecution report file saved as:\n" ANSI_COLOR_RESET);
     printf("\t%s\n", outputFullPath);
 
+    clock_gettime(CLOCK_MONOTONIC, &writeStart);
     reportOutputFile = fopen(outputFullPath, "a+");
+    if (reportOutputFile == NULL)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tUnable to create report file: %s.\n" ANSI_COLOR_RESET, strerror(errno));
+        exit(1);
+    }
     fprintf(reportOutputFile, "Execution results for smvp-toolbox v.%d.%d.%d, %s algorithm\n", MAJOR_VER, MINOR_VER, REVISION_VER, alg_name);
     fprintf(reportOutputFile, "Generated on %lu (Unix time)\n\n", outputFileTime);
     fprintf(reportOutputFile, "Sparse matrix file in use:\n%s\n\n", inputFileName);
-    fprintf(reportOutputFile, "Non-zero numbers contained in matrix: %d\n\n", fInputNonZeros);
+    fprintf(reportOutputFile, "Non-zero numbers contained in matrix: %lld\n\n", fInputNonZeros);
     fprintf(reportOutputFile, "Compute times for %d iterations:\n\n", iter);
     fprintf(reportOutputFile, "Total Time: %g ms\n", timeData->time_total);
     fprintf(reportOutputFile, "Average Time: %g ms\n", timeData->time_avg);
     fprintf(reportOutputFile, "Fastest Time: %g ms\n", timeData->time_min);
     fprintf(reportOutputFile, "Slowest Time: %g ms\n", timeData->time_max);
     fprintf(reportOutputFile, "Time StDev: %g ms\n\n", timeData->time_stdev);
-    fprintf(reportOutputFile, "Output vector (one cell per line):\n");
-    fprintf(reportOutputFile, "[\n");
-    for (index = 0; index < fInputRows; index++)
+    if (timeData->stable)
+    {
+        fprintf(reportOutputFile, "Stable mode counters for timed iterations:\n\n");
+        fprintf(reportOutputFile, "Minor Page Faults: %ld\n", timeData->minor_faults);
+        fprintf(reportOutputFile, "Major Page Faults: %ld\n", timeData->major_faults);
+        fprintf(reportOutputFile, "Voluntary Context Switches: %ld\n", timeData->vol_ctx_switches);
+        fprintf(reportOutputFile, "Involuntary Context Switches: %ld\n", timeData->invol_ctx_switches);
+        fprintf(reportOutputFile, "CPU Migrations: %ld\n\n", timeData->migrations);
+    }
+    fprintf(reportOutputFile, "Kernel array backing: %s\n", smvp_backing_name(timeData->backing));
+    if (timeData->dtlb_valid)
+    {
+        fprintf(reportOutputFile, "dTLB Load Misses: %lld (%g per iteration)\n\n", timeData->dtlb_misses, (double)timeData->dtlb_misses / iter);
+    }
+    else
+    {
+        fprintf(reportOutputFile, "dTLB Load Misses: unavailable\n\n");
+    }
+    if (timeData->prefetch > 0 || timeData->prefetch_gain > 0)
+    {
+        fprintf(reportOutputFile, "Software prefetch distance: %d\n", timeData->prefetch);
+        fprintf(reportOutputFile, "Prefetch gain over plain kernel: %.3fx\n\n", timeData->prefetch_gain);
+    }
+    if (timeData->threads > 0)
     {
-        fprintf(reportOutputFile, "%g", outputVector[index]);
-        if (index < fInputRows - 1)
+        fprintf(reportOutputFile, "Threads: %d\n", timeData->threads);
+        fprintf(reportOutputFile, "NUMA nodes used: %d\n", timeData->numa.nodes);
+        fprintf(reportOutputFile, "First-touch placement: %s\n", timeData->numa.placed ? "yes" : "no");
+        fprintf(reportOutputFile, "Replicated x: %s\n", timeData->numa.replicated ? "yes" : "no");
+        if (timeData->numa.local_pages >= 0)
         {
-            fprintf(reportOutputFile, "\n");
+            fprintf(reportOutputFile, "Matrix pages local/remote: %ld/%ld\n", timeData->numa.local_pages, timeData->numa.remote_pages);
         }
-        else
+        if (timeData->numa_counters_valid)
         {
-            fprintf(reportOutputFile, "\n]\n\n");
+            fprintf(reportOutputFile, "Node loads local/remote: %lld/%lld\n", timeData->numa_local_loads, timeData->numa_remote_loads);
         }
+        fprintf(reportOutputFile, "\n");
     }
-
-    fclose(reportOutputFile);
-}
-
-// Function: smvp_csr_compute
-// Calculates SMVP using CSR algorithm
-// Returns results vector directly, time data via pointer
-double *smvp_csr_compute(MMRawData *mmImportData, int fInputRows, int fInputNonZeros, int compiter, struct _time_data_ *csr_time)
-{
-
-    CSRData workingMatrix;
-    double *onesVector, *outputVector;
-    double comp_time_taken;
-    int i, j, index;
-    double *time_run = (double *)malloc(compiter * sizeof(double));
-    struct timespec *time_run_start = (struct timespec *)malloc(sizeof(struct timespec) * compiter);
-    struct timespec *time_run_end = (struct timespec *)malloc(sizeof(struct timespec) * compiter);
-
-    // Convert loaded data to CSR format
-    printf(ANSI_COLOR_YELLOW "[INFO]\tConverting loaded content to CSR format.\n" ANSI_COLOR_RESET);
-
-    // Sort imported data now to simplify future data processing
-    qsort(mmImportData, (size_t)fInputNonZeros, sizeof(MMRawData), mmrd_comparator_row_col);
-
-    // Allocate memory for CSR storage
-    workingMatrix.row_ptr = (int *)malloc(sizeof(int) * (long unsigned int)(fInputRows + 1));
-    workingMatrix.col_ind = (int *)malloc(sizeof(int) * (long unsigned int)fInputNonZeros);
-    workingMatrix.val = (double *)malloc(sizeof(double) * (long unsigned int)fInputNonZeros);
-
-    // Convert MatrixMarket format into CSR format
-    for (index = 0; index < fInputNonZeros; index++)
+    if (timeData->stream.panels > 0)
     {
-        workingMatrix.val[index] = mmImportData[index].val;
-        workingMatrix.col_ind[index] = mmImportData[index].col;
-
-        if (index == fInputNonZeros - 1)
+        fprintf(reportOutputFile, "Panels: %d (%s)\n", timeData->stream.panels, timeData->stream.direct ? "O_DIRECT" : "page cache dropped before each pass");
+        fprintf(reportOutputFile, "Panel bytes read per iteration: %zu\n", timeData->stream.bytes_read / iter);
+        fprintf(reportOutputFile, "I/O time per iteration: %g ms\n", timeData->stream.io_seconds * 1e3 / iter);
+        fprintf(reportOutputFile, "Compute time per iteration: %g ms\n", timeData->stream.compute_seconds * 1e3 / iter);
+        fprintf(reportOutputFile, "Stall time per iteration: %g ms\n", timeData->stream.stall_seconds * 1e3 / iter);
+        fprintf(reportOutputFile, "I/O bandwidth: %g MB/s\n", timeData->stream.bytes_read / 1e6 / timeData->stream.io_seconds);
+        fprintf(reportOutputFile, "Compute throughput: %g MB/s\n\n", timeData->stream.bytes_read / 1e6 / timeData->stream.compute_seconds);
+    }
+    if (outputFormat == SMVP_OUTPUT_TEXT)
+    {
+        fprintf(reportOutputFile, "Output vector (one cell per line):\n");
+        if ((vectorBytes = smvpWriteVectorText(reportOutputFile, outputVector, fInputRows)) < 0)
         {
-            workingMatrix.row_ptr[mmImportData[index].row + 1] = fInputNonZeros;
+            snprintf(vectorError, sizeof(vectorError), "%s", strerror(errno));
         }
-        else if (mmImportData[index].row < mmImportData[(index + 1)].row)
+    }
+    else
+    {
+        // Same name as the report with the format as its extension
+        vectorPath = strdup(outputFullPath);
+        strcpy(vectorPath + strlen(vectorPath) - strlen("txt"), smvpOutputFormatName(outputFormat));
+        if (outputFormat == SMVP_OUTPUT_BIN)
         {
-            workingMatrix.row_ptr[mmImportData[index].row + 1] = index + 1;
+            vectorBytes = smvpWriteVectorBinary(vectorPath, outputVector, fInputRows, vectorError, sizeof(vectorError));
+            fprintf(reportOutputFile, "Output vector: %d little-endian float64 values in\n%s\n\n", fInputRows, vectorPath);
         }
-        else if (index == 0)
+        else
         {
-            workingMatrix.row_ptr[mmImportData[index].row] = 0;
+            vectorBytes = smvpWriteVectorNpy(vectorPath, outputVector, fInputRows, vectorError, sizeof(vectorError));
+            fprintf(reportOutputFile, "Output vector: NumPy array of shape (%d,) in\n%s\n\n", fInputRows, vectorPath);
         }
     }
+    if (vectorBytes < 0)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tUnable to write output vector: %s.\n" ANSI_COLOR_RESET, vectorError);
+        exit(1);
+    }
 
-    // Prepare the "ones" vector and output vector
-    onesVector = (double *)malloc(sizeof(double) * (long unsigned int)fInputRows);
-    vectorInit(fInputRows, onesVector, 1);
-    outputVector = (double *)malloc(sizeof(double) * (long unsigned int)fInputRows);
+    // Text vectors are part of the report file itself
+    reportBytes = ftell(reportOutputFile) + ((outputFormat != SMVP_OUTPUT_TEXT) ? vectorBytes : 0);
+    fclose(reportOutputFile);
+    clock_gettime(CLOCK_MONOTONIC, &writeEnd);
+    writeMs = ((writeEnd.tv_sec - writeStart.tv_sec) * 1e9 + (writeEnd.tv_nsec - writeStart.tv_nsec)) / 1e6;
+    if (vectorPath != NULL)
+    {
+        printf("\t%s\n", vectorPath);
+    }
+    printf(ANSI_COLOR_CYAN "[DATA]\tReport write time: " ANSI_COLOR_RESET "%g ms (%.1f MB/s, output vector as %s)\n", writeMs, reportBytes / 1e3 / writeMs, smvpOutputFormatName(outputFormat));
 
-    printf(ANSI_COLOR_YELLOW "[INFO]\tCalculating %d iterations of SMVP CSR.\n" ANSI_COLOR_RESET, compiter);
+    free(vectorPath);
+    free(outputFullPath);
+    free(outputFileName);
+}
 
-    if (SMVP_CSR_DEBUG)
+// Function: generateReportRecord
+// Writes the machine-readable JSON record and CSV row of one algorithm run next to its report
+// matrix supplies the row-length statistics and may be NULL when the matrix is not resident
+// The samples are also kept in compare (NULL without --compare) for the baseline comparison
+void generateReportRecord(const char *inputFileName, char *reportPath, int alg_mode, int rows, int cols, long long nnz, const smvp_matrix_t *matrix, int iter, struct _time_data_ *timeData, CompareSet *compare)
+{
+    RunRecord record;
+    char version[32], jsonPath[4096], error[256];
+
+    snprintf(version, sizeof(version), "%d.%d.%d", MAJOR_VER, MINOR_VER, REVISION_VER);
+    record.version = version;
+    record.matrixPath = inputFileName;
+    record.algorithm = reportAlgName(alg_mode);
+    record.rows = rows;
+    record.cols = cols;
+    record.nnz = nnz;
+    record.matrix = matrix;
+    record.iterations = iter;
+    record.timeData = timeData;
+    smvpCompareAdd(compare, &record);
+
+    // A missing record must not cost the run its results, the text report is already written
+    if (smvpWriteRunRecord(reportPath, &record, jsonPath, sizeof(jsonPath), error, sizeof(error)) != 0)
     {
-        printf("[DEBUG]\tCSR JIT row_ptr:\n\t[");
-        for (i = 0; i < fInputRows + 1; i++)
-        {
-            printf("%d, ", workingMatrix.row_ptr[i]);
-        }
-        printf("]\n");
-        printf("[DEBUG]\tCSR JIT val:\n\t[");
-        for (i = 0; i < fInputNonZeros; i++)
-        {
-            printf("%g, ", workingMatrix.val[i]);
-        }
-        printf("]\n");
-        printf("[DEBUG]\tCSR JIT col_ind:\n\t[");
-        for (i = 0; i < fInputNonZeros; i++)
-        {
-            printf("%d, ", workingMatrix.col_ind[i]);
-        }
-        printf("]\n\n");
+        printf(ANSI_COLOR_RED "[WARN]\tUnable to write benchmark record: %s.\n" ANSI_COLOR_RESET, error);
+        return;
     }
+    printf(ANSI_COLOR_MAGENTA "[FILE]\tBenchmark record saved as:\n" ANSI_COLOR_RESET);
+    printf("\t%s\n", jsonPath);
+}
 
-    //
-    // ATOMIC SECTION START
-    // PERFORM NO ACTIONS OTHER THAN SMVP BETWEEN START AND END TIME CAPTURES
-    //
+// Function: summarizeTimes
+// Populates the totals, extremes and spread of the time structure from its per-iteration times (ms)
+void summarizeTimes(struct _time_data_ *timeData, int compiter)
+{
+    int i;
 
-    // Compute CSR SMVP (technically y=Axn, not y=x(A^n) as indicated in reqs doc, but is an approved deviation)
     for (i = 0; i < compiter; i++)
     {
-        //Reset output vector contents between iterations
-        vectorInit(fInputRows, outputVector, 0);
+        timeData->time_total += timeData->time_each[i];
+        timeData->time_avg += timeData->time_each[i];
 
-        // Capture compute run start time
-        clock_gettime(CLOCK_MONOTONIC_RAW, &time_run_start[i]);
-
-        for (index = 0; index < fInputRows; index++)
+        if (i == 0)
+        {
+            timeData->time_min = timeData->time_each[i];
+            timeData->time_max = timeData->time_each[i];
+        }
+        else
         {
-            for (j = workingMatrix.row_ptr[index]; j < workingMatrix.row_ptr[index + 1]; j++)
+            if (timeData->time_min > timeData->time_each[i])
+            {
+                timeData->time_min = timeData->time_each[i];
+            }
+            if (timeData->time_max < timeData->time_each[i])
             {
-                outputVector[index] += workingMatrix.val[j] * onesVector[workingMatrix.col_ind[j]];
+                timeData->time_max = timeData->time_each[i];
             }
         }
+    }
+    timeData->time_avg /= compiter;
+    timeData->time_stdev = calcStDevDouble(timeData->time_each, compiter);
+}
+
+// Function: smvp_timed_multiply
+// Runs compiter timed y = A*x products through libsmvp and populates the time structure
+// Shared by every benchmarked format so all of them are measured identically, SMVP_FORMAT_TRANSPOSE times y = A^T*x
+void smvp_timed_multiply(RunArena *arena, smvp_matrix_t *matrix, int format, double *onesVector, double *outputVector, int compiter, struct _time_data_ *timeData, StableConfig *stable)
+{
+    smvp_info_t info;
+    int i, cpu, lastCpu, dtlbFd, inLen, outLen;
+    long migrations = 0;
+    struct rusage usageStart;
+    double *time_run = (double *)arenaAcquire(arena, compiter * sizeof(double));
+    struct timespec *time_run_start = (struct timespec *)arenaAcquire(arena, sizeof(struct timespec) * compiter);
+    struct timespec *time_run_end = (struct timespec *)arenaAcquire(arena, sizeof(struct timespec) * compiter);
+
+    smvp_get_info(matrix, &info);
+    inLen = (format == SMVP_FORMAT_TRANSPOSE) ? info.rows : info.cols;
+    outLen = (format == SMVP_FORMAT_TRANSPOSE) ? info.cols : info.rows;
+
+    // Fault in and lock every buffer touched by the atomic section (no-op unless --stable)
+    if (stable->enabled && smvp_lock(matrix) != SMVP_SUCCESS)
+    {
+        printf(ANSI_COLOR_RED "[WARN]\tUnable to lock matrix into memory (%s), continuing with prefault only.\n" ANSI_COLOR_RESET, strerror(errno));
+    }
+    stablePrefault(stable, onesVector, sizeof(double) * (long unsigned int)inLen);
+    stablePrefault(stable, outputVector, sizeof(double) * (long unsigned int)outLen);
+    stablePrefault(stable, time_run_start, sizeof(struct timespec) * compiter);
+    stablePrefault(stable, time_run_end, sizeof(struct timespec) * compiter);
+    stableSampleBegin(stable, info.nthreads > 0, &usageStart);
+    lastCpu = sched_getcpu();
+
+    // Record which backing the matrix arrays received and count dTLB misses over the whole timed loop
+    timeData->backing = info.backing;
+    dtlbFd = dtlbCounterOpen();
+    if (dtlbFd >= 0)
+    {
+        ioctl(dtlbFd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(dtlbFd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    //
+    // ATOMIC SECTION START
+    // PERFORM NO ACTIONS OTHER THAN SMVP BETWEEN START AND END TIME CAPTURES
+    //
+
+    // Compute SMVP (technically y=Axn, not y=x(A^n) as indicated in reqs doc, but is an approved deviation)
+    // beta = 0 overwrites the output vector, so no reset is needed between iterations
+    for (i = 0; i < compiter; i++)
+    {
+        // Capture compute run start time
+        clock_gettime(CLOCK_MONOTONIC_RAW, &time_run_start[i]);
+
+        if (format == SMVP_FORMAT_TRANSPOSE)
+        {
+            smvp_multiply_transpose(matrix, 1.0, onesVector, 0.0, outputVector);
+        }
+        else
+        {
+            smvp_multiply(matrix, format, 1.0, onesVector, 0.0, outputVector);
+        }
 
         // Capture compute run end time
         clock_gettime(CLOCK_MONOTONIC_RAW, &time_run_end[i]);
+
+        // Track migrations outside of the timed region
+        if (stable->enabled && (cpu = sched_getcpu()) != lastCpu)
+        {
+            lastCpu = cpu;
+            migrations++;
+        }
     }
 
     //
@@ -424,6 +854,9 @@ double *smvp_csr_compute(MMRawData *mmImportData, int fInputRows, int fInputNonZ
     // PERFORM NO ACTIONS OTHER THAN SMVP BETWEEN START AND END TIME CAPTURES
     //
 
+    dtlbCounterClose(dtlbFd, timeData, compiter);
+    stableSampleEnd(stable, info.nthreads > 0, &usageStart, migrations, timeData);
+
     // Convert all per-run timespec structs to time in milliseconds & populate time structure
     for (i = 0; i < compiter; i++)
     {
@@ -431,46 +864,187 @@ double *smvp_csr_compute(MMRawData *mmImportData, int fInputRows, int fInputNonZ
         time_run[i] = (double)((time_run_end[i].tv_sec * 1e9 + time_run_end[i].tv_nsec) - (time_run_start[i].tv_sec * 1e9 + time_run_start[i].tv_nsec));
         time_run[i] /= 1e6;
 
-        csr_time->time_each[i] = time_run[i];
-        csr_time->time_total += time_run[i];
-        csr_time->time_avg += time_run[i];
+        timeData->time_each[i] = time_run[i];
+    }
+    summarizeTimes(timeData, compiter);
 
-        if (i == 0)
+    arenaRelease(arena, time_run);
+    arenaRelease(arena, time_run_start);
+    arenaRelease(arena, time_run_end);
+}
+
+// Function: numaCountersBegin
+// Snapshots the pool's node load counters before a threaded timed loop
+void numaCountersBegin(smvp_pool_t *pool, struct _time_data_ *timeData)
+{
+    timeData->numa_counters_valid = (smvp_pool_counters(pool, &timeData->numa_local_loads, &timeData->numa_remote_loads) == SMVP_SUCCESS);
+}
+
+// Function: numaCountersEnd
+// Records the placement of a threaded run and the node loads it caused, and displays both
+void numaCountersEnd(smvp_pool_t *pool, smvp_matrix_t *matrix, struct _time_data_ *timeData)
+{
+    long long local, remote;
+
+    smvp_numa_stats(matrix, &timeData->numa);
+    timeData->threads = timeData->numa.threads;
+    if (timeData->numa_counters_valid && smvp_pool_counters(pool, &local, &remote) == SMVP_SUCCESS)
+    {
+        timeData->numa_local_loads = local - timeData->numa_local_loads;
+        timeData->numa_remote_loads = remote - timeData->numa_remote_loads;
+    }
+    else
+    {
+        timeData->numa_counters_valid = 0;
+    }
+
+    printf(ANSI_COLOR_CYAN "[DATA]\tThreads: " ANSI_COLOR_RESET "%d\n", timeData->threads);
+    if (timeData->numa.nodes == 1)
+    {
+        printf(ANSI_COLOR_CYAN "[DATA]\tNUMA placement: " ANSI_COLOR_RESET "off (single node or --numa off)\n");
+        return;
+    }
+    printf(ANSI_COLOR_CYAN "[DATA]\tNUMA placement: " ANSI_COLOR_RESET "%d nodes, first touch per partition%s\n", timeData->numa.nodes, timeData->numa.replicated ? ", x replicated per node" : "");
+    if (timeData->numa.local_pages >= 0)
+    {
+        printf(ANSI_COLOR_CYAN "[DATA]\tMatrix pages local/remote: " ANSI_COLOR_RESET "%ld/%ld\n", timeData->numa.local_pages, timeData->numa.remote_pages);
+    }
+    if (timeData->numa_counters_valid)
+    {
+        printf(ANSI_COLOR_CYAN "[DATA]\tNode loads local/remote: " ANSI_COLOR_RESET "%lld/%lld\n", timeData->numa_local_loads, timeData->numa_remote_loads);
+    }
+    else
+    {
+        printf(ANSI_COLOR_CYAN "[DATA]\tNode loads local/remote: " ANSI_COLOR_RESET "unavailable (no hardware counter access)\n");
+    }
+}
+
+// Function: prefetchCalibrate
+// Applies the --prefetch setting to the CSR or TJDS kernel of a matrix. The chosen distance is timed against the
+// plain kernel in the same pass, so the gain is reported for auto and fixed distances alike
+void prefetchCalibrate(smvp_matrix_t *matrix, int format, const char *name, int prefetch, const double *x, double *y, struct _time_data_ *timeData)
+{
+    smvp_prefetch_tune_t tune;
+    int candidate, status;
+
+    if (prefetch == 0)
+    {
+        return;
+    }
+
+    printf(ANSI_COLOR_YELLOW "[INFO]\tCalibrating %s software prefetch distance.\n" ANSI_COLOR_RESET, name);
+    status = smvp_tune_prefetch(matrix, format, (prefetch > 0) ? &prefetch : NULL, (prefetch > 0) ? 1 : 0, x, y, &tune);
+    if (status != SMVP_SUCCESS)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\t%s prefetch calibration failed: %s.\n" ANSI_COLOR_RESET, name, smvp_strerror(status));
+        exit(1);
+    }
+
+    // A fixed distance is kept even when the plain kernel was faster
+    if (prefetch > 0)
+    {
+        smvp_set_prefetch(matrix, format, prefetch);
+        tune.distance = prefetch;
+        tune.gain = (tune.seconds[1] > 0) ? tune.seconds[0] / tune.seconds[1] : 1.0;
+    }
+
+    printf(ANSI_COLOR_CYAN "[DATA]\t%s prefetch calibration: " ANSI_COLOR_RESET, name);
+    for (candidate = 0; candidate < tune.candidates; candidate++)
+    {
+        printf("%sd=%d %.4f ms", (candidate == 0) ? "" : ", ", tune.tried[candidate], tune.seconds[candidate] * 1e3);
+    }
+    printf("\n");
+    if (tune.distance > 0)
+    {
+        printf(ANSI_COLOR_CYAN "[DATA]\t%s prefetch distance: " ANSI_COLOR_RESET "%d non-zeros (%.3fx the plain kernel)\n", name, tune.distance, tune.gain);
+    }
+    else
+    {
+        printf(ANSI_COLOR_CYAN "[DATA]\t%s prefetch distance: " ANSI_COLOR_RESET "off (no distance beat the plain kernel)\n", name);
+    }
+    timeData->prefetch = tune.distance;
+    timeData->prefetch_gain = tune.gain;
+}
+
+// Function: smvp_csr_compute
+// Calculates SMVP using CSR algorithm
+// Returns results vector directly, time data via pointer
+double *smvp_csr_compute(RunArena *arena, smvp_matrix_t *matrix, smvp_pool_t *pool, int compiter, int prefetch, struct _time_data_ *csr_time, StableConfig *stable)
+{
+
+    smvp_info_t info;
+    const int *row_ptr, *col_ind;
+    const double *val;
+    double *onesVector, *outputVector;
+    int i;
+
+    // CSR is the canonical representation held by the matrix, no conversion required
+    smvp_get_info(matrix, &info);
+
+    // Prepare the "ones" vector (one entry per column) and output vector (one entry per row)
+    onesVector = (double *)arenaAcquire(arena, sizeof(double) * (long unsigned int)info.cols);
+    vectorInit(info.cols, onesVector, 1);
+    outputVector = (double *)arenaAcquire(arena, sizeof(double) * (long unsigned int)info.rows);
+
+    // Threaded runs place each partition of y on the node of the worker that writes it
+    smvp_touch_rows(matrix, outputVector);
+
+    printf(ANSI_COLOR_YELLOW "[INFO]\tCalculating %d iterations of SMVP CSR.\n" ANSI_COLOR_RESET, compiter);
+
+    // The debug dump reads the 32-bit views, matrices with 64-bit row pointers skip it
+    if (SMVP_CSR_DEBUG && smvp_get_csr(matrix, &row_ptr, &col_ind, &val) == SMVP_SUCCESS)
+    {
+        printf("[DEBUG]\tCSR JIT row_ptr:\n\t[");
+        for (i = 0; i < info.rows + 1; i++)
         {
-            csr_time->time_min = time_run[i];
-            csr_time->time_max = time_run[i];
+            printf("%d, ", row_ptr[i]);
         }
-        else
+        printf("]\n");
+        printf("[DEBUG]\tCSR JIT val:\n\t[");
+        for (i = 0; i < info.nnz; i++)
         {
-            if (csr_time->time_min > time_run[i])
-            {
-                csr_time->time_min = time_run[i];
-            }
-            if (csr_time->time_max < time_run[i])
-            {
-                csr_time->time_max = time_run[i];
-            }
+            printf("%g, ", val[i]);
+        }
+        printf("]\n");
+        printf("[DEBUG]\tCSR JIT col_ind:\n\t[");
+        for (i = 0; i < info.nnz; i++)
+        {
+            printf("%d, ", col_ind[i]);
         }
+        printf("]\n\n");
+    }
+
+    prefetchCalibrate(matrix, SMVP_FORMAT_CSR, "CSR", prefetch, onesVector, outputVector, csr_time);
+    if (pool != NULL)
+    {
+        numaCountersBegin(pool, csr_time);
+    }
+    smvp_timed_multiply(arena, matrix, SMVP_FORMAT_CSR, onesVector, outputVector, compiter, csr_time, stable);
+    printf(ANSI_COLOR_CYAN "[DATA]\tKernel array backing: " ANSI_COLOR_RESET "%s\n", smvp_backing_name(csr_time->backing));
+    if (pool != NULL)
+    {
+        numaCountersEnd(pool, matrix, csr_time);
     }
-    csr_time->time_avg /= compiter;
-    csr_time->time_stdev = calcStDevDouble(csr_time->time_each, compiter);
 
     if (SMVP_CSR_DEBUG)
     {
         printf("[DEBUG]\tCSR JIT Vector Out:\n\t[");
-        for (i = 0; i < fInputRows; i++)
+        for (i = 0; i < info.rows; i++)
         {
             printf("%g, ", outputVector[i]);
         }
         printf("]\n\n");
     }
 
+    // End of the CSR phase, only the output vector outlives it (released by the caller once reported)
+    arenaRelease(arena, onesVector);
+
     return outputVector;
 }
 
 // Function: smvp_cisr_coegen
 // Generates CISR COE data file
-void smvp_cisr_coegen(MMRawData *mmImportData, int fInputRows, int fInputNonZeros, int slotCount) //, const char *inputFileName, char *reportPath)
+void smvp_cisr_coegen(RunArena *arena, smvp_matrix_t *matrix, int slotCount) //, const char *inputFileName, char *reportPath)
 {
 
     typedef struct _cisr_value_data_
@@ -480,41 +1054,27 @@ void smvp_cisr_coegen(MMRawData *mmImportData, int fInputRows, int fInputNonZero
         int slot;
     } CISRValData;
 
-    CSRData workingMatrix;
-    int i, j, index;
-
-    int *cisr_rowLengths = (int *)malloc(sizeof(int) * (long unsigned int)(fInputRows + 1));
-
-    // Convert loaded data to CSR format
+    struct
+    {
+        const int *row_ptr;
+        const int *col_ind;
+        const double *val;
+    } workingMatrix;
+    smvp_info_t info;
+    int fInputRows, fInputNonZeros;
+    int *cisr_rowLengths;
+
+    // CISR is built from the cached canonical CSR representation, whose 32-bit view the slot tables index with int
     printf(ANSI_COLOR_YELLOW "[INFO]\tConverting loaded content to CISR format.\n" ANSI_COLOR_RESET);
-
-    // Sort imported data now to simplify future data processing
-    qsort(mmImportData, (size_t)fInputNonZeros, sizeof(MMRawData), mmrd_comparator_row_col);
-
-    // Allocate memory for CSR storage
-    workingMatrix.row_ptr = (int *)malloc(sizeof(int) * (long unsigned int)(fInputRows + 1));
-    workingMatrix.col_ind = (int *)malloc(sizeof(int) * (long unsigned int)fInputNonZeros);
-    workingMatrix.val = (double *)malloc(sizeof(double) * (long unsigned int)fInputNonZeros);
-
-    // Convert MatrixMarket format into CSR format
-    for (index = 0; index < fInputNonZeros; index++)
+    smvp_get_info(matrix, &info);
+    if (smvp_get_csr(matrix, &workingMatrix.row_ptr, &workingMatrix.col_ind, &workingMatrix.val) != SMVP_SUCCESS)
     {
-        workingMatrix.val[index] = mmImportData[index].val;
-        workingMatrix.col_ind[index] = mmImportData[index].col;
-
-        if (index == fInputNonZeros - 1)
-        {
-            workingMatrix.row_ptr[mmImportData[index].row + 1] = fInputNonZeros;
-        }
-        else if (mmImportData[index].row < mmImportData[(index + 1)].row)
-        {
-            workingMatrix.row_ptr[mmImportData[index].row + 1] = index + 1;
-        }
-        else if (index == 0)
-        {
-            workingMatrix.row_ptr[mmImportData[index].row] = 0;
-        }
+        printf(ANSI_COLOR_RED "[ERROR]\tCISR generation supports at most %d non-zeros, matrix has %lld.\n" ANSI_COLOR_RESET, INT_MAX, (long long)info.nnz);
+        exit(1);
     }
+    fInputRows = info.rows;
+    fInputNonZeros = (int)info.nnz;
+    cisr_rowLengths = (int *)arenaAcquire(arena, sizeof(int) * (long unsigned int)(fInputRows + 1));
 
     //
     // Convert CSR format into CISR format
@@ -528,7 +1088,7 @@ void smvp_cisr_coegen(MMRawData *mmImportData, int fInputRows, int fInputNonZero
         slot_rowend[clean_0] = 0;
     }
 
-    slotgrp = malloc(sizeof(*slotgrp) * fInputNonZeros + 1); //absolute worst case size
+    slotgrp = arenaAcquire(arena, sizeof(*slotgrp) * fInputNonZeros + 1); //absolute worst case size
 
     int slot_grp_iter = 0;
     int csr_rowptr_iter = 0;
@@ -625,7 +1185,7 @@ void smvp_cisr_coegen(MMRawData *mmImportData, int fInputRows, int fInputNonZero
     //     }
     // }
 
-    CISRValData cisr_valData[slot_grp_total * slotCount + 1];
+    CISRValData *cisr_valData = (CISRValData *)arenaAcquire(arena, sizeof(CISRValData) * (long unsigned int)(slot_grp_total * slotCount + 1));
     int cisrdata_iter_1 = 0;
 
     // After determining the slot group assignments, expand the associated values into a usable data structure
@@ -701,7 +1261,7 @@ void smvp_cisr_coegen(MMRawData *mmImportData, int fInputRows, int fInputNonZero
     {
         // Generate value (cal + col_ind + slot_num) packed block (Contol Code 1)
         result = ((int)cisr_valData[cdv_iter].val << 20) | (cisr_valData[cdv_iter].col_ind << 8) | (cisr_valData[cdv_iter].slot << 0);
-        printf("01%08x,\n", result);
+        printf("01%08" PRIx64 ",\n", result);
 
         // Generate row length packed block if entries remain (Contol Code 2)
         if (rl_iter_1 < fInputRows)
@@ -722,472 +1282,1285 @@ void smvp_cisr_coegen(MMRawData *mmImportData, int fInputRows, int fInputNonZero
                 // No more row-Len entries exist, so append a zero-value and add a no-data entry "0" at bit 12
                 result |= (0x0 << 12) | (0x000 << 0);
             }
-            printf("02%08x,\n", result);
+            printf("02%08" PRIx64 ",\n", result);
         }
     }
     printf("03%08x;\n\n", 0xFFFFFFFF);
+
+    // End of the CISR phase
+    arenaRelease(arena, cisr_valData);
+    arenaRelease(arena, slotgrp);
+    arenaRelease(arena, cisr_rowLengths);
 }
 
 // Function: smvp_tjds_compute
 // Calculates SMVP using TJDS algorithm
 // Returns results vector directly, time data via pointer
-double *smvp_tjds_compute(MMRawData *mmImportData, int fInputRows, int fInputColumns, int fInputNonZeros, int compiter, struct _time_data_ *tjds_time)
+double *smvp_tjds_compute(RunArena *arena, smvp_matrix_t *matrix, int compiter, int prefetch, struct _time_data_ *tjds_time, StableConfig *stable)
 {
 
-    TJDSData workingMatrix;
-    MMDataPlus *mmCloneData;
-    TXTable *txList = (struct _transpose_table_ *)malloc(sizeof(struct _transpose_table_) * fInputColumns);
-    int index, txIter, i, num_tjdiag, k, p, j, sp_index;
-    double *onesVector, *outputVector, *onesVectorTemp;
-    double comp_time_taken;
-    double *time_run = (double *)malloc(compiter * sizeof(double));
-    struct timespec *time_run_start = (struct timespec *)malloc(sizeof(struct timespec) * compiter);
-    struct timespec *time_run_end = (struct timespec *)malloc(sizeof(struct timespec) * compiter);
+    smvp_info_t info;
+    const int *row_ind, *start_pos, *perm;
+    const double *val;
+    double *onesVector, *outputVector;
+    int index, num_tjdiag, status, lutDiagonals;
+    struct timespec convertStart, convertEnd;
 
-    if (SMVP_TJDS_DEBUG)
+    // Convert loaded data to TJDS format (built once and cached by the matrix)
+    printf(ANSI_COLOR_YELLOW "[INFO]\tConverting loaded content to TJDS format.\n" ANSI_COLOR_RESET);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &convertStart);
+    status = smvp_analyze(matrix, SMVP_FORMAT_TJDS);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &convertEnd);
+    tjds_time->convert_ms = ((convertEnd.tv_sec - convertStart.tv_sec) * 1e9 + (convertEnd.tv_nsec - convertStart.tv_nsec)) / 1e6;
+    if (status != SMVP_SUCCESS)
     {
-        printf(ANSI_COLOR_RED "[DEBUG]\tIF YOU CAN READ THIS MESSAGE, TJDS IMPLEMENTATION MAY BE INCOMPLETE AND/OR BROKEN\n" ANSI_COLOR_RESET);
+        printf(ANSI_COLOR_RED "[ERROR]\tTJDS conversion failed: %s.\n" ANSI_COLOR_RESET, smvp_strerror(status));
+        exit(1);
     }
-
-    // Convert loaded data to TJDS format
-    printf(ANSI_COLOR_YELLOW "[INFO]\tConverting loaded content to TJDS format.\n" ANSI_COLOR_RESET);
-
-    // Allocate memory for TJDS storage
-    workingMatrix.val = (double *)malloc(sizeof(double) * (long unsigned int)fInputNonZeros);
-    workingMatrix.row_ind = (int *)malloc(sizeof(int) * (long unsigned int)fInputNonZeros);
-    workingMatrix.start_pos = (int *)malloc(sizeof(int) * (long unsigned int)(fInputRows));
+    smvp_get_info(matrix, &info);
+    printf(ANSI_COLOR_CYAN "[DATA]\tTJDS conversion peak: " ANSI_COLOR_RESET "%zu bytes (final format %zu bytes, %g ms)\n", info.tjds_build_peak, info.tjds_bytes, tjds_time->convert_ms);
 
     // Prepare the "ones" vector and output vector
-    onesVector = (double *)malloc(sizeof(double) * (long unsigned int)fInputRows);
-    vectorInit(fInputRows, onesVector, 1);
-    outputVector = (double *)malloc(sizeof(double) * (long unsigned int)fInputRows);
-
-    // Sort imported data by columns to simplify future data processing
-    qsort(mmImportData, (size_t)fInputNonZeros, sizeof(MMRawData), mmrd_comparator_col_row);
-
-    /* Convert MatrixMarket format into TJDS format */
+    onesVector = (double *)arenaAcquire(arena, sizeof(double) * (long unsigned int)info.cols);
+    vectorInit(info.cols, onesVector, 1);
+    outputVector = (double *)arenaAcquire(arena, sizeof(double) * (long unsigned int)info.rows);
 
-    if (SMVP_TJDS_DEBUG)
+    if (SMVP_TJDS_DEBUG && smvp_get_tjds(matrix, &val, &row_ind, &start_pos, &perm, &num_tjdiag) == SMVP_SUCCESS)
     {
-        printf("[DEBUG]\tTJDS PHASE 0: Original Data (shown sideways):\n");
-        printf("\t[");
-        for (index = 0; index < fInputNonZeros; index++)
+        printf("[DEBUG]\tTJDS Pre-Calc Fields:\n");
+        printf("\tval:\t\t[");
+        for (index = 0; index < info.nnz; index++)
         {
-            printf("%g (%d), ", mmImportData[index].val, mmImportData[index].row);
-            if (mmImportData[index].col < mmImportData[index + 1].col)
-            {
-                printf("\n\t");
-            }
+            printf("%g, ", val[index]);
+        }
+        printf("]\n");
+        printf("\trow_ind:\t[");
+        for (index = 0; index < info.nnz; index++)
+        {
+            printf("%d, ", row_ind[index]);
+        }
+        printf("]\n");
+        printf("\tstart_pos:\t[");
+        for (index = 0; index < num_tjdiag + 1; index++)
+        {
+            printf("%d, ", start_pos[index]);
+        }
+        printf("]\n");
+        printf("\tperm:\t\t[");
+        for (index = 0; index < info.cols; index++)
+        {
+            printf("%d, ", perm[index]);
         }
         printf("]\n\n");
+        printf("\tnum_tjdiag (count, not 0-index):\t%d", num_tjdiag);
+        printf("\n\n");
     }
 
-    // 1. Allocate a "clone" import data object so we don't clobber the original data during compression (in case other algs will be called later)
-    mmCloneData = (MMDataPlus *)malloc(sizeof(MMDataPlus) * (long unsigned int)fInputNonZeros);
-
-    // 2. Compress import data vertically
-    for (index = 0; index < fInputNonZeros; index++)
-    {
-        // Capture the original row of the cell
-        mmCloneData[index].row_orig = mmImportData[index].row;
+    prefetchCalibrate(matrix, SMVP_FORMAT_TJDS, "TJDS", prefetch, onesVector, outputVector, tjds_time);
+    printf(ANSI_COLOR_YELLOW "[INFO]\tCalculating %d iterations of SMVP TJDS.\n" ANSI_COLOR_RESET, compiter);
 
-        // The column and value don't change.
-        mmCloneData[index].col = mmImportData[index].col;
-        mmCloneData[index].val = mmImportData[index].val;
+    smvp_timed_multiply(arena, matrix, SMVP_FORMAT_TJDS, onesVector, outputVector, compiter, tjds_time, stable);
+    printf(ANSI_COLOR_CYAN "[DATA]\tKernel array backing: " ANSI_COLOR_RESET "%s\n", smvp_backing_name(tjds_time->backing));
 
-        // If we're on the first NNZ...
-        if (index == 0)
+    // Inline Vivado LUT builder (sized for a specific FPGA target, enable with SMVP_TJDS_LUTGEN)
+    if (SMVP_TJDS_LUTGEN)
+    {
+        // The LUTs index the cached TJDS arrays through their 32-bit views, independent of the debug dump above
+        if ((status = smvp_get_tjds(matrix, &val, &row_ind, &start_pos, &perm, &num_tjdiag)) != SMVP_SUCCESS)
         {
-            // ...relocate the NNZ to the top of the column (row translate).
-            mmCloneData[index].row = 0;
+            printf(ANSI_COLOR_RED "[ERROR]\tTJDS LUT generation needs the 32-bit TJDS arrays: %s.\n" ANSI_COLOR_RESET, smvp_strerror(status));
+            exit(1);
         }
-        // If we're past the first NNZ...
-        else
+        lutDiagonals = (num_tjdiag < 9 + 1) ? num_tjdiag : 9 + 1;
+
+        for (int i = 0; i < lutDiagonals; i++)
         {
-            // ...and the column has changed between the current and previous NNZ...
-            if (mmImportData[index].col > mmImportData[index - 1].col)
-            {
-                // ...relocate the NNZ to the top of the column (row translate).
-                mmCloneData[index].row = 0;
-            }
-            // ...and there's a row gap between the current and previous NNZ...
-            else if ((mmImportData[index].row - mmImportData[index - 1].row) > 0)
+            for (int j = 0; j < 36519 + 1; j++)
             {
-                // ...relocate the NNZ to just below thw previous NNZ (row translate).
-                mmCloneData[index].row = (mmCloneData[index - 1].row + 1);
-            }
-            // ...and there's no row gap between the current and previous NNZ (DEFAULT CASE ASSUMPTION)...
-            else
-            {
-                // ...do nothing to the row of the NNZ.
-                mmCloneData[index].row = mmCloneData[index].row;
+                if (j < start_pos[i + 1] - start_pos[i] + i && j >= i)
+                {
+                    printf("a_ij[%d][%d] = 1'b1;\n", i, j);
+                }
+                else
+                {
+                    printf("a_ij[%d][%d] = 1'b0;\n", i, j);
+                }
             }
         }
-    }
 
-    if (SMVP_TJDS_DEBUG)
-    {
-        printf("[DEBUG]\tTJDS PHASE 2: Compress Matrix Vertically (shown sideways):\n");
-        printf("\t[");
-        for (index = 0; index < fInputNonZeros; index++)
+        int temp = 0;
+
+        for (int i = 0; i < lutDiagonals; i++)
         {
-            printf("%g (%d), ", mmCloneData[index].val, mmCloneData[index].row);
-            if (mmCloneData[index].col < mmCloneData[index + 1].col)
+            for (int j = 0; j < 36519 + 1; j++)
             {
-                printf("\n\t");
+                if (j < start_pos[i + 1] - start_pos[i] + i && j >= i)
+                {
+                    printf("i[%d][%d] = %d;\n", i, j, row_ind[temp]);
+                    temp++;
+                }
+                else
+                {
+                    printf("i[%d][%d] = 1'b0;\n", i, j);
+                }
             }
         }
-        printf("]\n\n");
     }
 
-    // Generate reordering table
-    // Iterate through the entire set of NNZs...
-    for (index = 0; index < fInputNonZeros; index++)
-    {
-        // ...if a column change is imminent...
-        if (mmCloneData[index].col < mmCloneData[index + 1].col)
-        {
-            // ...document the column length and position of the column.
-            txList[mmCloneData[index].col].colLength = mmCloneData[index].row;
-            txList[mmCloneData[index].col].originCol = mmCloneData[index].col;
-        }
+    // // Inline Vivado COE Builder (WIP)
+    // temp = 0;
+    // uint64_t  packed_val_temp = 0;
+    // int coe_memory_depth_min = fInputNonZeros * 2;
+    // int coe_memory_initialization_radix = 64; // this is a constant for the ROM structure we're using
+    //                                           // Given a radix of 48:
+    //                                           // 16U = TJDS_Row_Num (ex. i[X][]), 16M1 = TJDS_Col_Num (ex. i[][X]), 16M2 = TJDS_i_Val, 16L = TLDS_a_ij_val
+    //                                           // !!! RESIZE STRUCTURE IF ANY NUMBER EXCEEDS 4095 !!!
 
-        // If this is the last NNZ in the set...
-        if (index == fInputNonZeros - 1)
-        {
-            // ...document the column length and position of the the column.
-            txList[mmCloneData[index].col].colLength = mmCloneData[index].row;
-            txList[mmCloneData[index].col].originCol = mmCloneData[index].col;
-        }
-    }
+    // printf("******************************************************************\n");
+    // printf("*************  Single Port Block Memory .COE file   **************\n");
+    // printf("******************************************************************\n");
+    // printf("memory_initialization_radix=%d\n", coe_memory_initialization_radix);
+    // printf("memory_initialization_vector=\n");
+    // for (uint16_t i = 0; i < 7; i++)
+    // {
+    //     for (uint16_t j = 0; j < 33; j++)
+    //     {
+    //         packed_val_temp = 0;
+
+    //         packed_val_temp |= ( i << 48);
+    //         packed_val_temp |= ( j << 32);
+
+    //         if (j < start_pos[i + 1] - start_pos[i] + i && j >= i)
+    //         {
+    //             packed_val_temp |= (1<<0);
+    //         }
+    //         else
+    //         {
+    //             packed_val_temp |= (0<<0);
+    //         }
 
-    // Derive number of transpose jagged diagonals for later use in TJDS computation
-    num_tjdiag = txList[0].colLength + 1;
+    //         if (j < start_pos[i + 1] - start_pos[i] + i && j >= i)
+    //         {
+    //             packed_val_temp |= ((uint16_t)(row_ind[temp]) << 16);
+    //             temp++;
+    //         }
+    //         else
+    //         {
+    //             packed_val_temp |= (0 << 12);
+    //         }
 
-    // 3. Sort reordering table
-    qsort(txList, (size_t)fInputColumns, sizeof(TXTable), txtable_comparator_len);
+    //         if ((i == num_tjdiag - 1) && (j == fInputRows - 1))
+    //         {
+    //             printf("[%d][%d]\t%x;\n", i, j, packed_val_temp);
+    //         }
+    //         else
+    //         {
+    //             printf("[%d][%d]\t%x,\n", i, j, packed_val_temp);
+    //         }
+    //     }
+    // }
 
     if (SMVP_TJDS_DEBUG)
     {
-        printf("[DEBUG]\tTJDS PHASE 3: Reordering Table:\n");
-        printf("key\t[");
-        for (index = 0; index < fInputColumns; index++)
-        {
-            printf("%d, ", index);
-        }
-        printf("]\n");
-        printf("origCol\t[");
-        for (index = 0; index < fInputColumns; index++)
-        {
-            printf("%d, ", txList[index].originCol);
-        }
-        printf("]\n");
-        printf("colLen\t[");
-        for (index = 0; index < fInputColumns; index++)
+        printf("[DEBUG]\tTJDS PHASE 8: Output Vector:\n");
+        printf("\t[");
+        for (index = 0; index < info.rows; index++)
         {
-            printf("%d, ", txList[index].colLength);
+            printf("%g, ", outputVector[index]);
         }
         printf("]\n\n");
     }
 
-    // 4. Reassign import data column assignments and recorded row indicies using reordering table
-    for (index = 0; index < fInputNonZeros; index++)
-    {
-        for (txIter = 0; txIter < fInputColumns; txIter++)
-        {
-            if (txList[txIter].originCol == mmCloneData[index].col)
-            {
-                mmCloneData[index].col = txIter;
-                break;
-            }
-        }
-    }
+    // End of the TJDS phase, only the output vector outlives it (released by the caller once reported)
+    arenaRelease(arena, onesVector);
 
-    // 5. Reassign multiplication vector rows by using reordering table
-    onesVectorTemp = (double *)malloc(sizeof(double) * (long unsigned int)fInputRows);
-    for (index = 0; index < fInputRows; index++)
+    return outputVector;
+}
+
+// Function: smvp_acsr_compute
+// Calculates SMVP using adaptive CSR (rows binned by length, one specialized kernel per bin)
+// Returns results vector directly, time data via pointer
+double *smvp_acsr_compute(RunArena *arena, smvp_matrix_t *matrix, smvp_pool_t *pool, int compiter, struct _time_data_ *acsr_time, StableConfig *stable)
+{
+    static const char *binNames[SMVP_ACSR_BINS] = {"1", "2-4", "5-16", "17-64", "65+"};
+    smvp_acsr_bins_t bins;
+    smvp_info_t info;
+    double *onesVector, *outputVector;
+    int bin, status;
+    struct timespec convertStart, convertEnd;
+
+    // Bin the rows of the loaded CSR by length (built once and cached by the matrix)
+    printf(ANSI_COLOR_YELLOW "[INFO]\tBinning loaded content by row length for adaptive CSR.\n" ANSI_COLOR_RESET);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &convertStart);
+    status = smvp_analyze(matrix, SMVP_FORMAT_ACSR);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &convertEnd);
+    acsr_time->convert_ms = ((convertEnd.tv_sec - convertStart.tv_sec) * 1e9 + (convertEnd.tv_nsec - convertStart.tv_nsec)) / 1e6;
+    if (status != SMVP_SUCCESS)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tAdaptive CSR conversion failed: %s.\n" ANSI_COLOR_RESET, smvp_strerror(status));
+        exit(1);
+    }
+    smvp_get_info(matrix, &info);
+    smvp_get_acsr_bins(matrix, &bins);
+    printf(ANSI_COLOR_CYAN "[DATA]\tACSR binning time: " ANSI_COLOR_RESET "%g ms\n", acsr_time->convert_ms);
+    for (bin = 0; bin < SMVP_ACSR_BINS; bin++)
+    {
+        printf(ANSI_COLOR_CYAN "[DATA]\tACSR bin %-5s " ANSI_COLOR_RESET "%d rows, %lld non-zeros (%.1f%%)\n", binNames[bin], bins.rows[bin], (long long)bins.nnz[bin],
+               (info.nnz > 0) ? 100.0 * (double)bins.nnz[bin] / (double)info.nnz : 0.0);
+    }
+    printf(ANSI_COLOR_CYAN "[DATA]\tACSR empty rows: " ANSI_COLOR_RESET "%d\n", bins.empty_rows);
+    if (pool != NULL)
+    {
+        printf(ANSI_COLOR_CYAN "[DATA]\tACSR rows split across threads: " ANSI_COLOR_RESET "%d\n", bins.split_rows);
+    }
+
+    // Prepare the "ones" vector and output vector
+    onesVector = (double *)arenaAcquire(arena, sizeof(double) * (long unsigned int)info.cols);
+    vectorInit(info.cols, onesVector, 1);
+    outputVector = (double *)arenaAcquire(arena, sizeof(double) * (long unsigned int)info.rows);
+    smvp_touch_rows(matrix, outputVector);
+
+    printf(ANSI_COLOR_YELLOW "[INFO]\tCalculating %d iterations of SMVP ACSR.\n" ANSI_COLOR_RESET, compiter);
+
+    if (pool != NULL)
+    {
+        numaCountersBegin(pool, acsr_time);
+    }
+    smvp_timed_multiply(arena, matrix, SMVP_FORMAT_ACSR, onesVector, outputVector, compiter, acsr_time, stable);
+    printf(ANSI_COLOR_CYAN "[DATA]\tKernel array backing: " ANSI_COLOR_RESET "%s\n", smvp_backing_name(acsr_time->backing));
+    if (pool != NULL)
+    {
+        numaCountersEnd(pool, matrix, acsr_time);
+    }
+
+    // End of the ACSR phase, only the output vector outlives it (released by the caller once reported)
+    arenaRelease(arena, onesVector);
+
+    return outputVector;
+}
+
+// Function: csrReferenceMs
+// Fastest of a few CSR multiplies in ms (with the prefetch distance set, if any), the baseline of the tiled speedup
+double csrReferenceMs(smvp_matrix_t *matrix, const double *x, double *y, int runs)
+{
+    struct timespec start, end;
+    double ms, best = 0;
+    int run;
+
+    for (run = 0; run < runs; run++)
+    {
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+        smvp_multiply(matrix, SMVP_FORMAT_CSR, 1.0, x, 0.0, y);
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+        ms = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / 1e6;
+        best = (run == 0 || ms < best) ? ms : best;
+    }
+
+    return best;
+}
+
+// Function: smvp_tiled_compute
+// Calculates SMVP using column-tiled CSR (one CSR block per cache-sized tile of columns)
+// Returns results vector directly, time data via pointer
+double *smvp_tiled_compute(RunArena *arena, smvp_matrix_t *matrix, smvp_pool_t *pool, int compiter, struct _time_data_ *tiled_time, StableConfig *stable)
+{
+    smvp_tile_stats_t stats;
+    smvp_info_t info;
+    double *onesVector, *outputVector, referenceMs;
+    int status;
+    struct timespec convertStart, convertEnd;
+
+    // Cut the loaded CSR into column tiles (built once and cached by the matrix)
+    printf(ANSI_COLOR_YELLOW "[INFO]\tConverting loaded content to column-tiled CSR format.\n" ANSI_COLOR_RESET);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &convertStart);
+    status = smvp_analyze(matrix, SMVP_FORMAT_TILED);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &convertEnd);
+    tiled_time->convert_ms = ((convertEnd.tv_sec - convertStart.tv_sec) * 1e9 + (convertEnd.tv_nsec - convertStart.tv_nsec)) / 1e6;
+    if (status != SMVP_SUCCESS)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tColumn-tiled CSR conversion failed: %s.\n" ANSI_COLOR_RESET, smvp_strerror(status));
+        exit(1);
+    }
+    smvp_get_info(matrix, &info);
+    smvp_get_tile_stats(matrix, &stats);
+    printf(ANSI_COLOR_CYAN "[DATA]\tTiled CSR conversion time: " ANSI_COLOR_RESET "%g ms\n", tiled_time->convert_ms);
+    if (stats.cache_level == 0)
     {
-        for (txIter = 0; txIter < fInputColumns; txIter++)
+        printf(ANSI_COLOR_CYAN "[DATA]\tColumn tiles: " ANSI_COLOR_RESET "%d of %d columns (width set directly)\n", stats.num_tiles, stats.tile_cols);
+    }
+    else if (stats.cache_bytes == 0)
+    {
+        printf(ANSI_COLOR_CYAN "[DATA]\tColumn tiles: " ANSI_COLOR_RESET "%d of %d columns (L%d size unavailable, assumed %lu KiB)\n", stats.num_tiles, stats.tile_cols,
+               stats.cache_level, SMVP_TILE_CACHE_FALLBACK / 1024);
+    }
+    else
+    {
+        printf(ANSI_COLOR_CYAN "[DATA]\tColumn tiles: " ANSI_COLOR_RESET "%d of %d columns (half of the %zu KiB L%d cache)\n", stats.num_tiles, stats.tile_cols,
+               stats.cache_bytes / 1024, stats.cache_level);
+    }
+    printf(ANSI_COLOR_CYAN "[DATA]\tx vector / tile slice: " ANSI_COLOR_RESET "%.1f KiB / %.1f KiB\n", info.cols * sizeof(double) / 1024.0, stats.tile_cols * sizeof(double) / 1024.0);
+    printf(ANSI_COLOR_CYAN "[DATA]\tx reuse: " ANSI_COLOR_RESET "%.2f gathers per x cache line (%lld lines read once per multiply)\n", stats.x_reuse, (long long)stats.x_lines);
+    printf(ANSI_COLOR_CYAN "[DATA]\tRow segments: " ANSI_COLOR_RESET "%lld (%.2f y updates per row)\n", (long long)stats.segments, (info.rows > 0) ? (double)stats.segments / info.rows : 0.0);
+
+    // Prepare the "ones" vector and output vector
+    onesVector = (double *)arenaAcquire(arena, sizeof(double) * (long unsigned int)info.cols);
+    vectorInit(info.cols, onesVector, 1);
+    outputVector = (double *)arenaAcquire(arena, sizeof(double) * (long unsigned int)info.rows);
+    smvp_touch_rows(matrix, outputVector);
+
+    // Plain CSR on the same vectors and threads, for the speedup
+    referenceMs = csrReferenceMs(matrix, onesVector, outputVector, TILED_REFERENCE_RUNS);
+
+    printf(ANSI_COLOR_YELLOW "[INFO]\tCalculating %d iterations of SMVP column-tiled CSR.\n" ANSI_COLOR_RESET, compiter);
+
+    if (pool != NULL)
+    {
+        numaCountersBegin(pool, tiled_time);
+    }
+    smvp_timed_multiply(arena, matrix, SMVP_FORMAT_TILED, onesVector, outputVector, compiter, tiled_time, stable);
+    printf(ANSI_COLOR_CYAN "[DATA]\tKernel array backing: " ANSI_COLOR_RESET "%s\n", smvp_backing_name(tiled_time->backing));
+    if (pool != NULL)
+    {
+        numaCountersEnd(pool, matrix, tiled_time);
+    }
+    printf(ANSI_COLOR_CYAN "[DATA]\tSpeedup over CSR: " ANSI_COLOR_RESET "%.3fx (fastest multiply %.5f ms, CSR %.5f ms)\n",
+           (tiled_time->time_min > 0) ? referenceMs / tiled_time->time_min : 0.0, tiled_time->time_min, referenceMs);
+
+    // End of the tiled phase, only the output vector outlives it (released by the caller once reported)
+    arenaRelease(arena, onesVector);
+
+    return outputVector;
+}
+
+// Function: smvp_csrt_compute
+// Calculates the transpose product y = A^T*x straight from the loaded CSR (no transposed copy)
+// Returns results vector (cols entries) directly, time data via pointer
+double *smvp_csrt_compute(RunArena *arena, smvp_matrix_t *matrix, smvp_pool_t *pool, int compiter, struct _time_data_ *csrt_time, StableConfig *stable)
+{
+    static const char *modeNames[] = {"serial", "private y per thread, parallel reduction", "column ranges owned per thread"};
+    smvp_info_t info;
+    double *onesVector, *outputVector, *forwardVector, referenceMs;
+    int status;
+    struct timespec convertStart, convertEnd;
+
+    // Plan the transpose products (scratch only when bound to threads, the CSR arrays are read as they are)
+    printf(ANSI_COLOR_YELLOW "[INFO]\tPlanning transpose products over the loaded CSR content.\n" ANSI_COLOR_RESET);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &convertStart);
+    status = smvp_analyze(matrix, SMVP_FORMAT_TRANSPOSE);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &convertEnd);
+    csrt_time->convert_ms = ((convertEnd.tv_sec - convertStart.tv_sec) * 1e9 + (convertEnd.tv_nsec - convertStart.tv_nsec)) / 1e6;
+    if (status != SMVP_SUCCESS)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tTranspose planning failed: %s.\n" ANSI_COLOR_RESET, smvp_strerror(status));
+        exit(1);
+    }
+    smvp_get_info(matrix, &info);
+    printf(ANSI_COLOR_CYAN "[DATA]\tTranspose planning time: " ANSI_COLOR_RESET "%g ms\n", csrt_time->convert_ms);
+    printf(ANSI_COLOR_CYAN "[DATA]\tTranspose strategy: " ANSI_COLOR_RESET "%s\n", modeNames[info.transpose_mode]);
+    printf(ANSI_COLOR_CYAN "[DATA]\tTranspose scratch: " ANSI_COLOR_RESET "%.2f MiB (CSR arrays %.2f MiB)\n", (double)info.transpose_bytes / (1024 * 1024),
+           (double)info.bytes / (1024 * 1024));
+
+    // Prepare the "ones" vector (rows entries) and output vector (cols entries)
+    onesVector = (double *)arenaAcquire(arena, sizeof(double) * (long unsigned int)((info.rows > info.cols) ? info.rows : info.cols));
+    vectorInit((info.rows > info.cols) ? info.rows : info.cols, onesVector, 1);
+    outputVector = (double *)arenaAcquire(arena, sizeof(double) * (long unsigned int)info.cols);
+    vectorInit(info.cols, outputVector, 0);
+
+    // Forward CSR on the same threads, for the comparison
+    forwardVector = (double *)arenaAcquire(arena, sizeof(double) * (long unsigned int)info.rows);
+    smvp_touch_rows(matrix, forwardVector);
+    referenceMs = csrReferenceMs(matrix, onesVector, forwardVector, TILED_REFERENCE_RUNS);
+    arenaRelease(arena, forwardVector);
+
+    printf(ANSI_COLOR_YELLOW "[INFO]\tCalculating %d iterations of SMVP transpose CSR.\n" ANSI_COLOR_RESET, compiter);
+
+    if (pool != NULL)
+    {
+        numaCountersBegin(pool, csrt_time);
+    }
+    smvp_timed_multiply(arena, matrix, SMVP_FORMAT_TRANSPOSE, onesVector, outputVector, compiter, csrt_time, stable);
+    printf(ANSI_COLOR_CYAN "[DATA]\tKernel array backing: " ANSI_COLOR_RESET "%s\n", smvp_backing_name(csrt_time->backing));
+    if (pool != NULL)
+    {
+        numaCountersEnd(pool, matrix, csrt_time);
+    }
+    printf(ANSI_COLOR_CYAN "[DATA]\tTranspose / forward CSR time: " ANSI_COLOR_RESET "%.3fx (fastest multiply %.5f ms, CSR %.5f ms)\n",
+           (referenceMs > 0) ? csrt_time->time_min / referenceMs : 0.0, csrt_time->time_min, referenceMs);
+
+    // End of the transpose phase, only the output vector outlives it (released by the caller once reported)
+    arenaRelease(arena, onesVector);
+
+    return outputVector;
+}
+
+// Function: smvp_csr_debug
+// Because sometimes things just don't go the way you hoped they would
+void smvp_csr_debug(double *output_vector, struct _time_data_ *csr_time, int fInputRows, long long fInputNonZeros, int iter)
+{
+
+    int index;
+
+    printf("[DEBUG]\tCSR Iterations: %d\n", iter);
+    printf("[DEBUG]\tCSR fInputRows: %d\n", fInputRows);
+    printf("[DEBUG]\tCSR fInputNonZeros: %lld\n", fInputNonZeros);
+    printf("[DEBUG]\tCSR Total Time: %g\n", csr_time->time_total);
+    printf("[DEBUG]\tCSR Avg Time: %g\n", csr_time->time_avg);
+    printf("[DEBUG]\tCSR StDev Time: %g\n", csr_time->time_avg);
+    printf("[DEBUG]\tCSR Times:\n");
+    printf("\t[");
+    for (index = 0; index < iter; index++)
+    {
+        printf("%g, ", csr_time->time_each[index]);
+    }
+    printf("]\n");
+    printf("[DEBUG]\tCSR Output Vector:\n");
+    printf("\t[");
+    for (index = 0; index < fInputRows; index++)
+    {
+        printf("%g, ", output_vector[index]);
+    }
+    printf("]\n\n");
+}
+
+// Function: batchPathCompare
+// qsort() comparator ordering batch items by path
+int batchPathCompare(const void *a, const void *b)
+{
+    return strcmp(((const BatchItem *)a)->path, ((const BatchItem *)b)->path);
+}
+
+// Function: batchAddItem
+// Appends a matrix path to the batch, growing the item array as needed
+void batchAddItem(BatchQueue *queue, int *capacity, const char *dir, const char *name)
+{
+    size_t len;
+
+    if (queue->count == *capacity)
+    {
+        *capacity = (*capacity == 0) ? 64 : *capacity * 2;
+        queue->items = (BatchItem *)realloc(queue->items, sizeof(BatchItem) * (long unsigned int)*capacity);
+        if (queue->items == NULL)
         {
-            if (txList[txIter].originCol == index)
-            {
-                onesVectorTemp[txIter] = onesVector[index];
-                break;
-            }
+            printf(ANSI_COLOR_RED "[ERROR]\tUnable to allocate batch list.\n" ANSI_COLOR_RESET);
+            exit(1);
         }
     }
-    for (index = 0; index < fInputRows; index++)
+
+    memset(&queue->items[queue->count], 0, sizeof(BatchItem));
+    len = (dir ? strlen(dir) + 1 : 0) + strlen(name) + 1;
+    queue->items[queue->count].path = (char *)malloc(len);
+    if (dir)
     {
-        onesVector[index] = onesVectorTemp[index];
+        snprintf(queue->items[queue->count].path, len, "%s/%s", dir, name);
     }
-    free(onesVectorTemp);
+    else
+    {
+        snprintf(queue->items[queue->count].path, len, "%s", name);
+    }
+    queue->count++;
+}
 
-    // 6. Import data into appropriate TJDS structures
-    qsort(mmCloneData, (size_t)fInputNonZeros, sizeof(MMDataPlus), mmdp_comparator_row_col);
+// Function: batchCollect
+// Builds the batch from every *.mtx(.gz|.zst) file in a directory (sorted by name) or from a manifest
+// listing one path per line; blank lines and # comments are skipped and relative manifest
+// entries are resolved against the manifest's own directory
+void batchCollect(const char *source, BatchQueue *queue)
+{
+    struct stat sourceStats;
+    struct dirent *dirEntry;
+    DIR *dir;
+    FILE *manifest;
+    char *line = NULL, *entry, *end, *manifestDir, *slash;
+    size_t lineLen = 0, nameLen;
+    int capacity = 0;
+
+    if (stat(source, &sourceStats) != 0)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tBatch source not found.\n" ANSI_COLOR_RESET);
+        exit(1);
+    }
 
-    if (SMVP_TJDS_DEBUG)
+    if (S_ISDIR(sourceStats.st_mode))
     {
-        printf("[DEBUG]\tTJDS PHASE 6: Reorder Columns (shown normal):\n");
-        printf("\t[");
-        for (index = 0; index < fInputNonZeros; index++)
+        if ((dir = opendir(source)) == NULL)
         {
-            printf("%g, ", mmCloneData[index].val);
-            if (mmCloneData[index].row < mmCloneData[index + 1].row)
+            printf(ANSI_COLOR_RED "[ERROR]\tUnable to read batch directory: %s.\n" ANSI_COLOR_RESET, strerror(errno));
+            exit(1);
+        }
+        while ((dirEntry = readdir(dir)) != NULL)
+        {
+            // Compressed matrices are picked up too, the loader detects their format from the content
+            nameLen = strlen(dirEntry->d_name);
+            if ((nameLen > 4 && strcmp(dirEntry->d_name + nameLen - 4, ".mtx") == 0) ||
+                (nameLen > 7 && strcmp(dirEntry->d_name + nameLen - 7, ".mtx.gz") == 0) ||
+                (nameLen > 8 && strcmp(dirEntry->d_name + nameLen - 8, ".mtx.zst") == 0))
             {
-                printf("\n\t");
+                batchAddItem(queue, &capacity, source, dirEntry->d_name);
             }
         }
-        printf("]\n\n");
+        closedir(dir);
+        qsort(queue->items, (size_t)queue->count, sizeof(BatchItem), batchPathCompare);
+        return;
     }
 
-    // Copy values and col_orig as-ordered since they're already sorted correctly
-    sp_index = 0;
-    for (index = 0; index < fInputNonZeros; index++)
+    if ((manifest = fopen(source, "r")) == NULL)
     {
-        workingMatrix.val[index] = mmCloneData[index].val;
-        workingMatrix.row_ind[index] = mmCloneData[index].row_orig;
+        printf(ANSI_COLOR_RED "[ERROR]\tUnable to read batch manifest: %s.\n" ANSI_COLOR_RESET, strerror(errno));
+        exit(1);
+    }
+    manifestDir = strdup(source);
+    if ((slash = strrchr(manifestDir, '/')) != NULL)
+    {
+        *slash = '\0';
+    }
+    else
+    {
+        strcpy(manifestDir, ".");
+    }
 
-        // Start position of first NNZ is always zero
-        if (index == 0)
+    while (getline(&line, &lineLen, manifest) >= 0)
+    {
+        for (entry = line; isspace((unsigned char)*entry); entry++)
+            ;
+        for (end = entry + strlen(entry); end > entry && isspace((unsigned char)end[-1]); end--)
+            ;
+        *end = '\0';
+        if (*entry == '\0' || *entry == '#')
         {
-            workingMatrix.start_pos[sp_index] = index;
-            sp_index++;
+            continue;
         }
-        // If the row has incremented, capture the row as a start position
-        else if (mmCloneData[index].row > mmCloneData[index - 1].row)
+        batchAddItem(queue, &capacity, (*entry == '/' || strncmp(entry, SMVP_GENERATE_PREFIX, strlen(SMVP_GENERATE_PREFIX)) == 0) ? NULL : manifestDir, entry);
+    }
+
+    free(line);
+    free(manifestDir);
+    fclose(manifest);
+}
+
+// Function: batchLoader
+// I/O thread: loads matrices in order, never holding more than maxResident at once
+void *batchLoader(void *arg)
+{
+    BatchQueue *queue = (BatchQueue *)arg;
+    BatchItem *item;
+    struct timespec start, end;
+    smvp_matrix_t *matrix;
+    int index;
+
+    for (index = 0; index < queue->count; index++)
+    {
+        item = &queue->items[index];
+
+        pthread_mutex_lock(&queue->lock);
+        while (queue->resident >= queue->maxResident)
         {
-            workingMatrix.start_pos[sp_index] = index;
-            sp_index++;
+            pthread_cond_wait(&queue->changed, &queue->lock);
         }
-        // If we're at the end of the value list, record the "next" value as the last start position
-        else if (index == fInputNonZeros - 1)
+        queue->resident++;
+        pthread_mutex_unlock(&queue->lock);
+
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+        matrix = smvpLoadMatrixFile(item->path, queue->options, item->error, sizeof(item->error));
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+
+        pthread_mutex_lock(&queue->lock);
+        item->matrix = matrix;
+        item->loadMs = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / 1e6;
+        item->loaded = 1;
+        if (matrix == NULL)
         {
-            workingMatrix.start_pos[sp_index] = index + 1;
+            queue->resident--;
         }
+        pthread_cond_broadcast(&queue->changed);
+        pthread_mutex_unlock(&queue->lock);
     }
 
-    if (SMVP_TJDS_DEBUG)
+    return NULL;
+}
+
+// Function: batchBenchmark
+// Converts and times every selected format of one loaded matrix, recording the results in item
+// Returns the compute thread time spent (conversions plus timed loops) in ms
+double batchBenchmark(RunArena *arena, BatchItem *item, int alg_mode, int compiter, char *reportPath, CompareSet *compare, StableConfig *stable)
+{
+    static const int formats[BATCH_ALGS] = {SMVP_FORMAT_CSR, SMVP_FORMAT_TJDS, SMVP_FORMAT_ACSR, SMVP_FORMAT_TILED};
+    static const int algs[BATCH_ALGS] = {ALG_CSR, ALG_TJDS, ALG_ACSR, ALG_TILED};
+    struct _time_data_ *timeData;
+    struct timespec start, end;
+    smvp_info_t info;
+    double *onesVector, *outputVector, computeMs = 0;
+    int alg, status;
+
+    smvp_get_info(item->matrix, &info);
+    item->rows = info.rows;
+    item->cols = info.cols;
+    item->nnz = info.nnz;
+
+    onesVector = (double *)arenaAcquire(arena, sizeof(double) * (long unsigned int)info.cols);
+    vectorInit(info.cols, onesVector, 1);
+    outputVector = (double *)arenaAcquire(arena, sizeof(double) * (long unsigned int)info.rows);
+    smvp_touch_rows(item->matrix, outputVector);
+
+    for (alg = 0; alg < BATCH_ALGS; alg++)
     {
-        printf("[DEBUG]\tTJDS PHASE 7: Pre-Calc Fields:\n");
-        printf("\tval:\t\t[");
-        for (index = 0; index < fInputNonZeros; index++)
+        if (!(alg_mode & (algs[alg] | ALG_ALL)))
         {
-            printf("%g, ", workingMatrix.val[index]);
+            continue;
         }
-        printf("]\n");
-        printf("\trow_ind:\t[");
-        for (index = 0; index < fInputNonZeros; index++)
+
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+        status = smvp_analyze(item->matrix, formats[alg]);
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+        if (status != SMVP_SUCCESS)
         {
-            printf("%d, ", workingMatrix.row_ind[index]);
+            snprintf(item->error, sizeof(item->error), "conversion failed: %s", smvp_strerror(status));
+            continue;
         }
-        printf("]\n");
-        printf("\tstart_pos:\t[");
-        for (index = 0; index < num_tjdiag + 1; index++)
+        item->convertMs[alg] = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / 1e6;
+
+        timeData = newResultsData(arena, compiter);
+        smvp_timed_multiply(arena, item->matrix, formats[alg], onesVector, outputVector, compiter, timeData, stable);
+        item->ran[alg] = 1;
+        item->avgMs[alg] = timeData->time_avg;
+        item->minMs[alg] = timeData->time_min;
+        item->stdevMs[alg] = timeData->time_stdev;
+        computeMs += item->convertMs[alg] + timeData->time_total;
+
+        timeData->load_ms = item->loadMs;
+        timeData->convert_ms = item->convertMs[alg];
+        smvp_numa_stats(item->matrix, &timeData->numa);
+        timeData->threads = timeData->numa.threads;
+        generateReportRecord(item->path, reportPath, algs[alg], info.rows, info.cols, info.nnz, item->matrix, compiter, timeData, compare);
+        arenaRelease(arena, timeData);
+    }
+
+    arenaRelease(arena, outputVector);
+    arenaRelease(arena, onesVector);
+
+    return computeMs;
+}
+
+// Function: batchWriteSummary
+// Writes the consolidated batch table (one row per matrix) followed by pipeline totals
+void batchWriteSummary(FILE *out, BatchQueue *queue, int alg_mode, int compiter, double wallMs, double loadMs, double computeMs)
+{
+    static const char *names[BATCH_ALGS] = {"CSR", "TJDS", "ACSR", "TILED"};
+    static const int algs[BATCH_ALGS] = {ALG_CSR, ALG_TJDS, ALG_ACSR, ALG_TILED};
+    BatchItem *item;
+    const char *name;
+    int index, alg;
+
+    fprintf(out, "%-28s %9s %9s %10s", "Matrix", "Rows", "NNZ", "Load ms");
+    for (alg = 0; alg < BATCH_ALGS; alg++)
+    {
+        if (alg_mode & (algs[alg] | ALG_ALL))
         {
-            printf("%d, ", workingMatrix.start_pos[index]);
+            fprintf(out, " %5s %-4s %11s %11s %11s %8s", names[alg], "conv", "avg ms", "min ms", "stdev ms", "GFLOP/s");
         }
-        printf("]\n\n");
-        printf("\tnum_tjdiag (count, not 0-index):\t%d", num_tjdiag);
-        printf("\n\n");
     }
+    fprintf(out, "\n");
 
-    free(mmCloneData);
+    for (index = 0; index < queue->count; index++)
+    {
+        item = &queue->items[index];
+        name = strrchr(item->path, '/') ? strrchr(item->path, '/') + 1 : item->path;
+        if (item->rows == 0 && item->error[0] != '\0')
+        {
+            fprintf(out, "%-28.28s FAILED: %s\n", name, item->error);
+            continue;
+        }
+        fprintf(out, "%-28.28s %9d %9lld %10.3f", name, item->rows, item->nnz, item->loadMs);
+        for (alg = 0; alg < BATCH_ALGS; alg++)
+        {
+            if (!(alg_mode & (algs[alg] | ALG_ALL)))
+            {
+                continue;
+            }
+            if (!item->ran[alg])
+            {
+                fprintf(out, " %10s %11s %11s %11s %8s", "-", "-", "-", "-", "-");
+                continue;
+            }
+            // 2 flops (multiply + add) per non-zero
+            fprintf(out, " %10.3f %11.5f %11.5f %11.5f %8.3f", item->convertMs[alg], item->avgMs[alg], item->minMs[alg], item->stdevMs[alg],
+                    2.0 * item->nnz / (item->avgMs[alg] * 1e6));
+        }
+        fprintf(out, "\n");
+    }
 
-    printf(ANSI_COLOR_YELLOW "[INFO]\tCalculating %d iterations of SMVP TJDS.\n" ANSI_COLOR_RESET, compiter);
+    fprintf(out, "\n%d matrices, %d iterations per format\n", queue->count, compiter);
+    fprintf(out, "Wall time: %.3f ms\n", wallMs);
+    fprintf(out, "Load time (I/O thread): %.3f ms\n", loadMs);
+    fprintf(out, "Compute time (conversions and timed loops): %.3f ms\n", computeMs);
+    fprintf(out, "Compute share of wall time: %.1f%%\n", wallMs > 0 ? 100.0 * computeMs / wallMs : 0.0);
+}
 
-    //
-    // ATOMIC SECTION START
-    // PERFORM NO ACTIONS OTHER THAN SMVP BETWEEN START AND END TIME CAPTURES
-    //
+// Function: batchRun
+// Benchmarks every matrix of a directory or manifest. An I/O thread loads the next matrix while the
+// current one is converted and timed, and the results go to one summary table instead of per-file reports.
+void batchRun(const char *source, const smvp_options_t *options, int alg_mode, int compiter, int maxResident, char *reportPath, CompareSet *compare, RunArena *arena, smvp_pool_t *pool, StableConfig *stable)
+{
+    BatchQueue queue;
+    BatchItem *item;
+    pthread_t loader;
+    struct timespec wallStart, wallEnd;
+    double wallMs, loadMs = 0, computeMs = 0;
+    char *summaryPath;
+    size_t pathLen;
+    FILE *summaryFile;
+    int index;
 
-    // Compute TJDS SMVP (technically y=Axn, not y=x(A^n) as indicated in reqs doc, but is an approved deviation)
-    for (i = 0; i < compiter; i++)
+    memset(&queue, 0, sizeof(queue));
+    batchCollect(source, &queue);
+    if (queue.count == 0)
     {
+        printf(ANSI_COLOR_RED "[ERROR]\tBatch source contains no matrix files.\n" ANSI_COLOR_RESET);
+        exit(1);
+    }
+    queue.maxResident = maxResident;
+    queue.options = options;
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.changed, NULL);
 
-        //Reset output vector contents between iterations
-        vectorInit(fInputRows, outputVector, 0);
+    printf(ANSI_COLOR_YELLOW "[INFO]\tBatch of %d matrices, up to %d resident, %d iterations per format.\n" ANSI_COLOR_RESET, queue.count, maxResident, compiter);
 
-        // Capture compute run start time
-        clock_gettime(CLOCK_MONOTONIC_RAW, &time_run_start[i]);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &wallStart);
+    if (pthread_create(&loader, NULL, batchLoader, &queue) != 0)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tUnable to start batch I/O thread.\n" ANSI_COLOR_RESET);
+        exit(1);
+    }
 
-        for (index = 0; index < num_tjdiag + 1; index++)
+    // Pin only the compute thread, the I/O thread was created first and keeps the default mask
+    stableApplyAffinity(stable, pool);
+
+    for (index = 0; index < queue.count; index++)
+    {
+        item = &queue.items[index];
+
+        pthread_mutex_lock(&queue.lock);
+        while (!item->loaded)
         {
-            for (j = workingMatrix.start_pos[index]; j < workingMatrix.start_pos[index + 1]; j++)
-            {
-                p = workingMatrix.row_ind[j];
-                outputVector[p] += workingMatrix.val[j] * onesVector[p];
-            }
+            pthread_cond_wait(&queue.changed, &queue.lock);
         }
+        pthread_mutex_unlock(&queue.lock);
 
-        // Capture compute run end time
-        clock_gettime(CLOCK_MONOTONIC_RAW, &time_run_end[i]);
+        loadMs += item->loadMs;
+        if (item->matrix == NULL)
+        {
+            printf(ANSI_COLOR_RED "[WARN]\t[%d/%d] Skipping %s: %s.\n" ANSI_COLOR_RESET, index + 1, queue.count, item->path, item->error);
+            continue;
+        }
+
+        printf(ANSI_COLOR_MAGENTA "[FILE]\t[%d/%d] " ANSI_COLOR_RESET "%s\n", index + 1, queue.count, item->path);
+        if (pool != NULL && smvp_bind(item->matrix, pool, smvp_pool_size(pool)) != SMVP_SUCCESS)
+        {
+            printf(ANSI_COLOR_RED "[ERROR]\tUnable to bind matrix to worker threads.\n" ANSI_COLOR_RESET);
+            exit(1);
+        }
+        computeMs += batchBenchmark(arena, item, alg_mode, compiter, reportPath, compare, stable);
+
+        smvp_destroy(item->matrix);
+        item->matrix = NULL;
+        pthread_mutex_lock(&queue.lock);
+        queue.resident--;
+        pthread_cond_broadcast(&queue.changed);
+        pthread_mutex_unlock(&queue.lock);
+
+        // Buffer sizes change with every matrix, keep the arena from accumulating idle blocks
+        arenaTrim(arena);
     }
 
-    //
-    // ATOMIC SECTION END
-    // PERFORM NO ACTIONS OTHER THAN SMVP BETWEEN START AND END TIME CAPTURES
-    //
+    pthread_join(loader, NULL);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &wallEnd);
+    wallMs = ((wallEnd.tv_sec - wallStart.tv_sec) * 1e9 + (wallEnd.tv_nsec - wallStart.tv_nsec)) / 1e6;
 
-    // Inline Vivado LUT builder
+    printf(ANSI_COLOR_CYAN "[DATA]\tBatch summary:\n\n" ANSI_COLOR_RESET);
+    batchWriteSummary(stdout, &queue, alg_mode, compiter, wallMs, loadMs, computeMs);
+    printf("\n");
 
-    for (int i = 0; i < 9 + 1; i++)
+    pathLen = strlen(reportPath) + 64;
+    summaryPath = (char *)malloc(pathLen);
+    snprintf(summaryPath, pathLen, "%s%s%s_%lu.txt", reportPath,
+             (reportPath[0] != '\0' && reportPath[strlen(reportPath) - 1] != '/') ? "/" : "",
+             "smvp-toolbox_batch", (unsigned long)time(NULL));
+    if ((summaryFile = fopen(summaryPath, "w")) == NULL)
+    {
+        printf(ANSI_COLOR_RED "[WARN]\tUnable to write batch summary file %s.\n" ANSI_COLOR_RESET, summaryPath);
+    }
+    else
     {
-        for (int j = 0; j < 36519 + 1; j++)
+        fprintf(summaryFile, "Batch results for smvp-toolbox v.%d.%d.%d\n", MAJOR_VER, MINOR_VER, REVISION_VER);
+        fprintf(summaryFile, "Batch source: %s\n\n", source);
+        batchWriteSummary(summaryFile, &queue, alg_mode, compiter, wallMs, loadMs, computeMs);
+        fclose(summaryFile);
+        printf(ANSI_COLOR_MAGENTA "[FILE]\tBatch summary file saved as:\n" ANSI_COLOR_RESET);
+        printf("\t%s\n", summaryPath);
+    }
+
+    for (index = 0; index < queue.count; index++)
+    {
+        free(queue.items[index].path);
+    }
+    free(queue.items);
+    free(summaryPath);
+    pthread_mutex_destroy(&queue.lock);
+    pthread_cond_destroy(&queue.changed);
+}
+
+// Function: sweepIntCompare
+// qsort() comparator for ascending thread counts
+int sweepIntCompare(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+
+    return (x > y) - (x < y);
+}
+
+// Function: sweepDoubleCompare
+// qsort() comparator for ascending sample times
+int sweepDoubleCompare(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+// Function: sweepPhysicalCores
+// Counts online CPUs that are the first hardware thread of their core, thread counts above it share cores (SMT)
+int sweepPhysicalCores(void)
+{
+    char path[96];
+    FILE *siblings;
+    int cpu, first, cores = 0, online = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (cpu = 0; cpu < CPU_SETSIZE && cpu < (int)sysconf(_SC_NPROCESSORS_CONF); cpu++)
+    {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+        if ((siblings = fopen(path, "r")) == NULL)
         {
-            if (j < workingMatrix.start_pos[i + 1] - workingMatrix.start_pos[i] + i && j >= i)
-            {
-                printf("a_ij[%d][%d] = 1'b1;\n", i, j);
-            }
-            else
-            {
-                printf("a_ij[%d][%d] = 1'b0;\n", i, j);
-            }
+            continue;
         }
+        if (fscanf(siblings, "%d", &first) == 1 && first == cpu)
+        {
+            cores++;
+        }
+        fclose(siblings);
     }
+    return (cores >= 1 && cores <= online) ? cores : online;
+}
 
-    int temp = 0;
+// Function: sweepParseThreads
+// Builds the ascending thread count grid from "auto" (powers of two below the physical core count, the core
+// count and every hardware thread) or a comma list. 1 is always included as the speedup baseline
+int sweepParseThreads(const char *list, int cores, int **counts)
+{
+    int online = (int)sysconf(_SC_NPROCESSORS_ONLN), capacity = 64, count = 0, value, index, next;
+    int *grid = (int *)malloc(sizeof(int) * (long unsigned int)capacity);
+    const char *cursor = list;
+    char *end;
 
-    for (int i = 0; i < 9 + 1; i++)
+    grid[count++] = 1;
+    if (strcmp(list, "auto") == 0)
     {
-        for (int j = 0; j < 36519 + 1; j++)
+        for (value = 2; value < cores; value *= 2)
         {
-            if (j < workingMatrix.start_pos[i + 1] - workingMatrix.start_pos[i] + i && j >= i)
-            {
-                printf("i[%d][%d] = %d;\n", i, j, workingMatrix.row_ind[temp]);
-                temp++;
-            }
-            else
+            grid[count++] = value;
+        }
+        grid[count++] = cores;
+        grid[count++] = online;
+    }
+    else
+    {
+        while (*cursor != '\0')
+        {
+            value = (int)strtol(cursor, &end, 10);
+            if (end == cursor || value < 1 || value > SWEEP_MAX_THREADS || (*end != ',' && *end != '\0') || count == capacity)
             {
-                printf("i[%d][%d] = 1'b0;\n", i, j);
+                free(grid);
+                return 0;
             }
+            grid[count++] = value;
+            cursor = (*end == ',') ? end + 1 : end;
         }
     }
 
-    // // Inline Vivado COE Builder (WIP)
-    // temp = 0;
-    // uint64_t  packed_val_temp = 0;
-    // int coe_memory_depth_min = fInputNonZeros * 2;
-    // int coe_memory_initialization_radix = 64; // this is a constant for the ROM structure we're using
-    //                                           // Given a radix of 48:
-    //                                           // 16U = TJDS_Row_Num (ex. i[X][]), 16M1 = TJDS_Col_Num (ex. i[][X]), 16M2 = TJDS_i_Val, 16L = TLDS_a_ij_val
-    //                                           // !!! RESIZE STRUCTURE IF ANY NUMBER EXCEEDS 4095 !!!
+    qsort(grid, (size_t)count, sizeof(int), sweepIntCompare);
+    for (index = 1, next = 1; index < count; index++)
+    {
+        if (grid[index] != grid[next - 1])
+        {
+            grid[next++] = grid[index];
+        }
+    }
+    *counts = grid;
+    return next;
+}
 
-    // printf("******************************************************************\n");
-    // printf("*************  Single Port Block Memory .COE file   **************\n");
-    // printf("******************************************************************\n");
-    // printf("memory_initialization_radix=%d\n", coe_memory_initialization_radix);
-    // printf("memory_initialization_vector=\n");
-    // for (uint16_t i = 0; i < 7; i++)
-    // {
-    //     for (uint16_t j = 0; j < 33; j++)
-    //     {
-    //         packed_val_temp = 0;
+// Function: sweepMeasure
+// Median time in ms of compiter CSR multiplies on the matrix's current binding, after one untimed warm-up
+double sweepMeasure(RunArena *arena, smvp_matrix_t *matrix, int compiter, const double *x, double *y)
+{
+    struct timespec start, end;
+    double *samples = (double *)arenaAcquire(arena, sizeof(double) * (long unsigned int)compiter), median;
+    int iter;
 
-    //         packed_val_temp |= ( i << 48);
-    //         packed_val_temp |= ( j << 32);
+    smvp_multiply(matrix, SMVP_FORMAT_CSR, 1.0, x, 0.0, y);
+    for (iter = 0; iter < compiter; iter++)
+    {
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+        smvp_multiply(matrix, SMVP_FORMAT_CSR, 1.0, x, 0.0, y);
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+        samples[iter] = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / 1e6;
+    }
+    qsort(samples, (size_t)compiter, sizeof(double), sweepDoubleCompare);
+    median = (compiter % 2) ? samples[compiter / 2] : 0.5 * (samples[compiter / 2 - 1] + samples[compiter / 2]);
+    arenaRelease(arena, samples);
+    return median;
+}
 
-    //         if (j < workingMatrix.start_pos[i + 1] - workingMatrix.start_pos[i] + i && j >= i)
-    //         {
-    //             packed_val_temp |= (1<<0);
-    //         }
-    //         else
-    //         {
-    //             packed_val_temp |= (0<<0);
-    //         }
+// Function: sweepBandwidth
+// GB/s of one multiply from its compulsory traffic: values and column indices, row pointers, x read once and y written
+double sweepBandwidth(const SweepResult *result, double ms)
+{
+    return (12.0 * result->nnz + result->indexBits / 8.0 * (result->rows + 1.0) + 8.0 * result->cols + 8.0 * result->rows) / (ms * 1e6);
+}
 
-    //         if (j < workingMatrix.start_pos[i + 1] - workingMatrix.start_pos[i] + i && j >= i)
-    //         {
-    //             packed_val_temp |= ((uint16_t)(workingMatrix.row_ind[temp]) << 16);
-    //             temp++;
-    //         }
-    //         else
-    //         {
-    //             packed_val_temp |= (0 << 12);
-    //         }
+// Function: sweepWriteTable
+// Writes one row per matrix and thread count, speedup and efficiency are relative to the 1-thread point
+// The SMT column tells whether a point fits the physical cores (no), shares them (yes) or oversubscribes the CPUs (over)
+void sweepWriteTable(FILE *out, const SweepResult *results, int resultCount, const int *counts, int countLen, int cores)
+{
+    const SweepResult *result;
+    const char *name;
+    double ms, speedup;
+    int index, point, online = (int)sysconf(_SC_NPROCESSORS_ONLN);
 
-    //         if ((i == num_tjdiag - 1) && (j == fInputRows - 1))
-    //         {
-    //             printf("[%d][%d]\t%x;\n", i, j, packed_val_temp);
-    //         }
-    //         else
-    //         {
-    //             printf("[%d][%d]\t%x,\n", i, j, packed_val_temp);
-    //         }
-    //     }
-    // }
+    fprintf(out, "%-28s %9s %9s %7s %4s %11s %8s %8s %8s %6s\n", "Matrix", "Rows", "NNZ", "Threads", "SMT", "median ms", "GFLOP/s", "GB/s", "Speedup", "Eff %");
+    for (index = 0; index < resultCount; index++)
+    {
+        result = &results[index];
+        name = strrchr(result->path, '/') ? strrchr(result->path, '/') + 1 : result->path;
+        if (result->medianMs == NULL)
+        {
+            fprintf(out, "%-28.28s FAILED: %s\n", name, result->error);
+            continue;
+        }
+        for (point = 0; point < countLen; point++)
+        {
+            ms = result->medianMs[point];
+            speedup = result->medianMs[0] / ms;
+            // 2 flops (multiply + add) per non-zero
+            fprintf(out, "%-28.28s %9d %9lld %7d %4s %11.5f %8.3f %8.3f %8.2f %6.1f%s\n", name, result->rows, result->nnz, counts[point],
+                    (counts[point] > online) ? "over" : (counts[point] > cores) ? "yes" : "no", ms, 2.0 * result->nnz / (ms * 1e6), sweepBandwidth(result, ms), speedup,
+                    100.0 * speedup / counts[point], (counts[point] == result->saturation) ? "  <- bandwidth saturated" : "");
+        }
+    }
 
-    // Convert all per-run timespec structs to time in milliseconds & populate time structure
-    for (i = 0; i < compiter; i++)
+    fprintf(out, "\nBandwidth saturation point (fewest threads reaching %.0f%% of the matrix's peak GB/s):\n", 100.0 * SWEEP_SATURATION);
+    for (index = 0; index < resultCount; index++)
     {
-        // Calculate runtime in ns, then convert to ms
-        time_run[i] = (double)((time_run_end[i].tv_sec * 1e9 + time_run_end[i].tv_nsec) - (time_run_start[i].tv_sec * 1e9 + time_run_start[i].tv_nsec));
-        time_run[i] /= 1e6;
+        result = &results[index];
+        if (result->medianMs != NULL)
+        {
+            name = strrchr(result->path, '/') ? strrchr(result->path, '/') + 1 : result->path;
+            fprintf(out, "%-28.28s %d threads\n", name, result->saturation);
+        }
+    }
+    fprintf(out, "\n%d physical cores, %d hardware threads online\n", cores, online);
+}
+
+// Function: sweepRun
+// Times the threaded CSR kernel of every input at every thread count of the grid. One pool sized for the largest
+// count is started up front and each point only rebinds the matrix to its first n workers, so no point pays for
+// thread creation. Results go to one table on stdout and in a smvp-toolbox_sweep_<time>.txt file
+void sweepRun(BatchQueue *queue, const char *threadList, int compiter, int numaMode, char *reportPath, RunArena *arena)
+{
+    SweepResult *results;
+    smvp_pool_t *pool;
+    smvp_matrix_t *matrix;
+    smvp_info_t info;
+    int *counts, countLen, cores, index, point, status;
+    double *onesVector, *outputVector, peak;
+    char *tablePath;
+    size_t pathLen;
+    FILE *tableFile;
+
+    cores = sweepPhysicalCores();
+    if ((countLen = sweepParseThreads(threadList, cores, &counts)) == 0)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tInvalid [-w|--sweep] thread list, use auto or comma separated counts from 1 to %d.\n" ANSI_COLOR_RESET, SWEEP_MAX_THREADS);
+        exit(1);
+    }
+    if ((status = smvp_pool_create(&pool, counts[countLen - 1], numaMode)) != SMVP_SUCCESS)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tUnable to start %d worker threads: %s.\n" ANSI_COLOR_RESET, counts[countLen - 1], smvp_strerror(status));
+        exit(1);
+    }
+    results = (SweepResult *)calloc((size_t)queue->count, sizeof(SweepResult));
 
-        tjds_time->time_each[i] = time_run[i];
-        tjds_time->time_total += time_run[i];
-        tjds_time->time_avg += time_run[i];
+    printf(ANSI_COLOR_YELLOW "[INFO]\tSweeping %d matrices over %d thread counts (1 to %d, %d physical cores), %d iterations per point.\n" ANSI_COLOR_RESET,
+           queue->count, countLen, counts[countLen - 1], cores, compiter);
 
-        if (i == 0)
+    for (index = 0; index < queue->count; index++)
+    {
+        results[index].path = queue->items[index].path;
+        printf(ANSI_COLOR_MAGENTA "[FILE]\t[%d/%d] " ANSI_COLOR_RESET "%s\n", index + 1, queue->count, results[index].path);
+        if ((matrix = smvpLoadMatrixFile(results[index].path, queue->options, results[index].error, sizeof(results[index].error))) == NULL)
         {
-            tjds_time->time_min = time_run[i];
-            tjds_time->time_max = time_run[i];
+            printf(ANSI_COLOR_RED "[WARN]\t[%d/%d] Skipping %s: %s.\n" ANSI_COLOR_RESET, index + 1, queue->count, results[index].path, results[index].error);
+            continue;
         }
-        else
+        smvp_get_info(matrix, &info);
+        results[index].rows = info.rows;
+        results[index].cols = info.cols;
+        results[index].nnz = info.nnz;
+        results[index].indexBits = info.index_bits;
+        results[index].medianMs = (double *)malloc(sizeof(double) * (long unsigned int)countLen);
+
+        onesVector = (double *)arenaAcquire(arena, sizeof(double) * (long unsigned int)info.cols);
+        outputVector = (double *)arenaAcquire(arena, sizeof(double) * (long unsigned int)info.rows);
+        for (point = 0; point < info.cols; point++)
+        {
+            onesVector[point] = 1.0;
+        }
+
+        for (point = 0; point < countLen; point++)
         {
-            if (tjds_time->time_min > time_run[i])
+            // Rebinding repartitions the rows and first-touches them again, outside the timed loop
+            if ((status = smvp_bind(matrix, pool, counts[point])) != SMVP_SUCCESS)
             {
-                tjds_time->time_min = time_run[i];
+                printf(ANSI_COLOR_RED "[ERROR]\tUnable to bind matrix to %d worker threads: %s.\n" ANSI_COLOR_RESET, counts[point], smvp_strerror(status));
+                exit(1);
             }
-            if (tjds_time->time_max < time_run[i])
+            smvp_touch_rows(matrix, outputVector);
+            results[index].medianMs[point] = sweepMeasure(arena, matrix, compiter, onesVector, outputVector);
+            printf(ANSI_COLOR_CYAN "[DATA]\t%4d threads: " ANSI_COLOR_RESET "%.5f ms median, %.3f GB/s\n", counts[point], results[index].medianMs[point],
+                   sweepBandwidth(&results[index], results[index].medianMs[point]));
+        }
+
+        for (point = 0, peak = 0; point < countLen; point++)
+        {
+            peak = (sweepBandwidth(&results[index], results[index].medianMs[point]) > peak) ? sweepBandwidth(&results[index], results[index].medianMs[point]) : peak;
+        }
+        for (point = 0; point < countLen && results[index].saturation == 0; point++)
+        {
+            if (sweepBandwidth(&results[index], results[index].medianMs[point]) >= SWEEP_SATURATION * peak)
             {
-                tjds_time->time_max = time_run[i];
+                results[index].saturation = counts[point];
             }
         }
+
+        arenaRelease(arena, outputVector);
+        arenaRelease(arena, onesVector);
+        smvp_destroy(matrix);
+        arenaTrim(arena);
+    }
+    smvp_pool_destroy(pool);
+
+    printf(ANSI_COLOR_CYAN "[DATA]\tScaling sweep:\n\n" ANSI_COLOR_RESET);
+    sweepWriteTable(stdout, results, queue->count, counts, countLen, cores);
+    printf("\n");
+
+    pathLen = strlen(reportPath) + 64;
+    tablePath = (char *)malloc(pathLen);
+    snprintf(tablePath, pathLen, "%s%s%s_%lu.txt", reportPath,
+             (reportPath[0] != '\0' && reportPath[strlen(reportPath) - 1] != '/') ? "/" : "",
+             "smvp-toolbox_sweep", (unsigned long)time(NULL));
+    if ((tableFile = fopen(tablePath, "w")) == NULL)
+    {
+        printf(ANSI_COLOR_RED "[WARN]\tUnable to write sweep table file %s.\n" ANSI_COLOR_RESET, tablePath);
+    }
+    else
+    {
+        fprintf(tableFile, "Scaling sweep results for smvp-toolbox v.%d.%d.%d\n", MAJOR_VER, MINOR_VER, REVISION_VER);
+        fprintf(tableFile, "Threaded CSR kernel, %d iterations per point, median times\n\n", compiter);
+        sweepWriteTable(tableFile, results, queue->count, counts, countLen, cores);
+        fclose(tableFile);
+        printf(ANSI_COLOR_MAGENTA "[FILE]\tSweep table file saved as:\n" ANSI_COLOR_RESET);
+        printf("\t%s\n", tablePath);
     }
-    tjds_time->time_avg /= compiter;
-    tjds_time->time_stdev = calcStDevDouble(tjds_time->time_each, compiter);
 
-    if (SMVP_TJDS_DEBUG)
+    for (index = 0; index < queue->count; index++)
     {
-        printf("[DEBUG]\tTJDS PHASE 8: Output Vector:\n");
-        printf("\t[");
-        for (index = 0; index < fInputRows; index++)
+        free(results[index].medianMs);
+    }
+    free(results);
+    free(counts);
+    free(tablePath);
+}
+
+// Function: oocOpenPanels
+// Opens an up-to-date panel file for the input (newer than it, planned with the same budget),
+// building it first when there is none. Exits on any error, including a foreign file at panelPath
+smvp_panels_t *oocOpenPanels(const char *inputFileName, const char *panelPath, size_t panelBytes)
+{
+    struct stat inputStats, panelStats;
+    struct timespec start, end;
+    smvp_panels_t *panels = NULL;
+    smvp_panel_header_t header;
+    char error[256];
+    int status;
+
+    if (stat(inputFileName, &inputStats) != 0)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tSpecified input file not found.\n" ANSI_COLOR_RESET);
+        exit(1);
+    }
+    if (stat(panelPath, &panelStats) == 0)
+    {
+        if (panelStats.st_dev == inputStats.st_dev && panelStats.st_ino == inputStats.st_ino)
         {
-            printf("%g, ", outputVector[index]);
+            printf(ANSI_COLOR_RED "[ERROR]\tPanel file must not be the input file.\n" ANSI_COLOR_RESET);
+            exit(1);
+        }
+        if ((status = smvp_panels_open(&panels, panelPath)) == SMVP_ERR_FORMAT)
+        {
+            printf(ANSI_COLOR_RED "[ERROR]\t%s exists and is not a panel file, refusing to overwrite it.\n" ANSI_COLOR_RESET, panelPath);
+            exit(1);
+        }
+        if (status == SMVP_SUCCESS)
+        {
+            smvp_panels_header(panels, &header, NULL);
+            if (panelStats.st_mtime >= inputStats.st_mtime && header.panel_bytes == (int64_t)panelBytes)
+            {
+                printf(ANSI_COLOR_MAGENTA "[FILE]\tReusing panel file: " ANSI_COLOR_RESET "%s\n", panelPath);
+                return panels;
+            }
+            smvp_panels_close(panels);
         }
-        printf("]\n\n");
     }
 
-    return outputVector;
+    // Only one panel of the matrix is held in memory while converting
+    printf(ANSI_COLOR_YELLOW "[INFO]\tConverting input file into CSR panels of at most %.2f MiB.\n" ANSI_COLOR_RESET, (double)panelBytes / (1024 * 1024));
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+    if (smvpBuildPanelFile(inputFileName, panelPath, panelBytes, error, sizeof(error)) != 0)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tUnable to build panel file: %s.\n" ANSI_COLOR_RESET, error);
+        exit(1);
+    }
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+    printf(ANSI_COLOR_MAGENTA "[FILE]\tPanel file written: " ANSI_COLOR_RESET "%s\n", panelPath);
+    printf(ANSI_COLOR_CYAN "[DATA]\tPanel file build time: " ANSI_COLOR_RESET "%g ms\n", ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / 1e6);
+
+    if ((status = smvp_panels_open(&panels, panelPath)) != SMVP_SUCCESS)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tUnable to open panel file: %s.\n" ANSI_COLOR_RESET, (status == SMVP_ERR_SYSTEM) ? strerror(errno) : smvp_strerror(status));
+        exit(1);
+    }
+    return panels;
 }
 
-// Function: smvp_csr_debug
-// Because sometimes things just don't go the way you hoped they would
-void smvp_csr_debug(double *output_vector, struct _time_data_ *csr_time, int fInputRows, int fInputNonZeros, int iter)
+// Function: oocRun
+// Out-of-core CSR: streams the panel file compiter times, reading the next panel while the current one is multiplied
+// Reports I/O bandwidth next to compute throughput, the panel size is right when neither side waits long for the other
+void oocRun(const char *inputFileName, const char *panelPath, size_t panelBytes, int compiter, char *reportPath, int outputFormat, CompareSet *compare, RunArena *arena)
 {
+    smvp_panels_t *panels;
+    smvp_panel_header_t header;
+    smvp_stream_stats_t pass, *total;
+    struct _time_data_ *ooc_time;
+    struct timespec start, end;
+    size_t bufferBytes;
+    double *onesVector, *outputVector, ioMs, computeMs, wallMs, loadMs;
+    int i, status;
+
+    // Opening includes building the panel file when it is missing or stale
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+    panels = oocOpenPanels(inputFileName, panelPath, panelBytes);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+    loadMs = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / 1e6;
+    smvp_panels_header(panels, &header, &bufferBytes);
+    printf(ANSI_COLOR_CYAN "[DATA]\tNon-zero numbers contained in matrix: " ANSI_COLOR_RESET "%lld\n", (long long)header.nnz);
+    printf(ANSI_COLOR_CYAN "[DATA]\tPanels: " ANSI_COLOR_RESET "%d, streamed through 2 x %.2f MiB buffers\n", header.npanels, (double)bufferBytes / (1024 * 1024));
+
+    // Only the vectors are memory resident
+    onesVector = (double *)arenaAcquire(arena, sizeof(double) * (long unsigned int)header.cols);
+    vectorInit(header.cols, onesVector, 1);
+    outputVector = (double *)arenaAcquire(arena, sizeof(double) * (long unsigned int)header.rows);
+    ooc_time = newResultsData(arena, compiter);
+    ooc_time->load_ms = loadMs;
+    total = &ooc_time->stream;
+
+    printf(ANSI_COLOR_YELLOW "[INFO]\tCalculating %d iterations of out-of-core SMVP CSR.\n" ANSI_COLOR_RESET, compiter);
+    for (i = 0; i < compiter; i++)
+    {
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+        status = smvp_panels_multiply(panels, 1.0, onesVector, 0.0, outputVector, &pass);
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+        if (status != SMVP_SUCCESS)
+        {
+            printf(ANSI_COLOR_RED "[ERROR]\tStreaming panel file failed: %s.\n" ANSI_COLOR_RESET, (status == SMVP_ERR_SYSTEM) ? strerror(errno) : smvp_strerror(status));
+            exit(1);
+        }
+        ooc_time->time_each[i] = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / 1e6;
+
+        total->panels = pass.panels;
+        total->direct = pass.direct;
+        total->bytes_read += pass.bytes_read;
+        total->io_seconds += pass.io_seconds;
+        total->compute_seconds += pass.compute_seconds;
+        total->stall_seconds += pass.stall_seconds;
+        total->wall_seconds += pass.wall_seconds;
+    }
+    summarizeTimes(ooc_time, compiter);
+
+    ioMs = total->io_seconds * 1e3 / compiter;
+    computeMs = total->compute_seconds * 1e3 / compiter;
+    wallMs = total->wall_seconds * 1e3 / compiter;
+    printf(ANSI_COLOR_CYAN "[DATA]\tPanel reads: " ANSI_COLOR_RESET "%s\n", total->direct ? "O_DIRECT" : "buffered, page cache dropped before each pass");
+    printf(ANSI_COLOR_CYAN "[DATA]\tI/O bandwidth: " ANSI_COLOR_RESET "%.1f MB/s (%g ms per pass)\n", total->bytes_read / 1e6 / total->io_seconds, ioMs);
+    printf(ANSI_COLOR_CYAN "[DATA]\tCompute throughput: " ANSI_COLOR_RESET "%.1f MB/s, %.3f GFLOP/s (%g ms per pass)\n", total->bytes_read / 1e6 / total->compute_seconds,
+           2.0 * (double)header.nnz * compiter / total->compute_seconds / 1e9, computeMs);
+    printf(ANSI_COLOR_CYAN "[DATA]\tKernel stalled on I/O: " ANSI_COLOR_RESET "%g ms per pass\n", total->stall_seconds * 1e3 / compiter);
+
+    // With two buffers a pass takes the slower side plus filling and draining the pipeline (about one panel)
+    printf(ANSI_COLOR_CYAN "[DATA]\tPipeline fill/drain: " ANSI_COLOR_RESET "%g ms per pass, %s bound\n", wallMs - ((ioMs > computeMs) ? ioMs : computeMs),
+           (ioMs > computeMs) ? "I/O" : "compute");
+
+    generateReportText(inputFileName, reportPath, ALG_OOC, (long long)header.nnz, header.rows, compiter, outputVector, ooc_time, outputFormat);
+    generateReportRecord(inputFileName, reportPath, ALG_OOC, header.rows, header.cols, (long long)header.nnz, NULL, compiter, ooc_time, compare);
+
+    arenaRelease(arena, onesVector);
+    arenaRelease(arena, outputVector);
+    arenaRelease(arena, ooc_time);
+    smvp_panels_close(panels);
+}
 
-    int index;
+// Function: compareFinish
+// Prints the --compare table once every run is done and returns the exit status:
+// 2 when a run regressed significantly against its baseline, 0 otherwise (and without --compare)
+int compareFinish(CompareSet *compare)
+{
+    int regressions;
 
-    printf("[DEBUG]\tCSR Iterations: %d\n", iter);
-    printf("[DEBUG]\tCSR fInputRows: %d\n", fInputRows);
-    printf("[DEBUG]\tCSR fInputNonZeros: %d\n", fInputNonZeros);
-    printf("[DEBUG]\tCSR Total Time: %g\n", csr_time->time_total);
-    printf("[DEBUG]\tCSR Avg Time: %g\n", csr_time->time_avg);
-    printf("[DEBUG]\tCSR StDev Time: %g\n", csr_time->time_avg);
-    printf("[DEBUG]\tCSR Times:\n");
-    printf("\t[");
-    for (index = 0; index < iter; index++)
+    if (compare == NULL)
     {
-        printf("%g, ", csr_time->time_each[index]);
+        return 0;
     }
-    printf("]\n");
-    printf("[DEBUG]\tCSR Output Vector:\n");
-    printf("\t[");
-    for (index = 0; index < fInputRows; index++)
+    printf(ANSI_COLOR_CYAN "[DATA]\tComparison with baseline %s:\n\n" ANSI_COLOR_RESET, compare->source);
+    regressions = smvpCompareReport(stdout, compare);
+    printf("\n");
+    if (regressions > 0)
     {
-        printf("%g, ", output_vector[index]);
+        printf(ANSI_COLOR_RED "[ERROR]\t%d run%s significantly slower than the baseline.\n" ANSI_COLOR_RESET, regressions, (regressions == 1) ? " is" : "s are");
+    }
+    smvpCompareFree(compare);
+    return (regressions > 0) ? 2 : 0;
+}
+
+// Function: poolStart
+// Starts the CSR worker pool when more than one thread is requested, leaves *pool NULL otherwise
+void poolStart(smvp_pool_t **pool, int threads, int numaMode)
+{
+    int status;
+
+    *pool = NULL;
+    if (threads > 1 && (status = smvp_pool_create(pool, threads, numaMode)) != SMVP_SUCCESS)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tUnable to start %d worker threads: %s.\n" ANSI_COLOR_RESET, threads, smvp_strerror(status));
+        exit(1);
     }
-    printf("]\n\n");
 }
 
 // Function: popt_usage
@@ -1222,13 +2595,42 @@ int main(int argc, const char *argv[])
     const char *inputFileName;
     char *reportPath;
     char c;
-    FILE *mmInputFile;
+    FILE *mmInputFile = NULL;
     MM_typecode matcode;
     poptContext optCon;
-    int mmio_rb_return, mmio_rs_return, index, alg_mode, calc_iter, cisr_slots;
-    int fInputRows, fInputCols, fInputNonZeros;
-    int *iteration_time;
-    double *output_vector;
+    int mmio_rb_return, mmio_rs_return, mmio_rd_return, index, alg_mode, calc_iter, cisr_slots;
+    int fInputRows, fInputCols;
+    long long fInputNonZeros;
+    StableConfig stable;
+    ServerConfig server;
+    int serverTuned = 0;
+    smvp_options_t matrixOptions;
+    const char *batchSource = NULL;
+    int batchResident = 2, batchTuned = 0;
+    int threads = 1, numaMode = SMVP_NUMA_AUTO;
+    const char *panelPath = NULL;
+    size_t panelBytes = (size_t)64 * 1024 * 1024;
+    int panelTuned = 0;
+    int outputFormat = SMVP_OUTPUT_TEXT, outputTuned = 0;
+    int prefetch = 0;
+    char *prefetchEnd;
+    CompareSet compareSet, *compare = NULL;
+    char compareError[512];
+    smvp_pool_t *pool = NULL;
+    RunArena arena;
+    smvp_matrix_t *matrix;
+    smvp_info_t matrixInfo;
+    int *cooRow = NULL, *cooCol = NULL, status, compression;
+    int64_t *csrRowPtr = NULL, nnz64, badEntry;
+    double *cooVal = NULL;
+    const char *generateSpec = NULL, *sweepThreads = NULL, *sweepInput;
+    BatchQueue sweepQueue;
+    int sweepCapacity = 0;
+    char *generateName = NULL, generateError[256];
+    StreamCoo streamCoo;
+    char streamError[160];
+    struct timespec loadStart, loadEnd;
+    double loadMs;
 
     // Ust POPT library to handle command line arguments robustly
     // POPT library and documentation available at https://github.com/devzero2000/POPT
@@ -1237,6 +2639,23 @@ int main(int argc, const char *argv[])
         int iter;
         int slots;
         char *outputFolder;
+        int cpu;
+        char *hugePages;
+        char *serveSocket;
+        int cacheMiB;
+        int workers;
+        char *batchSource;
+        int resident;
+        int threads;
+        char *numa;
+        char *panelFile;
+        int panelMiB;
+        char *outputFormat;
+        char *compare;
+        char *generate;
+        char *sweep;
+        char *prefetch;
+        int tileLevel;
 
     } popt_field;
 
@@ -1245,15 +2664,40 @@ int main(int argc, const char *argv[])
         {"csr", 'c', POPT_ARG_NONE, NULL, 'c', "Enable CSR SMVP algorithm.", NULL},
         {"cisr-gen", 'g', POPT_ARG_NONE, NULL, 'g', "Generate CISR COE file.", NULL},
         {"tjds", 't', POPT_ARG_NONE, NULL, 't', "Enable TJDS SMVP algorithm.", NULL},
+        {"tiled", 'b', POPT_ARG_NONE, NULL, 'b', "Enable column-tiled CSR SMVP algorithm (x read one cache-sized tile at a time, threaded with -T).", NULL},
+        {"tile-level", 'L', POPT_ARG_INT, &popt_field.tileLevel, 'L', "Cache level whose size sets the column tile width of [-b|--tiled].", "2"},
+        {"transpose", 'r', POPT_ARG_NONE, NULL, 'r', "Enable transpose CSR SMVP algorithm (y = A^T*x from the CSR arrays, threaded with -T).", NULL},
+        {"adaptive-csr", 'A', POPT_ARG_NONE, NULL, 'A', "Enable adaptive CSR SMVP algorithm (rows binned by length, threaded with -T).", NULL},
         {"number", 'n', POPT_ARG_INT, &popt_field.iter, 'n', "Number of computation iterations per-algorithm.", "1000"},
         {"slots", 's', POPT_ARG_INT, &popt_field.slots, 's', "Number of slots for CISR.", "16"},
         {"dir", 'd', POPT_ARG_STRING, &popt_field.outputFolder, 'd', "Output folder for reports.", "./"},
+        {"stable", 'S', POPT_ARG_NONE, NULL, 'S', "Reduce timing jitter (pin CPU, lock and prefault buffers, report faults/migrations).", NULL},
+        {"cpu", 'C', POPT_ARG_INT, &popt_field.cpu, 'C', "CPU to pin the compute thread to in stable mode, workers of -T are pinned from it on.", "0"},
+        {"priority", 'P', POPT_ARG_NONE, NULL, 'P', "Raise scheduling priority in stable mode.", NULL},
+        {"hugepages", 'H', POPT_ARG_STRING, &popt_field.hugePages, 'H', "Huge page backing for large kernel arrays (none, thp, explicit).", "none"},
+        {"serve", 'D', POPT_ARG_STRING, &popt_field.serveSocket, 'D', "Run as a persistent server on a Unix socket instead of processing a file.", "/path/to/socket"},
+        {"cache-mb", 'M', POPT_ARG_INT, &popt_field.cacheMiB, 'M', "Server matrix cache limit in MiB.", "1024"},
+        {"workers", 'W', POPT_ARG_INT, &popt_field.workers, 'W', "Server worker threads.", "4"},
+        {"batch", 'B', POPT_ARG_STRING, &popt_field.batchSource, 'B', "Benchmark every .mtx file in a directory, or every path listed in a manifest file.", "/path/to/dir|manifest"},
+        {"resident", 'R', POPT_ARG_INT, &popt_field.resident, 'R', "Matrices held in memory at once in batch mode.", "2"},
+        {"threads", 'T', POPT_ARG_INT, &popt_field.threads, 'T', "Worker threads for the CSR, adaptive CSR, column-tiled CSR and transpose CSR kernels.", "1"},
+        {"numa", 'N', POPT_ARG_STRING, &popt_field.numa, 'N', "NUMA placement for threaded kernels (off, auto, replicate). No effect on single-node machines.", "auto"},
+        {"out-of-core", 'O', POPT_ARG_STRING, &popt_field.panelFile, 'O', "Stream CSR row panels from this file instead of loading the matrix (built from the input file when missing or stale).", "/path/to/file.panels"},
+        {"panel-mb", 'K', POPT_ARG_INT, &popt_field.panelMiB, 'K', "Out-of-core panel size in MiB.", "64"},
+        {"output-format", 'F', POPT_ARG_STRING, &popt_field.outputFormat, 'F', "Output vector format for reports (text, bin, npy). bin and npy write the vector next to the report.", "text"},
+        {"generate", 'G', POPT_ARG_STRING, &popt_field.generate, 'G', "Benchmark a synthetic matrix instead of an input file (rmat, banded, poisson2d, poisson3d, random, see README).", "kind:key=value,..."},
+        {"sweep", 'w', POPT_ARG_STRING, &popt_field.sweep, 'w', "Time the threaded CSR kernel of every input over a grid of thread counts and report speedup, efficiency and bandwidth saturation (auto: 1 to all hardware threads).", "auto|1,2,4,..."},
+        {"prefetch", 'p', POPT_ARG_STRING, &popt_field.prefetch, 'p', "Software prefetch in the CSR and TJDS kernels (off, auto: calibrate the distance per matrix, or a distance in non-zeros). Reports the gain over the plain kernel.", "off|auto|16"},
+        {"compare", 'X', POPT_ARG_STRING, &popt_field.compare, 'X', "Compare every run with baseline benchmark records (a record .json file or a report folder), exit with 2 on a significant regression.", "/path/to/baseline"},
         POPT_AUTOHELP
             POPT_TABLEEND};
 
     optCon = poptGetContext(NULL, argc, argv, optionsTable, POPT_CONTEXT_NO_EXEC | POPT_CONTEXT_POSIXMEHARDER);
     poptSetOtherOptionHelp(optCon, "[OPTIONS] <file>");
 
+    // Reports go to the current working directory unless -d is given
+    reportPath = "";
+
     // Start with no algorithms selected, enable specific algs as options are processed.
     alg_mode = ALG_NONE;
 
@@ -1263,6 +2707,19 @@ int main(int argc, const char *argv[])
     // Define default CISR slot count
     cisr_slots = 16;
 
+    // Stable mode is opt-in, pin to the current CPU unless told otherwise
+    stable.enabled = 0;
+    stable.cpu = -1;
+    stable.priority = 0;
+
+    // Matrices get the library defaults unless [-H|--hugepages] or [-L|--tile-level] change them
+    smvp_options_init(&matrixOptions);
+
+    // Server mode is opt-in
+    server.socketPath = NULL;
+    server.cacheLimit = (size_t)1024 * 1024 * 1024;
+    server.workers = 4;
+
     // Display usage if no arguments are specified
     if (argc < 2)
     {
@@ -1283,10 +2740,32 @@ int main(int argc, const char *argv[])
             }
             else
             {
-                alg_mode = ALG_ALL;
+                alg_mode = ALG_ALL;
+                break;
+            }
+        case 'c':
+            if (alg_mode == ALG_ALL)
+            {
+                printf(ANSI_COLOR_RED "[ERROR]\tCombining [-a|--all] with other algorithm flags is not supported.\n" ANSI_COLOR_RESET);
+                exit(1);
+            }
+            else
+            {
+                alg_mode += ALG_CSR;
+                break;
+            }
+        case 't':
+            if (alg_mode == ALG_ALL)
+            {
+                printf(ANSI_COLOR_RED "[ERROR]\tCombining [-a|--all] with other algorithm flags is not supported.\n" ANSI_COLOR_RESET);
+                exit(1);
+            }
+            else
+            {
+                alg_mode += ALG_TJDS;
                 break;
             }
-        case 'c':
+        case 'b':
             if (alg_mode == ALG_ALL)
             {
                 printf(ANSI_COLOR_RED "[ERROR]\tCombining [-a|--all] with other algorithm flags is not supported.\n" ANSI_COLOR_RESET);
@@ -1294,10 +2773,21 @@ int main(int argc, const char *argv[])
             }
             else
             {
-                alg_mode += ALG_CSR;
+                alg_mode += ALG_TILED;
                 break;
             }
-        case 't':
+        case 'L':
+            if (popt_field.tileLevel >= 1 && popt_field.tileLevel <= 4)
+            {
+                matrixOptions.tile_level = popt_field.tileLevel;
+            }
+            else
+            {
+                printf(ANSI_COLOR_RED "[ERROR]\tInvalid cache level specified for column tiles. Use 1 to 4.\n" ANSI_COLOR_RESET);
+                exit(1);
+            }
+            break;
+        case 'r':
             if (alg_mode == ALG_ALL)
             {
                 printf(ANSI_COLOR_RED "[ERROR]\tCombining [-a|--all] with other algorithm flags is not supported.\n" ANSI_COLOR_RESET);
@@ -1305,7 +2795,18 @@ int main(int argc, const char *argv[])
             }
             else
             {
-                alg_mode += ALG_TJDS;
+                alg_mode += ALG_CSRT;
+                break;
+            }
+        case 'A':
+            if (alg_mode == ALG_ALL)
+            {
+                printf(ANSI_COLOR_RED "[ERROR]\tCombining [-a|--all] with other algorithm flags is not supported.\n" ANSI_COLOR_RESET);
+                exit(1);
+            }
+            else
+            {
+                alg_mode += ALG_ACSR;
                 break;
             }
         case 'g':
@@ -1353,12 +2854,191 @@ int main(int argc, const char *argv[])
                 printf(ANSI_COLOR_RED "[ERROR]\tReport output folder not found. Check path and/or create folder if it does not exist.\n" ANSI_COLOR_RESET);
                 exit(1);
             }
+        case 'S':
+            stable.enabled = 1;
+            break;
+        case 'C':
+            if (popt_field.cpu >= 0 && popt_field.cpu < CPU_SETSIZE)
+            {
+                stable.cpu = popt_field.cpu;
+            }
+            else
+            {
+                printf(ANSI_COLOR_RED "[ERROR]\tInvalid CPU number specified.\n" ANSI_COLOR_RESET);
+                exit(1);
+            }
+            break;
+        case 'P':
+            stable.priority = 1;
+            break;
+        case 'H':
+            if (strcmp(popt_field.hugePages, "none") == 0)
+            {
+                matrixOptions.hugepages = SMVP_HUGE_NONE;
+            }
+            else if (strcmp(popt_field.hugePages, "thp") == 0)
+            {
+                matrixOptions.hugepages = SMVP_HUGE_THP;
+            }
+            else if (strcmp(popt_field.hugePages, "explicit") == 0)
+            {
+                matrixOptions.hugepages = SMVP_HUGE_EXPLICIT;
+            }
+            else
+            {
+                printf(ANSI_COLOR_RED "[ERROR]\tInvalid huge page mode specified. Use none, thp or explicit.\n" ANSI_COLOR_RESET);
+                exit(1);
+            }
+            break;
+        case 'D':
+            server.socketPath = popt_field.serveSocket;
+            break;
+        case 'M':
+            if (popt_field.cacheMiB >= 1)
+            {
+                server.cacheLimit = (size_t)popt_field.cacheMiB * 1024 * 1024;
+                serverTuned = 1;
+            }
+            else
+            {
+                printf(ANSI_COLOR_RED "[ERROR]\tInvalid server cache limit specified.\n" ANSI_COLOR_RESET);
+                exit(1);
+            }
+            break;
+        case 'W':
+            if (popt_field.workers >= 1)
+            {
+                server.workers = popt_field.workers;
+                serverTuned = 1;
+            }
+            else
+            {
+                printf(ANSI_COLOR_RED "[ERROR]\tInvalid number of server workers specified.\n" ANSI_COLOR_RESET);
+                exit(1);
+            }
+            break;
+        case 'B':
+            batchSource = popt_field.batchSource;
+            break;
+        case 'T':
+            if (popt_field.threads >= 1)
+            {
+                threads = popt_field.threads;
+            }
+            else
+            {
+                printf(ANSI_COLOR_RED "[ERROR]\tInvalid number of threads specified.\n" ANSI_COLOR_RESET);
+                exit(1);
+            }
+            break;
+        case 'N':
+            if (strcmp(popt_field.numa, "off") == 0)
+            {
+                numaMode = SMVP_NUMA_OFF;
+            }
+            else if (strcmp(popt_field.numa, "auto") == 0)
+            {
+                numaMode = SMVP_NUMA_AUTO;
+            }
+            else if (strcmp(popt_field.numa, "replicate") == 0)
+            {
+                numaMode = SMVP_NUMA_REPLICATE;
+            }
+            else
+            {
+                printf(ANSI_COLOR_RED "[ERROR]\tInvalid NUMA mode specified. Use off, auto or replicate.\n" ANSI_COLOR_RESET);
+                exit(1);
+            }
+            break;
+        case 'O':
+            panelPath = popt_field.panelFile;
+            break;
+        case 'F':
+            if (strcmp(popt_field.outputFormat, "text") == 0)
+            {
+                outputFormat = SMVP_OUTPUT_TEXT;
+            }
+            else if (strcmp(popt_field.outputFormat, "bin") == 0)
+            {
+                outputFormat = SMVP_OUTPUT_BIN;
+            }
+            else if (strcmp(popt_field.outputFormat, "npy") == 0)
+            {
+                outputFormat = SMVP_OUTPUT_NPY;
+            }
+            else
+            {
+                printf(ANSI_COLOR_RED "[ERROR]\tInvalid output format specified. Use text, bin or npy.\n" ANSI_COLOR_RESET);
+                exit(1);
+            }
+            outputTuned = 1;
+            break;
+        case 'X':
+            // Load the baseline now so a bad one fails before anything is benchmarked
+            if (smvpCompareLoad(popt_field.compare, &compareSet, compareError, sizeof(compareError)) != 0)
+            {
+                printf(ANSI_COLOR_RED "[ERROR]\tUnable to load baseline: %s.\n" ANSI_COLOR_RESET, compareError);
+                exit(1);
+            }
+            compare = &compareSet;
+            break;
+        case 'G':
+            generateSpec = popt_field.generate;
+            break;
+        case 'w':
+            sweepThreads = popt_field.sweep;
+            break;
+        case 'p':
+            if (strcmp(popt_field.prefetch, "off") == 0)
+            {
+                prefetch = 0;
+            }
+            else if (strcmp(popt_field.prefetch, "auto") == 0)
+            {
+                prefetch = PREFETCH_AUTO;
+            }
+            else if ((prefetch = (int)strtol(popt_field.prefetch, &prefetchEnd, 10)) < 1 || prefetch > SMVP_PREFETCH_MAX || *prefetchEnd != '\0')
+            {
+                printf(ANSI_COLOR_RED "[ERROR]\tInvalid prefetch setting specified. Use off, auto or a distance from 1 to %d.\n" ANSI_COLOR_RESET, SMVP_PREFETCH_MAX);
+                exit(1);
+            }
+            break;
+        case 'K':
+            if (popt_field.panelMiB >= 1)
+            {
+                panelBytes = (size_t)popt_field.panelMiB * 1024 * 1024;
+                panelTuned = 1;
+            }
+            else
+            {
+                printf(ANSI_COLOR_RED "[ERROR]\tInvalid panel size specified.\n" ANSI_COLOR_RESET);
+                exit(1);
+            }
+            break;
+        case 'R':
+            if (popt_field.resident >= 1)
+            {
+                batchResident = popt_field.resident;
+                batchTuned = 1;
+            }
+            else
+            {
+                printf(ANSI_COLOR_RED "[ERROR]\tInvalid number of resident matrices specified.\n" ANSI_COLOR_RESET);
+                exit(1);
+            }
+            break;
         default:
             poptPrintUsage(optCon, stderr, 0);
             exit(1);
         }
     }
 
+    if ((stable.cpu >= 0 || stable.priority) && !stable.enabled)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\t[-C|--cpu] and [-P|--priority] require [-S|--stable].\n" ANSI_COLOR_RESET);
+        exit(1);
+    }
+
     // Handle popt option exceptions where appropriate
     if (c < -1)
     {
@@ -1385,97 +3065,413 @@ int main(int argc, const char *argv[])
         }
     }
 
-    // Parse mandatory arguments
-    inputFileName = poptGetArg(optCon);
-    if ((inputFileName == NULL) || !(poptPeekArg(optCon) == NULL))
+    // Only single-file runs write per-algorithm reports with an output vector
+    if (outputTuned && (server.socketPath != NULL || batchSource != NULL))
     {
-        popt_usage(optCon, 1, ANSI_COLOR_RED "[ERROR]\tMust specify a single input file", "ex., /path/to/file.mtx\n" ANSI_COLOR_RESET);
+        printf(ANSI_COLOR_RED "[ERROR]\t[-F|--output-format] cannot be combined with [-D|--serve] or [-B|--batch], neither writes output vectors.\n" ANSI_COLOR_RESET);
+        exit(1);
     }
-    else if ((mmInputFile = fopen(inputFileName, "r")) == NULL)
+
+    if (compare != NULL && server.socketPath != NULL)
     {
-        printf(ANSI_COLOR_RED "[ERROR]\tSpecified input file not found.\n" ANSI_COLOR_RESET);
+        printf(ANSI_COLOR_RED "[ERROR]\t[-X|--compare] cannot be combined with [-D|--serve], server requests are not benchmark runs.\n" ANSI_COLOR_RESET);
         exit(1);
     }
 
-    // Done parsing options/args, release popt instance
-    poptFreeContext(optCon);
-    printf(ANSI_COLOR_GREEN "\n[START]\tExecuting smvp-toolbox-cli v%d.%d.%d\n" ANSI_COLOR_RESET, MAJOR_VER, MINOR_VER, REVISION_VER);
+    // Prefetch calibration belongs to the per-algorithm phases of a single in-memory matrix
+    if (prefetch != 0 && (server.socketPath != NULL || batchSource != NULL || sweepThreads != NULL || panelPath != NULL))
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\t[-p|--prefetch] cannot be combined with [-D|--serve], [-B|--batch], [-w|--sweep] or [-O|--out-of-core].\n" ANSI_COLOR_RESET);
+        exit(1);
+    }
+
+    // Transpose products are a per-file phase with an output vector of cols entries, not a batch or served kernel
+    if ((alg_mode & ALG_CSRT) && (server.socketPath != NULL || batchSource != NULL || sweepThreads != NULL || panelPath != NULL))
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\t[-r|--transpose] cannot be combined with [-D|--serve], [-B|--batch], [-w|--sweep] or [-O|--out-of-core].\n" ANSI_COLOR_RESET);
+        exit(1);
+    }
+
+    // Scaling sweeps take every input file, the generated matrix and the batch source together, CSR only
+    if (sweepThreads != NULL)
+    {
+        if ((alg_mode != ALG_NONE && alg_mode != ALG_CSR) || threads > 1 || stable.enabled || panelPath != NULL || server.socketPath != NULL || outputTuned || compare != NULL || batchTuned)
+        {
+            printf(ANSI_COLOR_RED "[ERROR]\t[-w|--sweep] times the threaded CSR kernel only, it cannot be combined with other algorithms, [-T|--threads], [-S|--stable], [-O|--out-of-core], [-D|--serve], [-F|--output-format], [-X|--compare] or [-R|--resident].\n" ANSI_COLOR_RESET);
+            exit(1);
+        }
+        memset(&sweepQueue, 0, sizeof(sweepQueue));
+        sweepQueue.options = &matrixOptions;
+        if (batchSource != NULL)
+        {
+            batchCollect(batchSource, &sweepQueue);
+            sweepCapacity = sweepQueue.count;
+        }
+        if (generateSpec != NULL)
+        {
+            generateName = (char *)malloc(strlen(SMVP_GENERATE_PREFIX) + strlen(generateSpec) + 1);
+            sprintf(generateName, "%s%s", SMVP_GENERATE_PREFIX, generateSpec);
+            batchAddItem(&sweepQueue, &sweepCapacity, NULL, generateName);
+            free(generateName);
+        }
+        while ((sweepInput = poptGetArg(optCon)) != NULL)
+        {
+            batchAddItem(&sweepQueue, &sweepCapacity, NULL, sweepInput);
+        }
+        if (sweepQueue.count == 0)
+        {
+            popt_usage(optCon, 1, ANSI_COLOR_RED "[ERROR]\t[-w|--sweep] needs at least one input", "ex., /path/to/file.mtx, [-G|--generate] or [-B|--batch]\n" ANSI_COLOR_RESET);
+        }
+        poptFreeContext(optCon);
+        printf(ANSI_COLOR_GREEN "\n[START]\tExecuting smvp-toolbox-cli v%d.%d.%d (sweep mode)\n" ANSI_COLOR_RESET, MAJOR_VER, MINOR_VER, REVISION_VER);
+
+        arenaInit(&arena, matrixOptions.hugepages);
+        sweepRun(&sweepQueue, sweepThreads, calc_iter, numaMode, reportPath, &arena);
+        arenaReport(&arena);
+        arenaDestroy(&arena);
+        for (index = 0; index < sweepQueue.count; index++)
+        {
+            free(sweepQueue.items[index].path);
+        }
+        free(sweepQueue.items);
+
+        printf(ANSI_COLOR_GREEN "[STOP]\tExit smvp-toolbox v%d.%d.%d\n\n" ANSI_COLOR_RESET, MAJOR_VER, MINOR_VER, REVISION_VER);
+        return 0;
+    }
 
-    // Ensure input file is of proper format and contains an appropriate matrix type
-    mmio_rb_return = mm_read_banner(mmInputFile, &matcode);
-    if (mmio_rb_return != 0)
+    // Generated matrices replace the single input file, batch manifests list them as generate:<spec> lines instead
+    if (generateSpec != NULL && (server.socketPath != NULL || batchSource != NULL || panelPath != NULL))
     {
-        mmioErrorHandler(mmio_rb_return);
+        printf(ANSI_COLOR_RED "[ERROR]\t[-G|--generate] cannot be combined with [-D|--serve], [-B|--batch] or [-O|--out-of-core].\n" ANSI_COLOR_RESET);
+        exit(1);
+    }
+
+    // Server mode takes no input file, matrices arrive with each request
+    if (server.socketPath != NULL)
+    {
+        if (poptPeekArg(optCon) != NULL || alg_mode != ALG_NONE)
+        {
+            printf(ANSI_COLOR_RED "[ERROR]\t[-D|--serve] does not take an input file or algorithm flags.\n" ANSI_COLOR_RESET);
+            exit(1);
+        }
+        poptFreeContext(optCon);
+        printf(ANSI_COLOR_GREEN "\n[START]\tExecuting smvp-toolbox-cli v%d.%d.%d (server mode)\n" ANSI_COLOR_RESET, MAJOR_VER, MINOR_VER, REVISION_VER);
+        server.options = matrixOptions;
+        status = smvpServerRun(&server);
+        printf(ANSI_COLOR_GREEN "[STOP]\tExit smvp-toolbox v%d.%d.%d\n\n" ANSI_COLOR_RESET, MAJOR_VER, MINOR_VER, REVISION_VER);
+        return status;
+    }
+    else if (serverTuned)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\t[-M|--cache-mb] and [-W|--workers] require [-D|--serve].\n" ANSI_COLOR_RESET);
+        exit(1);
+    }
+
+    // Batch mode takes its matrices from a directory or manifest instead of a single input file
+    if (batchSource != NULL)
+    {
+        if (poptPeekArg(optCon) != NULL)
+        {
+            printf(ANSI_COLOR_RED "[ERROR]\t[-B|--batch] does not take an input file.\n" ANSI_COLOR_RESET);
+            exit(1);
+        }
+        if (alg_mode != ALG_ALL && (alg_mode & ALG_CISR))
+        {
+            printf(ANSI_COLOR_RED "[ERROR]\tCISR COE generation is not supported in batch mode.\n" ANSI_COLOR_RESET);
+            exit(1);
+        }
+        poptFreeContext(optCon);
+        printf(ANSI_COLOR_GREEN "\n[START]\tExecuting smvp-toolbox-cli v%d.%d.%d (batch mode)\n" ANSI_COLOR_RESET, MAJOR_VER, MINOR_VER, REVISION_VER);
+
+        // Benchmark every format unless told otherwise
+        arenaInit(&arena, matrixOptions.hugepages);
+        poolStart(&pool, threads, numaMode);
+        batchRun(batchSource, &matrixOptions, (alg_mode == ALG_NONE) ? ALG_ALL : alg_mode, calc_iter, batchResident, reportPath, compare, &arena, pool, &stable);
+        arenaReport(&arena);
+        smvp_pool_destroy(pool);
+        arenaDestroy(&arena);
+        status = compareFinish(compare);
+
+        printf(ANSI_COLOR_GREEN "[STOP]\tExit smvp-toolbox v%d.%d.%d\n\n" ANSI_COLOR_RESET, MAJOR_VER, MINOR_VER, REVISION_VER);
+        return status;
     }
-    else if (mm_is_sparse(matcode) == 0)
+    else if (batchTuned)
     {
-        printf(ANSI_COLOR_RED "[ERROR]\tThis application only supports sparse matricies. Specified input file does not appear to contain a sparse matrix.\n" ANSI_COLOR_RESET);
+        printf(ANSI_COLOR_RED "[ERROR]\t[-R|--resident] requires [-B|--batch].\n" ANSI_COLOR_RESET);
         exit(1);
     }
 
-    // Load sparse matrix properties from input file
-    printf(ANSI_COLOR_MAGENTA "[FILE]\tInput matrix file name: " ANSI_COLOR_RESET "%s\n", inputFileName);
-    printf(ANSI_COLOR_YELLOW "[INFO]\tLoading matrix content from source file.\n" ANSI_COLOR_RESET);
-    mmio_rs_return = mm_read_mtx_crd_size(mmInputFile, &fInputRows, &fInputCols, &fInputNonZeros);
-    if (mmio_rs_return != 0)
+    // Out-of-core mode streams a single matrix through the CSR kernel on the calling thread
+    if (panelPath != NULL && ((alg_mode != ALG_NONE && alg_mode != ALG_CSR) || threads > 1 || stable.enabled))
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\t[-O|--out-of-core] runs the serial CSR kernel only, it cannot be combined with other algorithms, [-T|--threads] or [-S|--stable].\n" ANSI_COLOR_RESET);
+        exit(1);
+    }
+    else if (panelPath == NULL && panelTuned)
     {
-        mmioErrorHandler(mmio_rs_return);
+        printf(ANSI_COLOR_RED "[ERROR]\t[-K|--panel-mb] requires [-O|--out-of-core].\n" ANSI_COLOR_RESET);
+        exit(1);
     }
 
-    // Stage matrix content from the input file into working memory
-    MMRawData mmImportData[fInputNonZeros];
-    for (index = 0; index < fInputNonZeros; index++)
+    // Parse mandatory arguments, a generated matrix is named generate:<spec> in reports and records
+    if (generateSpec != NULL)
     {
-        if (mm_is_pattern(matcode) != 0)
+        if (poptPeekArg(optCon) != NULL)
         {
-            fscanf(mmInputFile, "%d %d\n", &mmImportData[index].row, &mmImportData[index].col);
-            mmImportData[index].val = 1; //Not really needed, but keeps the data sane just in case it does get referenced somewhere
+            printf(ANSI_COLOR_RED "[ERROR]\t[-G|--generate] does not take an input file.\n" ANSI_COLOR_RESET);
+            exit(1);
         }
-        else
+        generateName = (char *)malloc(strlen(SMVP_GENERATE_PREFIX) + strlen(generateSpec) + 1);
+        sprintf(generateName, "%s%s", SMVP_GENERATE_PREFIX, generateSpec);
+        inputFileName = generateName;
+    }
+    else if (((inputFileName = poptGetArg(optCon)) == NULL) || !(poptPeekArg(optCon) == NULL))
+    {
+        popt_usage(optCon, 1, ANSI_COLOR_RED "[ERROR]\tMust specify a single input file", "ex., /path/to/file.mtx\n" ANSI_COLOR_RESET);
+    }
+    else if ((mmInputFile = fopen(inputFileName, "r")) == NULL)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tSpecified input file not found.\n" ANSI_COLOR_RESET);
+        exit(1);
+    }
+
+    // Done parsing options/args, release popt instance
+    poptFreeContext(optCon);
+    printf(ANSI_COLOR_GREEN "\n[START]\tExecuting smvp-toolbox-cli v%d.%d.%d\n" ANSI_COLOR_RESET, MAJOR_VER, MINOR_VER, REVISION_VER);
+
+    // Every buffer from here on comes from the run arena and is freed before exit
+    arenaInit(&arena, matrixOptions.hugepages);
+
+    // The matrix never enters memory in out-of-core mode, only its panels pass through
+    if (panelPath != NULL)
+    {
+        fclose(mmInputFile);
+        if (smvpDetectCompression(inputFileName) != SMVP_COMPRESS_NONE)
         {
-            fscanf(mmInputFile, "%d %d %lg\n", &mmImportData[index].row, &mmImportData[index].col, &mmImportData[index].val);
+            printf(ANSI_COLOR_RED "[ERROR]\t[-O|--out-of-core] needs an uncompressed input file.\n" ANSI_COLOR_RESET);
+            exit(1);
         }
-        // Convert from 1-based coordinate system to 0-based coordinate system (make sure to unpack to the original format when writing output files!)
-        mmImportData[index].row--;
-        mmImportData[index].col--;
+        printf(ANSI_COLOR_MAGENTA "[FILE]\tInput matrix file name: " ANSI_COLOR_RESET "%s\n", inputFileName);
+        oocRun(inputFileName, panelPath, panelBytes, calc_iter, reportPath, outputFormat, compare, &arena);
+        arenaReport(&arena);
+        arenaDestroy(&arena);
+        status = compareFinish(compare);
+
+        printf(ANSI_COLOR_GREEN "[STOP]\tExit smvp-toolbox v%d.%d.%d\n\n" ANSI_COLOR_RESET, MAJOR_VER, MINOR_VER, REVISION_VER);
+        return status;
     }
 
-    // Close input file only if it isn't somehow mapped as keyboard input
-    if (mmInputFile != stdin)
+    // Compressed files are decompressed on one thread and parsed on the others, straight into the staging arrays
+    clock_gettime(CLOCK_MONOTONIC_RAW, &loadStart);
+    compression = (generateSpec != NULL) ? SMVP_COMPRESS_NONE : smvpDetectCompression(inputFileName);
+    if (generateSpec != NULL)
+    {
+        printf(ANSI_COLOR_MAGENTA "[FILE]\tGenerated matrix: " ANSI_COLOR_RESET "%s\n", generateSpec);
+        printf(ANSI_COLOR_YELLOW "[INFO]\tBuilding matrix content in CSR with %d generator threads.\n" ANSI_COLOR_RESET, smvpDefaultParseThreads());
+        if ((matrix = smvpGenerateMatrix(generateSpec, smvpDefaultParseThreads(), &matrixOptions, generateError, sizeof(generateError))) == NULL)
+        {
+            printf(ANSI_COLOR_RED "[ERROR]\tUnable to generate matrix: %s.\n" ANSI_COLOR_RESET, generateError);
+            exit(1);
+        }
+        smvp_get_info(matrix, &matrixInfo);
+        fInputRows = matrixInfo.rows;
+        fInputCols = matrixInfo.cols;
+        fInputNonZeros = matrixInfo.nnz;
+    }
+    else if (compression != SMVP_COMPRESS_NONE)
     {
         fclose(mmInputFile);
+        printf(ANSI_COLOR_MAGENTA "[FILE]\tInput matrix file name: " ANSI_COLOR_RESET "%s\n", inputFileName);
+        printf(ANSI_COLOR_YELLOW "[INFO]\tLoading matrix content from %s compressed source file.\n" ANSI_COLOR_RESET, smvpCompressionName(compression));
+        if (smvpStreamMatrix(inputFileName, compression, smvpDefaultParseThreads(), arenaStreamAlloc, &arena, &streamCoo, streamError, sizeof(streamError)) != 0)
+        {
+            printf(ANSI_COLOR_RED "[ERROR]\tUnable to load compressed input file: %s.\n" ANSI_COLOR_RESET, streamError);
+            exit(1);
+        }
+        fInputRows = streamCoo.rows;
+        fInputCols = streamCoo.cols;
+        fInputNonZeros = streamCoo.nnz;
+        cooRow = streamCoo.row;
+        cooCol = streamCoo.col;
+        cooVal = streamCoo.val;
+        printf(ANSI_COLOR_CYAN "[DATA]\tDecompressed and parsed: " ANSI_COLOR_RESET "%.2f MiB into %.2f MiB of text in %g ms (%.1f MB/s of text, %d parser threads)\n",
+               streamCoo.bytesIn / (1024.0 * 1024.0), streamCoo.bytesOut / (1024.0 * 1024.0), streamCoo.seconds * 1e3, streamCoo.bytesOut / 1e6 / streamCoo.seconds, streamCoo.parseThreads);
+    }
+    else
+    {
+        // Ensure input file is of proper format and contains an appropriate matrix type
+        mmio_rb_return = mm_read_banner(mmInputFile, &matcode);
+        if (mmio_rb_return != 0)
+        {
+            mmioErrorHandler(mmio_rb_return);
+        }
+        else if (mm_is_sparse(matcode) == 0)
+        {
+            printf(ANSI_COLOR_RED "[ERROR]\tThis application only supports sparse matricies. Specified input file does not appear to contain a sparse matrix.\n" ANSI_COLOR_RESET);
+            exit(1);
+        }
+
+        // Load sparse matrix properties from input file
+        printf(ANSI_COLOR_MAGENTA "[FILE]\tInput matrix file name: " ANSI_COLOR_RESET "%s\n", inputFileName);
+        printf(ANSI_COLOR_YELLOW "[INFO]\tLoading matrix content from source file.\n" ANSI_COLOR_RESET);
+        mmio_rs_return = mm_read_mtx_crd_size64(mmInputFile, &fInputRows, &fInputCols, &nnz64);
+        if (mmio_rs_return != 0)
+        {
+            mmioErrorHandler(mmio_rs_return);
+        }
+        fInputNonZeros = nnz64;
+
+        // Parse matrix content from the input file straight into CSR (rows are counted while parsing)
+        // Row pointers are staged at 64 bits, the library keeps 32 unless the non-zeros exceed the index limit
+        csrRowPtr = (int64_t *)arenaAcquire(&arena, sizeof(int64_t) * ((long unsigned int)fInputRows + 1));
+        cooCol = (int *)arenaAcquire(&arena, sizeof(int) * (long unsigned int)fInputNonZeros);
+        cooVal = (double *)arenaAcquire(&arena, sizeof(double) * (long unsigned int)fInputNonZeros);
+        mmio_rd_return = mm_read_mtx_crd_csr64(mmInputFile, fInputRows, fInputCols, nnz64, csrRowPtr, cooCol, cooVal, matcode, &badEntry);
+        if (mmio_rd_return == MM_UNSUPPORTED_TYPE)
+        {
+            mmioErrorHandler(mmio_rd_return);
+        }
+        else if (mmio_rd_return != 0)
+        {
+            printf(ANSI_COLOR_RED "[ERROR]\tCould not process specified Matrix Market input file. Entry %lld of %lld %s.\n" ANSI_COLOR_RESET, (long long)badEntry, fInputNonZeros, smvpEntryErrorText(mmio_rd_return));
+            exit(1);
+        }
+
+        // Close input file only if it isn't somehow mapped as keyboard input
+        if (mmInputFile != stdin)
+        {
+            fclose(mmInputFile);
+        }
     }
+    clock_gettime(CLOCK_MONOTONIC_RAW, &loadEnd);
+    loadMs = ((loadEnd.tv_sec - loadStart.tv_sec) * 1e9 + (loadEnd.tv_nsec - loadStart.tv_nsec)) / 1e6;
 
-    printf(ANSI_COLOR_CYAN "[DATA]\tNon-zero numbers contained in matrix: " ANSI_COLOR_RESET "%d\n", fInputNonZeros);
+    printf(ANSI_COLOR_CYAN "[DATA]\tNon-zero numbers contained in matrix: " ANSI_COLOR_RESET "%lld\n", fInputNonZeros);
     printf(ANSI_COLOR_CYAN "[DATA]\tVector operand in use: " ANSI_COLOR_RESET "Ones vector with dimensions [%d, %d]\n", fInputRows, 1);
 
-    // Run every SMVP algorithm selected by user
-    if (alg_mode & ALG_CSR)
+    // Workers are started before the compute thread is pinned so they do not inherit its single-CPU mask
+    poolStart(&pool, threads, numaMode);
+
+    // Pin and prioritize once, before any conversion, so every algorithm runs under the same conditions
+    stableApplyAffinity(&stable, pool);
+
+    // Build the canonical representation once, every algorithm derives its format from it
+    clock_gettime(CLOCK_MONOTONIC_RAW, &loadStart);
+    if (generateSpec != NULL)
+    {
+        status = SMVP_SUCCESS; // Already built in place by the generator
+    }
+    else if (csrRowPtr != NULL)
+    {
+        status = smvp_create_csr64(&matrix, fInputRows, fInputCols, csrRowPtr, cooCol, cooVal, &matrixOptions);
+    }
+    else
+    {
+        status = smvp_create_coo(&matrix, fInputRows, fInputCols, fInputNonZeros, cooRow, cooCol, cooVal, &matrixOptions);
+    }
+    if (status != SMVP_SUCCESS)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tUnable to build matrix from input file: %s.\n" ANSI_COLOR_RESET, smvp_strerror(status));
+        exit(1);
+    }
+    clock_gettime(CLOCK_MONOTONIC_RAW, &loadEnd);
+    loadMs += ((loadEnd.tv_sec - loadStart.tv_sec) * 1e9 + (loadEnd.tv_nsec - loadStart.tv_nsec)) / 1e6;
+    printf(ANSI_COLOR_CYAN "[DATA]\tMatrix load time: " ANSI_COLOR_RESET "%g ms (%s)\n", loadMs, (generateSpec != NULL) ? "generated in CSR" : "parse and canonical CSR build");
+    arenaRelease(&arena, cooVal);
+    arenaRelease(&arena, cooCol);
+    arenaRelease(&arena, cooRow);
+    arenaRelease(&arena, csrRowPtr);
+
+    // Threaded CSR: partition rows over the pool, first-touching them on their workers' nodes
+    if (pool != NULL && (status = smvp_bind(matrix, pool, threads)) != SMVP_SUCCESS)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tUnable to bind matrix to worker threads: %s.\n" ANSI_COLOR_RESET, smvp_strerror(status));
+        exit(1);
+    }
+
+    // Run every SMVP algorithm selected by user (ALG_ALL is its own flag, so it must be tested for explicitly)
+    if (alg_mode & (ALG_CSR | ALG_ALL))
     {
         // DO CSR
-        struct _time_data_ *csr_time = newResultsData(csr_time, calc_iter);
-        double *output_vector_csr = smvp_csr_compute(mmImportData, fInputRows, fInputNonZeros, calc_iter, csr_time);
-        generateReportText(inputFileName, reportPath, ALG_CSR, fInputNonZeros, fInputRows, calc_iter, output_vector_csr, csr_time);
+        struct _time_data_ *csr_time = newResultsData(&arena, calc_iter);
+        csr_time->load_ms = loadMs;
+        double *output_vector_csr = smvp_csr_compute(&arena, matrix, pool, calc_iter, prefetch, csr_time, &stable);
+        generateReportText(inputFileName, reportPath, ALG_CSR, fInputNonZeros, fInputRows, calc_iter, output_vector_csr, csr_time, outputFormat);
+        generateReportRecord(inputFileName, reportPath, ALG_CSR, fInputRows, fInputCols, fInputNonZeros, matrix, calc_iter, csr_time, compare);
 
         if (SMVP_CSR_DEBUG)
         {
             smvp_csr_debug(output_vector_csr, csr_time, fInputRows, fInputNonZeros, calc_iter);
         }
+
+        // Output vector is released so the next algorithm reuses it
+        arenaRelease(&arena, output_vector_csr);
+        arenaRelease(&arena, csr_time);
     }
-    if (alg_mode & ALG_TJDS)
+    if (alg_mode & (ALG_TJDS | ALG_ALL))
     {
         // DO TJDS
-        struct _time_data_ *tjds_time = newResultsData(tjds_time, calc_iter);
-        double *output_vector_tjds = smvp_tjds_compute(mmImportData, fInputRows, fInputCols, fInputNonZeros, calc_iter, tjds_time);
-        generateReportText(inputFileName, reportPath, ALG_TJDS, fInputNonZeros, fInputRows, calc_iter, output_vector_tjds, tjds_time);
+        struct _time_data_ *tjds_time = newResultsData(&arena, calc_iter);
+        tjds_time->load_ms = loadMs;
+        double *output_vector_tjds = smvp_tjds_compute(&arena, matrix, calc_iter, prefetch, tjds_time, &stable);
+        generateReportText(inputFileName, reportPath, ALG_TJDS, fInputNonZeros, fInputRows, calc_iter, output_vector_tjds, tjds_time, outputFormat);
+        generateReportRecord(inputFileName, reportPath, ALG_TJDS, fInputRows, fInputCols, fInputNonZeros, matrix, calc_iter, tjds_time, compare);
+
+        arenaRelease(&arena, output_vector_tjds);
+        arenaRelease(&arena, tjds_time);
     }
-    if (alg_mode & ALG_CISR)
+    if (alg_mode & (ALG_ACSR | ALG_ALL))
+    {
+        // DO ACSR
+        struct _time_data_ *acsr_time = newResultsData(&arena, calc_iter);
+        acsr_time->load_ms = loadMs;
+        double *output_vector_acsr = smvp_acsr_compute(&arena, matrix, pool, calc_iter, acsr_time, &stable);
+        generateReportText(inputFileName, reportPath, ALG_ACSR, fInputNonZeros, fInputRows, calc_iter, output_vector_acsr, acsr_time, outputFormat);
+        generateReportRecord(inputFileName, reportPath, ALG_ACSR, fInputRows, fInputCols, fInputNonZeros, matrix, calc_iter, acsr_time, compare);
+
+        arenaRelease(&arena, output_vector_acsr);
+        arenaRelease(&arena, acsr_time);
+    }
+    if (alg_mode & (ALG_TILED | ALG_ALL))
+    {
+        // DO COLUMN-TILED CSR
+        struct _time_data_ *tiled_time = newResultsData(&arena, calc_iter);
+        tiled_time->load_ms = loadMs;
+        double *output_vector_tiled = smvp_tiled_compute(&arena, matrix, pool, calc_iter, tiled_time, &stable);
+        generateReportText(inputFileName, reportPath, ALG_TILED, fInputNonZeros, fInputRows, calc_iter, output_vector_tiled, tiled_time, outputFormat);
+        generateReportRecord(inputFileName, reportPath, ALG_TILED, fInputRows, fInputCols, fInputNonZeros, matrix, calc_iter, tiled_time, compare);
+
+        arenaRelease(&arena, output_vector_tiled);
+        arenaRelease(&arena, tiled_time);
+    }
+    if (alg_mode & ALG_CSRT)
+    {
+        // DO TRANSPOSE CSR (not part of --all-algs, it computes A^T*x rather than A*x)
+        struct _time_data_ *csrt_time = newResultsData(&arena, calc_iter);
+        csrt_time->load_ms = loadMs;
+        double *output_vector_csrt = smvp_csrt_compute(&arena, matrix, pool, calc_iter, csrt_time, &stable);
+        generateReportText(inputFileName, reportPath, ALG_CSRT, fInputNonZeros, fInputCols, calc_iter, output_vector_csrt, csrt_time, outputFormat);
+        generateReportRecord(inputFileName, reportPath, ALG_CSRT, fInputRows, fInputCols, fInputNonZeros, matrix, calc_iter, csrt_time, compare);
+
+        arenaRelease(&arena, output_vector_csrt);
+        arenaRelease(&arena, csrt_time);
+    }
+    if (alg_mode & (ALG_CISR | ALG_ALL))
     {
         // DO CISR COE
-        smvp_cisr_coegen(mmImportData, fInputRows, fInputNonZeros, cisr_slots); //, const char *inputFileName, char *reportPath)
+        smvp_cisr_coegen(&arena, matrix, cisr_slots); //, const char *inputFileName, char *reportPath)
     }
 
+    smvp_get_info(matrix, &matrixInfo);
+    printf(ANSI_COLOR_CYAN "[DATA]\tMatrix handle peak usage: " ANSI_COLOR_RESET "%.2f MiB\n", (double)matrixInfo.bytes_peak / (1024 * 1024));
+    arenaReport(&arena);
+    smvp_destroy(matrix);
+    smvp_pool_destroy(pool);
+    arenaDestroy(&arena);
+    free(generateName);
+    status = compareFinish(compare);
+
     printf(ANSI_COLOR_GREEN "[STOP]\tExit smvp-toolbox v%d.%d.%d\n\n" ANSI_COLOR_RESET, MAJOR_VER, MINOR_VER, REVISION_VER);
 
-    return 0;
+    return status;
 }
@@ -0,0 +1,542 @@
+/*
+*  ==================================================================
+*  matrix-generate.c for smvp-toolbox
+*  Builds synthetic matrices straight into CSR on worker threads:
+*  R-MAT power-law graphs, banded, 2D/3D Poisson stencils and
+*  uniform random matrices, from a textual spec
+*  ==================================================================
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "mmio/mmio.h"
+#include "libsmvp/smvp.h"
+#include "smvp-cli.h"
+
+// Rows handed to a thread at a time, threads take every nthreads-th block so skewed
+// (R-MAT) row lengths even out without any coordination
+#define GENERATE_BLOCK_ROWS 1024
+
+#define GEN_RMAT 0
+#define GEN_BANDED 1
+#define GEN_POISSON2D 2
+#define GEN_POISSON3D 3
+#define GEN_RANDOM 4
+
+// Struct: _gen_spec_
+// A parsed --generate spec
+typedef struct _gen_spec_
+{
+    int kind;       // GEN_*
+    int rows;
+    int cols;
+    int n;          // Grid side (Poisson) or matrix order (banded)
+    int scale;      // R-MAT: rows = cols = 2^scale
+    int width;      // Banded: non-zeros on each side of the diagonal
+    double perRow;  // R-MAT: average non-zeros per row, random: non-zeros in every row
+    double a, b, c; // R-MAT quadrant probabilities (d = 1 - a - b - c)
+    uint64_t seed;
+} GenSpec;
+
+// Struct: _gen_worker_
+// One generator thread and the pass it runs (count the rows, or fill them)
+typedef struct _gen_worker_
+{
+    const GenSpec *spec;
+    int index;
+    int nthreads;
+    int fill;        // 0: store row lengths in rowPtr[row + 1], 1: write columns and values
+    int64_t *rowPtr;
+    int *colInd;
+    double *val;
+    int *scratch;    // Candidate columns of the current row (R-MAT, random)
+    int scratchLen;
+    int failed;
+} GenWorker;
+
+// Function: splitmix64
+// Advances a splitmix64 state and returns the next 64 random bits
+static uint64_t splitmix64(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Function: uniform
+// Returns a double in (0, 1]
+static double uniform(uint64_t *state)
+{
+    return ((splitmix64(state) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+// Function: rowState
+// Every row draws from its own stream, so the matrix depends on the seed only and not on the thread count
+static uint64_t rowState(const GenSpec *spec, int row)
+{
+    uint64_t state = spec->seed ^ ((uint64_t)row * 0xd1b54a32d192ed03ULL);
+
+    splitmix64(&state);
+    return state;
+}
+
+// Function: poisson
+// Poisson variate: multiplication method for small means, rounded normal approximation above 64
+static long poisson(uint64_t *state, double mean)
+{
+    double limit, product, gauss;
+    long count;
+
+    if (mean <= 0)
+    {
+        return 0;
+    }
+    if (mean > 64)
+    {
+        gauss = sqrt(-2 * log(uniform(state))) * cos(2 * M_PI * uniform(state));
+        count = lround(mean + sqrt(mean) * gauss);
+        return (count > 0) ? count : 0;
+    }
+    limit = exp(-mean);
+    product = uniform(state);
+    for (count = 0; product > limit; count++)
+    {
+        product *= uniform(state);
+    }
+    return count;
+}
+
+// Function: compareInt
+// qsort() comparison for ascending ints
+static int compareInt(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+
+    return (x > y) - (x < y);
+}
+
+// Function: sampleRow
+// R-MAT and random rows: draws the row's candidate columns into the worker's scratch buffer,
+// then sorts them and drops duplicates. Returns the row length, or -1 when out of memory
+static int sampleRow(GenWorker *worker, int row, uint64_t *state)
+{
+    const GenSpec *spec = worker->spec;
+    double top, pRight;
+    long count, index;
+    int level, bit, col, len, *grown;
+
+    if (spec->kind == GEN_RMAT)
+    {
+        // Probability mass of this row: (a + b) for every 0 bit of the row index, (c + d) for every 1 bit
+        top = spec->a + spec->b;
+        pRight = (double)spec->perRow * spec->rows;
+        for (level = spec->scale - 1; level >= 0; level--)
+        {
+            pRight *= ((row >> level) & 1) ? (1 - top) : top;
+        }
+        count = poisson(state, pRight);
+    }
+    else
+    {
+        count = (long)spec->perRow;
+    }
+    count = (count < spec->cols) ? count : spec->cols;
+
+    if (count > worker->scratchLen)
+    {
+        if ((grown = (int *)realloc(worker->scratch, sizeof(int) * (long unsigned int)count)) == NULL)
+        {
+            return -1;
+        }
+        worker->scratch = grown;
+        worker->scratchLen = (int)count;
+    }
+
+    for (index = 0; index < count; index++)
+    {
+        if (spec->kind == GEN_RMAT)
+        {
+            // Given the row's quadrant at each level, the column half is right with probability b/(a+b) or d/(c+d)
+            col = 0;
+            for (level = spec->scale - 1; level >= 0; level--)
+            {
+                bit = ((row >> level) & 1);
+                pRight = bit ? (1 - spec->a - spec->b - spec->c) / (1 - spec->a - spec->b) : spec->b / (spec->a + spec->b);
+                col |= (uniform(state) <= pRight) << level;
+            }
+        }
+        else
+        {
+            col = (int)(splitmix64(state) % (uint64_t)spec->cols);
+        }
+        worker->scratch[index] = col;
+    }
+
+    qsort(worker->scratch, (size_t)count, sizeof(int), compareInt);
+    for (index = 0, len = 0; index < count; index++)
+    {
+        if (len == 0 || worker->scratch[index] != worker->scratch[len - 1])
+        {
+            worker->scratch[len++] = worker->scratch[index];
+        }
+    }
+    return len;
+}
+
+// Function: stencilRow
+// Poisson rows: the 5-point (2D) or 7-point (3D) Laplacian over an n^2 or n^3 grid, in column order
+// Returns the row length and writes the entries when col is not NULL
+static int stencilRow(const GenSpec *spec, int row, int *col, double *val)
+{
+    long n = spec->n, plane = n * n, offsets[7];
+    int x, y, z, len = 0, index, dims = (spec->kind == GEN_POISSON3D) ? 3 : 2;
+    int valid[7];
+
+    x = (int)(row % n);
+    y = (int)((row / n) % n);
+    z = (dims == 3) ? (int)(row / plane) : 0;
+
+    // Neighbours in ascending column order: -z, -y, -x, self, +x, +y, +z
+    offsets[0] = -plane, valid[0] = (dims == 3 && z > 0);
+    offsets[1] = -n, valid[1] = (y > 0);
+    offsets[2] = -1, valid[2] = (x > 0);
+    offsets[3] = 0, valid[3] = 1;
+    offsets[4] = 1, valid[4] = (x < n - 1);
+    offsets[5] = n, valid[5] = (y < n - 1);
+    offsets[6] = plane, valid[6] = (dims == 3 && z < n - 1);
+
+    for (index = 0; index < 7; index++)
+    {
+        if (!valid[index])
+        {
+            continue;
+        }
+        if (col != NULL)
+        {
+            col[len] = (int)(row + offsets[index]);
+            val[len] = (index == 3) ? 2.0 * dims : -1.0;
+        }
+        len++;
+    }
+    return len;
+}
+
+// Function: generateRows
+// Thread body: counts or fills every nthreads-th block of GENERATE_BLOCK_ROWS rows
+// Block bounds and band edges are 64-bit, near INT_MAX rows the next block start or row + width would overflow int
+static void *generateRows(void *arg)
+{
+    GenWorker *worker = (GenWorker *)arg;
+    const GenSpec *spec = worker->spec;
+    uint64_t state;
+    int64_t block, last, first;
+    int row, len, index;
+
+    for (block = (int64_t)worker->index * GENERATE_BLOCK_ROWS; block < spec->rows; block += (int64_t)worker->nthreads * GENERATE_BLOCK_ROWS)
+    {
+        last = (block + GENERATE_BLOCK_ROWS < spec->rows) ? block + GENERATE_BLOCK_ROWS : spec->rows;
+        for (row = (int)block; row < last; row++)
+        {
+            if (spec->kind == GEN_POISSON2D || spec->kind == GEN_POISSON3D)
+            {
+                len = stencilRow(spec, row, worker->fill ? worker->colInd + worker->rowPtr[row] : NULL, worker->fill ? worker->val + worker->rowPtr[row] : NULL);
+            }
+            else if (spec->kind == GEN_BANDED)
+            {
+                first = ((int64_t)row - spec->width > 0) ? (int64_t)row - spec->width : 0;
+                len = (int)((((int64_t)row + spec->width < spec->cols) ? (int64_t)row + spec->width + 1 : spec->cols) - first);
+                if (worker->fill)
+                {
+                    state = rowState(spec, row);
+                    for (index = 0; index < len; index++)
+                    {
+                        worker->colInd[worker->rowPtr[row] + index] = (int)(first + index);
+                        worker->val[worker->rowPtr[row] + index] = uniform(&state);
+                    }
+                }
+            }
+            else
+            {
+                // Both passes replay the same draws, the fill pass then takes the values from the same stream
+                state = rowState(spec, row);
+                if ((len = sampleRow(worker, row, &state)) < 0)
+                {
+                    worker->failed = 1;
+                    return NULL;
+                }
+                if (worker->fill)
+                {
+                    memcpy(worker->colInd + worker->rowPtr[row], worker->scratch, sizeof(int) * (long unsigned int)len);
+                    for (index = 0; index < len; index++)
+                    {
+                        worker->val[worker->rowPtr[row] + index] = uniform(&state);
+                    }
+                }
+            }
+            if (!worker->fill)
+            {
+                worker->rowPtr[row + 1] = len;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Function: generatePass
+// Runs one pass over all rows on nthreads threads (the calling thread is worker 0)
+static int generatePass(GenWorker *workers, int nthreads, int fill, int64_t *rowPtr, int *colInd, double *val)
+{
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * (long unsigned int)nthreads);
+    int index, started, failed = 0;
+
+    for (index = 0; index < nthreads; index++)
+    {
+        workers[index].fill = fill;
+        workers[index].rowPtr = rowPtr;
+        workers[index].colInd = colInd;
+        workers[index].val = val;
+    }
+    for (started = 1; started < nthreads; started++)
+    {
+        if (pthread_create(&threads[started], NULL, generateRows, &workers[started]) != 0)
+        {
+            break;
+        }
+    }
+    // Blocks of threads that could not be started are picked up here
+    for (index = started; index < nthreads; index++)
+    {
+        generateRows(&workers[index]);
+    }
+    generateRows(&workers[0]);
+    for (index = 1; index < started; index++)
+    {
+        pthread_join(threads[index], NULL);
+    }
+    for (index = 0; index < nthreads; index++)
+    {
+        failed |= workers[index].failed;
+    }
+    free(threads);
+    return failed ? -1 : 0;
+}
+
+// Function: parseSpec
+// Parses "kind:key=value,..." into spec, returns nonzero with a message in error
+static int parseSpec(const char *text, GenSpec *spec, char *error, size_t errorLen)
+{
+    char *copy = strdup(text), *params, *key, *value, *save = NULL, *end;
+    double number;
+    int result = -1;
+
+    memset(spec, 0, sizeof(*spec));
+    spec->perRow = 16;
+    spec->width = 2;
+    spec->a = 0.57;
+    spec->b = 0.19;
+    spec->c = 0.19;
+    spec->seed = 1;
+    spec->scale = -1;
+    spec->n = -1;
+    spec->rows = -1;
+    spec->cols = -1;
+
+    if ((params = strchr(copy, ':')) != NULL)
+    {
+        *params++ = '\0';
+    }
+    else
+    {
+        params = copy + strlen(copy);
+    }
+    if (strcmp(copy, "rmat") == 0)
+    {
+        spec->kind = GEN_RMAT;
+    }
+    else if (strcmp(copy, "banded") == 0)
+    {
+        spec->kind = GEN_BANDED;
+    }
+    else if (strcmp(copy, "poisson2d") == 0)
+    {
+        spec->kind = GEN_POISSON2D;
+    }
+    else if (strcmp(copy, "poisson3d") == 0)
+    {
+        spec->kind = GEN_POISSON3D;
+    }
+    else if (strcmp(copy, "random") == 0)
+    {
+        spec->kind = GEN_RANDOM;
+    }
+    else
+    {
+        snprintf(error, errorLen, "unknown generator '%s' (use rmat, banded, poisson2d, poisson3d or random)", copy);
+        goto done;
+    }
+
+    for (key = strtok_r(params, ",", &save); key != NULL; key = strtok_r(NULL, ",", &save))
+    {
+        if ((value = strchr(key, '=')) == NULL)
+        {
+            snprintf(error, errorLen, "parameter '%s' has no value", key);
+            goto done;
+        }
+        *value++ = '\0';
+        number = strtod(value, &end);
+        if (end == value || *end != '\0' || number < 0)
+        {
+            snprintf(error, errorLen, "parameter %s has an invalid value '%s'", key, value);
+            goto done;
+        }
+        if (strcmp(key, "scale") == 0 && number <= 30)
+        {
+            spec->scale = (int)number;
+        }
+        else if (strcmp(key, "n") == 0 && number <= INT_MAX)
+        {
+            spec->n = (int)number;
+        }
+        else if (strcmp(key, "rows") == 0 && number <= INT_MAX)
+        {
+            spec->rows = (int)number;
+        }
+        else if (strcmp(key, "cols") == 0 && number <= INT_MAX)
+        {
+            spec->cols = (int)number;
+        }
+        else if (strcmp(key, "width") == 0 && number <= INT_MAX)
+        {
+            spec->width = (int)number;
+        }
+        else if (strcmp(key, "nnz") == 0 || strcmp(key, "edges") == 0)
+        {
+            spec->perRow = number;
+        }
+        else if (strcmp(key, "a") == 0 || strcmp(key, "b") == 0 || strcmp(key, "c") == 0)
+        {
+            *((key[0] == 'a') ? &spec->a : (key[0] == 'b') ? &spec->b : &spec->c) = number;
+        }
+        else if (strcmp(key, "seed") == 0)
+        {
+            spec->seed = (uint64_t)strtoull(value, NULL, 10);
+        }
+        else
+        {
+            snprintf(error, errorLen, "unknown or out of range parameter %s=%s", key, value);
+            goto done;
+        }
+    }
+
+    // Shape of each kind, everything is square except random
+    switch (spec->kind)
+    {
+    case GEN_RMAT:
+        if (spec->scale < 1 || spec->a <= 0 || spec->b <= 0 || spec->c <= 0 || spec->a + spec->b + spec->c >= 1)
+        {
+            snprintf(error, errorLen, "rmat needs scale=1..30 and a, b, c > 0 with a + b + c < 1");
+            goto done;
+        }
+        spec->rows = spec->cols = 1 << spec->scale;
+        break;
+    case GEN_BANDED:
+        spec->rows = spec->cols = spec->n;
+        break;
+    case GEN_POISSON2D:
+        spec->rows = spec->cols = (spec->n >= 1 && (long)spec->n * spec->n <= INT_MAX) ? spec->n * spec->n : -1;
+        break;
+    case GEN_POISSON3D:
+        spec->rows = spec->cols = (spec->n >= 1 && (double)spec->n * spec->n * spec->n <= INT_MAX) ? spec->n * spec->n * spec->n : -1;
+        break;
+    default:
+        spec->cols = (spec->cols < 0) ? spec->rows : spec->cols;
+        break;
+    }
+    if (spec->rows < 1 || spec->cols < 1)
+    {
+        snprintf(error, errorLen, "%s", (spec->kind == GEN_RANDOM) ? "random needs rows=" : "banded and poisson need n= (and at most 2^31 - 1 rows)");
+        goto done;
+    }
+    result = 0;
+
+done:
+    free(copy);
+    return result;
+}
+
+// Function: smvpGenerateMatrix
+// Builds the matrix described by spec (see README) on up to threads threads: a first pass counts
+// every row, a second writes the rows straight into the handle's CSR arrays. Rows are drawn from
+// per-row random streams, so the same seed gives the same matrix for any thread count
+smvp_matrix_t *smvpGenerateMatrix(const char *spec, int threads, const smvp_options_t *opts, char *error, size_t errorLen)
+{
+    GenSpec gen;
+    GenWorker *workers;
+    smvp_matrix_t *matrix = NULL;
+    int64_t *rowPtr = NULL;
+    int *colInd, index, status;
+    double *val;
+    int64_t nnz = 0;
+
+    if (parseSpec(spec, &gen, error, errorLen) != 0)
+    {
+        return NULL;
+    }
+    threads = (threads < 1) ? 1 : threads;
+    workers = (GenWorker *)calloc((size_t)threads, sizeof(GenWorker));
+    rowPtr = (int64_t *)malloc(sizeof(int64_t) * ((long unsigned int)gen.rows + 1));
+    if (workers == NULL || rowPtr == NULL)
+    {
+        snprintf(error, errorLen, "out of memory for %d row pointers", gen.rows);
+        goto done;
+    }
+    for (index = 0; index < threads; index++)
+    {
+        workers[index].spec = &gen;
+        workers[index].index = index;
+        workers[index].nthreads = threads;
+    }
+
+    // 1. Row lengths, then row pointers (64-bit, the library narrows them when the total allows)
+    if (generatePass(workers, threads, 0, rowPtr, NULL, NULL) != 0)
+    {
+        snprintf(error, errorLen, "out of memory sampling rows");
+        goto done;
+    }
+    rowPtr[0] = 0;
+    for (index = 0; index < gen.rows; index++)
+    {
+        nnz += rowPtr[index + 1];
+        rowPtr[index + 1] = nnz;
+    }
+
+    // 2. Columns and values, written in place
+    if ((status = smvp_create_csr_fill(&matrix, gen.rows, gen.cols, rowPtr, &colInd, &val, opts)) != SMVP_SUCCESS)
+    {
+        snprintf(error, errorLen, "%s", smvp_strerror(status));
+        goto done;
+    }
+    if (generatePass(workers, threads, 1, rowPtr, colInd, val) != 0)
+    {
+        snprintf(error, errorLen, "out of memory sampling rows");
+        smvp_destroy(matrix);
+        matrix = NULL;
+    }
+
+done:
+    for (index = 0; workers != NULL && index < threads; index++)
+    {
+        free(workers[index].scratch);
+    }
+    free(workers);
+    free(rowPtr);
+    return matrix;
+}
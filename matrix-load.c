@@ -0,0 +1,140 @@
+/*
+*  ==================================================================
+*  matrix-load.c for smvp-toolbox
+*  Non-fatal Matrix Market loading shared by server and batch modes
+*  ==================================================================
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "mmio/mmio.h"
+#include "libsmvp/smvp.h"
+#include "smvp-cli.h"
+
+// Function: mallocStreamAlloc
+// StreamAlloc adapter for plain malloc()
+static void *mallocStreamAlloc(void *ctx, size_t len)
+{
+    (void)ctx;
+    return malloc(len);
+}
+
+// Function: smvpEntryErrorText
+// Describes a status from the mmio entry readers, worded to follow "entry N of M"
+const char *smvpEntryErrorText(int retcode)
+{
+    switch (retcode)
+    {
+    case MM_PREMATURE_EOF:
+        return "missing, file ends early";
+    case MM_MALFORMED_ENTRY:
+        return "malformed, a field is missing or not a number";
+    case MM_INDEX_OUT_OF_RANGE:
+        return "out of range for the matrix dimensions";
+    case MM_LINE_TOO_LONG:
+        return "on a line that is too long";
+    case MM_OUT_OF_MEMORY:
+        return "could not be sorted, out of memory";
+    case MM_TOO_LARGE:
+        return "beyond the size this reader supports";
+    default:
+        return "could not be read";
+    }
+}
+
+// Function: smvpLoadMatrixFile
+// Reads a Matrix Market coordinate file into a new handle. Unlike the one-shot CLI path this
+// never exits: every failure is returned with a message so servers and batches keep running.
+// opts (NULL = library defaults) are handed to the new handle.
+smvp_matrix_t *smvpLoadMatrixFile(const char *path, const smvp_options_t *opts, char *error, size_t errorLen)
+{
+    FILE *mmInputFile;
+    MM_typecode matcode;
+    int rows, cols, status;
+    int64_t nnz, badEntry;
+    int64_t *csrRowPtr = NULL;
+    int *csrCol = NULL;
+    double *csrVal = NULL;
+    smvp_matrix_t *matrix = NULL;
+
+    StreamCoo streamCoo;
+    int compression;
+
+    // "generate:<spec>" builds a synthetic matrix instead of reading a file
+    if (strncmp(path, SMVP_GENERATE_PREFIX, strlen(SMVP_GENERATE_PREFIX)) == 0)
+    {
+        return smvpGenerateMatrix(path + strlen(SMVP_GENERATE_PREFIX), smvpDefaultParseThreads(), opts, error, errorLen);
+    }
+    compression = smvpDetectCompression(path);
+
+    // gzip and zstd files are decompressed and parsed in memory by the streaming pipeline
+    if (compression != SMVP_COMPRESS_NONE)
+    {
+        if (smvpStreamMatrix(path, compression, smvpDefaultParseThreads(), mallocStreamAlloc, NULL, &streamCoo, error, errorLen) == 0 &&
+            (status = smvp_create_coo(&matrix, streamCoo.rows, streamCoo.cols, streamCoo.nnz, streamCoo.row, streamCoo.col, streamCoo.val, opts)) != SMVP_SUCCESS)
+        {
+            snprintf(error, errorLen, "%s", smvp_strerror(status));
+            matrix = NULL;
+        }
+        free(streamCoo.row);
+        free(streamCoo.col);
+        free(streamCoo.val);
+        return matrix;
+    }
+
+    if ((mmInputFile = fopen(path, "r")) == NULL)
+    {
+        snprintf(error, errorLen, "cannot open %s: %s", path, strerror(errno));
+        return NULL;
+    }
+    if (mm_read_banner(mmInputFile, &matcode) != 0 || mm_is_sparse(matcode) == 0)
+    {
+        snprintf(error, errorLen, "not a sparse Matrix Market file");
+        fclose(mmInputFile);
+        return NULL;
+    }
+    if ((status = mm_read_mtx_crd_size64(mmInputFile, &rows, &cols, &nnz)) != 0)
+    {
+        snprintf(error, errorLen, (status == MM_TOO_LARGE) ? "more than INT_MAX rows or columns" : "size line missing or malformed");
+        fclose(mmInputFile);
+        return NULL;
+    }
+
+    // Entries are parsed straight into CSR, no COO staging copy; the library narrows the row pointers
+    // to 32 bits when the non-zeros allow it
+    csrRowPtr = (int64_t *)malloc(sizeof(int64_t) * ((long unsigned int)rows + 1));
+    csrCol = (int *)malloc(sizeof(int) * (long unsigned int)nnz);
+    csrVal = (double *)malloc(sizeof(double) * (long unsigned int)nnz);
+    if (csrRowPtr == NULL || (nnz > 0 && (csrCol == NULL || csrVal == NULL)))
+    {
+        snprintf(error, errorLen, "out of memory staging %lld entries", (long long)nnz);
+        goto done;
+    }
+    if ((status = mm_read_mtx_crd_csr64(mmInputFile, rows, cols, nnz, csrRowPtr, csrCol, csrVal, matcode, &badEntry)) != 0)
+    {
+        if (status == MM_UNSUPPORTED_TYPE)
+        {
+            snprintf(error, errorLen, "complex matrices are not supported");
+        }
+        else
+        {
+            snprintf(error, errorLen, "entry %lld of %lld %s", (long long)badEntry, (long long)nnz, smvpEntryErrorText(status));
+        }
+        goto done;
+    }
+
+    if ((status = smvp_create_csr64(&matrix, rows, cols, csrRowPtr, csrCol, csrVal, opts)) != SMVP_SUCCESS)
+    {
+        snprintf(error, errorLen, "%s", smvp_strerror(status));
+        matrix = NULL;
+    }
+
+done:
+    free(csrRowPtr);
+    free(csrCol);
+    free(csrVal);
+    fclose(mmInputFile);
+    return matrix;
+}
@@ -0,0 +1,257 @@
+/*
+*  ==================================================================
+*  matrix-panels.c for smvp-toolbox
+*  Converts a Matrix Market file into an out-of-core CSR panel file
+*  ==================================================================
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "mmio/mmio.h"
+#include "libsmvp/smvp.h"
+#include "smvp-cli.h"
+
+// Panels distributed per pass over the input file, each holds an open temporary file
+#define PANEL_BUILD_FANOUT 64
+
+// Struct: _panel_record_
+// One entry parked in a panel's temporary bucket file
+typedef struct _panel_record_
+{
+    int row; // Local to the panel
+    int col;
+    double val;
+} PanelRecord;
+
+// Function: readPanelEntry
+// Reads the next coordinate entry as 0-based indices, returns nonzero if it is malformed or out of range
+static int readPanelEntry(FILE *mmInputFile, MM_typecode matcode, int rows, int cols, int *row, int *col, double *val)
+{
+    int fields;
+
+    if (mm_is_pattern(matcode) != 0)
+    {
+        fields = fscanf(mmInputFile, "%d %d\n", row, col);
+        *val = 1;
+        fields = (fields == 2) ? 3 : fields;
+    }
+    else
+    {
+        fields = fscanf(mmInputFile, "%d %d %lg\n", row, col, val);
+    }
+    (*row)--;
+    (*col)--;
+
+    return (fields != 3 || *row < 0 || *row >= rows || *col < 0 || *col >= cols);
+}
+
+// Function: findPanel
+// Binary search for the panel holding a row, firstRow has npanels + 1 entries
+static int findPanel(const int *firstRow, int npanels, int row)
+{
+    int low = 0, high = npanels - 1, mid;
+
+    while (low < high)
+    {
+        mid = (low + high + 1) / 2;
+        if (firstRow[mid] <= row)
+        {
+            low = mid;
+        }
+        else
+        {
+            high = mid - 1;
+        }
+    }
+    return low;
+}
+
+// Function: buildPanel
+// Sorts one panel's bucket into CSR (the same ordering smvp_create_coo() gives in core) and writes it
+static int buildPanel(smvp_panel_writer_t *writer, int panel, int cols, FILE *bucket, char *error, size_t errorLen)
+{
+    PanelRecord record;
+    smvp_matrix_t *block = NULL;
+    const int *rowPtr, *colInd;
+    const double *blockVal;
+    int *row, *col, first, nrows, status, result = -1;
+    double *val;
+    long nnz, index;
+
+    smvp_panels_span(writer, panel, &first, &nrows, &nnz);
+    row = (int *)malloc(sizeof(int) * (long unsigned int)(nnz + 1));
+    col = (int *)malloc(sizeof(int) * (long unsigned int)(nnz + 1));
+    val = (double *)malloc(sizeof(double) * (long unsigned int)(nnz + 1));
+    if (row == NULL || col == NULL || val == NULL)
+    {
+        snprintf(error, errorLen, "out of memory building panel %d (%ld entries)", panel, nnz);
+        goto done;
+    }
+
+    rewind(bucket);
+    for (index = 0; index < nnz; index++)
+    {
+        if (fread(&record, sizeof(record), 1, bucket) != 1)
+        {
+            snprintf(error, errorLen, "temporary bucket for panel %d truncated", panel);
+            goto done;
+        }
+        row[index] = record.row;
+        col[index] = record.col;
+        val[index] = record.val;
+    }
+
+    if ((status = smvp_create_coo(&block, nrows, cols, (int)nnz, row, col, val, NULL)) != SMVP_SUCCESS)
+    {
+        snprintf(error, errorLen, "panel %d: %s", panel, smvp_strerror(status));
+        goto done;
+    }
+    smvp_get_csr(block, &rowPtr, &colInd, &blockVal);
+    if ((status = smvp_panels_put(writer, panel, rowPtr, colInd, blockVal)) != SMVP_SUCCESS)
+    {
+        snprintf(error, errorLen, "writing panel %d: %s", panel, (status == SMVP_ERR_SYSTEM) ? strerror(errno) : smvp_strerror(status));
+        goto done;
+    }
+    result = 0;
+
+done:
+    smvp_destroy(block);
+    free(row);
+    free(col);
+    free(val);
+    return result;
+}
+
+// Function: smvpBuildPanelFile
+// Converts a Matrix Market file into a panel file without ever holding more than one panel:
+// a first pass counts the non-zeros of every row to plan the panels, later passes park each
+// group of PANEL_BUILD_FANOUT panels in temporary files that are then sorted one panel at a time
+int smvpBuildPanelFile(const char *mtxPath, const char *panelPath, size_t panelBytes, char *error, size_t errorLen)
+{
+    FILE *mmInputFile;
+    FILE *bucket[PANEL_BUILD_FANOUT];
+    MM_typecode matcode;
+    PanelRecord record;
+    smvp_panel_writer_t *writer = NULL;
+    long dataStart;
+    int rows, cols, nnz, index, panel, npanels, group, groupEnd, status, result = -1;
+    int *rowCount = NULL, *firstRow = NULL, nrows;
+    long panelNnz;
+
+    memset(bucket, 0, sizeof(bucket));
+    if ((mmInputFile = fopen(mtxPath, "r")) == NULL)
+    {
+        snprintf(error, errorLen, "cannot open %s: %s", mtxPath, strerror(errno));
+        return -1;
+    }
+    if (mm_read_banner(mmInputFile, &matcode) != 0 || mm_is_sparse(matcode) == 0)
+    {
+        snprintf(error, errorLen, "not a sparse Matrix Market file");
+        fclose(mmInputFile);
+        return -1;
+    }
+    if ((status = mm_read_mtx_crd_size(mmInputFile, &rows, &cols, &nnz)) != 0)
+    {
+        snprintf(error, errorLen, (status == MM_TOO_LARGE) ? "more than INT_MAX entries, beyond what panel conversion supports" : "size line missing or malformed");
+        fclose(mmInputFile);
+        return -1;
+    }
+    dataStart = ftell(mmInputFile);
+
+    // 1. Row lengths plan the panels
+    if ((rowCount = (int *)calloc((long unsigned int)rows + 1, sizeof(int))) == NULL)
+    {
+        snprintf(error, errorLen, "out of memory counting %d rows", rows);
+        goto done;
+    }
+    for (index = 0; index < nnz; index++)
+    {
+        if (readPanelEntry(mmInputFile, matcode, rows, cols, &record.row, &record.col, &record.val) != 0)
+        {
+            snprintf(error, errorLen, "entry %d of %d malformed or out of range", index + 1, nnz);
+            goto done;
+        }
+        rowCount[record.row]++;
+    }
+    if ((status = smvp_panels_begin(&writer, panelPath, rows, cols, rowCount, panelBytes)) != SMVP_SUCCESS)
+    {
+        snprintf(error, errorLen, "cannot create %s: %s", panelPath, (status == SMVP_ERR_SYSTEM) ? strerror(errno) : smvp_strerror(status));
+        goto done;
+    }
+    free(rowCount);
+    rowCount = NULL;
+
+    npanels = smvp_panels_count(writer);
+    if ((firstRow = (int *)malloc(sizeof(int) * ((long unsigned int)npanels + 1))) == NULL)
+    {
+        snprintf(error, errorLen, "out of memory planning %d panels", npanels);
+        goto done;
+    }
+    for (panel = 0; panel < npanels; panel++)
+    {
+        smvp_panels_span(writer, panel, &firstRow[panel], &nrows, &panelNnz);
+    }
+    firstRow[npanels] = rows;
+
+    // 2. One pass over the entries per group of panels, then sort and write each panel of the group
+    for (group = 0; group < npanels; group = groupEnd)
+    {
+        groupEnd = (group + PANEL_BUILD_FANOUT < npanels) ? group + PANEL_BUILD_FANOUT : npanels;
+        for (panel = group; panel < groupEnd; panel++)
+        {
+            if ((bucket[panel - group] = tmpfile()) == NULL)
+            {
+                snprintf(error, errorLen, "cannot create temporary file: %s", strerror(errno));
+                goto done;
+            }
+        }
+
+        fseek(mmInputFile, dataStart, SEEK_SET);
+        for (index = 0; index < nnz; index++)
+        {
+            readPanelEntry(mmInputFile, matcode, rows, cols, &record.row, &record.col, &record.val);
+            if (record.row < firstRow[group] || record.row >= firstRow[groupEnd])
+            {
+                continue;
+            }
+            panel = findPanel(firstRow, npanels, record.row);
+            record.row -= firstRow[panel];
+            if (fwrite(&record, sizeof(record), 1, bucket[panel - group]) != 1)
+            {
+                snprintf(error, errorLen, "writing temporary file: %s", strerror(errno));
+                goto done;
+            }
+        }
+
+        for (panel = group; panel < groupEnd; panel++)
+        {
+            if (buildPanel(writer, panel, cols, bucket[panel - group], error, errorLen) != 0)
+            {
+                goto done;
+            }
+            fclose(bucket[panel - group]);
+            bucket[panel - group] = NULL;
+        }
+    }
+    result = 0;
+
+done:
+    for (index = 0; index < PANEL_BUILD_FANOUT; index++)
+    {
+        if (bucket[index] != NULL)
+        {
+            fclose(bucket[index]);
+        }
+    }
+    if (writer != NULL && (status = smvp_panels_end(writer)) != SMVP_SUCCESS && result == 0)
+    {
+        snprintf(error, errorLen, "finishing %s: %s", panelPath, (status == SMVP_ERR_SYSTEM) ? strerror(errno) : smvp_strerror(status));
+        result = -1;
+    }
+    free(rowCount);
+    free(firstRow);
+    fclose(mmInputFile);
+    return result;
+}
@@ -0,0 +1,705 @@
+/*
+*  ==================================================================
+*  matrix-stream.c for smvp-toolbox
+*  Compressed Matrix Market input: one decompression thread feeding a
+*  ring of line-aligned buffers, several threads parsing them straight
+*  into the COO staging arrays
+*  ==================================================================
+*/
+
+// Required for memrchr()
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <zlib.h>
+#ifdef SMVP_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "mmio/mmio.h"
+#include "smvp-cli.h"
+
+#define STREAM_RING_SLOTS 8
+#define STREAM_CHUNK_BYTES (4 * 1024 * 1024)
+#define STREAM_INPUT_BYTES (256 * 1024)
+#define STREAM_MAX_PARSERS 64
+
+#define SLOT_FREE 0
+#define SLOT_READY 1
+#define SLOT_PARSING 2
+
+// Struct: _stream_decoder_
+// Produces the decompressed bytes of a gzip or zstd file in caller-sized pieces
+typedef struct _stream_decoder_
+{
+    FILE *file;
+    int compression;
+    unsigned char *in;
+    int eof;   // Every byte has been produced
+    int ended; // The last frame/member is complete (input may still hold another)
+    z_stream zs;
+    int zsInit;
+#ifdef SMVP_HAVE_ZSTD
+    ZSTD_DStream *zstd;
+    ZSTD_inBuffer zin;
+#endif
+    size_t bytesIn;
+    size_t bytesOut;
+} StreamDecoder;
+
+// Struct: _stream_slot_
+// One ring buffer, always holding whole lines
+typedef struct _stream_slot_
+{
+    char *data; // STREAM_CHUNK_BYTES + 1, NUL terminated
+    size_t len;
+    long firstEntry; // Entry number of the first non-blank line
+    long lines;      // Non-blank lines in data
+    int state;
+} StreamSlot;
+
+// Struct: _stream_pipeline_
+// Shared state of the decompression thread and the parser threads
+typedef struct _stream_pipeline_
+{
+    StreamDecoder decoder;
+    StreamSlot slot[STREAM_RING_SLOTS];
+    char *carry; // Partial line left over from the previous chunk
+    size_t carryLen;
+    int pattern;
+    StreamCoo *coo;
+    long entries; // Non-blank lines handed out so far
+    int done;     // Decompression finished, no more slots will become ready
+    int failed;
+    char error[160];
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} StreamPipeline;
+
+// Function: smvpDetectCompression
+// Identifies a gzip or zstd file by its magic bytes, anything else is treated as plain text
+int smvpDetectCompression(const char *path)
+{
+    unsigned char magic[4];
+    FILE *file;
+    size_t got;
+
+    if ((file = fopen(path, "rb")) == NULL)
+    {
+        return SMVP_COMPRESS_NONE;
+    }
+    got = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+
+    if (got >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+    {
+        return SMVP_COMPRESS_GZIP;
+    }
+    if (got == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+    {
+        return SMVP_COMPRESS_ZSTD;
+    }
+    return SMVP_COMPRESS_NONE;
+}
+
+// Function: smvpCompressionName
+// Printable name of a SMVP_COMPRESS_* value
+const char *smvpCompressionName(int compression)
+{
+    switch (compression)
+    {
+    case SMVP_COMPRESS_GZIP:
+        return "gzip";
+    case SMVP_COMPRESS_ZSTD:
+        return "zstd";
+    default:
+        return "none";
+    }
+}
+
+// Function: smvpDefaultParseThreads
+// One parser per online CPU, minus the one the decompression thread keeps busy
+int smvpDefaultParseThreads(void)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (cpus > 2) ? (int)cpus - 1 : 1;
+}
+
+// Function: decoderOpen
+// Opens the file and prepares the decompressor for its format
+static int decoderOpen(StreamDecoder *dec, const char *path, int compression, char *error, size_t errorLen)
+{
+    memset(dec, 0, sizeof(*dec));
+    dec->compression = compression;
+    if ((dec->file = fopen(path, "rb")) == NULL)
+    {
+        snprintf(error, errorLen, "cannot open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    if ((dec->in = (unsigned char *)malloc(STREAM_INPUT_BYTES)) == NULL)
+    {
+        snprintf(error, errorLen, "out of memory");
+        return -1;
+    }
+
+    if (compression == SMVP_COMPRESS_GZIP)
+    {
+        // 15 + 32: any window size, gzip or zlib header detected automatically
+        if (inflateInit2(&dec->zs, 15 + 32) != Z_OK)
+        {
+            snprintf(error, errorLen, "zlib initialization failed");
+            return -1;
+        }
+        dec->zsInit = 1;
+        return 0;
+    }
+#ifdef SMVP_HAVE_ZSTD
+    if (compression == SMVP_COMPRESS_ZSTD)
+    {
+        if ((dec->zstd = ZSTD_createDStream()) == NULL || ZSTD_isError(ZSTD_initDStream(dec->zstd)))
+        {
+            snprintf(error, errorLen, "zstd initialization failed");
+            return -1;
+        }
+        return 0;
+    }
+#endif
+    snprintf(error, errorLen, "%s input is not supported by this build", smvpCompressionName(compression));
+    return -1;
+}
+
+// Function: decoderClose
+// Releases the decompressor and closes the file
+static void decoderClose(StreamDecoder *dec)
+{
+    if (dec->zsInit)
+    {
+        inflateEnd(&dec->zs);
+    }
+#ifdef SMVP_HAVE_ZSTD
+    if (dec->zstd != NULL)
+    {
+        ZSTD_freeDStream(dec->zstd);
+    }
+#endif
+    if (dec->file != NULL)
+    {
+        fclose(dec->file);
+    }
+    free(dec->in);
+}
+
+// Function: decoderFill
+// Reads more compressed input, returns the byte count (0 at end of file, -1 on error)
+static long decoderFill(StreamDecoder *dec, char *error, size_t errorLen)
+{
+    size_t got = fread(dec->in, 1, STREAM_INPUT_BYTES, dec->file);
+
+    if (got == 0 && ferror(dec->file))
+    {
+        snprintf(error, errorLen, "read error: %s", strerror(errno));
+        return -1;
+    }
+    if (got == 0 && !dec->ended)
+    {
+        snprintf(error, errorLen, "compressed input is truncated");
+        return -1;
+    }
+    dec->bytesIn += got;
+    return (long)got;
+}
+
+// Function: decoderRead
+// Decompresses up to cap bytes into out, concatenated gzip members and zstd frames are read through
+// Returns the number of bytes produced, -1 on error; dec->eof is set once the input is exhausted
+static long decoderRead(StreamDecoder *dec, char *out, size_t cap, char *error, size_t errorLen)
+{
+    size_t produced = 0;
+    long got;
+    int ret;
+
+    if (dec->compression == SMVP_COMPRESS_GZIP)
+    {
+        dec->zs.next_out = (Bytef *)out;
+        dec->zs.avail_out = (uInt)cap;
+        while (dec->zs.avail_out > 0 && !dec->eof)
+        {
+            if (dec->zs.avail_in == 0)
+            {
+                if ((got = decoderFill(dec, error, errorLen)) < 0)
+                {
+                    return -1;
+                }
+                if (got == 0)
+                {
+                    dec->eof = 1;
+                    break;
+                }
+                dec->zs.next_in = dec->in;
+                dec->zs.avail_in = (uInt)got;
+            }
+            ret = inflate(&dec->zs, Z_NO_FLUSH);
+            if (ret == Z_STREAM_END)
+            {
+                dec->ended = 1;
+                inflateReset(&dec->zs);
+            }
+            else if (ret == Z_OK)
+            {
+                dec->ended = 0;
+            }
+            else
+            {
+                snprintf(error, errorLen, "gzip data is corrupt (%s)", (dec->zs.msg != NULL) ? dec->zs.msg : "inflate failed");
+                return -1;
+            }
+        }
+        produced = cap - dec->zs.avail_out;
+    }
+#ifdef SMVP_HAVE_ZSTD
+    else if (dec->compression == SMVP_COMPRESS_ZSTD)
+    {
+        ZSTD_outBuffer zout = {out, cap, 0};
+        size_t zret;
+
+        while (zout.pos < zout.size && !dec->eof)
+        {
+            if (dec->zin.pos == dec->zin.size)
+            {
+                if ((got = decoderFill(dec, error, errorLen)) < 0)
+                {
+                    return -1;
+                }
+                if (got == 0)
+                {
+                    dec->eof = 1;
+                    break;
+                }
+                dec->zin.src = dec->in;
+                dec->zin.size = (size_t)got;
+                dec->zin.pos = 0;
+            }
+            zret = ZSTD_decompressStream(dec->zstd, &zout, &dec->zin);
+            if (ZSTD_isError(zret))
+            {
+                snprintf(error, errorLen, "zstd data is corrupt (%s)", ZSTD_getErrorName(zret));
+                return -1;
+            }
+            dec->ended = (zret == 0);
+        }
+        produced = zout.pos;
+    }
+#endif
+
+    dec->bytesOut += produced;
+    return (long)produced;
+}
+
+// Function: lineIsBlank
+// True for lines holding nothing but spaces, tabs and carriage returns
+static int lineIsBlank(const char *line, const char *end)
+{
+    for (; line < end; line++)
+    {
+        if (*line != ' ' && *line != '\t' && *line != '\r')
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Function: countLines
+// Number of non-blank lines in [data, end), the slot bookkeeping and the parsers must agree on this
+static long countLines(const char *data, const char *end)
+{
+    const char *line = data, *newline;
+    long lines = 0;
+
+    while (line < end)
+    {
+        newline = (const char *)memchr(line, '\n', (size_t)(end - line));
+        if (newline == NULL)
+        {
+            newline = end;
+        }
+        lines += !lineIsBlank(line, newline);
+        line = newline + 1;
+    }
+    return lines;
+}
+
+// Function: pipelineFail
+// Records the first error and wakes every thread so they can leave
+static void pipelineFail(StreamPipeline *pipe, const char *message)
+{
+    pthread_mutex_lock(&pipe->lock);
+    if (!pipe->failed)
+    {
+        pipe->failed = 1;
+        snprintf(pipe->error, sizeof(pipe->error), "%s", message);
+    }
+    pthread_cond_broadcast(&pipe->changed);
+    pthread_mutex_unlock(&pipe->lock);
+}
+
+// Function: streamDecompress
+// Decompression thread: fills the ring in order, cutting every chunk after its last newline
+static void *streamDecompress(void *arg)
+{
+    StreamPipeline *pipe = (StreamPipeline *)arg;
+    StreamSlot *slot;
+    char error[160], *cut;
+    long got, sequence;
+    size_t len;
+
+    for (sequence = 0;; sequence++)
+    {
+        slot = &pipe->slot[sequence % STREAM_RING_SLOTS];
+        pthread_mutex_lock(&pipe->lock);
+        while (slot->state != SLOT_FREE && !pipe->failed)
+        {
+            pthread_cond_wait(&pipe->changed, &pipe->lock);
+        }
+        pthread_mutex_unlock(&pipe->lock);
+        if (pipe->failed)
+        {
+            break;
+        }
+
+        // Leftover partial line first, then as much new data as fits
+        memcpy(slot->data, pipe->carry, pipe->carryLen);
+        len = pipe->carryLen;
+        pipe->carryLen = 0;
+        while (len < STREAM_CHUNK_BYTES && !pipe->decoder.eof)
+        {
+            if ((got = decoderRead(&pipe->decoder, slot->data + len, STREAM_CHUNK_BYTES - len, error, sizeof(error))) < 0)
+            {
+                pipelineFail(pipe, error);
+                return NULL;
+            }
+            len += (size_t)got;
+        }
+        if (len == 0)
+        {
+            break;
+        }
+
+        // Keep the trailing partial line for the next chunk unless this is the end of the input
+        if (!pipe->decoder.eof)
+        {
+            if ((cut = (char *)memrchr(slot->data, '\n', len)) == NULL)
+            {
+                pipelineFail(pipe, "line longer than the decompression buffer");
+                return NULL;
+            }
+            pipe->carryLen = len - (size_t)(cut + 1 - slot->data);
+            memcpy(pipe->carry, cut + 1, pipe->carryLen);
+            len -= pipe->carryLen;
+        }
+        slot->data[len] = '\0';
+        slot->len = len;
+        slot->lines = countLines(slot->data, slot->data + len);
+
+        pthread_mutex_lock(&pipe->lock);
+        slot->firstEntry = pipe->entries;
+        pipe->entries += slot->lines;
+        slot->state = SLOT_READY;
+        pthread_cond_broadcast(&pipe->changed);
+        pthread_mutex_unlock(&pipe->lock);
+
+        if (pipe->decoder.eof && pipe->carryLen == 0)
+        {
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&pipe->lock);
+    pipe->done = 1;
+    pthread_cond_broadcast(&pipe->changed);
+    pthread_mutex_unlock(&pipe->lock);
+    return NULL;
+}
+
+// Function: parseSlot
+// Parses the lines of one chunk into their final positions of the COO arrays, returns nonzero on a bad line
+static int parseSlot(StreamPipeline *pipe, const StreamSlot *slot, char *error, size_t errorLen)
+{
+    StreamCoo *coo = pipe->coo;
+    const char *line = slot->data, *end = slot->data + slot->len, *newline, *field;
+    char *cursor;
+    long entry = slot->firstEntry, row, col;
+    double val;
+    int valid;
+
+    if (entry + slot->lines > coo->nnz)
+    {
+        snprintf(error, errorLen, "file holds more entries than the %d on its size line", coo->nnz);
+        return -1;
+    }
+
+    while (line < end)
+    {
+        newline = (const char *)memchr(line, '\n', (size_t)(end - line));
+        if (newline == NULL)
+        {
+            newline = end;
+        }
+        if (!lineIsBlank(line, newline))
+        {
+            // Each field must start before the end of the line, strtol() would happily skip past it
+            row = strtol(line, &cursor, 10);
+            valid = (cursor != line);
+            field = cursor;
+            col = strtol(field, &cursor, 10);
+            valid = valid && (cursor != field);
+            val = 1;
+            if (!pipe->pattern)
+            {
+                field = cursor;
+                val = strtod(field, &cursor);
+                valid = valid && (cursor != field);
+            }
+            if (!valid || cursor > newline || row < 1 || row > coo->rows || col < 1 || col > coo->cols)
+            {
+                snprintf(error, errorLen, "entry %ld of %d malformed or out of range", entry + 1, coo->nnz);
+                return -1;
+            }
+            coo->row[entry] = (int)row - 1;
+            coo->col[entry] = (int)col - 1;
+            coo->val[entry] = val;
+            entry++;
+        }
+        line = newline + 1;
+    }
+    return 0;
+}
+
+// Function: streamParse
+// Parser thread: takes ready chunks in any order, their entry numbers were fixed by the decompressor
+static void *streamParse(void *arg)
+{
+    StreamPipeline *pipe = (StreamPipeline *)arg;
+    StreamSlot *slot;
+    char error[160];
+    int index;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pipe->lock);
+        for (slot = NULL; slot == NULL && !pipe->failed;)
+        {
+            for (index = 0; index < STREAM_RING_SLOTS && slot == NULL; index++)
+            {
+                if (pipe->slot[index].state == SLOT_READY)
+                {
+                    slot = &pipe->slot[index];
+                }
+            }
+            if (slot == NULL && pipe->done)
+            {
+                break;
+            }
+            if (slot == NULL)
+            {
+                pthread_cond_wait(&pipe->changed, &pipe->lock);
+            }
+        }
+        if (slot == NULL || pipe->failed)
+        {
+            pthread_mutex_unlock(&pipe->lock);
+            return NULL;
+        }
+        slot->state = SLOT_PARSING;
+        pthread_mutex_unlock(&pipe->lock);
+
+        if (parseSlot(pipe, slot, error, sizeof(error)) != 0)
+        {
+            pipelineFail(pipe, error);
+            return NULL;
+        }
+
+        pthread_mutex_lock(&pipe->lock);
+        slot->state = SLOT_FREE;
+        pthread_cond_broadcast(&pipe->changed);
+        pthread_mutex_unlock(&pipe->lock);
+    }
+}
+
+// Function: readStreamHeader
+// Decompresses until the size line has been seen, hands banner through size line to mmio,
+// and leaves whatever followed it in the carry buffer for the decompression thread
+static int readStreamHeader(StreamPipeline *pipe, StreamCoo *coo, char *error, size_t errorLen)
+{
+    char *text = pipe->slot[0].data, *line, *newline;
+    size_t len = 0;
+    long got;
+    int sawBanner = 0, status;
+    FILE *header;
+
+    for (line = text;;)
+    {
+        // Look for a complete size line: the first one after the banner that is neither a comment nor blank
+        while ((newline = (char *)memchr(line, '\n', len - (size_t)(line - text))) != NULL)
+        {
+            if (!sawBanner)
+            {
+                sawBanner = 1;
+            }
+            else if (*line != '%' && !lineIsBlank(line, newline))
+            {
+                break;
+            }
+            line = newline + 1;
+        }
+        if (newline != NULL)
+        {
+            break;
+        }
+        if (pipe->decoder.eof || len == STREAM_CHUNK_BYTES)
+        {
+            snprintf(error, errorLen, "size line missing or malformed");
+            return -1;
+        }
+        if ((got = decoderRead(&pipe->decoder, text + len, STREAM_CHUNK_BYTES - len, error, errorLen)) < 0)
+        {
+            return -1;
+        }
+        len += (size_t)got;
+    }
+
+    if ((header = fmemopen(text, (size_t)(newline + 1 - text), "r")) == NULL)
+    {
+        snprintf(error, errorLen, "cannot parse header: %s", strerror(errno));
+        return -1;
+    }
+    if (mm_read_banner(header, &coo->matcode) != 0 || mm_is_sparse(coo->matcode) == 0)
+    {
+        snprintf(error, errorLen, "not a sparse Matrix Market file");
+        fclose(header);
+        return -1;
+    }
+    status = mm_read_mtx_crd_size(header, &coo->rows, &coo->cols, &coo->nnz);
+    fclose(header);
+    if (status != 0 || coo->rows < 0 || coo->cols < 0 || coo->nnz < 0)
+    {
+        // Compressed input is staged as COO with int counts, larger matrices have to be decompressed first
+        snprintf(error, errorLen, (status == MM_TOO_LARGE) ? "more than INT_MAX entries, decompress the file to load it" : "size line missing or malformed");
+        return -1;
+    }
+
+    pipe->carryLen = len - (size_t)(newline + 1 - text);
+    memcpy(pipe->carry, newline + 1, pipe->carryLen);
+    return 0;
+}
+
+// Function: smvpStreamMatrix
+// Loads a compressed Matrix Market file into COO arrays obtained from alloc, 0-based like every other load path.
+// Nothing is written to disk and only STREAM_RING_SLOTS chunks of decompressed text exist at any time
+int smvpStreamMatrix(const char *path, int compression, int parseThreads, StreamAlloc alloc, void *allocCtx, StreamCoo *coo, char *error, size_t errorLen)
+{
+    StreamPipeline *pipe;
+    pthread_t decompressor, parser[STREAM_MAX_PARSERS];
+    struct timespec start, end;
+    int index, started = 0, result = -1;
+
+    memset(coo, 0, sizeof(*coo));
+    coo->compression = compression;
+    if ((pipe = (StreamPipeline *)calloc(1, sizeof(*pipe))) == NULL)
+    {
+        snprintf(error, errorLen, "out of memory");
+        return -1;
+    }
+    pthread_mutex_init(&pipe->lock, NULL);
+    pthread_cond_init(&pipe->changed, NULL);
+    pipe->coo = coo;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (decoderOpen(&pipe->decoder, path, compression, error, errorLen) != 0)
+    {
+        goto done;
+    }
+    for (index = 0; index < STREAM_RING_SLOTS; index++)
+    {
+        if ((pipe->slot[index].data = (char *)malloc(STREAM_CHUNK_BYTES + 1)) == NULL)
+        {
+            snprintf(error, errorLen, "out of memory");
+            goto done;
+        }
+    }
+    if ((pipe->carry = (char *)malloc(STREAM_CHUNK_BYTES)) == NULL)
+    {
+        snprintf(error, errorLen, "out of memory");
+        goto done;
+    }
+
+    // The header decides the array sizes, so it is read before any thread starts
+    if (readStreamHeader(pipe, coo, error, errorLen) != 0)
+    {
+        goto done;
+    }
+    pipe->pattern = (mm_is_pattern(coo->matcode) != 0);
+    coo->row = (int *)alloc(allocCtx, sizeof(int) * (long unsigned int)coo->nnz);
+    coo->col = (int *)alloc(allocCtx, sizeof(int) * (long unsigned int)coo->nnz);
+    coo->val = (double *)alloc(allocCtx, sizeof(double) * (long unsigned int)coo->nnz);
+    if (coo->nnz > 0 && (coo->row == NULL || coo->col == NULL || coo->val == NULL))
+    {
+        snprintf(error, errorLen, "out of memory staging %d entries", coo->nnz);
+        goto done;
+    }
+
+    parseThreads = (parseThreads < 1) ? 1 : (parseThreads > STREAM_MAX_PARSERS) ? STREAM_MAX_PARSERS : parseThreads;
+    if (pthread_create(&decompressor, NULL, streamDecompress, pipe) != 0)
+    {
+        snprintf(error, errorLen, "cannot start decompression thread");
+        goto done;
+    }
+    for (started = 0; started < parseThreads; started++)
+    {
+        if (pthread_create(&parser[started], NULL, streamParse, pipe) != 0)
+        {
+            pipelineFail(pipe, "cannot start parser thread");
+            break;
+        }
+    }
+    pthread_join(decompressor, NULL);
+    for (index = 0; index < started; index++)
+    {
+        pthread_join(parser[index], NULL);
+    }
+
+    if (pipe->failed)
+    {
+        snprintf(error, errorLen, "%s", pipe->error);
+        goto done;
+    }
+    if (pipe->entries != coo->nnz)
+    {
+        snprintf(error, errorLen, "file holds %ld entries, its size line promises %d", pipe->entries, coo->nnz);
+        goto done;
+    }
+    result = 0;
+
+done:
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    coo->seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    coo->bytesIn = pipe->decoder.bytesIn;
+    coo->bytesOut = pipe->decoder.bytesOut;
+    coo->parseThreads = started;
+    decoderClose(&pipe->decoder);
+    for (index = 0; index < STREAM_RING_SLOTS; index++)
+    {
+        free(pipe->slot[index].data);
+    }
+    free(pipe->carry);
+    pthread_cond_destroy(&pipe->changed);
+    pthread_mutex_destroy(&pipe->lock);
+    free(pipe);
+    return result;
+}
@@ -22,7 +22,6 @@ int main()
     int I[nz] = {0, 4, 2, 8};
     int J[nz] = {3, 8, 7, 5};
     double val[nz] = {1.1, 2.2, 3.2, 4.4};
-    int i;
 
     mm_initialize_typecode(&matcode);
     mm_set_matrix(&matcode);
@@ -33,10 +32,10 @@ int main()
     mm_write_mtx_crd_size(stdout, M, N, nz);
 
     /* NOTE: matrix market files use 1-based indices, i.e. first element
-      of a vector has index 1, not 0.  */
+      of a vector has index 1, not 0.  index_base 0 tells the writer
+      that I[] and J[] hold C indices. */
 
-    for (i = 0; i < nz; i++)
-        fprintf(stdout, "%d %d %10.3g\n", I[i] + 1, J[i] + 1, val[i]);
+    mm_write_mtx_crd_bulk(stdout, nz, I, J, val, matcode, 0, 1, NULL);
 
     return 0;
 }
@@ -10,6 +10,10 @@
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <pthread.h>
 
 #include "mmio.h"
 
@@ -177,13 +181,15 @@ int mm_write_mtx_crd_size(FILE *f, int M, int N, int nz)
         return 0;
 }
 
-int mm_read_mtx_crd_size(FILE *f, int *M, int *N, int *nz)
+int mm_read_mtx_crd_size64(FILE *f, int *M, int *N, int64_t *nz)
 {
     char line[MM_MAX_LINE_LENGTH];
+    int64_t rows, cols;
     int num_items_read;
 
     /* set return null parameter values, in case we exit with errors */
-    *M = *N = *nz = 0;
+    *M = *N = 0;
+    *nz = 0;
 
     /* now continue scanning until you reach the end-of-comments */
     do
@@ -193,17 +199,33 @@ int mm_read_mtx_crd_size(FILE *f, int *M, int *N, int *nz)
     } while (line[0] == '%');
 
     /* line[] is either blank or has M,N, nz */
-    if (sscanf(line, "%d %d %d", M, N, nz) == 3)
-        return 0;
-
-    else
+    if (sscanf(line, "%" SCNd64 " %" SCNd64 " %" SCNd64, &rows, &cols, nz) != 3)
         do
         {
-            num_items_read = fscanf(f, "%d %d %d", M, N, nz);
+            num_items_read = fscanf(f, "%" SCNd64 " %" SCNd64 " %" SCNd64, &rows, &cols, nz);
             if (num_items_read == EOF)
                 return MM_PREMATURE_EOF;
         } while (num_items_read != 3);
 
+    /* row and column indices stay int, only the entry count may pass INT_MAX */
+    if (rows > INT_MAX || cols > INT_MAX)
+        return MM_TOO_LARGE;
+    *M = (int)rows;
+    *N = (int)cols;
+    return 0;
+}
+
+int mm_read_mtx_crd_size(FILE *f, int *M, int *N, int *nz)
+{
+    int64_t count;
+    int ret_code;
+
+    *nz = 0;
+    if ((ret_code = mm_read_mtx_crd_size64(f, M, N, &count)) != 0)
+        return ret_code;
+    if (count > INT_MAX)
+        return MM_TOO_LARGE;
+    *nz = (int)count;
     return 0;
 }
 
@@ -306,6 +328,231 @@ int mm_read_mtx_crd_entry(FILE *f, int *I, int *J,
     return 0;
 }
 
+/************************************************************************
+    mm_read_crd_line()  reads one coordinate entry with fgets/strtol/strtod
+                        (no scanf), skipping blank lines.  Indices come
+                        back 0-based and range checked against M x N.
+                        Pattern entries get the value 1.0.
+************************************************************************/
+
+static int mm_read_crd_line(FILE *f, int M, int N, MM_typecode matcode,
+                            int *I, int *J, double *real, double *imag)
+{
+    char line[MM_MAX_LINE_LENGTH];
+    char *p, *end;
+    long i, j;
+    size_t len;
+
+    do
+    {
+        if (fgets(line, MM_MAX_LINE_LENGTH, f) == NULL)
+            return MM_PREMATURE_EOF;
+        len = strlen(line);
+        if (len == MM_MAX_LINE_LENGTH - 1 && line[len - 1] != '\n' && !feof(f))
+            return MM_LINE_TOO_LONG;
+        for (p = line; isspace((unsigned char)*p); p++)
+            ;
+    } while (*p == '\0');
+
+    /* the buffer holds a single line, so a field strtol() can't find is missing */
+    i = strtol(p, &end, 10);
+    if (end == p)
+        return MM_MALFORMED_ENTRY;
+    p = end;
+    j = strtol(p, &end, 10);
+    if (end == p)
+        return MM_MALFORMED_ENTRY;
+    p = end;
+
+    *real = 1.0;
+    *imag = 0.0;
+    if (!mm_is_pattern(matcode))
+    {
+        *real = strtod(p, &end);
+        if (end == p)
+            return MM_MALFORMED_ENTRY;
+        p = end;
+        if (mm_is_complex(matcode))
+        {
+            *imag = strtod(p, &end);
+            if (end == p)
+                return MM_MALFORMED_ENTRY;
+        }
+    }
+
+    if (i < 1 || i > M || j < 1 || j > N)
+        return MM_INDEX_OUT_OF_RANGE;
+    *I = (int)i - 1;
+    *J = (int)j - 1;
+    return 0;
+}
+
+/************************************************************************
+    mm_read_mtx_crd_soa()  reads nz entries straight into already
+                           allocated I[], J[] and val[] (2*nz for complex,
+                           may be NULL for pattern).  Call after
+                           mm_read_mtx_crd_size().
+************************************************************************/
+
+int mm_read_mtx_crd_soa(FILE *f, int M, int N, int nz, int I[], int J[],
+                        double val[], MM_typecode matcode, int *bad_entry)
+{
+    double real, imag;
+    int k, ret_code;
+
+    *bad_entry = 0;
+    if (!(mm_is_real(matcode) || mm_is_integer(matcode) ||
+          mm_is_pattern(matcode) || mm_is_complex(matcode)))
+        return MM_UNSUPPORTED_TYPE;
+
+    for (k = 0; k < nz; k++)
+    {
+        ret_code = mm_read_crd_line(f, M, N, matcode, &I[k], &J[k], &real, &imag);
+        if (ret_code != 0)
+        {
+            *bad_entry = k + 1;
+            return ret_code;
+        }
+        if (val == NULL)
+            continue;
+        if (mm_is_complex(matcode))
+        {
+            val[2 * k] = real;
+            val[2 * k + 1] = imag;
+        }
+        else
+            val[k] = real;
+    }
+    return 0;
+}
+
+/************************************************************************
+    mm_read_mtx_crd_csr64()  reads nz entries straight into CSR arrays:
+                           row_ptr[M+1], col_ind[nz], val[nz] (may be NULL
+                           for pattern).  Complex is not supported.
+
+                           Rows are counted while parsing.  As long as the
+                           file is sorted by row every entry already sits
+                           in its final slot; the first out-of-order row
+                           switches to a row index per entry and a stable
+                           in-place permutation at the end, so the columns
+                           of a row keep their file order either way.
+                           When that permutation cannot be allocated
+                           *bad_entry is the out-of-order entry.
+                           Call after mm_read_mtx_crd_size64().
+************************************************************************/
+
+int mm_read_mtx_crd_csr64(FILE *f, int M, int N, int64_t nz,
+                          int64_t row_ptr[], int col_ind[], double val[],
+                          MM_typecode matcode, int64_t *bad_entry)
+{
+    double real, imag, vtmp;
+    int64_t *I = NULL;
+    int64_t k, c, dest;
+    int i, j, r, last = 0, ret_code;
+
+    *bad_entry = 0;
+    if (!(mm_is_real(matcode) || mm_is_integer(matcode) ||
+          mm_is_pattern(matcode)))
+        return MM_UNSUPPORTED_TYPE;
+
+    for (r = 0; r <= M; r++)
+        row_ptr[r] = 0;
+
+    for (k = 0; k < nz; k++)
+    {
+        ret_code = mm_read_crd_line(f, M, N, matcode, &i, &j, &real, &imag);
+        if (ret_code != 0)
+        {
+            free(I);
+            *bad_entry = k + 1;
+            return ret_code;
+        }
+
+        if (I == NULL && i < last)
+        {
+            /* unsorted: recover the rows of the sorted prefix from the counts */
+            if ((I = (int64_t *)malloc((long unsigned int)nz * sizeof(int64_t))) == NULL)
+            {
+                *bad_entry = k + 1;
+                return MM_OUT_OF_MEMORY;
+            }
+            for (r = 0, dest = 0; r < M; r++)
+                for (c = 0; c < row_ptr[r + 1]; c++)
+                    I[dest++] = r;
+        }
+        if (I != NULL)
+            I[k] = i;
+        last = i;
+
+        row_ptr[i + 1]++;
+        col_ind[k] = j;
+        if (val != NULL)
+            val[k] = real;
+    }
+
+    for (r = 0; r < M; r++)
+        row_ptr[r + 1] += row_ptr[r];
+
+    if (I == NULL)
+        return 0;
+
+    /* I[k] becomes the destination of entry k, then follow the cycles */
+    for (k = 0; k < nz; k++)
+        I[k] = row_ptr[I[k]]++;
+    for (r = M; r > 0; r--)
+        row_ptr[r] = row_ptr[r - 1];
+    row_ptr[0] = 0;
+
+    for (k = 0; k < nz; k++)
+    {
+        while (I[k] != k)
+        {
+            dest = I[k];
+            j = col_ind[dest];
+            col_ind[dest] = col_ind[k];
+            col_ind[k] = j;
+            if (val != NULL)
+            {
+                vtmp = val[dest];
+                val[dest] = val[k];
+                val[k] = vtmp;
+            }
+            I[k] = I[dest];
+            I[dest] = dest;
+        }
+    }
+
+    free(I);
+    return 0;
+}
+
+/************************************************************************
+    mm_read_mtx_crd_csr()  int row_ptr[] form of mm_read_mtx_crd_csr64()
+                           for files with at most INT_MAX entries
+************************************************************************/
+
+int mm_read_mtx_crd_csr(FILE *f, int M, int N, int nz, int row_ptr[],
+                        int col_ind[], double val[], MM_typecode matcode,
+                        int *bad_entry)
+{
+    int64_t *wide, bad;
+    int r, ret_code;
+
+    *bad_entry = 0;
+    if ((wide = (int64_t *)malloc(((long unsigned int)M + 1) * sizeof(int64_t))) == NULL)
+        return MM_OUT_OF_MEMORY;
+
+    ret_code = mm_read_mtx_crd_csr64(f, M, N, nz, wide, col_ind, val, matcode, &bad);
+    if (ret_code == 0)
+        for (r = 0; r <= M; r++)
+            row_ptr[r] = (int)wide[r];
+    *bad_entry = (int)bad;
+
+    free(wide);
+    return ret_code;
+}
+
 /************************************************************************
     mm_read_mtx_crd()  fills M, N, nz, array of values, and return
                         type code, e.g. 'MCRS'
@@ -386,7 +633,7 @@ int mm_write_mtx_crd(char fname[], int M, int N, int nz, int I[], int J[],
                      double val[], MM_typecode matcode)
 {
     FILE *f;
-    int i;
+    int ret_code;
 
     if (strcmp(fname, "stdout") == 0)
         f = stdout;
@@ -400,28 +647,445 @@ int mm_write_mtx_crd(char fname[], int M, int N, int nz, int I[], int J[],
     /* print matrix sizes and nonzeros */
     fprintf(f, "%d %d %d\n", M, N, nz);
 
-    /* print values */
+    /* print values (I[] and J[] are passed through as given) */
+    ret_code = mm_write_mtx_crd_bulk(f, nz, I, J, val, matcode, 1, 1, NULL);
+
+    if (f != stdout)
+        fclose(f);
+
+    return ret_code;
+}
+
+/************************************************************************
+    Bulk coordinate writer
+
+    Entries are formatted by hand into large buffers instead of one
+    fprintf() per nonzero: integers digit by digit, doubles as the
+    shortest digits that strtod() reads back to the same bits (see
+    mm_grisu2() below), so a file written here and read with
+    mm_read_mtx_crd_soa() reproduces val[] exactly.
+
+    Blocks of MM_BULK_BLOCK entries are formatted concurrently, one per
+    thread, then written in order with one fwrite() each.
+************************************************************************/
+
+#define MM_BULK_BLOCK (1 << 17)
+#define MM_BULK_LINE 80 /* two 11-char indices, two 24-char doubles */
+
+typedef struct
+{
+    const int *I, *J;
+    const double *val;
+    int first, count, index_base, fields, spawned;
+    char *buf;
+    size_t len;
+} mm_bulk_block;
+
+static char *mm_format_int(char *p, int v)
+{
+    char digits[12];
+    unsigned int u;
+    int n = 0;
+
+    if (v < 0)
+    {
+        *p++ = '-';
+        u = 0u - (unsigned int)v;
+    }
+    else
+        u = (unsigned int)v;
+    do
+    {
+        digits[n++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u != 0);
+    while (n > 0)
+        *p++ = digits[--n];
+    return p;
+}
+
+/*  Shortest round-trip doubles: Grisu2 (Loitsch, "Printing Floating-Point
+    Numbers Quickly and Accurately with Integers", PLDI 2010).  Digits are
+    generated strictly inside the rounding interval of v, so strtod() always
+    gives v back; they are the shortest such digits for all but a tiny
+    fraction of inputs, where one extra digit may appear.
+
+    mm_pow10_f/e hold 10^(-348 + 8i) ~= f * 2^e, f normalized and rounded to
+    nearest (computed exactly with big integers). */
+
+typedef struct
+{
+    uint64_t f;
+    int e;
+} mm_diy_fp;
+
+static const uint64_t mm_pow10_f[87] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+    0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+    0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+    0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+    0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+    0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+    0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+    0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+    0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+    0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+    0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+    0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+    0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+    0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+    0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+    0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+    0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+    0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+    0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+    0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+    0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+    0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL};
+static const short mm_pow10_e[87] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+    -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+    -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+    -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+    56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+    694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+    1013, 1039, 1066};
+
+static mm_diy_fp mm_diy_mul(mm_diy_fp x, mm_diy_fp y)
+{
+    const uint64_t m32 = 0xFFFFFFFFu;
+    uint64_t a = x.f >> 32, b = x.f & m32, c = y.f >> 32, d = y.f & m32;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t mid = (bd >> 32) + (ad & m32) + (bc & m32) + (1u << 31);
+    mm_diy_fp r;
+
+    r.f = ac + (ad >> 32) + (bc >> 32) + (mid >> 32);
+    r.e = x.e + y.e + 64;
+    return r;
+}
+
+static mm_diy_fp mm_diy_normalize(mm_diy_fp x)
+{
+    while (!(x.f & ((uint64_t)1 << 63)))
+    {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+static void mm_grisu_round(char *buf, int len, uint64_t delta, uint64_t rest,
+                           uint64_t ten_kappa, uint64_t wp_w)
+{
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w))
+    {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+/* digits of v into buf (no sign, no point), v = digits * 10^K */
+static int mm_grisu2(double v, char *buf, int *K)
+{
+    static const uint32_t pow10[] = {1, 10, 100, 1000, 10000, 100000,
+                                     1000000, 10000000, 100000000, 1000000000};
+    mm_diy_fp w, mp, mm, c, W, Wp, Wm, one;
+    uint64_t bits, p2, delta, wp_w, rest;
+    uint32_t p1, d;
+    int kappa, len = 0, k, index, biased;
+    double dk;
+
+    memcpy(&bits, &v, sizeof(bits));
+    biased = (int)((bits >> 52) & 0x7FF);
+    w.f = bits & (((uint64_t)1 << 52) - 1);
+    if (biased != 0)
+    {
+        w.f += (uint64_t)1 << 52;
+        w.e = biased - 1075;
+    }
+    else
+        w.e = -1074;
+
+    /* boundaries m- and m+, halfway to the neighbouring doubles */
+    mp.f = (w.f << 1) + 1;
+    mp.e = w.e - 1;
+    mp = mm_diy_normalize(mp);
+    if (w.f == ((uint64_t)1 << 52))
+    {
+        mm.f = (w.f << 2) - 1;
+        mm.e = w.e - 2;
+    }
+    else
+    {
+        mm.f = (w.f << 1) - 1;
+        mm.e = w.e - 1;
+    }
+    mm.f <<= mm.e - mp.e;
+    mm.e = mp.e;
+
+    /* cached power bringing m+ into the exponent range [-60, -32] */
+    dk = (-61 - mp.e) * 0.30102999566398114 + 347;
+    k = (int)dk;
+    if (dk - k > 0.0)
+        k++;
+    index = (k >> 3) + 1;
+    *K = -(-348 + index * 8);
+    c.f = mm_pow10_f[index];
+    c.e = mm_pow10_e[index];
+
+    W = mm_diy_mul(mm_diy_normalize(w), c);
+    Wp = mm_diy_mul(mp, c);
+    Wm = mm_diy_mul(mm, c);
+    Wm.f++;
+    Wp.f--;
+
+    /* digit generation */
+    delta = Wp.f - Wm.f;
+    wp_w = Wp.f - W.f;
+    one.f = (uint64_t)1 << -Wp.e;
+    one.e = Wp.e;
+    p1 = (uint32_t)(Wp.f >> -one.e);
+    p2 = Wp.f & (one.f - 1);
+    for (kappa = 1; kappa < 10 && p1 >= pow10[kappa]; kappa++)
+        ;
+
+    while (kappa > 0)
+    {
+        d = p1 / pow10[kappa - 1];
+        p1 %= pow10[kappa - 1];
+        if (d || len)
+            buf[len++] = (char)('0' + d);
+        kappa--;
+        rest = ((uint64_t)p1 << -one.e) + p2;
+        if (rest <= delta)
+        {
+            *K += kappa;
+            mm_grisu_round(buf, len, delta, rest, (uint64_t)pow10[kappa] << -one.e, wp_w);
+            return len;
+        }
+    }
+    for (;;)
+    {
+        p2 *= 10;
+        delta *= 10;
+        d = (uint32_t)(p2 >> -one.e);
+        if (d || len)
+            buf[len++] = (char)('0' + d);
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta)
+        {
+            *K += kappa;
+            mm_grisu_round(buf, len, delta, p2, one.f, wp_w * (-kappa < 10 ? pow10[-kappa] : 0));
+            return len;
+        }
+    }
+}
+
+/*  mm_dtoa(): writes v into buf (room for MM_DTOA_LEN bytes) in the
+    round-trip form above and returns the end, no NUL is appended */
+char *mm_dtoa(char *p, double v)
+{
+    char digits[20];
+    int len, K, point, i;
+
+    if (v != v || v - v != 0)
+        return p + snprintf(p, MM_DTOA_LEN, "%g", v); /* nan, inf */
+    if (v < 0 || (v == 0 && 1 / v < 0))
+    {
+        *p++ = '-';
+        v = -v;
+    }
+    if (v == 0)
+    {
+        *p++ = '0';
+        return p;
+    }
+
+    len = mm_grisu2(v, digits, &K);
+    point = len + K; /* v = 0.digits * 10^point */
+
+    if (K >= 0 && point <= 17)
+    {
+        /* integer: 1500 */
+        memcpy(p, digits, (size_t)len);
+        p += len;
+        for (i = 0; i < K; i++)
+            *p++ = '0';
+    }
+    else if (point > 0 && point <= 17)
+    {
+        /* 12.5 */
+        memcpy(p, digits, (size_t)point);
+        p += point;
+        *p++ = '.';
+        memcpy(p, digits + point, (size_t)(len - point));
+        p += len - point;
+    }
+    else if (point > -5 && point <= 0)
+    {
+        /* 0.00125 */
+        *p++ = '0';
+        *p++ = '.';
+        for (i = point; i < 0; i++)
+            *p++ = '0';
+        memcpy(p, digits, (size_t)len);
+        p += len;
+    }
+    else
+    {
+        /* 1.25e-07 */
+        *p++ = digits[0];
+        if (len > 1)
+        {
+            *p++ = '.';
+            memcpy(p, digits + 1, (size_t)(len - 1));
+            p += len - 1;
+        }
+        *p++ = 'e';
+        *p++ = (point - 1 < 0) ? '-' : '+';
+        i = (point - 1 < 0) ? 1 - point : point - 1;
+        if (i >= 100)
+            *p++ = (char)('0' + i / 100);
+        *p++ = (char)('0' + i / 10 % 10);
+        *p++ = (char)('0' + i % 10);
+    }
+    return p;
+}
+
+static void *mm_format_block(void *arg)
+{
+    mm_bulk_block *b = (mm_bulk_block *)arg;
+    char *p = b->buf;
+    int k, shift = (b->index_base == 0) ? 1 : 0;
+
+    for (k = b->first; k < b->first + b->count; k++)
+    {
+        p = mm_format_int(p, b->I[k] + shift);
+        *p++ = ' ';
+        p = mm_format_int(p, b->J[k] + shift);
+        if (b->fields == 1)
+        {
+            *p++ = ' ';
+            p = mm_dtoa(p, b->val[k]);
+        }
+        else if (b->fields == 2)
+        {
+            *p++ = ' ';
+            p = mm_dtoa(p, b->val[2 * k]);
+            *p++ = ' ';
+            p = mm_dtoa(p, b->val[2 * k + 1]);
+        }
+        *p++ = '\n';
+    }
+    b->len = (size_t)(p - b->buf);
+    return NULL;
+}
+
+/************************************************************************
+    mm_write_mtx_crd_bulk()  writes nz entries after the banner and size
+                             line.  index_base is the base of I[] and J[]:
+                             0 for C indices (as returned by the _soa and
+                             _csr readers), 1 if they are already 1-based.
+                             nthreads <= 1 formats on the calling thread.
+                             bytes (may be NULL) receives the bytes written.
+************************************************************************/
+
+int mm_write_mtx_crd_bulk(FILE *f, int nz, int I[], int J[], double val[],
+                          MM_typecode matcode, int index_base, int nthreads,
+                          size_t *bytes)
+{
+    mm_bulk_block *block;
+    pthread_t *tid;
+    int fields, t, used, next, round, ret_code = 0;
+    size_t total = 0;
+
+    if (bytes != NULL)
+        *bytes = 0;
     if (mm_is_pattern(matcode))
-        for (i = 0; i < nz; i++)
-            fprintf(f, "%d %d\n", I[i], J[i]);
-    else if (mm_is_real(matcode))
-        for (i = 0; i < nz; i++)
-            fprintf(f, "%d %d %20.16g\n", I[i], J[i], val[i]);
+        fields = 0;
+    else if (mm_is_real(matcode) || mm_is_integer(matcode))
+        fields = 1;
     else if (mm_is_complex(matcode))
-        for (i = 0; i < nz; i++)
-            fprintf(f, "%d %d %20.16g %20.16g\n", I[i], J[i], val[2 * i],
-                    val[2 * i + 1]);
+        fields = 2;
     else
-    {
-        if (f != stdout)
-            fclose(f);
         return MM_UNSUPPORTED_TYPE;
+
+    if (nthreads < 1)
+        nthreads = 1;
+    if (nthreads > nz / MM_BULK_BLOCK + 1)
+        nthreads = nz / MM_BULK_BLOCK + 1;
+
+    block = (mm_bulk_block *)calloc((size_t)nthreads, sizeof(mm_bulk_block));
+    tid = (pthread_t *)calloc((size_t)nthreads, sizeof(pthread_t));
+    if (block == NULL || tid == NULL)
+    {
+        free(block);
+        free(tid);
+        return MM_OUT_OF_MEMORY;
+    }
+    for (t = 0; t < nthreads; t++)
+    {
+        block[t].I = I;
+        block[t].J = J;
+        block[t].val = val;
+        block[t].index_base = index_base;
+        block[t].fields = fields;
+        block[t].buf = (char *)malloc((size_t)MM_BULK_BLOCK * MM_BULK_LINE);
+        if (block[t].buf == NULL)
+            ret_code = MM_OUT_OF_MEMORY;
     }
 
-    if (f != stdout)
-        fclose(f);
+    for (next = 0; next < nz && ret_code == 0; next += round)
+    {
+        /* one block per thread, the caller formats the first */
+        for (used = 0, round = 0; used < nthreads && next + round < nz; used++)
+        {
+            block[used].first = next + round;
+            block[used].count = (nz - block[used].first < MM_BULK_BLOCK) ? nz - block[used].first : MM_BULK_BLOCK;
+            round += block[used].count;
+        }
+        for (t = 1; t < used; t++)
+        {
+            block[t].spawned = (pthread_create(&tid[t], NULL, mm_format_block, &block[t]) == 0);
+            if (!block[t].spawned)
+                mm_format_block(&block[t]);
+        }
+        mm_format_block(&block[0]);
+        for (t = 1; t < used; t++)
+            if (block[t].spawned)
+                pthread_join(tid[t], NULL);
 
-    return 0;
+        for (t = 0; t < used; t++)
+        {
+            if (fwrite(block[t].buf, 1, block[t].len, f) != block[t].len)
+            {
+                ret_code = MM_COULD_NOT_WRITE_FILE;
+                break;
+            }
+            total += block[t].len;
+        }
+    }
+
+    for (t = 0; t < nthreads; t++)
+        free(block[t].buf);
+    free(block);
+    free(tid);
+
+    if (ret_code == 0 && fflush(f) != 0)
+        ret_code = MM_COULD_NOT_WRITE_FILE;
+    if (bytes != NULL)
+        *bytes = total;
+    return ret_code;
 }
 
 /**
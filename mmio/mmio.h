@@ -9,6 +9,8 @@
 #ifndef MM_IO_H
 #define MM_IO_H
 
+#include <stdint.h>
+
 #define MM_MAX_LINE_LENGTH 1025
 #define MatrixMarketBanner "%%MatrixMarket"
 #define MM_MAX_TOKEN_LENGTH 64
@@ -19,6 +21,7 @@ char *mm_typecode_to_str(MM_typecode matcode);
 
 int mm_read_banner(FILE *f, MM_typecode *matcode);
 int mm_read_mtx_crd_size(FILE *f, int *M, int *N, int *nz);
+int mm_read_mtx_crd_size64(FILE *f, int *M, int *N, int64_t *nz);
 int mm_read_mtx_array_size(FILE *f, int *M, int *N);
 
 int mm_write_banner(FILE *f, MM_typecode matcode);
@@ -83,6 +86,10 @@ int mm_is_valid(MM_typecode matcode);		/* too complex for a macro */
 #define MM_UNSUPPORTED_TYPE		15
 #define MM_LINE_TOO_LONG		16
 #define MM_COULD_NOT_WRITE_FILE	17
+#define MM_MALFORMED_ENTRY		18	/* missing or non-numeric field */
+#define MM_INDEX_OUT_OF_RANGE	19	/* row or column outside 1..M, 1..N */
+#define MM_OUT_OF_MEMORY		20
+#define MM_TOO_LARGE			21	/* size beyond what the int form can hold */
 
 
 /******************** Matrix Market internal definitions ********************
@@ -128,6 +135,25 @@ int mm_read_mtx_crd_entry(FILE *f, int *I, int *J, double *real, double *img,
 int mm_read_unsymmetric_sparse(const char *fname, int *M_, int *N_, int *nz_,
                 double **val_, int **I_, int **J_);
 
+/*  direct-to-storage readers: entries go straight into the caller's      */
+/*  arrays as 0-based indices, *bad_entry is the 1-based entry that failed */
+
+int mm_read_mtx_crd_soa(FILE *f, int M, int N, int nz, int I[], int J[],
+		double val[], MM_typecode matcode, int *bad_entry);
+int mm_read_mtx_crd_csr(FILE *f, int M, int N, int nz, int row_ptr[],
+		int col_ind[], double val[], MM_typecode matcode, int *bad_entry);
+int mm_read_mtx_crd_csr64(FILE *f, int M, int N, int64_t nz,
+		int64_t row_ptr[], int col_ind[], double val[], MM_typecode matcode,
+		int64_t *bad_entry);
+
+/*  bulk writer: buffered, optionally multi-threaded, round-trip exact    */
+
+int mm_write_mtx_crd_bulk(FILE *f, int nz, int I[], int J[], double val[],
+		MM_typecode matcode, int index_base, int nthreads, size_t *bytes);
+
+#define MM_DTOA_LEN 25
+char *mm_dtoa(char *buf, double v);
+
 
 
 #endif
@@ -0,0 +1,587 @@
+/*
+*  ==================================================================
+*  report-compare.c for smvp-toolbox
+*  Compares the runs of this invocation with baseline benchmark
+*  records (--compare) using a Mann-Whitney U test on the samples
+*  ==================================================================
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "mmio/mmio.h"
+#include "libsmvp/smvp.h"
+#include "smvp-cli.h"
+
+// Two-sided significance level a regression has to reach to fail the run
+#define COMPARE_ALPHA 0.05
+// Median changes smaller than this fraction are never reported as regressions, however significant
+#define COMPARE_MIN_CHANGE 0.02
+// Below this many samples on either side the normal approximation of U is not trusted
+#define COMPARE_MIN_SAMPLES 5
+// Deepest object nesting of a record the reader follows
+#define JSON_MAX_DEPTH 8
+
+// Struct: _json_reader_
+// Cursor over one record document and the object keys leading to the current value
+typedef struct _json_reader_
+{
+    const char *p;
+    int depth;
+    char key[JSON_MAX_DEPTH][32];
+    CompareRun *run; // Receives the fields --compare needs
+} JsonReader;
+
+// Struct: _ranked_sample_
+// One time of the pooled samples, tagged with the side it came from
+typedef struct _ranked_sample_
+{
+    double value;
+    int baseline;
+} RankedSample;
+
+// Function: baseName
+// Returns the file name part of a path, runs are matched by it so baselines can come from another folder
+static const char *baseName(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+
+    return (slash != NULL) ? slash + 1 : path;
+}
+
+// Function: runAppendSample
+// Adds one per-iteration time to a run
+static int runAppendSample(CompareRun *run, double value)
+{
+    double *grown;
+
+    if (run->count == run->capacity)
+    {
+        run->capacity = (run->capacity > 0) ? run->capacity * 2 : 64;
+        if ((grown = (double *)realloc(run->samples, sizeof(double) * (long unsigned int)run->capacity)) == NULL)
+        {
+            return -1;
+        }
+        run->samples = grown;
+    }
+    run->samples[run->count++] = value;
+    return 0;
+}
+
+// Function: jsonSkipSpace
+// Advances the reader past white space
+static void jsonSkipSpace(JsonReader *reader)
+{
+    while (*reader->p == ' ' || *reader->p == '\t' || *reader->p == '\n' || *reader->p == '\r')
+    {
+        reader->p++;
+    }
+}
+
+// Function: jsonReadString
+// Reads a quoted string into text (truncated to textLen), returns nonzero if it is malformed
+static int jsonReadString(JsonReader *reader, char *text, size_t textLen)
+{
+    size_t len = 0;
+    char c;
+
+    if (*reader->p++ != '"')
+    {
+        return -1;
+    }
+    while ((c = *reader->p++) != '"')
+    {
+        if (c == '\0')
+        {
+            return -1;
+        }
+        if (c == '\\')
+        {
+            c = *reader->p++;
+            if (c == 'u')
+            {
+                // Only control characters are written escaped, keep a placeholder
+                if (strlen(reader->p) < 4)
+                {
+                    return -1;
+                }
+                reader->p += 4;
+                c = '?';
+            }
+            else if (c == 'n' || c == 't' || c == 'r' || c == 'b' || c == 'f')
+            {
+                c = ' ';
+            }
+            else if (c == '\0')
+            {
+                return -1;
+            }
+        }
+        if (len + 1 < textLen)
+        {
+            text[len++] = c;
+        }
+    }
+    text[len] = '\0';
+    return 0;
+}
+
+// Function: jsonIsPath
+// Tests whether the keys leading to the current value are exactly the given ones
+static int jsonIsPath(const JsonReader *reader, const char *outer, const char *inner)
+{
+    if (inner == NULL)
+    {
+        return reader->depth == 1 && strcmp(reader->key[0], outer) == 0;
+    }
+    return reader->depth == 2 && strcmp(reader->key[0], outer) == 0 && strcmp(reader->key[1], inner) == 0;
+}
+
+// Function: jsonReadValue
+// Reads one value, keeping the record fields --compare needs, returns nonzero if it is malformed
+static int jsonReadValue(JsonReader *reader, int inArray)
+{
+    char text[4096], *end;
+    double number;
+
+    jsonSkipSpace(reader);
+    if (*reader->p == '{')
+    {
+        reader->p++;
+        if (reader->depth == JSON_MAX_DEPTH)
+        {
+            return -1;
+        }
+        reader->depth++;
+        for (jsonSkipSpace(reader); *reader->p != '}';)
+        {
+            if (jsonReadString(reader, reader->key[reader->depth - 1], sizeof(reader->key[0])) != 0)
+            {
+                return -1;
+            }
+            jsonSkipSpace(reader);
+            if (*reader->p++ != ':' || jsonReadValue(reader, 0) != 0)
+            {
+                return -1;
+            }
+            jsonSkipSpace(reader);
+            if (*reader->p == ',')
+            {
+                reader->p++;
+                jsonSkipSpace(reader);
+            }
+            else if (*reader->p != '}')
+            {
+                return -1;
+            }
+        }
+        reader->p++;
+        reader->depth--;
+        return 0;
+    }
+    if (*reader->p == '[')
+    {
+        reader->p++;
+        for (jsonSkipSpace(reader); *reader->p != ']';)
+        {
+            if (jsonReadValue(reader, 1) != 0)
+            {
+                return -1;
+            }
+            jsonSkipSpace(reader);
+            if (*reader->p == ',')
+            {
+                reader->p++;
+            }
+            else if (*reader->p != ']')
+            {
+                return -1;
+            }
+            jsonSkipSpace(reader);
+        }
+        reader->p++;
+        return 0;
+    }
+    if (*reader->p == '"')
+    {
+        if (jsonReadString(reader, text, sizeof(text)) != 0)
+        {
+            return -1;
+        }
+        if (jsonIsPath(reader, "matrix", "file"))
+        {
+            reader->run->matrix = strdup(text);
+        }
+        else if (jsonIsPath(reader, "run", "algorithm"))
+        {
+            snprintf(reader->run->algorithm, sizeof(reader->run->algorithm), "%.15s", text);
+        }
+        return 0;
+    }
+    if (strncmp(reader->p, "true", 4) == 0 || strncmp(reader->p, "null", 4) == 0)
+    {
+        reader->p += 4;
+        return 0;
+    }
+    if (strncmp(reader->p, "false", 5) == 0)
+    {
+        reader->p += 5;
+        return 0;
+    }
+
+    number = strtod(reader->p, &end);
+    if (end == reader->p)
+    {
+        return -1;
+    }
+    reader->p = end;
+    if (inArray && jsonIsPath(reader, "samples_ms", NULL))
+    {
+        return runAppendSample(reader->run, number);
+    }
+    if (jsonIsPath(reader, "unix_time", NULL))
+    {
+        reader->run->unixTime = (long long)number;
+    }
+    return 0;
+}
+
+// Function: readRecordFile
+// Reads matrix, algorithm and samples of one JSON benchmark record, returns nonzero if it is not one
+static int readRecordFile(const char *path, CompareRun *run, char *error, size_t errorLen)
+{
+    JsonReader reader;
+    FILE *recordFile;
+    char *doc;
+    long len;
+
+    memset(run, 0, sizeof(*run));
+    if ((recordFile = fopen(path, "r")) == NULL)
+    {
+        snprintf(error, errorLen, "cannot open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    fseek(recordFile, 0, SEEK_END);
+    len = ftell(recordFile);
+    rewind(recordFile);
+    if (len < 0 || (doc = (char *)malloc((size_t)len + 1)) == NULL)
+    {
+        snprintf(error, errorLen, "cannot read %s", path);
+        fclose(recordFile);
+        return -1;
+    }
+    doc[fread(doc, 1, (size_t)len, recordFile)] = '\0';
+    fclose(recordFile);
+
+    memset(&reader, 0, sizeof(reader));
+    reader.p = doc;
+    reader.run = run;
+    if (jsonReadValue(&reader, 0) != 0 || run->matrix == NULL || run->algorithm[0] == '\0')
+    {
+        snprintf(error, errorLen, "%s is not a benchmark record", path);
+        free(doc);
+        free(run->matrix);
+        free(run->samples);
+        memset(run, 0, sizeof(*run));
+        return -1;
+    }
+    free(doc);
+    return 0;
+}
+
+// Function: findRun
+// Returns the run of a list matching matrix file name and algorithm, or NULL
+static CompareRun *findRun(CompareRun *runs, int count, const char *matrix, const char *algorithm)
+{
+    int index;
+
+    for (index = 0; index < count; index++)
+    {
+        if (strcmp(baseName(runs[index].matrix), baseName(matrix)) == 0 && strcmp(runs[index].algorithm, algorithm) == 0)
+        {
+            return &runs[index];
+        }
+    }
+    return NULL;
+}
+
+// Function: addBaseline
+// Keeps the newest baseline record of every matrix and algorithm
+static void addBaseline(CompareSet *set, CompareRun *run)
+{
+    CompareRun *known = findRun(set->baseline, set->baselineCount, run->matrix, run->algorithm);
+
+    if (known != NULL && known->unixTime >= run->unixTime)
+    {
+        free(run->matrix);
+        free(run->samples);
+        return;
+    }
+    if (known != NULL)
+    {
+        free(known->matrix);
+        free(known->samples);
+        *known = *run;
+        return;
+    }
+    set->baseline[set->baselineCount++] = *run;
+}
+
+// Function: smvpCompareLoad
+// Loads the baseline: one JSON record file, or every smvp-toolbox_record_*.json in a folder
+// (records of an earlier invocation's report folder). Returns 0 or -1 with a message in error
+int smvpCompareLoad(const char *source, CompareSet *set, char *error, size_t errorLen)
+{
+    struct stat st;
+    struct dirent *entry;
+    CompareRun run;
+    DIR *dir;
+    char *path;
+    size_t pathLen;
+    int capacity = 0;
+
+    memset(set, 0, sizeof(*set));
+    set->source = source;
+    if (stat(source, &st) != 0)
+    {
+        snprintf(error, errorLen, "cannot open %s: %s", source, strerror(errno));
+        return -1;
+    }
+    if (!S_ISDIR(st.st_mode))
+    {
+        set->baseline = (CompareRun *)malloc(sizeof(CompareRun));
+        if (set->baseline == NULL || readRecordFile(source, &run, error, errorLen) != 0)
+        {
+            return -1;
+        }
+        set->baseline[set->baselineCount++] = run;
+        return 0;
+    }
+
+    if ((dir = opendir(source)) == NULL)
+    {
+        snprintf(error, errorLen, "cannot open %s: %s", source, strerror(errno));
+        return -1;
+    }
+    while ((entry = readdir(dir)) != NULL)
+    {
+        pathLen = strlen(entry->d_name);
+        if (strncmp(entry->d_name, "smvp-toolbox_record_", 20) != 0 || pathLen < 5 || strcmp(entry->d_name + pathLen - 5, ".json") != 0)
+        {
+            continue;
+        }
+        pathLen += strlen(source) + 2;
+        path = (char *)malloc(pathLen);
+        snprintf(path, pathLen, "%s/%s", source, entry->d_name);
+        if (readRecordFile(path, &run, error, errorLen) != 0)
+        {
+            printf(ANSI_COLOR_RED "[WARN]\tSkipping baseline record: %s.\n" ANSI_COLOR_RESET, error);
+            free(path);
+            continue;
+        }
+        free(path);
+        if (set->baselineCount == capacity)
+        {
+            capacity = (capacity > 0) ? capacity * 2 : 16;
+            set->baseline = (CompareRun *)realloc(set->baseline, sizeof(CompareRun) * (long unsigned int)capacity);
+        }
+        addBaseline(set, &run);
+    }
+    closedir(dir);
+
+    if (set->baselineCount == 0)
+    {
+        snprintf(error, errorLen, "%s holds no benchmark records", source);
+        return -1;
+    }
+    return 0;
+}
+
+// Function: smvpCompareAdd
+// Keeps the samples of one run of this invocation for smvpCompareReport()
+void smvpCompareAdd(CompareSet *set, const RunRecord *record)
+{
+    CompareRun *run;
+    int capacity;
+
+    if (set == NULL)
+    {
+        return;
+    }
+    capacity = (set->currentCount > 0) ? set->currentCount + 1 : 1;
+    set->current = (CompareRun *)realloc(set->current, sizeof(CompareRun) * (long unsigned int)capacity);
+    run = &set->current[set->currentCount++];
+    memset(run, 0, sizeof(*run));
+    run->matrix = strdup(record->matrixPath);
+    snprintf(run->algorithm, sizeof(run->algorithm), "%s", record->algorithm);
+    run->samples = (double *)malloc(sizeof(double) * (long unsigned int)(record->iterations + 1));
+    memcpy(run->samples, record->timeData->time_each, sizeof(double) * (long unsigned int)record->iterations);
+    run->count = record->iterations;
+    run->capacity = record->iterations;
+}
+
+// Function: compareRanked
+// qsort() comparison for pooled samples in ascending time
+static int compareRanked(const void *a, const void *b)
+{
+    double x = ((const RankedSample *)a)->value, y = ((const RankedSample *)b)->value;
+
+    return (x > y) - (x < y);
+}
+
+// Function: compareDouble
+// qsort() comparison for ascending doubles
+static int compareDouble(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+// Function: compareMedian
+// Median of a run's samples
+static double compareMedian(const CompareRun *run)
+{
+    double *sorted = (double *)malloc(sizeof(double) * (long unsigned int)run->count), median;
+
+    memcpy(sorted, run->samples, sizeof(double) * (long unsigned int)run->count);
+    qsort(sorted, (size_t)run->count, sizeof(double), compareDouble);
+    median = (run->count % 2) ? sorted[run->count / 2] : (sorted[run->count / 2 - 1] + sorted[run->count / 2]) / 2;
+    free(sorted);
+    return median;
+}
+
+// Function: mannWhitneyP
+// Two-sided p-value of the Mann-Whitney U test between two samples: normal approximation
+// with tie correction and continuity correction, NAN when either side is too small
+static double mannWhitneyP(const CompareRun *baseline, const CompareRun *current)
+{
+    RankedSample *pooled;
+    double n1 = baseline->count, n2 = current->count, n = n1 + n2;
+    double rankSum = 0, tieSum = 0, rank, u, mean, sigma, z;
+    int total = baseline->count + current->count, index, first, last;
+
+    if (baseline->count < COMPARE_MIN_SAMPLES || current->count < COMPARE_MIN_SAMPLES)
+    {
+        return NAN;
+    }
+    pooled = (RankedSample *)malloc(sizeof(RankedSample) * (long unsigned int)total);
+    for (index = 0; index < baseline->count; index++)
+    {
+        pooled[index].value = baseline->samples[index];
+        pooled[index].baseline = 1;
+    }
+    for (index = 0; index < current->count; index++)
+    {
+        pooled[baseline->count + index].value = current->samples[index];
+        pooled[baseline->count + index].baseline = 0;
+    }
+    qsort(pooled, (size_t)total, sizeof(RankedSample), compareRanked);
+
+    // Tied times share the average of the ranks they span
+    for (first = 0; first < total; first = last)
+    {
+        for (last = first + 1; last < total && pooled[last].value == pooled[first].value; last++)
+        {
+        }
+        rank = (first + 1 + last) / 2.0;
+        for (index = first; index < last; index++)
+        {
+            rankSum += pooled[index].baseline ? rank : 0;
+        }
+        tieSum += pow(last - first, 3) - (last - first);
+    }
+    free(pooled);
+
+    u = rankSum - n1 * (n1 + 1) / 2;
+    mean = n1 * n2 / 2;
+    sigma = sqrt(n1 * n2 / 12 * ((n + 1) - tieSum / (n * (n - 1))));
+    if (sigma == 0)
+    {
+        return 1;
+    }
+    z = (fabs(u - mean) - 0.5) / sigma;
+    return (z > 0) ? erfc(z / sqrt(2)) : 1;
+}
+
+// Function: significanceMarker
+// Stars for the usual significance levels
+static const char *significanceMarker(double p)
+{
+    if (isnan(p) || p >= COMPARE_ALPHA)
+    {
+        return "";
+    }
+    return (p < 0.001) ? "***" : (p < 0.01) ? "**" : "*";
+}
+
+// Function: smvpCompareReport
+// Writes the speedup/regression table of every run that has a baseline and returns the
+// number of significant regressions: slower medians with p < COMPARE_ALPHA that changed
+// by at least COMPARE_MIN_CHANGE
+int smvpCompareReport(FILE *out, const CompareSet *set)
+{
+    const CompareRun *current, *baseline;
+    double baseMedian, median, speedup, p;
+    int index, regressions = 0, matched = 0, regressed;
+
+    fprintf(out, "%-28s %-8s %12s %12s %8s %10s %-3s %s\n", "Matrix", "Alg", "Base ms", "Median ms", "Speedup", "p-value", "", "Verdict");
+    for (index = 0; index < set->currentCount; index++)
+    {
+        current = &set->current[index];
+        if ((baseline = findRun(set->baseline, set->baselineCount, current->matrix, current->algorithm)) == NULL)
+        {
+            fprintf(out, "%-28.28s %-8s %12s %12s %8s %10s %-3s %s\n", baseName(current->matrix), current->algorithm, "-", "-", "-", "-", "", "no baseline");
+            continue;
+        }
+        matched++;
+        if (baseline->count == 0 || current->count == 0)
+        {
+            fprintf(out, "%-28.28s %-8s %12s %12s %8s %10s %-3s %s\n", baseName(current->matrix), current->algorithm, "-", "-", "-", "-", "", "no samples");
+            continue;
+        }
+        baseMedian = compareMedian(baseline);
+        median = compareMedian(current);
+        speedup = baseMedian / median;
+        p = mannWhitneyP(baseline, current);
+        regressed = !isnan(p) && p < COMPARE_ALPHA && median > baseMedian * (1 + COMPARE_MIN_CHANGE);
+        regressions += regressed;
+
+        fprintf(out, "%-28.28s %-8s %12.5f %12.5f %7.3fx ", baseName(current->matrix), current->algorithm, baseMedian, median, speedup);
+        if (isnan(p))
+        {
+            fprintf(out, "%10s %-3s %s\n", "-", "", "too few samples");
+            continue;
+        }
+        fprintf(out, "%10.3g %-3s %s\n", p, significanceMarker(p),
+                regressed ? "REGRESSION" : (p < COMPARE_ALPHA && median < baseMedian * (1 - COMPARE_MIN_CHANGE)) ? "faster" : "unchanged");
+    }
+    fprintf(out, "\n%d of %d runs matched a baseline, %d significant regressions\n", matched, set->currentCount, regressions);
+    fprintf(out, "Mann-Whitney U on per-iteration times: * p < 0.05, ** p < 0.01, *** p < 0.001; changes under %g%% are not regressions\n", COMPARE_MIN_CHANGE * 100);
+    return regressions;
+}
+
+// Function: smvpCompareFree
+// Releases the baseline and collected runs
+void smvpCompareFree(CompareSet *set)
+{
+    int index;
+
+    for (index = 0; index < set->baselineCount; index++)
+    {
+        free(set->baseline[index].matrix);
+        free(set->baseline[index].samples);
+    }
+    for (index = 0; index < set->currentCount; index++)
+    {
+        free(set->current[index].matrix);
+        free(set->current[index].samples);
+    }
+    free(set->baseline);
+    free(set->current);
+    memset(set, 0, sizeof(*set));
+}
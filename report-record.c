@@ -0,0 +1,619 @@
+/*
+*  ==================================================================
+*  report-record.c for smvp-toolbox
+*  Writes machine-readable benchmark records: one JSON document and
+*  one row of the shared CSV file per algorithm run
+*  ==================================================================
+*/
+
+// Required for flock() and open_memstream()
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include "mmio/mmio.h"
+#include "libsmvp/smvp.h"
+#include "smvp-cli.h"
+
+// Build configuration, passed in by CMake
+#ifndef SMVP_BUILD_TYPE
+#define SMVP_BUILD_TYPE ""
+#endif
+#ifndef SMVP_BUILD_FLAGS
+#define SMVP_BUILD_FLAGS ""
+#endif
+
+#define RECORD_SCHEMA 1
+#define RECORD_CSV_NAME "smvp-toolbox_records.csv"
+
+// Struct: _row_stats_
+// Distribution of the non-zeros per row
+typedef struct _row_stats_
+{
+    int valid;
+    int min;
+    int max;
+    int empty;
+    double mean;
+    double stdev;
+} RowStats;
+
+// Function: rowStatsCompute
+// Gathers the row-length distribution from the CSR row pointers of either index width
+static void rowStatsCompute(const smvp_matrix_t *A, RowStats *stats)
+{
+    smvp_info_t info;
+    const int *rowPtr = NULL, *colInd;
+    const int64_t *rowPtr64 = NULL;
+    const double *val;
+    double sum = 0, sumSq = 0;
+    int row, len;
+
+    memset(stats, 0, sizeof(*stats));
+    if (A == NULL || smvp_get_info(A, &info) != SMVP_SUCCESS || info.rows <= 0 ||
+        (smvp_get_csr(A, &rowPtr, &colInd, &val) != SMVP_SUCCESS && smvp_get_csr64(A, &rowPtr64, &colInd, &val) != SMVP_SUCCESS))
+    {
+        return;
+    }
+    stats->valid = 1;
+    for (row = 0; row < info.rows; row++)
+    {
+        len = (rowPtr != NULL) ? rowPtr[row + 1] - rowPtr[row] : (int)(rowPtr64[row + 1] - rowPtr64[row]);
+        stats->min = (row == 0 || len < stats->min) ? len : stats->min;
+        stats->max = (len > stats->max) ? len : stats->max;
+        stats->empty += (len == 0);
+        sum += len;
+        sumSq += (double)len * len;
+    }
+    stats->mean = sum / info.rows;
+    stats->stdev = sqrt(fmax(sumSq / info.rows - stats->mean * stats->mean, 0));
+}
+
+// Function: compareDouble
+// qsort() comparison for ascending doubles
+static int compareDouble(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+// Function: sampleMedian
+// Median of the per-iteration times (the samples themselves are left in run order)
+static double sampleMedian(const double *samples, int n)
+{
+    double *sorted, median;
+
+    if (n <= 0 || (sorted = (double *)malloc(sizeof(double) * (long unsigned int)n)) == NULL)
+    {
+        return NAN;
+    }
+    memcpy(sorted, samples, sizeof(double) * (long unsigned int)n);
+    qsort(sorted, (size_t)n, sizeof(double), compareDouble);
+    median = (n % 2) ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    free(sorted);
+    return median;
+}
+
+// Function: readCpuModel
+// Copies the first "model name" of /proc/cpuinfo into model (empty when unavailable)
+static void readCpuModel(char *model, size_t modelLen)
+{
+    char line[256], *value;
+    FILE *cpuinfo;
+
+    model[0] = '\0';
+    if ((cpuinfo = fopen("/proc/cpuinfo", "r")) == NULL)
+    {
+        return;
+    }
+    while (fgets(line, sizeof(line), cpuinfo) != NULL)
+    {
+        if (strncmp(line, "model name", 10) == 0 && (value = strchr(line, ':')) != NULL)
+        {
+            value += strspn(value + 1, " \t") + 1;
+            value[strcspn(value, "\n")] = '\0';
+            snprintf(model, modelLen, "%s", value);
+            break;
+        }
+    }
+    fclose(cpuinfo);
+}
+
+// Function: jsonString
+// Writes s as a quoted JSON string, NULL as null
+static void jsonString(FILE *out, const char *s)
+{
+    if (s == NULL)
+    {
+        fputs("null", out);
+        return;
+    }
+    fputc('"', out);
+    for (; *s != '\0'; s++)
+    {
+        if (*s == '"' || *s == '\\')
+        {
+            fprintf(out, "\\%c", *s);
+        }
+        else if ((unsigned char)*s < 0x20)
+        {
+            fprintf(out, "\\u%04x", (unsigned int)(unsigned char)*s);
+        }
+        else
+        {
+            fputc(*s, out);
+        }
+    }
+    fputc('"', out);
+}
+
+// Function: jsonNumber
+// Writes v in its shortest round-trip form, non-finite values as null
+static void jsonNumber(FILE *out, double v)
+{
+    char digits[MM_DTOA_LEN];
+
+    if (!isfinite(v))
+    {
+        fputs("null", out);
+        return;
+    }
+    fwrite(digits, 1, (size_t)(mm_dtoa(digits, v) - digits), out);
+}
+
+// Function: csvField
+// Writes s as a CSV field, quoted only when it holds a separator, quote or line break
+static void csvField(FILE *out, const char *s)
+{
+    if (strpbrk(s, ",\"\r\n") == NULL)
+    {
+        fputs(s, out);
+        return;
+    }
+    fputc('"', out);
+    for (; *s != '\0'; s++)
+    {
+        if (*s == '"')
+        {
+            fputc('"', out);
+        }
+        fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+// Function: csvNumber
+// Writes v as a CSV field, empty when it is not finite
+static void csvNumber(FILE *out, double v)
+{
+    if (isfinite(v))
+    {
+        jsonNumber(out, v);
+    }
+}
+
+// Function: joinPath
+// Returns dir/name in a new buffer (just name when dir is empty)
+static char *joinPath(const char *dir, const char *name)
+{
+    size_t len = strlen(dir) + strlen(name) + 2;
+    char *path = (char *)malloc(len);
+
+    if (path != NULL)
+    {
+        snprintf(path, len, "%s%s%s", dir, (dir[0] != '\0' && dir[strlen(dir) - 1] != '/') ? "/" : "", name);
+    }
+    return path;
+}
+
+// Function: writeAll
+// write() loop for a whole buffer, returns 0 or -1 with errno set
+static int writeAll(int fd, const char *data, size_t len)
+{
+    ssize_t got;
+
+    while (len > 0)
+    {
+        if ((got = write(fd, data, len)) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        data += got;
+        len -= (size_t)got;
+    }
+    return 0;
+}
+
+// Function: writeJson
+// Formats the JSON document of one run
+static void writeJson(FILE *out, const RunRecord *record, const RowStats *rowStats, double median, time_t now, const char *host, const char *cpuModel)
+{
+    const struct _time_data_ *t = record->timeData;
+    struct utsname uts;
+    char stamp[32];
+    int i;
+
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    if (uname(&uts) != 0)
+    {
+        memset(&uts, 0, sizeof(uts));
+    }
+
+    fprintf(out, "{\n  \"schema\": %d,\n  \"tool\": \"smvp-toolbox\",\n  \"version\": ", RECORD_SCHEMA);
+    jsonString(out, record->version);
+    fprintf(out, ",\n  \"timestamp\": \"%s\",\n  \"unix_time\": %lld,\n", stamp, (long long)now);
+
+    fputs("  \"host\": {\"name\": ", out);
+    jsonString(out, host);
+    fputs(", \"os\": ", out);
+    jsonString(out, uts.sysname);
+    fputs(", \"kernel\": ", out);
+    jsonString(out, uts.release);
+    fputs(", \"machine\": ", out);
+    jsonString(out, uts.machine);
+    fputs(", \"cpu_model\": ", out);
+    jsonString(out, cpuModel);
+    fprintf(out, ", \"cpus_online\": %ld, \"memory_bytes\": %lld},\n", sysconf(_SC_NPROCESSORS_ONLN), (long long)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE));
+
+    fputs("  \"build\": {\"compiler\": ", out);
+#ifdef __VERSION__
+    jsonString(out, __VERSION__);
+#else
+    jsonString(out, NULL);
+#endif
+    fputs(", \"build_type\": ", out);
+    jsonString(out, SMVP_BUILD_TYPE);
+    fputs(", \"c_flags\": ", out);
+    jsonString(out, SMVP_BUILD_FLAGS);
+#ifdef SMVP_HAVE_ZSTD
+    fputs(", \"zstd\": true},\n", out);
+#else
+    fputs(", \"zstd\": false},\n", out);
+#endif
+
+    fputs("  \"matrix\": {\"file\": ", out);
+    jsonString(out, record->matrixPath);
+    fprintf(out, ", \"rows\": %d, \"cols\": %d, \"nnz\": %lld, \"row_nnz\": ", record->rows, record->cols, record->nnz);
+    if (rowStats->valid)
+    {
+        fprintf(out, "{\"min\": %d, \"max\": %d, \"mean\": ", rowStats->min, rowStats->max);
+        jsonNumber(out, rowStats->mean);
+        fputs(", \"stdev\": ", out);
+        jsonNumber(out, rowStats->stdev);
+        fprintf(out, ", \"empty_rows\": %d}},\n", rowStats->empty);
+    }
+    else
+    {
+        fputs("null},\n", out);
+    }
+
+    fputs("  \"run\": {\"algorithm\": ", out);
+    jsonString(out, record->algorithm);
+    fprintf(out, ", \"threads\": %d, \"iterations\": %d, \"backing\": ", t->threads, record->iterations);
+    jsonString(out, smvp_backing_name(t->backing));
+    fputs(", \"load_ms\": ", out);
+    jsonNumber(out, t->load_ms);
+    fputs(", \"convert_ms\": ", out);
+    jsonNumber(out, t->convert_ms);
+    fprintf(out, ", \"prefetch\": %d, \"prefetch_gain\": ", t->prefetch);
+    if (t->prefetch_gain > 0)
+    {
+        jsonNumber(out, t->prefetch_gain);
+    }
+    else
+    {
+        fputs("null", out);
+    }
+    fputs("},\n", out);
+
+    fputs("  \"time_ms\": {\"total\": ", out);
+    jsonNumber(out, t->time_total);
+    fputs(", \"avg\": ", out);
+    jsonNumber(out, t->time_avg);
+    fputs(", \"median\": ", out);
+    jsonNumber(out, median);
+    fputs(", \"min\": ", out);
+    jsonNumber(out, t->time_min);
+    fputs(", \"max\": ", out);
+    jsonNumber(out, t->time_max);
+    fputs(", \"stdev\": ", out);
+    jsonNumber(out, t->time_stdev);
+    fputs("},\n  \"samples_ms\": [", out);
+    for (i = 0; i < record->iterations; i++)
+    {
+        fputs((i == 0) ? "" : ", ", out);
+        jsonNumber(out, t->time_each[i]);
+    }
+    fputs("],\n", out);
+
+    // Counters are null when they were not captured, so consumers can tell "off" from zero
+    fputs("  \"counters\": {\"stable\": ", out);
+    if (t->stable)
+    {
+        fprintf(out, "{\"minor_faults\": %ld, \"major_faults\": %ld, \"vol_ctx_switches\": %ld, \"invol_ctx_switches\": %ld, \"migrations\": %ld}",
+                t->minor_faults, t->major_faults, t->vol_ctx_switches, t->invol_ctx_switches, t->migrations);
+    }
+    else
+    {
+        fputs("null", out);
+    }
+    fputs(", \"dtlb_load_misses\": ", out);
+    if (t->dtlb_valid)
+    {
+        fprintf(out, "%lld", t->dtlb_misses);
+    }
+    else
+    {
+        fputs("null", out);
+    }
+    fputs(", \"numa\": ", out);
+    if (t->threads > 0)
+    {
+        fprintf(out, "{\"nodes\": %d, \"placed\": %s, \"replicated\": %s, ", t->numa.nodes, t->numa.placed ? "true" : "false", t->numa.replicated ? "true" : "false");
+        if (t->numa.local_pages >= 0)
+        {
+            fprintf(out, "\"local_pages\": %ld, \"remote_pages\": %ld, ", t->numa.local_pages, t->numa.remote_pages);
+        }
+        else
+        {
+            fputs("\"local_pages\": null, \"remote_pages\": null, ", out);
+        }
+        if (t->numa_counters_valid)
+        {
+            fprintf(out, "\"local_loads\": %lld, \"remote_loads\": %lld}", t->numa_local_loads, t->numa_remote_loads);
+        }
+        else
+        {
+            fputs("\"local_loads\": null, \"remote_loads\": null}", out);
+        }
+    }
+    else
+    {
+        fputs("null", out);
+    }
+    fputs(", \"stream\": ", out);
+    if (t->stream.panels > 0)
+    {
+        fprintf(out, "{\"panels\": %d, \"direct\": %s, \"bytes_read\": %zu, \"io_seconds\": ", t->stream.panels, t->stream.direct ? "true" : "false", t->stream.bytes_read);
+        jsonNumber(out, t->stream.io_seconds);
+        fputs(", \"compute_seconds\": ", out);
+        jsonNumber(out, t->stream.compute_seconds);
+        fputs(", \"stall_seconds\": ", out);
+        jsonNumber(out, t->stream.stall_seconds);
+        fputs(", \"wall_seconds\": ", out);
+        jsonNumber(out, t->stream.wall_seconds);
+        fputs("}", out);
+    }
+    else
+    {
+        fputs("null", out);
+    }
+    fputs("}\n}\n", out);
+}
+
+// Function: writeCsvRow
+// Formats the CSV row of one run, preceded by the header line when the file is new
+static void writeCsvRow(FILE *out, int withHeader, const RunRecord *record, const RowStats *rowStats, double median, time_t now, const char *host, const char *jsonName)
+{
+    const struct _time_data_ *t = record->timeData;
+
+    if (withHeader)
+    {
+        fputs("unix_time,host,version,matrix,algorithm,rows,cols,nnz,row_nnz_min,row_nnz_max,row_nnz_mean,row_nnz_stdev,"
+              "threads,iterations,load_ms,convert_ms,total_ms,avg_ms,median_ms,min_ms,max_ms,stdev_ms,"
+              "minor_faults,major_faults,vol_ctx_switches,invol_ctx_switches,migrations,dtlb_load_misses,record\n",
+              out);
+    }
+    fprintf(out, "%lld,", (long long)now);
+    csvField(out, host);
+    fputc(',', out);
+    csvField(out, record->version);
+    fputc(',', out);
+    csvField(out, record->matrixPath);
+    fputc(',', out);
+    csvField(out, record->algorithm);
+    fprintf(out, ",%d,%d,%lld,", record->rows, record->cols, record->nnz);
+    if (rowStats->valid)
+    {
+        fprintf(out, "%d,%d,", rowStats->min, rowStats->max);
+        csvNumber(out, rowStats->mean);
+        fputc(',', out);
+        csvNumber(out, rowStats->stdev);
+    }
+    else
+    {
+        fputs(",,,", out);
+    }
+    fprintf(out, ",%d,%d,", t->threads, record->iterations);
+    csvNumber(out, t->load_ms);
+    fputc(',', out);
+    csvNumber(out, t->convert_ms);
+    fputc(',', out);
+    csvNumber(out, t->time_total);
+    fputc(',', out);
+    csvNumber(out, t->time_avg);
+    fputc(',', out);
+    csvNumber(out, median);
+    fputc(',', out);
+    csvNumber(out, t->time_min);
+    fputc(',', out);
+    csvNumber(out, t->time_max);
+    fputc(',', out);
+    csvNumber(out, t->time_stdev);
+    if (t->stable)
+    {
+        fprintf(out, ",%ld,%ld,%ld,%ld,%ld,", t->minor_faults, t->major_faults, t->vol_ctx_switches, t->invol_ctx_switches, t->migrations);
+    }
+    else
+    {
+        fputs(",,,,,,", out);
+    }
+    if (t->dtlb_valid)
+    {
+        fprintf(out, "%lld", t->dtlb_misses);
+    }
+    fputc(',', out);
+    csvField(out, jsonName);
+    fputc('\n', out);
+}
+
+// Function: publishJson
+// Writes the document to a temporary file in the report folder and renames it into place,
+// so readers only ever see complete records
+static int publishJson(const char *path, const char *doc, size_t docLen, char *error, size_t errorLen)
+{
+    char *tmpPath;
+    size_t len = strlen(path) + 8;
+    int fd;
+
+    if ((tmpPath = (char *)malloc(len)) == NULL)
+    {
+        snprintf(error, errorLen, "out of memory");
+        return -1;
+    }
+    snprintf(tmpPath, len, "%s.XXXXXX", path);
+    if ((fd = mkstemp(tmpPath)) < 0)
+    {
+        snprintf(error, errorLen, "cannot create %s: %s", tmpPath, strerror(errno));
+        free(tmpPath);
+        return -1;
+    }
+    if (fchmod(fd, 0644) != 0 || writeAll(fd, doc, docLen) != 0 || fsync(fd) != 0)
+    {
+        snprintf(error, errorLen, "writing %s: %s", tmpPath, strerror(errno));
+        close(fd);
+        unlink(tmpPath);
+        free(tmpPath);
+        return -1;
+    }
+    if (close(fd) != 0 || rename(tmpPath, path) != 0)
+    {
+        snprintf(error, errorLen, "publishing %s: %s", path, strerror(errno));
+        unlink(tmpPath);
+        free(tmpPath);
+        return -1;
+    }
+    free(tmpPath);
+    return 0;
+}
+
+// Function: appendCsv
+// Appends one row to the shared CSV file under an exclusive lock, in a single write(),
+// so rows from concurrent runs never interleave and the header is written exactly once
+static int appendCsv(const char *path, const RunRecord *record, const RowStats *rowStats, double median, time_t now, const char *host, const char *jsonName, char *error, size_t errorLen)
+{
+    struct stat st;
+    char *row = NULL;
+    size_t rowLen = 0;
+    FILE *rowStream;
+    int fd, withHeader, result = -1;
+
+    if ((fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644)) < 0)
+    {
+        snprintf(error, errorLen, "cannot open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    if (flock(fd, LOCK_EX) != 0 || fstat(fd, &st) != 0)
+    {
+        snprintf(error, errorLen, "locking %s: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    // Only known once the lock is held: whoever finds the file empty writes the header
+    withHeader = (st.st_size == 0);
+    if ((rowStream = open_memstream(&row, &rowLen)) == NULL)
+    {
+        snprintf(error, errorLen, "out of memory");
+    }
+    else
+    {
+        writeCsvRow(rowStream, withHeader, record, rowStats, median, now, host, jsonName);
+        fclose(rowStream);
+        if (writeAll(fd, row, rowLen) != 0)
+        {
+            snprintf(error, errorLen, "writing %s: %s", path, strerror(errno));
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+
+    free(row);
+    flock(fd, LOCK_UN);
+    if (close(fd) != 0 && result == 0)
+    {
+        snprintf(error, errorLen, "writing %s: %s", path, strerror(errno));
+        result = -1;
+    }
+    return result;
+}
+
+// Function: smvpWriteRunRecord
+// Writes smvp-toolbox_record_<ALG>_<time>_<pid>_<seq>.json and appends a row to
+// smvp-toolbox_records.csv in the report folder. The JSON path is returned in jsonPath,
+// returns 0 or -1 with a message in error
+int smvpWriteRunRecord(const char *reportPath, const RunRecord *record, char *jsonPath, size_t jsonPathLen, char *error, size_t errorLen)
+{
+    static int sequence = 0;
+    RowStats rowStats;
+    char host[256], cpuModel[128], jsonName[128];
+    char *doc = NULL, *path = NULL;
+    size_t docLen = 0;
+    FILE *docStream;
+    double median;
+    time_t now = time(NULL);
+    int result = -1;
+
+    if (gethostname(host, sizeof(host)) != 0)
+    {
+        host[0] = '\0';
+    }
+    host[sizeof(host) - 1] = '\0';
+    readCpuModel(cpuModel, sizeof(cpuModel));
+    rowStatsCompute(record->matrix, &rowStats);
+    median = sampleMedian(record->timeData->time_each, record->iterations);
+
+    // Time, process and sequence make the name unique across concurrent and back-to-back runs
+    snprintf(jsonName, sizeof(jsonName), "smvp-toolbox_record_%s_%lld_%ld_%d.json", record->algorithm, (long long)now, (long)getpid(), sequence++);
+    if ((path = joinPath(reportPath, jsonName)) == NULL || (docStream = open_memstream(&doc, &docLen)) == NULL)
+    {
+        snprintf(error, errorLen, "out of memory");
+        goto done;
+    }
+    writeJson(docStream, record, &rowStats, median, now, host, cpuModel);
+    fclose(docStream);
+    if (publishJson(path, doc, docLen, error, errorLen) != 0)
+    {
+        goto done;
+    }
+    snprintf(jsonPath, jsonPathLen, "%s", path);
+
+    free(path);
+    if ((path = joinPath(reportPath, RECORD_CSV_NAME)) == NULL)
+    {
+        snprintf(error, errorLen, "out of memory");
+        goto done;
+    }
+    result = appendCsv(path, record, &rowStats, median, now, host, jsonName, error, errorLen);
+
+done:
+    free(doc);
+    free(path);
+    return result;
+}
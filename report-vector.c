@@ -0,0 +1,185 @@
+/*
+*  ==================================================================
+*  report-vector.c for smvp-toolbox
+*  Writes report output vectors as text, raw doubles or NumPy .npy
+*  ==================================================================
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "mmio/mmio.h"
+#include "libsmvp/smvp.h"
+#include "smvp-cli.h"
+
+// .npy headers are padded so the data starts on this boundary (format version 1.0)
+#define NPY_ALIGN 64
+
+// Function: smvpOutputFormatName
+// Returns the --output-format spelling of an SMVP_OUTPUT_* value
+const char *smvpOutputFormatName(int format)
+{
+    switch (format)
+    {
+    case SMVP_OUTPUT_BIN:
+        return "bin";
+    case SMVP_OUTPUT_NPY:
+        return "npy";
+    default:
+        return "text";
+    }
+}
+
+// Function: storeLittleEndian
+// Copies doubles to dest in little-endian byte order (a plain copy on little-endian hosts)
+static void storeLittleEndian(unsigned char *dest, const double *y, int n)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    uint64_t bits;
+    int index, byte;
+
+    for (index = 0; index < n; index++)
+    {
+        memcpy(&bits, &y[index], sizeof(bits));
+        for (byte = 0; byte < 8; byte++)
+        {
+            *dest++ = (unsigned char)(bits >> (8 * byte));
+        }
+    }
+#else
+    memcpy(dest, y, sizeof(double) * (size_t)n);
+#endif
+}
+
+// Function: smvpWriteVectorText
+// Formats the report's vector block (one shortest round-trip value per line) into a single
+// buffer and hands it to the stream in one write, returns the bytes written or -1
+long smvpWriteVectorText(FILE *out, const double *y, int n)
+{
+    char *buffer, *cursor;
+    size_t len;
+    int index;
+
+    if ((buffer = (char *)malloc((size_t)n * (MM_DTOA_LEN + 1) + 8)) == NULL)
+    {
+        return -1;
+    }
+    cursor = buffer;
+    *cursor++ = '[';
+    *cursor++ = '\n';
+    for (index = 0; index < n; index++)
+    {
+        cursor = mm_dtoa(cursor, y[index]);
+        *cursor++ = '\n';
+    }
+    memcpy(cursor, "]\n\n", 3);
+    len = (size_t)(cursor + 3 - buffer);
+
+    // Flush the report header first so the vector leaves in one write() of its own
+    if (fflush(out) != 0 || fwrite(buffer, 1, len, out) != len || fflush(out) != 0)
+    {
+        free(buffer);
+        return -1;
+    }
+    free(buffer);
+    return (long)len;
+}
+
+// Function: smvpWriteVectorBinary
+// Writes y as n raw little-endian doubles, returns the bytes written or -1
+long smvpWriteVectorBinary(const char *path, const double *y, int n, char *error, size_t errorLen)
+{
+    unsigned char *data;
+    size_t len = sizeof(double) * (size_t)n, done = 0;
+    ssize_t got;
+    int fd;
+
+    if ((data = (unsigned char *)malloc(len + 1)) == NULL)
+    {
+        snprintf(error, errorLen, "out of memory");
+        return -1;
+    }
+    storeLittleEndian(data, y, n);
+
+    if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+    {
+        snprintf(error, errorLen, "cannot create %s: %s", path, strerror(errno));
+        free(data);
+        return -1;
+    }
+    while (done < len)
+    {
+        if ((got = write(fd, data + done, len - done)) < 0 && errno != EINTR)
+        {
+            snprintf(error, errorLen, "writing %s: %s", path, strerror(errno));
+            close(fd);
+            free(data);
+            return -1;
+        }
+        done += (got > 0) ? (size_t)got : 0;
+    }
+    free(data);
+    if (close(fd) != 0)
+    {
+        snprintf(error, errorLen, "writing %s: %s", path, strerror(errno));
+        return -1;
+    }
+    return (long)len;
+}
+
+// Function: smvpWriteVectorNpy
+// Writes y as a 1-D float64 NumPy array: the file is sized up front, mapped, and the header
+// and values are stored straight into the mapping. Returns the bytes written or -1
+long smvpWriteVectorNpy(const char *path, const double *y, int n, char *error, size_t errorLen)
+{
+    char dict[128];
+    unsigned char *map;
+    size_t headerLen, dataLen = sizeof(double) * (size_t)n, fileLen;
+    int dictLen, fd;
+
+    // Magic, version 1.0, little-endian header length, then the dict padded with spaces and a newline
+    dictLen = snprintf(dict, sizeof(dict), "{'descr': '<f8', 'fortran_order': False, 'shape': (%d,), }", n);
+    headerLen = 10 + (size_t)dictLen + 1;
+    headerLen = (headerLen + NPY_ALIGN - 1) / NPY_ALIGN * NPY_ALIGN;
+    fileLen = headerLen + dataLen;
+
+    if ((fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0)
+    {
+        snprintf(error, errorLen, "cannot create %s: %s", path, strerror(errno));
+        return -1;
+    }
+    // Reserve the blocks now: running out of space later would arrive as SIGBUS on the mapping
+    if ((errno = posix_fallocate(fd, 0, (off_t)fileLen)) != 0)
+    {
+        snprintf(error, errorLen, "sizing %s: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    if ((map = (unsigned char *)mmap(NULL, fileLen, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+    {
+        snprintf(error, errorLen, "mapping %s: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    memcpy(map, "\x93NUMPY\x01\x00", 8);
+    map[8] = (unsigned char)((headerLen - 10) & 0xff);
+    map[9] = (unsigned char)((headerLen - 10) >> 8);
+    memset(map + 10, ' ', headerLen - 10);
+    memcpy(map + 10, dict, (size_t)dictLen);
+    map[headerLen - 1] = '\n';
+    storeLittleEndian(map + headerLen, y, n);
+
+    munmap(map, fileLen);
+    if (close(fd) != 0)
+    {
+        snprintf(error, errorLen, "writing %s: %s", path, strerror(errno));
+        return -1;
+    }
+    return (long)fileLen;
+}
@@ -0,0 +1,158 @@
+/*
+*  ==================================================================
+*  smvp-cli.h for smvp-toolbox
+*  Definitions shared by the command line front end source files
+*  ==================================================================
+*/
+
+#ifndef SMVP_CLI_H
+#define SMVP_CLI_H
+
+#include <stddef.h>
+#include "mmio/mmio.h"
+#include "libsmvp/smvp.h"
+
+// ANSI terminal color escape codes for making output BEAUTIFUL
+#define ANSI_COLOR_RED "\x1b[31m"
+#define ANSI_COLOR_GREEN "\x1b[32m"
+#define ANSI_COLOR_YELLOW "\x1b[33m"
+#define ANSI_COLOR_BLUE "\x1b[34m"
+#define ANSI_COLOR_MAGENTA "\x1b[35m"
+#define ANSI_COLOR_CYAN "\x1b[36m"
+#define ANSI_COLOR_RESET "\x1b[0m"
+
+// Struct: _results_data_
+// Provides a convenient structure for storing/manipulating algorithm run results
+struct _time_data_
+{
+    double time_total;
+    double time_avg;
+    double time_stdev;
+    double time_min;
+    double time_max;
+    int stable;              // Nonzero when the counters below were captured in --stable mode
+    long minor_faults;       // Page faults serviced without I/O during the timed loop
+    long major_faults;       // Page faults requiring I/O during the timed loop
+    long vol_ctx_switches;   // Voluntary context switches during the timed loop
+    long invol_ctx_switches; // Involuntary context switches (preemptions) during the timed loop
+    long migrations;         // Number of times the compute thread was observed on a different CPU
+    int backing;             // SMVP_BACKING_* type of the matrix value array
+    int dtlb_valid;          // Nonzero when dtlb_misses was read from a hardware counter
+    long long dtlb_misses;   // dTLB load misses accumulated over all timed iterations
+    int threads;             // Pool workers the kernel ran on (0 = serial)
+    smvp_numa_t numa;        // Placement of the bound matrix (threads > 0 only)
+    int numa_counters_valid; // Nonzero when the node load counters below were read
+    long long numa_local_loads;
+    long long numa_remote_loads;
+    smvp_stream_stats_t stream; // Summed over all iterations of an out-of-core run (stream.panels > 0)
+    double load_ms;             // Parse and canonical build of the matrix (shared by every algorithm of a run)
+    double convert_ms;          // Conversion into this algorithm's format (0 when none was needed)
+    int prefetch;               // Software prefetch distance the kernel ran with (0 = plain kernel)
+    double prefetch_gain;       // Calibrated speedup of that distance over the plain kernel (0 = not calibrated)
+    double time_each[];
+};
+
+// matrix-load.c
+smvp_matrix_t *smvpLoadMatrixFile(const char *path, const smvp_options_t *opts, char *error, size_t errorLen);
+const char *smvpEntryErrorText(int retcode);
+
+// Paths starting with this are --generate specs rather than files
+#define SMVP_GENERATE_PREFIX "generate:"
+
+// matrix-generate.c
+smvp_matrix_t *smvpGenerateMatrix(const char *spec, int threads, const smvp_options_t *opts, char *error, size_t errorLen);
+
+// Compressed input formats, detected from the file's magic bytes
+#define SMVP_COMPRESS_NONE 0
+#define SMVP_COMPRESS_GZIP 1
+#define SMVP_COMPRESS_ZSTD 2
+
+// Struct: _stream_coo_
+// COO staging arrays filled by smvpStreamMatrix() and what it took to fill them
+typedef struct _stream_coo_
+{
+    MM_typecode matcode;
+    int rows;
+    int cols;
+    int nnz;
+    int *row; // 0-based
+    int *col; // 0-based
+    double *val;
+    int compression;   // SMVP_COMPRESS_*
+    int parseThreads;  // Parser threads started
+    size_t bytesIn;    // Compressed bytes read
+    size_t bytesOut;   // Text bytes produced
+    double seconds;    // Open to last entry parsed
+} StreamCoo;
+
+// Allocator for the staging arrays, so callers can hand out arena buffers
+typedef void *(*StreamAlloc)(void *ctx, size_t len);
+
+// matrix-stream.c
+int smvpDetectCompression(const char *path);
+const char *smvpCompressionName(int compression);
+int smvpDefaultParseThreads(void);
+int smvpStreamMatrix(const char *path, int compression, int parseThreads, StreamAlloc alloc, void *allocCtx, StreamCoo *coo, char *error, size_t errorLen);
+
+// matrix-panels.c
+int smvpBuildPanelFile(const char *mtxPath, const char *panelPath, size_t panelBytes, char *error, size_t errorLen);
+
+// Report output vector formats (--output-format)
+#define SMVP_OUTPUT_TEXT 0 // Inline in the report, one value per line
+#define SMVP_OUTPUT_BIN 1  // Raw little-endian doubles next to the report
+#define SMVP_OUTPUT_NPY 2  // NumPy .npy (1-D float64) next to the report
+
+// report-vector.c
+const char *smvpOutputFormatName(int format);
+long smvpWriteVectorText(FILE *out, const double *y, int n);
+long smvpWriteVectorBinary(const char *path, const double *y, int n, char *error, size_t errorLen);
+long smvpWriteVectorNpy(const char *path, const double *y, int n, char *error, size_t errorLen);
+
+// Struct: _run_record_
+// One algorithm run as written to the machine-readable benchmark records
+typedef struct _run_record_
+{
+    const char *version;   // smvp-toolbox version, "major.minor.revision"
+    const char *matrixPath;
+    const char *algorithm; // Report name of the algorithm (CSR, TJDS, CSR-OOC)
+    int rows;
+    int cols;
+    long long nnz;
+    const smvp_matrix_t *matrix; // Source of the row-length statistics (NULL when the matrix is not resident)
+    int iterations;
+    const struct _time_data_ *timeData;
+} RunRecord;
+
+// report-record.c
+int smvpWriteRunRecord(const char *reportPath, const RunRecord *record, char *jsonPath, size_t jsonPathLen, char *error, size_t errorLen);
+
+// Struct: _compare_run_
+// Per-iteration times of one run, from a baseline record or from this invocation
+typedef struct _compare_run_
+{
+    char *matrix;       // Path as recorded, runs are matched by its file name
+    char algorithm[16]; // Report name of the algorithm
+    long long unixTime; // When the baseline was recorded (the newest record per matrix and algorithm wins)
+    double *samples;    // ms
+    int count;
+    int capacity;
+} CompareRun;
+
+// Struct: _compare_set_
+// Baseline runs loaded for --compare and the runs of this invocation they are compared with
+typedef struct _compare_set_
+{
+    const char *source;
+    CompareRun *baseline;
+    int baselineCount;
+    CompareRun *current;
+    int currentCount;
+} CompareSet;
+
+// report-compare.c
+int smvpCompareLoad(const char *source, CompareSet *set, char *error, size_t errorLen);
+void smvpCompareAdd(CompareSet *set, const RunRecord *record);
+int smvpCompareReport(FILE *out, const CompareSet *set);
+void smvpCompareFree(CompareSet *set);
+
+#endif
@@ -0,0 +1,142 @@
+/*
+*   smvp-toolbox server example client
+*
+*   Asks a running server (smvp-toolkit-cli --serve <socket>) to multiply a
+*   matrix file by a ones vector, repeatedly, and prints the latency split
+*   reported by the server along with the sum of y.
+*
+*   Usage:  smvp-client <socket> <file.mtx> [csr|csc|tjds] [repeat]
+*
+*   NOTES:
+*
+*   1) The first request loads and converts the matrix, later requests (from
+*      this or any other client) are served from the cache.
+*
+*   2) x and y live in a POSIX shared memory object created here; only its
+*      name travels over the socket. See smvp-server.h for the layout.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "libsmvp/smvp.h"
+#include "smvp-server.h"
+
+static int transact(int fd, SmvpRequest *request, SmvpResponse *response)
+{
+    size_t done;
+    ssize_t got;
+
+    for (done = 0; done < sizeof(*request); done += (size_t)got)
+    {
+        if ((got = write(fd, (char *)request + done, sizeof(*request) - done)) <= 0)
+            return -1;
+    }
+    for (done = 0; done < sizeof(*response); done += (size_t)got)
+    {
+        if ((got = read(fd, (char *)response + done, sizeof(*response) - done)) <= 0)
+            return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    struct sockaddr_un address;
+    SmvpRequest *request;
+    SmvpResponse response;
+    char shmName[64];
+    double *x, *y, sum;
+    size_t shmLen;
+    void *base;
+    int fd, shmFd, i, repeat, format;
+    long long setupNs = 0, multiplyNs = 0;
+
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s <socket> <file.mtx> [csr|csc|tjds] [repeat]\n", argv[0]);
+        exit(1);
+    }
+    format = SMVP_FORMAT_CSR;
+    if (argc > 3 && strcmp(argv[3], "tjds") == 0)
+        format = SMVP_FORMAT_TJDS;
+    else if (argc > 3 && strcmp(argv[3], "csc") == 0)
+        format = SMVP_FORMAT_CSC;
+    repeat = (argc > 4) ? atoi(argv[4]) : 1;
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        exit(1);
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, argv[1], sizeof(address.sun_path) - 1);
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+
+    request = (SmvpRequest *)calloc(1, sizeof(SmvpRequest));
+    request->magic = SMVP_SERVER_MAGIC;
+    request->op = SMVP_REQ_LOAD;
+    request->format = format;
+    strncpy(request->path, argv[2], SMVP_SERVER_PATH_MAX - 1);
+    if (transact(fd, request, &response) != 0 || response.status != SMVP_SRV_OK)
+    {
+        fprintf(stderr, "load failed: %s\n", response.message);
+        exit(1);
+    }
+    printf("%s: %d x %d, %lld non-zeros (%s, setup %.3f ms)\n", argv[2], response.rows, response.cols,
+           (long long)response.nnz, response.cacheHit ? "cached" : "loaded", response.setupNs / 1e6);
+
+    // Vectors go through shared memory, never the socket
+    snprintf(shmName, sizeof(shmName), "/smvp-client-%d", (int)getpid());
+    shmLen = SMVP_SHM_SIZE(response.rows, response.cols);
+    if ((shmFd = shm_open(shmName, O_RDWR | O_CREAT | O_EXCL, 0600)) < 0 || ftruncate(shmFd, (off_t)shmLen) != 0)
+    {
+        perror("shm_open");
+        exit(1);
+    }
+    base = mmap(NULL, shmLen, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+    close(shmFd);
+    x = (double *)base;
+    y = (double *)((char *)base + SMVP_SHM_Y_OFFSET(response.cols));
+    for (i = 0; i < response.cols; i++)
+        x[i] = 1.0;
+
+    request->op = SMVP_REQ_MULTIPLY;
+    request->alpha = 1.0;
+    request->beta = 0.0;
+    strncpy(request->shmName, shmName, SMVP_SERVER_SHM_MAX - 1);
+    for (i = 0; i < repeat; i++)
+    {
+        if (transact(fd, request, &response) != 0 || response.status != SMVP_SRV_OK)
+        {
+            fprintf(stderr, "multiply failed: %s\n", response.message);
+            shm_unlink(shmName);
+            exit(1);
+        }
+        setupNs += response.setupNs;
+        multiplyNs += response.multiplyNs;
+    }
+
+    for (sum = 0, i = 0; i < response.rows; i++)
+        sum += y[i];
+    printf("%d multiplies: avg setup %.4f ms, avg multiply %.4f ms, sum(y) = %.17g\n", repeat,
+           setupNs / 1e6 / repeat, multiplyNs / 1e6 / repeat, sum);
+    printf("cache: %llu entries, %.2f MiB, %llu hits, %llu misses, %llu waits, %llu evictions\n",
+           (unsigned long long)response.cacheEntries, response.cacheBytes / (1024.0 * 1024.0),
+           (unsigned long long)response.cacheHits, (unsigned long long)response.cacheMisses,
+           (unsigned long long)response.cacheWaits, (unsigned long long)response.cacheEvictions);
+
+    munmap(base, shmLen);
+    shm_unlink(shmName);
+    close(fd);
+    free(request);
+
+    return 0;
+}
@@ -0,0 +1,776 @@
+/*
+*   smvp-toolbox distributed-memory benchmark (MPI)
+*
+*   Multiplies a Matrix Market file by a fixed vector across MPI ranks and
+*   reports, per rank, how the time of an iteration splits into compute and
+*   exposed communication.
+*
+*   Usage:  mpirun -np N smvp-mpi [-n iterations] [-p] [-v] <file.mtx>
+*
+*       -n  Timed iterations (default 100)
+*       -p  Every rank parses its own byte range of the file (default: rank 0 parses all of it)
+*       -v  Gather y on rank 0 and check it against a serial multiply of the whole matrix
+*
+*   NOTES:
+*
+*   1) Rows are partitioned into contiguous blocks of roughly equal non-zero
+*      counts. x is partitioned the same way (square matrices) or into equal
+*      column blocks, so every rank owns the x entries of its diagonal block.
+*
+*   2) Each rank keeps two CSR blocks: the columns it owns, numbered from 0,
+*      and the off-rank (halo) columns it references, compressed to 0..h-1 in
+*      owner order. An iteration posts the halo exchange, multiplies the owned
+*      block while messages are in flight, then waits and adds the halo block.
+*
+*   3) x[c] = 1 + (c % 13) / 13 rather than the CLI's ones vector, so a halo
+*      entry delivered to the wrong slot changes the result that -v checks.
+*
+*   4) Built only with -DSMVP_MPI=ON, see CMakeLists.txt.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+#include <mpi.h>
+#include "mmio/mmio.h"
+#include "libsmvp/smvp.h"
+#include "smvp-cli.h"
+
+// Struct: _dist_entry_
+// One matrix entry on its way to the rank owning its row
+typedef struct _dist_entry_
+{
+    int row;
+    int col;
+    double val;
+} DistEntry;
+
+// Struct: _dist_matrix_
+// This rank's rows, split into owned and halo column blocks, plus the halo exchange plan
+typedef struct _dist_matrix_
+{
+    int rows;            // Global dimensions
+    int cols;
+    long nnz;
+    int *rowPart;        // nranks + 1 row boundaries
+    int *colPart;        // nranks + 1 boundaries of the x blocks
+    int firstCol;        // First owned column (colPart[rank])
+    int ownCols;         // Owned columns
+    int localRows;
+    long localNnz;
+    smvp_matrix_t *own;  // localRows x ownCols
+    smvp_matrix_t *halo; // localRows x haloCols, NULL when no entry references another rank
+    int haloCols;
+    int *recvCount;      // Halo entries from each rank, stored contiguously in rank order
+    int *recvOffset;
+    int *sendCount;      // Owned x entries each rank needs from us
+    int *sendOffset;
+    int *sendIndex;      // Local (0-based within the owned block) x indices to pack
+    int neighbors;       // Ranks we receive from
+} DistMatrix;
+
+// Struct: _rank_stats_
+// Per-rank results gathered on rank 0, all doubles so one MPI_Gather carries them
+typedef struct _rank_stats_
+{
+    double rows;
+    double nnz;
+    double haloCols;
+    double neighbors;
+    double sendBytes; // Per iteration
+    double loadMs;    // Parse, redistribution and local CSR build
+    double computeMs; // Per iteration, both blocks
+    double commMs;    // Per iteration, exposed: posting, packing and waiting
+    double iterMs;    // Per iteration
+} RankStats;
+
+static int mpiRank, mpiSize;
+
+// Function: mpiFail
+// Prints an error for this rank and takes every rank down with it
+static void mpiFail(const char *message)
+{
+    printf(ANSI_COLOR_RED "[ERROR]\tRank %d: %s.\n" ANSI_COLOR_RESET, mpiRank, message);
+    fflush(stdout);
+    MPI_Abort(MPI_COMM_WORLD, 1);
+}
+
+// Function: xValue
+// Entry c of the operand vector
+static double xValue(int c)
+{
+    return 1.0 + (double)(c % 13) / 13.0;
+}
+
+// Function: readHeader
+// Rank 0 reads the banner and size line and shares them with every rank
+// header[] = rows, cols, nnz, pattern, data offset, file length
+static void readHeader(const char *path, long header[6])
+{
+    FILE *mmInputFile;
+    MM_typecode matcode;
+    int rows, cols, nnz, status;
+
+    if (mpiRank == 0)
+    {
+        if ((mmInputFile = fopen(path, "r")) == NULL)
+        {
+            mpiFail("specified input file not found");
+        }
+        if (mm_read_banner(mmInputFile, &matcode) != 0 || mm_is_sparse(matcode) == 0)
+        {
+            mpiFail("input file is not a sparse Matrix Market file");
+        }
+        if ((status = mm_read_mtx_crd_size(mmInputFile, &rows, &cols, &nnz)) != 0)
+        {
+            mpiFail((status == MM_TOO_LARGE) ? "more than INT_MAX entries, beyond what smvp-mpi supports" : "size line missing or malformed");
+        }
+        header[0] = rows;
+        header[1] = cols;
+        header[2] = nnz;
+        header[3] = (mm_is_pattern(matcode) != 0);
+        header[4] = ftell(mmInputFile);
+        fseek(mmInputFile, 0, SEEK_END);
+        header[5] = ftell(mmInputFile);
+        fclose(mmInputFile);
+    }
+    MPI_Bcast(header, 6, MPI_LONG, 0, MPI_COMM_WORLD);
+}
+
+// Function: parseRange
+// Parses every entry line that starts in [start, end) of the file into a new array
+static DistEntry *parseRange(const char *path, const long header[6], long start, long end, int *count)
+{
+    FILE *mmInputFile;
+    DistEntry *entries = NULL;
+    char line[1024], message[160];
+    int capacity = 0, fields;
+    long lineStart;
+
+    *count = 0;
+    if (start >= end)
+    {
+        return NULL;
+    }
+    if ((mmInputFile = fopen(path, "r")) == NULL)
+    {
+        mpiFail("specified input file not found");
+    }
+
+    // A line belongs to the rank its first byte falls to, finish the one straddling start
+    fseek(mmInputFile, start - 1, SEEK_SET);
+    if (start == header[4] || fgets(line, sizeof(line), mmInputFile) == NULL)
+    {
+        fseek(mmInputFile, start, SEEK_SET);
+    }
+
+    while ((lineStart = ftell(mmInputFile)) < end && fgets(line, sizeof(line), mmInputFile) != NULL)
+    {
+        if (strspn(line, " \t\r\n") == strlen(line))
+        {
+            continue;
+        }
+        if (*count == capacity)
+        {
+            capacity = (capacity > 0) ? capacity * 2 : 4096;
+            if ((entries = (DistEntry *)realloc(entries, sizeof(DistEntry) * (long unsigned int)capacity)) == NULL)
+            {
+                mpiFail("out of memory staging entries");
+            }
+        }
+        if (header[3])
+        {
+            fields = sscanf(line, "%d %d", &entries[*count].row, &entries[*count].col);
+            entries[*count].val = 1;
+            fields = (fields == 2) ? 3 : fields;
+        }
+        else
+        {
+            fields = sscanf(line, "%d %d %lg", &entries[*count].row, &entries[*count].col, &entries[*count].val);
+        }
+        entries[*count].row--;
+        entries[*count].col--;
+        if (fields != 3 || entries[*count].row < 0 || entries[*count].row >= header[0] || entries[*count].col < 0 || entries[*count].col >= header[1])
+        {
+            snprintf(message, sizeof(message), "malformed or out of range entry at byte %ld", lineStart);
+            mpiFail(message);
+        }
+        (*count)++;
+    }
+
+    fclose(mmInputFile);
+    return entries;
+}
+
+// Function: partitionRows
+// Splits the rows into nranks contiguous blocks of about nnz / nranks entries each
+static void partitionRows(const int *rowCount, int rows, long nnz, int *part)
+{
+    long prefix = 0;
+    int rank = 1, row;
+
+    part[0] = 0;
+    for (row = 0; row < rows && rank < mpiSize; row++)
+    {
+        prefix += rowCount[row];
+        while (rank < mpiSize && prefix >= (nnz * rank) / mpiSize)
+        {
+            part[rank++] = row + 1;
+        }
+    }
+    while (rank <= mpiSize)
+    {
+        part[rank++] = rows;
+    }
+}
+
+// Function: findOwner
+// Rank whose block [part[r], part[r + 1]) holds index
+static int findOwner(const int *part, int index)
+{
+    int low = 0, high = mpiSize - 1, mid;
+
+    while (low < high)
+    {
+        mid = (low + high + 1) / 2;
+        if (part[mid] <= index)
+        {
+            low = mid;
+        }
+        else
+        {
+            high = mid - 1;
+        }
+    }
+    return low;
+}
+
+// Function: compareInt
+// qsort() comparator for ints
+static int compareInt(const void *a, const void *b)
+{
+    int left = *(const int *)a, right = *(const int *)b;
+
+    return (left > right) - (left < right);
+}
+
+// Function: distributeEntries
+// Parses the file (on rank 0 or on every rank), partitions the rows by non-zeros and sends each entry to its row's owner
+static DistEntry *distributeEntries(const char *path, int parallelRead, DistMatrix *D, int *localCount)
+{
+    MPI_Datatype entryType;
+    DistEntry *parsed, *sendBuf, *received;
+    long header[6], span, start, end, parsedTotal, parsedCount;
+    int *rowCount, *sendCount, *sendOffset, *recvCount, *recvOffset, *cursor;
+    int count, index, rank, owner;
+
+    readHeader(path, header);
+    D->rows = (int)header[0];
+    D->cols = (int)header[1];
+    D->nnz = header[2];
+
+    // 1. Parse: by byte ranges on every rank, or the whole data section on rank 0
+    span = header[5] - header[4];
+    if (parallelRead)
+    {
+        start = header[4] + span * mpiRank / mpiSize;
+        end = header[4] + span * (mpiRank + 1) / mpiSize;
+    }
+    else
+    {
+        start = (mpiRank == 0) ? header[4] : header[5];
+        end = header[5];
+    }
+    parsed = parseRange(path, header, start, end, &count);
+    parsedCount = count;
+    MPI_Allreduce(&parsedCount, &parsedTotal, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (parsedTotal != D->nnz)
+    {
+        mpiFail("entry count does not match the size line");
+    }
+
+    // 2. Every rank learns the global row lengths and derives the same partition
+    rowCount = (int *)calloc((long unsigned int)D->rows + 1, sizeof(int));
+    D->rowPart = (int *)malloc(sizeof(int) * ((long unsigned int)mpiSize + 1));
+    D->colPart = (int *)malloc(sizeof(int) * ((long unsigned int)mpiSize + 1));
+    if (rowCount == NULL || D->rowPart == NULL || D->colPart == NULL)
+    {
+        mpiFail("out of memory partitioning rows");
+    }
+    for (index = 0; index < count; index++)
+    {
+        rowCount[parsed[index].row]++;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, rowCount, D->rows, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    partitionRows(rowCount, D->rows, D->nnz, D->rowPart);
+    free(rowCount);
+    for (rank = 0; rank <= mpiSize; rank++)
+    {
+        D->colPart[rank] = (D->rows == D->cols) ? D->rowPart[rank] : (int)((long)D->cols * rank / mpiSize);
+    }
+
+    // 3. Bucket the parsed entries by owner and exchange them
+    sendCount = (int *)calloc((long unsigned int)mpiSize, sizeof(int));
+    sendOffset = (int *)calloc((long unsigned int)mpiSize, sizeof(int));
+    recvCount = (int *)calloc((long unsigned int)mpiSize, sizeof(int));
+    recvOffset = (int *)calloc((long unsigned int)mpiSize, sizeof(int));
+    cursor = (int *)calloc((long unsigned int)mpiSize, sizeof(int));
+    sendBuf = (DistEntry *)malloc(sizeof(DistEntry) * ((long unsigned int)count + 1));
+    if (sendCount == NULL || sendOffset == NULL || recvCount == NULL || recvOffset == NULL || cursor == NULL || sendBuf == NULL)
+    {
+        mpiFail("out of memory redistributing entries");
+    }
+    for (index = 0; index < count; index++)
+    {
+        sendCount[findOwner(D->rowPart, parsed[index].row)]++;
+    }
+    for (rank = 1; rank < mpiSize; rank++)
+    {
+        sendOffset[rank] = sendOffset[rank - 1] + sendCount[rank - 1];
+    }
+    memcpy(cursor, sendOffset, sizeof(int) * (long unsigned int)mpiSize);
+    for (index = 0; index < count; index++)
+    {
+        owner = findOwner(D->rowPart, parsed[index].row);
+        sendBuf[cursor[owner]++] = parsed[index];
+    }
+    free(parsed);
+
+    MPI_Alltoall(sendCount, 1, MPI_INT, recvCount, 1, MPI_INT, MPI_COMM_WORLD);
+    *localCount = 0;
+    for (rank = 0; rank < mpiSize; rank++)
+    {
+        recvOffset[rank] = *localCount;
+        *localCount += recvCount[rank];
+    }
+    if ((received = (DistEntry *)malloc(sizeof(DistEntry) * ((long unsigned int)*localCount + 1))) == NULL)
+    {
+        mpiFail("out of memory receiving entries");
+    }
+    MPI_Type_contiguous((int)sizeof(DistEntry), MPI_BYTE, &entryType);
+    MPI_Type_commit(&entryType);
+    MPI_Alltoallv(sendBuf, sendCount, sendOffset, entryType, received, recvCount, recvOffset, entryType, MPI_COMM_WORLD);
+    MPI_Type_free(&entryType);
+
+    free(sendBuf);
+    free(sendCount);
+    free(sendOffset);
+    free(recvCount);
+    free(recvOffset);
+    free(cursor);
+    return received;
+}
+
+// Function: buildLocal
+// Builds the owned and halo CSR blocks of this rank's rows and agrees on who sends which x entries to whom
+static void buildLocal(DistEntry *entries, int count, DistMatrix *D)
+{
+    smvp_matrix_t *full;
+    const int *rowPtr, *colInd;
+    const double *val;
+    int *row, *col, *ownPtr, *ownInd, *haloPtr, *haloInd, *haloGlobal, *sendGlobal;
+    double *ownVal, *haloVal;
+    int index, j, ownNnz, haloNnz, unique, rank, firstRow, sendTotal;
+    int *found;
+
+    firstRow = D->rowPart[mpiRank];
+    D->localRows = D->rowPart[mpiRank + 1] - firstRow;
+    D->firstCol = D->colPart[mpiRank];
+    D->ownCols = D->colPart[mpiRank + 1] - D->firstCol;
+    D->localNnz = count;
+
+    // 1. Sort this rank's entries into CSR over global column numbers
+    row = (int *)malloc(sizeof(int) * ((long unsigned int)count + 1));
+    col = (int *)malloc(sizeof(int) * ((long unsigned int)count + 1));
+    ownVal = (double *)malloc(sizeof(double) * ((long unsigned int)count + 1));
+    if (row == NULL || col == NULL || ownVal == NULL)
+    {
+        mpiFail("out of memory building local rows");
+    }
+    for (index = 0; index < count; index++)
+    {
+        row[index] = entries[index].row - firstRow;
+        col[index] = entries[index].col;
+        ownVal[index] = entries[index].val;
+    }
+    if (smvp_create_coo(&full, D->localRows, D->cols, count, row, col, ownVal, NULL) != SMVP_SUCCESS)
+    {
+        mpiFail("unable to build local rows");
+    }
+    free(row);
+    free(col);
+    free(ownVal);
+    smvp_get_csr(full, &rowPtr, &colInd, &val);
+
+    // 2. Off-rank columns, sorted and de-duplicated; sorted order is also owner order
+    haloGlobal = (int *)malloc(sizeof(int) * ((long unsigned int)count + 1));
+    for (unique = 0, index = 0; index < count; index++)
+    {
+        if (colInd[index] < D->firstCol || colInd[index] >= D->firstCol + D->ownCols)
+        {
+            haloGlobal[unique++] = colInd[index];
+        }
+    }
+    haloNnz = unique;
+    qsort(haloGlobal, (size_t)unique, sizeof(int), compareInt);
+    for (D->haloCols = 0, index = 0; index < unique; index++)
+    {
+        if (D->haloCols == 0 || haloGlobal[index] != haloGlobal[D->haloCols - 1])
+        {
+            haloGlobal[D->haloCols++] = haloGlobal[index];
+        }
+    }
+
+    // 3. Split the rows into the owned block (local column numbers) and the halo block (compressed numbers)
+    ownNnz = count - haloNnz;
+    ownPtr = (int *)malloc(sizeof(int) * ((long unsigned int)D->localRows + 1));
+    ownInd = (int *)malloc(sizeof(int) * ((long unsigned int)ownNnz + 1));
+    ownVal = (double *)malloc(sizeof(double) * ((long unsigned int)ownNnz + 1));
+    haloPtr = (int *)malloc(sizeof(int) * ((long unsigned int)D->localRows + 1));
+    haloInd = (int *)malloc(sizeof(int) * ((long unsigned int)haloNnz + 1));
+    haloVal = (double *)malloc(sizeof(double) * ((long unsigned int)haloNnz + 1));
+    if (haloGlobal == NULL || ownPtr == NULL || ownInd == NULL || ownVal == NULL || haloPtr == NULL || haloInd == NULL || haloVal == NULL)
+    {
+        mpiFail("out of memory splitting local rows");
+    }
+    ownPtr[0] = 0;
+    haloPtr[0] = 0;
+    for (ownNnz = 0, haloNnz = 0, index = 0; index < D->localRows; index++)
+    {
+        for (j = rowPtr[index]; j < rowPtr[index + 1]; j++)
+        {
+            if (colInd[j] >= D->firstCol && colInd[j] < D->firstCol + D->ownCols)
+            {
+                ownInd[ownNnz] = colInd[j] - D->firstCol;
+                ownVal[ownNnz++] = val[j];
+            }
+            else
+            {
+                found = (int *)bsearch(&colInd[j], haloGlobal, (size_t)D->haloCols, sizeof(int), compareInt);
+                haloInd[haloNnz] = (int)(found - haloGlobal);
+                haloVal[haloNnz++] = val[j];
+            }
+        }
+        ownPtr[index + 1] = ownNnz;
+        haloPtr[index + 1] = haloNnz;
+    }
+    smvp_destroy(full);
+
+    D->halo = NULL;
+    if (smvp_create_csr(&D->own, D->localRows, D->ownCols, ownPtr, ownInd, ownVal, NULL) != SMVP_SUCCESS ||
+        (haloNnz > 0 && smvp_create_csr(&D->halo, D->localRows, D->haloCols, haloPtr, haloInd, haloVal, NULL) != SMVP_SUCCESS))
+    {
+        mpiFail("unable to build owned/halo blocks");
+    }
+    free(ownPtr);
+    free(ownInd);
+    free(ownVal);
+    free(haloPtr);
+    free(haloInd);
+    free(haloVal);
+
+    // 4. Tell every owner which of its x entries we need, it keeps the list as its send plan
+    D->recvCount = (int *)calloc((long unsigned int)mpiSize, sizeof(int));
+    D->recvOffset = (int *)calloc((long unsigned int)mpiSize, sizeof(int));
+    D->sendCount = (int *)calloc((long unsigned int)mpiSize, sizeof(int));
+    D->sendOffset = (int *)calloc((long unsigned int)mpiSize, sizeof(int));
+    if (D->recvCount == NULL || D->recvOffset == NULL || D->sendCount == NULL || D->sendOffset == NULL)
+    {
+        mpiFail("out of memory planning the halo exchange");
+    }
+    for (index = 0; index < D->haloCols; index++)
+    {
+        D->recvCount[findOwner(D->colPart, haloGlobal[index])]++;
+    }
+    D->neighbors = 0;
+    for (rank = 0; rank < mpiSize; rank++)
+    {
+        D->recvOffset[rank] = (rank > 0) ? D->recvOffset[rank - 1] + D->recvCount[rank - 1] : 0;
+        D->neighbors += (D->recvCount[rank] > 0);
+    }
+    MPI_Alltoall(D->recvCount, 1, MPI_INT, D->sendCount, 1, MPI_INT, MPI_COMM_WORLD);
+    for (sendTotal = 0, rank = 0; rank < mpiSize; rank++)
+    {
+        D->sendOffset[rank] = sendTotal;
+        sendTotal += D->sendCount[rank];
+    }
+    sendGlobal = (int *)malloc(sizeof(int) * ((long unsigned int)sendTotal + 1));
+    D->sendIndex = (int *)malloc(sizeof(int) * ((long unsigned int)sendTotal + 1));
+    if (sendGlobal == NULL || D->sendIndex == NULL)
+    {
+        mpiFail("out of memory planning the halo exchange");
+    }
+    MPI_Alltoallv(haloGlobal, D->recvCount, D->recvOffset, MPI_INT, sendGlobal, D->sendCount, D->sendOffset, MPI_INT, MPI_COMM_WORLD);
+    for (index = 0; index < sendTotal; index++)
+    {
+        D->sendIndex[index] = sendGlobal[index] - D->firstCol;
+    }
+    free(sendGlobal);
+    free(haloGlobal);
+}
+
+// Function: distMultiply
+// y = A*x for this rank's rows: the owned block is multiplied while the halo exchange is in flight
+static void distMultiply(const DistMatrix *D, const double *xOwn, double *xHalo, double *sendBuf, double *y, MPI_Request *requests, double *computeSec, double *commSec)
+{
+    double mark;
+    int rank, pending = 0, index;
+
+    mark = MPI_Wtime();
+    for (rank = 0; rank < mpiSize; rank++)
+    {
+        if (D->recvCount[rank] > 0)
+        {
+            MPI_Irecv(xHalo + D->recvOffset[rank], D->recvCount[rank], MPI_DOUBLE, rank, 0, MPI_COMM_WORLD, &requests[pending++]);
+        }
+    }
+    for (rank = 0; rank < mpiSize; rank++)
+    {
+        if (D->sendCount[rank] > 0)
+        {
+            for (index = D->sendOffset[rank]; index < D->sendOffset[rank] + D->sendCount[rank]; index++)
+            {
+                sendBuf[index] = xOwn[D->sendIndex[index]];
+            }
+            MPI_Isend(sendBuf + D->sendOffset[rank], D->sendCount[rank], MPI_DOUBLE, rank, 0, MPI_COMM_WORLD, &requests[pending++]);
+        }
+    }
+    *commSec += MPI_Wtime() - mark;
+
+    // Purely local part, overlapping the exchange
+    mark = MPI_Wtime();
+    smvp_multiply(D->own, SMVP_FORMAT_CSR, 1.0, xOwn, 0.0, y);
+    *computeSec += MPI_Wtime() - mark;
+
+    mark = MPI_Wtime();
+    MPI_Waitall(pending, requests, MPI_STATUSES_IGNORE);
+    *commSec += MPI_Wtime() - mark;
+
+    mark = MPI_Wtime();
+    if (D->halo != NULL)
+    {
+        smvp_multiply(D->halo, SMVP_FORMAT_CSR, 1.0, xHalo, 1.0, y);
+    }
+    *computeSec += MPI_Wtime() - mark;
+}
+
+// Function: verifyResult
+// Gathers y on rank 0 and compares it against a serial multiply of the whole matrix
+static int verifyResult(const char *path, const DistMatrix *D, const double *y)
+{
+    smvp_matrix_t *A;
+    double *yAll = NULL, *yRef, *x, err, maxErr = 0;
+    int *counts = NULL, *offsets = NULL, rank, index, ok = 1;
+    char error[128];
+
+    if (mpiRank == 0)
+    {
+        yAll = (double *)malloc(sizeof(double) * ((long unsigned int)D->rows + 1));
+        counts = (int *)malloc(sizeof(int) * (long unsigned int)mpiSize);
+        offsets = (int *)malloc(sizeof(int) * (long unsigned int)mpiSize);
+        for (rank = 0; rank < mpiSize; rank++)
+        {
+            offsets[rank] = D->rowPart[rank];
+            counts[rank] = D->rowPart[rank + 1] - D->rowPart[rank];
+        }
+    }
+    MPI_Gatherv(y, D->localRows, MPI_DOUBLE, yAll, counts, offsets, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    if (mpiRank != 0)
+    {
+        return 1;
+    }
+
+    if ((A = smvpLoadMatrixFile(path, NULL, error, sizeof(error))) == NULL)
+    {
+        mpiFail(error);
+    }
+    x = (double *)malloc(sizeof(double) * ((long unsigned int)D->cols + 1));
+    yRef = (double *)malloc(sizeof(double) * ((long unsigned int)D->rows + 1));
+    for (index = 0; index < D->cols; index++)
+    {
+        x[index] = xValue(index);
+    }
+    smvp_multiply(A, SMVP_FORMAT_CSR, 1.0, x, 0.0, yRef);
+
+    // Owned and halo sums are added in a different order than the serial kernel, so compare with a tolerance
+    for (index = 0; index < D->rows; index++)
+    {
+        err = fabs(yAll[index] - yRef[index]) / ((fabs(yRef[index]) > 1.0) ? fabs(yRef[index]) : 1.0);
+        maxErr = (err > maxErr) ? err : maxErr;
+    }
+    ok = (maxErr <= 1e-12);
+    printf(ANSI_COLOR_CYAN "[DATA]\tVerification against serial CSR: " ANSI_COLOR_RESET "%s (max relative error %g)\n", ok ? "passed" : "FAILED", maxErr);
+
+    smvp_destroy(A);
+    free(x);
+    free(yRef);
+    free(yAll);
+    free(counts);
+    free(offsets);
+    return ok;
+}
+
+// Function: printRankTable
+// Displays the per-rank split of an iteration into compute and exposed communication
+static void printRankTable(const RankStats *stats, int iterations)
+{
+    double slowest = 0, nnzMax = 0, nnzSum = 0, commSum = 0, iterSum = 0;
+    int rank;
+
+    printf(ANSI_COLOR_CYAN "[DATA]\tPer-rank times, averaged over %d iterations:\n" ANSI_COLOR_RESET, iterations);
+    printf("\t%5s %10s %12s %9s %5s %11s %10s %12s %10s %10s\n", "rank", "rows", "nnz", "halo", "nbrs", "sent KiB", "load ms", "compute ms", "comm ms", "iter ms");
+    for (rank = 0; rank < mpiSize; rank++)
+    {
+        printf("\t%5d %10.0f %12.0f %9.0f %5.0f %11.2f %10.2f %12.4f %10.4f %10.4f\n", rank, stats[rank].rows, stats[rank].nnz, stats[rank].haloCols,
+               stats[rank].neighbors, stats[rank].sendBytes / 1024, stats[rank].loadMs, stats[rank].computeMs, stats[rank].commMs, stats[rank].iterMs);
+        slowest = (stats[rank].iterMs > slowest) ? stats[rank].iterMs : slowest;
+        nnzMax = (stats[rank].nnz > nnzMax) ? stats[rank].nnz : nnzMax;
+        nnzSum += stats[rank].nnz;
+        commSum += stats[rank].commMs;
+        iterSum += stats[rank].iterMs;
+    }
+    printf(ANSI_COLOR_CYAN "[DATA]\tSlowest rank iteration: " ANSI_COLOR_RESET "%g ms\n", slowest);
+    printf(ANSI_COLOR_CYAN "[DATA]\tNon-zero imbalance (max/mean): " ANSI_COLOR_RESET "%.3f\n", (nnzSum > 0) ? nnzMax * mpiSize / nnzSum : 1.0);
+    printf(ANSI_COLOR_CYAN "[DATA]\tExposed communication share: " ANSI_COLOR_RESET "%.1f%%\n", (iterSum > 0) ? 100.0 * commSum / iterSum : 0.0);
+}
+
+int main(int argc, char *argv[])
+{
+    DistMatrix D;
+    DistEntry *entries;
+    RankStats mine, *stats = NULL;
+    MPI_Request *requests;
+    double *xOwn, *xHalo, *sendBuf, *y, mark, computeSec = 0, commSec = 0, iterSec;
+    int option, iterations = 100, parallelRead = 0, verify = 0, localCount, index, ok = 1;
+    const char *path;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &mpiRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &mpiSize);
+
+    while ((option = getopt(argc, argv, "n:pv")) != -1)
+    {
+        switch (option)
+        {
+        case 'n':
+            iterations = atoi(optarg);
+            break;
+        case 'p':
+            parallelRead = 1;
+            break;
+        case 'v':
+            verify = 1;
+            break;
+        default:
+            iterations = 0;
+        }
+    }
+    if (optind != argc - 1 || iterations < 1)
+    {
+        if (mpiRank == 0)
+        {
+            fprintf(stderr, "Usage: mpirun -np N %s [-n iterations] [-p] [-v] <file.mtx>\n", argv[0]);
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+    path = argv[optind];
+    memset(&D, 0, sizeof(D));
+
+    if (mpiRank == 0)
+    {
+        printf(ANSI_COLOR_GREEN "\n[START]\tExecuting smvp-mpi on %d ranks\n" ANSI_COLOR_RESET, mpiSize);
+        printf(ANSI_COLOR_MAGENTA "[FILE]\tInput matrix file name: " ANSI_COLOR_RESET "%s\n", path);
+        printf(ANSI_COLOR_YELLOW "[INFO]\tLoading matrix content (%s).\n" ANSI_COLOR_RESET, parallelRead ? "every rank parses a byte range" : "rank 0 parses, entries are scattered by row");
+    }
+
+    // Load: parse, partition by non-zeros, redistribute, split into owned and halo blocks
+    MPI_Barrier(MPI_COMM_WORLD);
+    mark = MPI_Wtime();
+    entries = distributeEntries(path, parallelRead, &D, &localCount);
+    buildLocal(entries, localCount, &D);
+    free(entries);
+    mine.loadMs = (MPI_Wtime() - mark) * 1e3;
+
+    xOwn = (double *)malloc(sizeof(double) * ((long unsigned int)D.ownCols + 1));
+    xHalo = (double *)malloc(sizeof(double) * ((long unsigned int)D.haloCols + 1));
+    sendBuf = (double *)malloc(sizeof(double) * ((long unsigned int)D.sendOffset[mpiSize - 1] + D.sendCount[mpiSize - 1] + 1));
+    y = (double *)malloc(sizeof(double) * ((long unsigned int)D.localRows + 1));
+    requests = (MPI_Request *)malloc(sizeof(MPI_Request) * 2 * (long unsigned int)mpiSize);
+    if (xOwn == NULL || xHalo == NULL || sendBuf == NULL || y == NULL || requests == NULL)
+    {
+        mpiFail("out of memory allocating vectors");
+    }
+    for (index = 0; index < D.ownCols; index++)
+    {
+        xOwn[index] = xValue(D.firstCol + index);
+    }
+
+    if (mpiRank == 0)
+    {
+        printf(ANSI_COLOR_CYAN "[DATA]\tNon-zero numbers contained in matrix: " ANSI_COLOR_RESET "%ld\n", D.nnz);
+        printf(ANSI_COLOR_YELLOW "[INFO]\tCalculating %d iterations of distributed SMVP CSR.\n" ANSI_COLOR_RESET, iterations);
+    }
+
+    // One untimed iteration settles the message paths, then every rank starts the timed loop together
+    distMultiply(&D, xOwn, xHalo, sendBuf, y, requests, &computeSec, &commSec);
+    computeSec = 0;
+    commSec = 0;
+    MPI_Barrier(MPI_COMM_WORLD);
+    mark = MPI_Wtime();
+    for (index = 0; index < iterations; index++)
+    {
+        distMultiply(&D, xOwn, xHalo, sendBuf, y, requests, &computeSec, &commSec);
+    }
+    iterSec = MPI_Wtime() - mark;
+
+    mine.rows = D.localRows;
+    mine.nnz = (double)D.localNnz;
+    mine.haloCols = D.haloCols;
+    mine.neighbors = D.neighbors;
+    mine.sendBytes = sizeof(double) * (double)(D.sendOffset[mpiSize - 1] + D.sendCount[mpiSize - 1]);
+    mine.computeMs = computeSec * 1e3 / iterations;
+    mine.commMs = commSec * 1e3 / iterations;
+    mine.iterMs = iterSec * 1e3 / iterations;
+    if (mpiRank == 0)
+    {
+        stats = (RankStats *)malloc(sizeof(RankStats) * (long unsigned int)mpiSize);
+    }
+    MPI_Gather(&mine, (int)(sizeof(RankStats) / sizeof(double)), MPI_DOUBLE, stats, (int)(sizeof(RankStats) / sizeof(double)), MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    if (mpiRank == 0)
+    {
+        printRankTable(stats, iterations);
+        free(stats);
+    }
+
+    if (verify)
+    {
+        ok = verifyResult(path, &D, y);
+    }
+    MPI_Bcast(&ok, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    smvp_destroy(D.own);
+    smvp_destroy(D.halo);
+    free(D.rowPart);
+    free(D.colPart);
+    free(D.recvCount);
+    free(D.recvOffset);
+    free(D.sendCount);
+    free(D.sendOffset);
+    free(D.sendIndex);
+    free(xOwn);
+    free(xHalo);
+    free(sendBuf);
+    free(y);
+    free(requests);
+
+    if (mpiRank == 0)
+    {
+        printf(ANSI_COLOR_GREEN "[STOP]\tExit smvp-mpi\n\n" ANSI_COLOR_RESET);
+    }
+    MPI_Finalize();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,789 @@
+/*
+*  ==================================================================
+*  smvp-server.c for smvp-toolbox
+*  Persistent SMVP server with a memory-bounded matrix cache
+*  ==================================================================
+*/
+
+// Required for struct stat st_mtim and MSG_NOSIGNAL
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "libsmvp/smvp.h"
+#include "smvp-cli.h"
+#include "smvp-server.h"
+
+// Struct: _cache_entry_
+// A converted matrix and the identity of the file it came from
+typedef struct _cache_entry_
+{
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    smvp_matrix_t *matrix;
+    smvp_info_t info;
+    pthread_rwlock_t lock; // Readers multiply, the writer runs smvp_analyze()
+    int ready;             // Load finished (successfully or not)
+    int failed;
+    int linked; // Still reachable through the LRU list
+    int refs;   // Requests currently using the entry
+    size_t bytes;
+    char error[128];
+    struct _cache_entry_ *prev; // Towards most recently used
+    struct _cache_entry_ *next; // Towards least recently used
+} CacheEntry;
+
+// Struct: _matrix_cache_
+// LRU list of converted matrices bounded by total handle bytes
+typedef struct _matrix_cache_
+{
+    pthread_mutex_t lock;
+    pthread_cond_t loaded;
+    CacheEntry *head;
+    CacheEntry *tail;
+    size_t bytes;
+    size_t limit;
+    const smvp_options_t *options; // Handle options of every loaded matrix
+    uint64_t entries;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t waits; // Lookups that found the entry still loading, counted apart from hits
+    uint64_t evictions;
+} MatrixCache;
+
+// Struct: _conn_queue_
+// Accepted connections waiting for a worker
+typedef struct _conn_queue_
+{
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    pthread_cond_t space; // Signaled whenever a worker takes a connection off a full queue
+    int *fds;
+    int capacity;
+    int head;
+    int count;
+    int *active; // Connection each worker is serving (-1 = idle), shut down on exit
+    int stopping;
+} ConnQueue;
+
+// Struct: _server_state_
+// Everything a worker thread needs
+typedef struct _server_state_
+{
+    MatrixCache cache;
+    ConnQueue queue;
+    int listenFd;
+    int workers;
+} ServerState;
+
+// Struct: _worker_arg_
+// Per-thread argument for serverWorker()
+typedef struct _worker_arg_
+{
+    ServerState *server;
+    int id;
+} WorkerArg;
+
+// Struct: _shm_mapping_
+// Shared memory vectors mapped for a connection, reused while the name stays the same
+typedef struct _shm_mapping_
+{
+    char name[SMVP_SERVER_SHM_MAX];
+    void *base;
+    size_t len;
+} ShmMapping;
+
+static volatile sig_atomic_t serverStopSignal = 0;
+
+// Function: serverSignalHandler
+// Requests an orderly shutdown on SIGINT/SIGTERM
+static void serverSignalHandler(int signum)
+{
+    (void)signum;
+    serverStopSignal = 1;
+}
+
+// Function: elapsedNs
+// Nanoseconds between two CLOCK_MONOTONIC_RAW captures
+static int64_t elapsedNs(struct timespec *start, struct timespec *end)
+{
+    return (int64_t)(end->tv_sec - start->tv_sec) * 1000000000LL + (end->tv_nsec - start->tv_nsec);
+}
+
+// Function: cacheUnlink
+// Removes an entry from the LRU list (cache lock held)
+static void cacheUnlink(MatrixCache *cache, CacheEntry *entry)
+{
+    if (!entry->linked)
+        return;
+    if (entry->prev)
+        entry->prev->next = entry->next;
+    else
+        cache->head = entry->next;
+    if (entry->next)
+        entry->next->prev = entry->prev;
+    else
+        cache->tail = entry->prev;
+    entry->prev = entry->next = NULL;
+    entry->linked = 0;
+    cache->bytes -= entry->bytes;
+    cache->entries--;
+}
+
+// Function: cachePushFront
+// Makes an entry the most recently used (cache lock held)
+static void cachePushFront(MatrixCache *cache, CacheEntry *entry)
+{
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head)
+        cache->head->prev = entry;
+    cache->head = entry;
+    if (cache->tail == NULL)
+        cache->tail = entry;
+    entry->linked = 1;
+    cache->bytes += entry->bytes;
+    cache->entries++;
+}
+
+// Function: cacheEntryDestroy
+// Frees an entry that is unlinked and no longer referenced
+static void cacheEntryDestroy(CacheEntry *entry)
+{
+    if (entry->matrix)
+        smvp_destroy(entry->matrix);
+    pthread_rwlock_destroy(&entry->lock);
+    free(entry);
+}
+
+// Function: cacheEvict
+// Drops least recently used idle entries until the cache fits its limit (cache lock held).
+// Entries in use stay resident, and so does the most recently used one even when it alone is
+// over the limit, otherwise a matrix larger than the cache would be reloaded on every request.
+static void cacheEvict(MatrixCache *cache)
+{
+    CacheEntry *entry = cache->tail, *prev;
+
+    while (cache->bytes > cache->limit && entry != NULL && entry != cache->head)
+    {
+        prev = entry->prev;
+        if (entry->refs == 0 && entry->ready)
+        {
+            cacheUnlink(cache, entry);
+            cacheEntryDestroy(entry);
+            cache->evictions++;
+        }
+        entry = prev;
+    }
+}
+
+// Function: cacheAcquire
+// Returns a referenced, ready entry for path, loading it on a miss. Concurrent requests for a
+// file that is still loading wait for the first loader instead of converting it twice, and are
+// counted as waits rather than hits.
+static CacheEntry *cacheAcquire(MatrixCache *cache, const char *path, int *hit, char *error, size_t errorLen)
+{
+    struct stat fileStats;
+    CacheEntry *entry;
+    smvp_matrix_t *matrix;
+    smvp_info_t loaded;
+    int waited;
+
+    if (stat(path, &fileStats) != 0)
+    {
+        snprintf(error, errorLen, "cannot stat %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    for (entry = cache->head; entry != NULL; entry = entry->next)
+    {
+        if (entry->dev == fileStats.st_dev && entry->ino == fileStats.st_ino)
+            break;
+    }
+
+    if (entry != NULL && (entry->size != fileStats.st_size ||
+                          entry->mtime.tv_sec != fileStats.st_mtim.tv_sec ||
+                          entry->mtime.tv_nsec != fileStats.st_mtim.tv_nsec))
+    {
+        // File rewritten in place, retire the old conversion and load again
+        cacheUnlink(cache, entry);
+        if (entry->refs == 0 && entry->ready)
+            cacheEntryDestroy(entry);
+        entry = NULL;
+    }
+
+    if (entry != NULL)
+    {
+        entry->refs++;
+        cacheUnlink(cache, entry);
+        cachePushFront(cache, entry);
+        waited = !entry->ready;
+        while (!entry->ready)
+            pthread_cond_wait(&cache->loaded, &cache->lock);
+        if (entry->failed)
+        {
+            snprintf(error, errorLen, "%s", entry->error);
+            if (--entry->refs == 0 && !entry->linked)
+                cacheEntryDestroy(entry);
+            pthread_mutex_unlock(&cache->lock);
+            return NULL;
+        }
+        if (waited)
+            cache->waits++;
+        else
+            cache->hits++;
+        pthread_mutex_unlock(&cache->lock);
+        *hit = !waited;
+        return entry;
+    }
+
+    // Miss: publish a placeholder so other requests for the same file wait on it
+    if ((entry = (CacheEntry *)calloc(1, sizeof(CacheEntry))) == NULL)
+    {
+        pthread_mutex_unlock(&cache->lock);
+        snprintf(error, errorLen, "out of memory");
+        return NULL;
+    }
+    entry->dev = fileStats.st_dev;
+    entry->ino = fileStats.st_ino;
+    entry->size = fileStats.st_size;
+    entry->mtime = fileStats.st_mtim;
+    entry->refs = 1;
+    pthread_rwlock_init(&entry->lock, NULL);
+    cachePushFront(cache, entry);
+    cache->misses++;
+    pthread_mutex_unlock(&cache->lock);
+
+    matrix = smvpLoadMatrixFile(path, cache->options, entry->error, sizeof(entry->error));
+
+    pthread_mutex_lock(&cache->lock);
+    entry->ready = 1;
+    if (matrix == NULL)
+    {
+        entry->failed = 1;
+        snprintf(error, errorLen, "%s", entry->error);
+        cacheUnlink(cache, entry);
+        pthread_cond_broadcast(&cache->loaded);
+        if (--entry->refs == 0)
+            cacheEntryDestroy(entry);
+        pthread_mutex_unlock(&cache->lock);
+        return NULL;
+    }
+    entry->matrix = matrix;
+    smvp_get_info(matrix, &entry->info);
+    if (entry->linked)
+    {
+        cache->bytes += entry->info.bytes;
+    }
+    entry->bytes = entry->info.bytes;
+    loaded = entry->info;
+    cacheEvict(cache);
+    pthread_cond_broadcast(&cache->loaded);
+    pthread_mutex_unlock(&cache->lock);
+
+    printf(ANSI_COLOR_YELLOW "[INFO]\tLoaded %s (%d x %d, %lld non-zeros, %.2f MiB).\n" ANSI_COLOR_RESET,
+           path, loaded.rows, loaded.cols, (long long)loaded.nnz, (double)loaded.bytes / (1024 * 1024));
+    *hit = 0;
+    return entry;
+}
+
+// Function: cacheEnsureFormat
+// Converts an entry to format once; later requests find it already analyzed
+static int cacheEnsureFormat(MatrixCache *cache, CacheEntry *entry, int format)
+{
+    int status = SMVP_SUCCESS;
+    size_t before;
+
+    pthread_rwlock_rdlock(&entry->lock);
+    if (entry->info.formats & format)
+    {
+        pthread_rwlock_unlock(&entry->lock);
+        return SMVP_SUCCESS;
+    }
+    pthread_rwlock_unlock(&entry->lock);
+
+    pthread_rwlock_wrlock(&entry->lock);
+    if (!(entry->info.formats & format))
+    {
+        status = smvp_analyze(entry->matrix, format);
+
+        pthread_mutex_lock(&cache->lock);
+        before = entry->bytes;
+        smvp_get_info(entry->matrix, &entry->info);
+        entry->bytes = entry->info.bytes;
+        if (entry->linked)
+        {
+            cache->bytes = cache->bytes - before + entry->bytes;
+        }
+        cacheEvict(cache);
+        pthread_mutex_unlock(&cache->lock);
+    }
+    pthread_rwlock_unlock(&entry->lock);
+
+    return status;
+}
+
+// Function: cacheRelease
+// Drops a request's reference, freeing retired entries and enforcing the limit
+static void cacheRelease(MatrixCache *cache, CacheEntry *entry)
+{
+    pthread_mutex_lock(&cache->lock);
+    if (--entry->refs == 0 && !entry->linked)
+    {
+        cacheEntryDestroy(entry);
+    }
+    cacheEvict(cache);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+// Function: cacheFillStats
+// Copies cache counters into a response
+static void cacheFillStats(MatrixCache *cache, SmvpResponse *response)
+{
+    pthread_mutex_lock(&cache->lock);
+    response->cacheBytes = cache->bytes;
+    response->cacheEntries = cache->entries;
+    response->cacheHits = cache->hits;
+    response->cacheMisses = cache->misses;
+    response->cacheWaits = cache->waits;
+    response->cacheEvictions = cache->evictions;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+// Function: shmMap
+// Maps the client's vector object, reusing the previous mapping when the name is unchanged
+static int shmMap(ShmMapping *mapping, const char *name, size_t required, char *error, size_t errorLen)
+{
+    int fd;
+    struct stat shmStats;
+
+    if (mapping->base != NULL && strcmp(mapping->name, name) == 0 && mapping->len >= required)
+        return 0;
+
+    if (mapping->base != NULL)
+    {
+        munmap(mapping->base, mapping->len);
+        mapping->base = NULL;
+    }
+
+    if ((fd = shm_open(name, O_RDWR, 0)) < 0)
+    {
+        snprintf(error, errorLen, "shm_open(%s): %s", name, strerror(errno));
+        return -1;
+    }
+    if (fstat(fd, &shmStats) != 0)
+    {
+        snprintf(error, errorLen, "fstat(%s): %s", name, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    if ((size_t)shmStats.st_size < required)
+    {
+        snprintf(error, errorLen, "shared memory %s holds %ld bytes, %lu required", name, (long)shmStats.st_size, (long unsigned int)required);
+        close(fd);
+        return -1;
+    }
+
+    mapping->len = (size_t)shmStats.st_size;
+    mapping->base = mmap(NULL, mapping->len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping->base == MAP_FAILED)
+    {
+        mapping->base = NULL;
+        snprintf(error, errorLen, "mmap(%s): %s", name, strerror(errno));
+        return -1;
+    }
+    snprintf(mapping->name, sizeof(mapping->name), "%s", name);
+
+    return 0;
+}
+
+// Function: readFull
+// Reads exactly len bytes, returns 0 on a clean close before the first byte
+static ssize_t readFull(int fd, void *buffer, size_t len)
+{
+    size_t done = 0;
+    ssize_t got;
+
+    while (done < len)
+    {
+        got = read(fd, (char *)buffer + done, len - done);
+        if (got == 0)
+            return (ssize_t)done;
+        if (got < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        done += (size_t)got;
+    }
+
+    return (ssize_t)done;
+}
+
+// Function: writeFull
+// Writes exactly len bytes without raising SIGPIPE on a vanished client
+static int writeFull(int fd, const void *buffer, size_t len)
+{
+    size_t done = 0;
+    ssize_t put;
+
+    while (done < len)
+    {
+        put = send(fd, (const char *)buffer + done, len - done, MSG_NOSIGNAL);
+        if (put < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        done += (size_t)put;
+    }
+
+    return 0;
+}
+
+// Function: serveRequest
+// Executes one request. Returns 1 when the client asked the server to shut down.
+static int serveRequest(ServerState *server, SmvpRequest *request, SmvpResponse *response, ShmMapping *mapping)
+{
+    struct timespec received, start, end;
+    CacheEntry *entry;
+    double *x, *y;
+    int hit = 0, status;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &received);
+    memset(response, 0, sizeof(*response));
+
+    if (request->magic != SMVP_SERVER_MAGIC)
+    {
+        response->status = SMVP_SRV_ERR_PROTOCOL;
+        snprintf(response->message, sizeof(response->message), "bad request magic");
+        return 0;
+    }
+
+    request->path[SMVP_SERVER_PATH_MAX - 1] = '\0';
+    request->shmName[SMVP_SERVER_SHM_MAX - 1] = '\0';
+
+    switch (request->op)
+    {
+    case SMVP_REQ_STATS:
+        cacheFillStats(&server->cache, response);
+        return 0;
+    case SMVP_REQ_SHUTDOWN:
+        cacheFillStats(&server->cache, response);
+        return 1;
+    case SMVP_REQ_LOAD:
+    case SMVP_REQ_MULTIPLY:
+        break;
+    default:
+        response->status = SMVP_SRV_ERR_PROTOCOL;
+        snprintf(response->message, sizeof(response->message), "unknown operation %u", request->op);
+        return 0;
+    }
+
+    if ((entry = cacheAcquire(&server->cache, request->path, &hit, response->message, sizeof(response->message))) == NULL)
+    {
+        response->status = SMVP_SRV_ERR_LOAD;
+        cacheFillStats(&server->cache, response);
+        return 0;
+    }
+    response->cacheHit = hit;
+    response->rows = entry->info.rows;
+    response->cols = entry->info.cols;
+    response->nnz = entry->info.nnz;
+
+    if ((status = cacheEnsureFormat(&server->cache, entry, request->format)) != SMVP_SUCCESS)
+    {
+        response->status = SMVP_SRV_ERR_MATRIX;
+        snprintf(response->message, sizeof(response->message), "%s", smvp_strerror(status));
+    }
+    else if (request->op == SMVP_REQ_MULTIPLY)
+    {
+        if (shmMap(mapping, request->shmName, SMVP_SHM_SIZE(entry->info.rows, entry->info.cols), response->message, sizeof(response->message)) != 0)
+        {
+            response->status = SMVP_SRV_ERR_SHM;
+        }
+        else
+        {
+            x = (double *)mapping->base;
+            y = (double *)((char *)mapping->base + SMVP_SHM_Y_OFFSET(entry->info.cols));
+
+            // Readers share the entry, only a concurrent conversion to a new format excludes them
+            pthread_rwlock_rdlock(&entry->lock);
+            clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+            status = smvp_multiply(entry->matrix, request->format, request->alpha, x, request->beta, y);
+            clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+            pthread_rwlock_unlock(&entry->lock);
+
+            response->setupNs = elapsedNs(&received, &start);
+            response->multiplyNs = elapsedNs(&start, &end);
+            if (status != SMVP_SUCCESS)
+            {
+                response->status = SMVP_SRV_ERR_MATRIX;
+                snprintf(response->message, sizeof(response->message), "%s", smvp_strerror(status));
+            }
+        }
+    }
+    else
+    {
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+        response->setupNs = elapsedNs(&received, &end);
+    }
+
+    cacheRelease(&server->cache, entry);
+    cacheFillStats(&server->cache, response);
+
+    return 0;
+}
+
+// Function: serverStop
+// Wakes every thread: idle workers through the queue, busy ones by shutting their connection
+static void serverStop(ServerState *server)
+{
+    int index;
+
+    pthread_mutex_lock(&server->queue.lock);
+    if (!server->queue.stopping)
+    {
+        server->queue.stopping = 1;
+        for (index = 0; index < server->workers; index++)
+        {
+            if (server->queue.active[index] >= 0)
+                shutdown(server->queue.active[index], SHUT_RDWR);
+        }
+        shutdown(server->listenFd, SHUT_RDWR);
+    }
+    pthread_cond_broadcast(&server->queue.ready);
+    pthread_cond_broadcast(&server->queue.space);
+    pthread_mutex_unlock(&server->queue.lock);
+}
+
+// Function: serverWorker
+// Serves queued connections until the server stops
+static void *serverWorker(void *arg)
+{
+    WorkerArg *worker = (WorkerArg *)arg;
+    ServerState *server = worker->server;
+    ConnQueue *queue = &server->queue;
+    SmvpRequest *request;
+    SmvpResponse response;
+    ShmMapping mapping;
+    ssize_t got;
+    int fd, stop;
+
+    // Requests carry a 4 KiB path, keep them off the thread stack
+    if ((request = (SmvpRequest *)malloc(sizeof(SmvpRequest))) == NULL)
+        return NULL;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&queue->lock);
+        while (queue->count == 0 && !queue->stopping)
+            pthread_cond_wait(&queue->ready, &queue->lock);
+        if (queue->stopping)
+        {
+            pthread_mutex_unlock(&queue->lock);
+            break;
+        }
+        fd = queue->fds[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        queue->active[worker->id] = fd;
+        pthread_cond_signal(&queue->space);
+        pthread_mutex_unlock(&queue->lock);
+
+        memset(&mapping, 0, sizeof(mapping));
+        stop = 0;
+        while (!stop && (got = readFull(fd, request, sizeof(SmvpRequest))) == (ssize_t)sizeof(SmvpRequest))
+        {
+            stop = serveRequest(server, request, &response, &mapping);
+            if (writeFull(fd, &response, sizeof(response)) != 0)
+                break;
+        }
+
+        if (mapping.base != NULL)
+            munmap(mapping.base, mapping.len);
+
+        pthread_mutex_lock(&queue->lock);
+        queue->active[worker->id] = -1;
+        pthread_mutex_unlock(&queue->lock);
+        close(fd);
+
+        if (stop)
+        {
+            printf(ANSI_COLOR_YELLOW "[INFO]\tShutdown requested by client.\n" ANSI_COLOR_RESET);
+            serverStop(server);
+        }
+    }
+
+    free(request);
+    return NULL;
+}
+
+// Function: smvpServerRun
+// Listens on config->socketPath and serves requests until SIGINT/SIGTERM or a shutdown request
+int smvpServerRun(const ServerConfig *config)
+{
+    ServerState server;
+    struct sockaddr_un address;
+    struct sigaction action;
+    pthread_t *threads;
+    WorkerArg *workerArgs;
+    CacheEntry *entry, *next;
+    sigset_t stopSignals;
+    int index, fd;
+
+    memset(&server, 0, sizeof(server));
+    server.workers = config->workers;
+
+    if (strlen(config->socketPath) >= sizeof(address.sun_path))
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tSocket path is too long.\n" ANSI_COLOR_RESET);
+        return 1;
+    }
+
+    // No SA_RESTART, a signal must interrupt accept()
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = serverSignalHandler;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    if ((server.listenFd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tUnable to create socket: %s.\n" ANSI_COLOR_RESET, strerror(errno));
+        return 1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, config->socketPath);
+    unlink(config->socketPath);
+    if (bind(server.listenFd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(server.listenFd, 64) != 0)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tUnable to listen on %s: %s.\n" ANSI_COLOR_RESET, config->socketPath, strerror(errno));
+        close(server.listenFd);
+        return 1;
+    }
+
+    pthread_mutex_init(&server.cache.lock, NULL);
+    pthread_cond_init(&server.cache.loaded, NULL);
+    server.cache.limit = config->cacheLimit;
+    server.cache.options = &config->options;
+    pthread_mutex_init(&server.queue.lock, NULL);
+    pthread_cond_init(&server.queue.ready, NULL);
+    pthread_cond_init(&server.queue.space, NULL);
+    server.queue.capacity = 4 * config->workers;
+    server.queue.fds = (int *)malloc(sizeof(int) * (long unsigned int)server.queue.capacity);
+    server.queue.active = (int *)malloc(sizeof(int) * (long unsigned int)config->workers);
+    threads = (pthread_t *)malloc(sizeof(pthread_t) * (long unsigned int)config->workers);
+    workerArgs = (WorkerArg *)malloc(sizeof(WorkerArg) * (long unsigned int)config->workers);
+    if (server.queue.fds == NULL || server.queue.active == NULL || threads == NULL || workerArgs == NULL)
+    {
+        printf(ANSI_COLOR_RED "[ERROR]\tUnable to allocate worker pool.\n" ANSI_COLOR_RESET);
+        exit(1);
+    }
+
+    // Workers inherit a mask without the stop signals so they are always delivered to accept()
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, NULL);
+    for (index = 0; index < config->workers; index++)
+    {
+        server.queue.active[index] = -1;
+        workerArgs[index].server = &server;
+        workerArgs[index].id = index;
+        if (pthread_create(&threads[index], NULL, serverWorker, &workerArgs[index]) != 0)
+        {
+            printf(ANSI_COLOR_RED "[ERROR]\tUnable to start worker thread.\n" ANSI_COLOR_RESET);
+            exit(1);
+        }
+    }
+
+    pthread_sigmask(SIG_UNBLOCK, &stopSignals, NULL);
+
+    printf(ANSI_COLOR_YELLOW "[INFO]\tServing on %s with %d workers, cache limit %.0f MiB.\n" ANSI_COLOR_RESET,
+           config->socketPath, config->workers, (double)config->cacheLimit / (1024 * 1024));
+    fflush(stdout);
+
+    while (!serverStopSignal)
+    {
+        if ((fd = accept(server.listenFd, NULL, NULL)) < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            // shutdown() from a worker lands here
+            break;
+        }
+
+        pthread_mutex_lock(&server.queue.lock);
+        // Every worker is busy and the backlog is full, let the kernel queue further clients until one frees up
+        while (server.queue.count == server.queue.capacity && !server.queue.stopping)
+            pthread_cond_wait(&server.queue.space, &server.queue.lock);
+        if (server.queue.stopping)
+        {
+            pthread_mutex_unlock(&server.queue.lock);
+            close(fd);
+            break;
+        }
+        server.queue.fds[(server.queue.head + server.queue.count) % server.queue.capacity] = fd;
+        server.queue.count++;
+        pthread_cond_signal(&server.queue.ready);
+        pthread_mutex_unlock(&server.queue.lock);
+    }
+
+    serverStop(&server);
+    for (index = 0; index < config->workers; index++)
+    {
+        pthread_join(threads[index], NULL);
+    }
+
+    // Connections accepted but never served
+    while (server.queue.count > 0)
+    {
+        close(server.queue.fds[server.queue.head]);
+        server.queue.head = (server.queue.head + 1) % server.queue.capacity;
+        server.queue.count--;
+    }
+
+    printf(ANSI_COLOR_CYAN "[DATA]\tCache hits/misses/waits/evictions: " ANSI_COLOR_RESET "%lu/%lu/%lu/%lu\n",
+           (long unsigned int)server.cache.hits, (long unsigned int)server.cache.misses, (long unsigned int)server.cache.waits,
+           (long unsigned int)server.cache.evictions);
+
+    for (entry = server.cache.head; entry != NULL; entry = next)
+    {
+        next = entry->next;
+        cacheEntryDestroy(entry);
+    }
+
+    close(server.listenFd);
+    unlink(config->socketPath);
+    free(threads);
+    free(workerArgs);
+    free(server.queue.fds);
+    free(server.queue.active);
+    pthread_mutex_destroy(&server.cache.lock);
+    pthread_cond_destroy(&server.cache.loaded);
+    pthread_mutex_destroy(&server.queue.lock);
+    pthread_cond_destroy(&server.queue.ready);
+    pthread_cond_destroy(&server.queue.space);
+
+    return 0;
+}
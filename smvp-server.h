@@ -0,0 +1,99 @@
+/*
+*  ==================================================================
+*  smvp-server.h for smvp-toolbox
+*  Persistent SMVP server (--serve) and its wire protocol
+*  ==================================================================
+*
+*  The server listens on a Unix domain (SOCK_STREAM) socket. A client
+*  sends fixed-size SmvpRequest records and reads one SmvpResponse per
+*  request; a connection may carry any number of requests.
+*
+*  Vectors never cross the socket. For SMVP_REQ_MULTIPLY the client
+*  creates a POSIX shared memory object (shm_open) laid out as
+*
+*      offset 0                         x, cols doubles
+*      offset SMVP_SHM_Y_OFFSET(cols)   y, rows doubles
+*
+*  and passes its name. The server maps it once per connection and
+*  writes y in place. Use SMVP_REQ_LOAD first to learn rows/cols.
+*
+*  Matrices are cached by file identity (device, inode, size, mtime),
+*  so rewriting a file causes a reload on the next request while
+*  renaming or hard-linking it does not.
+*/
+
+#ifndef SMVP_SERVER_H
+#define SMVP_SERVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "libsmvp/smvp.h"
+
+#define SMVP_SERVER_MAGIC 0x534d5650u // "SMVP"
+#define SMVP_SERVER_PATH_MAX 4096
+#define SMVP_SERVER_SHM_MAX 256
+
+// Request operations
+#define SMVP_REQ_LOAD 1     // Load (or find cached) path and analyze format, returns dimensions
+#define SMVP_REQ_MULTIPLY 2 // y = alpha*A*x + beta*y using the shared memory vectors
+#define SMVP_REQ_STATS 3    // Cache counters only
+#define SMVP_REQ_SHUTDOWN 4 // Stop accepting connections and exit once workers drain
+
+// Response status codes
+#define SMVP_SRV_OK 0
+#define SMVP_SRV_ERR_PROTOCOL 1 // Bad magic, operation or truncated request
+#define SMVP_SRV_ERR_LOAD 2     // Matrix file missing or unparseable
+#define SMVP_SRV_ERR_SHM 3      // Shared memory object missing or too small
+#define SMVP_SRV_ERR_MATRIX 4   // libsmvp rejected the conversion or multiply
+
+// y follows x, starting on a cache line boundary
+#define SMVP_SHM_Y_OFFSET(cols) ((((size_t)(cols) * sizeof(double)) + 63) & ~(size_t)63)
+#define SMVP_SHM_SIZE(rows, cols) (SMVP_SHM_Y_OFFSET(cols) + (size_t)(rows) * sizeof(double))
+
+// Struct: _smvp_request_
+// One client request, sent as-is over the socket
+typedef struct _smvp_request_
+{
+    uint32_t magic;  // SMVP_SERVER_MAGIC
+    uint32_t op;     // SMVP_REQ_*
+    int32_t format;  // SMVP_FORMAT_* (LOAD and MULTIPLY)
+    int32_t reserved;
+    double alpha;
+    double beta;
+    char path[SMVP_SERVER_PATH_MAX];    // Matrix Market file (LOAD and MULTIPLY)
+    char shmName[SMVP_SERVER_SHM_MAX]; // Shared memory object (MULTIPLY)
+} SmvpRequest;
+
+// Struct: _smvp_response_
+// Server reply to a single request
+typedef struct _smvp_response_
+{
+    int32_t status;   // SMVP_SRV_*
+    int32_t cacheHit; // Matrix was already resident (0 when this request loaded it or waited for another's load)
+    int32_t rows;
+    int32_t cols;
+    int64_t nnz;
+    int64_t setupNs;    // Receipt of request until the multiply starts (lookup, load, conversion, mapping)
+    int64_t multiplyNs; // The multiply itself
+    uint64_t cacheBytes;
+    uint64_t cacheEntries;
+    uint64_t cacheHits;
+    uint64_t cacheMisses;
+    uint64_t cacheWaits; // Requests that found the matrix still loading and waited for it
+    uint64_t cacheEvictions;
+    char message[128]; // Human readable error detail
+} SmvpResponse;
+
+// Struct: _server_config_
+// Command line settings for --serve
+typedef struct _server_config_
+{
+    const char *socketPath;
+    size_t cacheLimit; // Bytes of converted matrices kept resident
+    int workers;       // Connections served concurrently
+    smvp_options_t options; // Handed to every matrix the cache loads
+} ServerConfig;
+
+int smvpServerRun(const ServerConfig *config);
+
+#endif
@@ -0,0 +1,721 @@
+/*
+*  ==================================================================
+*  smvp-kernel-test.c for smvp-toolbox
+*  CTest driver: checks one libsmvp kernel on one Matrix Market file
+*  against a reference COO SpMV (correctness), its throughput
+*  against the stored baseline of this host (perf), the transpose
+*  plan the cost model picks for the file (plan), or its products
+*  while several threads multiply with one handle (concurrent)
+*
+*  smvp-kernel-test correctness <kernel> <file.mtx>
+*  smvp-kernel-test concurrent <kernel> <file.mtx>
+*  smvp-kernel-test perf <kernel> <file.mtx> <baselines.txt> <slack>
+*  smvp-kernel-test plan <kernel> <file.mtx> <private|owner|serial>
+*
+*  Exits 0 on success, 1 on failure and 77 (skipped) when this host
+*  has no baseline yet. Running the perf tests with SMVP_PERF_RECORD=1
+*  stores the measured throughput as the host's baseline instead.
+*  ==================================================================
+*/
+
+// Required for mkstemp() and gethostname()
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "mmio/mmio.h"
+#include "libsmvp/smvp.h"
+
+#define TEST_PASS 0
+#define TEST_FAIL 1
+#define TEST_SKIP 77
+
+// Relative error allowed against the reference, kernels may sum in a different order
+#define TEST_TOLERANCE 1e-12
+// Threads used by the pooled kernels, more than one partition even on small hosts
+#define TEST_THREADS 4
+// Split threshold for the pooled adaptive CSR kernel, the sample files have no row near the default
+#define TEST_ACSR_SPLIT 65
+// Prefetch distance of the prefetching kernels, short enough that the sample files run both sides of the bound check
+#define TEST_PREFETCH 16
+// Column tile width of the tiled kernels, narrow so every sample file spans several tiles
+#define TEST_TILE_COLS 64
+// Panel budget for the out-of-core kernel, small so even the sample files span several panels
+#define TEST_PANEL_BYTES 4096
+// Threads multiplying with one handle at once, and the products each of them checks
+#define CONCURRENT_CALLERS 3
+#define CONCURRENT_ROUNDS 20
+// Timed batches per perf measurement, and the least time one batch should take
+#define PERF_BATCHES 15
+#define PERF_BATCH_SECONDS 0.005
+
+// Struct: _test_kernel_
+// A kernel under test: a libsmvp format, optionally on the worker pool or streamed from panels
+typedef struct _test_kernel_
+{
+    const char *name;
+    int format;   // SMVP_FORMAT_* (panels stream CSR)
+    int threads;  // Pool workers (0 = serial)
+    int panels;   // Out-of-core: multiply from a panel file
+    int wide;     // Index limit lowered to 0 so the handle holds 64-bit offsets
+    int prefetch; // Software prefetch distance of the CSR or TJDS kernel (0 = plain kernel)
+    int plan;     // SMVP_TRANSPOSE_* plan forced for the transpose kernels (y = A^T*x), AUTO lets the cost model pick
+} TestKernel;
+
+static const TestKernel testKernels[] = {
+    {"csr", SMVP_FORMAT_CSR, 0, 0, 0, 0, SMVP_TRANSPOSE_SERIAL},
+    {"csr-threads", SMVP_FORMAT_CSR, TEST_THREADS, 0, 0, 0, SMVP_TRANSPOSE_SERIAL},
+    {"csc", SMVP_FORMAT_CSC, 0, 0, 0, 0, SMVP_TRANSPOSE_SERIAL},
+    {"tjds", SMVP_FORMAT_TJDS, 0, 0, 0, 0, SMVP_TRANSPOSE_SERIAL},
+    {"csr-ooc", SMVP_FORMAT_CSR, 0, 1, 0, 0, SMVP_TRANSPOSE_SERIAL},
+    {"csr-wide", SMVP_FORMAT_CSR, 0, 0, 1, 0, SMVP_TRANSPOSE_SERIAL},
+    {"csr-threads-wide", SMVP_FORMAT_CSR, TEST_THREADS, 0, 1, 0, SMVP_TRANSPOSE_SERIAL},
+    {"csc-wide", SMVP_FORMAT_CSC, 0, 0, 1, 0, SMVP_TRANSPOSE_SERIAL},
+    {"tjds-wide", SMVP_FORMAT_TJDS, 0, 0, 1, 0, SMVP_TRANSPOSE_SERIAL},
+    {"acsr", SMVP_FORMAT_ACSR, 0, 0, 0, 0, SMVP_TRANSPOSE_SERIAL},
+    {"acsr-threads", SMVP_FORMAT_ACSR, TEST_THREADS, 0, 0, 0, SMVP_TRANSPOSE_SERIAL},
+    {"acsr-wide", SMVP_FORMAT_ACSR, 0, 0, 1, 0, SMVP_TRANSPOSE_SERIAL},
+    {"csr-prefetch", SMVP_FORMAT_CSR, 0, 0, 0, TEST_PREFETCH, SMVP_TRANSPOSE_SERIAL},
+    {"csr-threads-prefetch", SMVP_FORMAT_CSR, TEST_THREADS, 0, 0, TEST_PREFETCH, SMVP_TRANSPOSE_SERIAL},
+    {"tjds-prefetch", SMVP_FORMAT_TJDS, 0, 0, 0, TEST_PREFETCH, SMVP_TRANSPOSE_SERIAL},
+    {"csr-prefetch-wide", SMVP_FORMAT_CSR, 0, 0, 1, TEST_PREFETCH, SMVP_TRANSPOSE_SERIAL},
+    {"tjds-prefetch-wide", SMVP_FORMAT_TJDS, 0, 0, 1, TEST_PREFETCH, SMVP_TRANSPOSE_SERIAL},
+    {"tiled", SMVP_FORMAT_TILED, 0, 0, 0, 0, SMVP_TRANSPOSE_SERIAL},
+    {"tiled-threads", SMVP_FORMAT_TILED, TEST_THREADS, 0, 0, 0, SMVP_TRANSPOSE_SERIAL},
+    {"tiled-wide", SMVP_FORMAT_TILED, 0, 0, 1, 0, SMVP_TRANSPOSE_SERIAL},
+    {"csrt", SMVP_FORMAT_TRANSPOSE, 0, 0, 0, 0, SMVP_TRANSPOSE_SERIAL},
+    {"csrt-private", SMVP_FORMAT_TRANSPOSE, TEST_THREADS, 0, 0, 0, SMVP_TRANSPOSE_PRIVATE},
+    {"csrt-owner", SMVP_FORMAT_TRANSPOSE, TEST_THREADS, 0, 0, 0, SMVP_TRANSPOSE_OWNER},
+    {"csrt-threads", SMVP_FORMAT_TRANSPOSE, TEST_THREADS, 0, 0, 0, SMVP_TRANSPOSE_AUTO},
+    {"csrt-wide", SMVP_FORMAT_TRANSPOSE, 0, 0, 1, 0, SMVP_TRANSPOSE_SERIAL},
+    {"csrt-owner-wide", SMVP_FORMAT_TRANSPOSE, TEST_THREADS, 0, 1, 0, SMVP_TRANSPOSE_OWNER},
+};
+
+// Struct: _test_matrix_
+// A test input as read from its file: raw COO for the reference and the matrix handle under test
+typedef struct _test_matrix_
+{
+    int rows;
+    int cols;
+    int nnz;
+    int *row; // 0-based, file order
+    int *col;
+    double *val;
+    smvp_matrix_t *A;
+    smvp_pool_t *pool;
+    smvp_panels_t *panels;
+    char panelPath[64];
+} TestMatrix;
+
+// Function: findKernel
+// Looks a kernel up by name, returns NULL when there is none
+static const TestKernel *findKernel(const char *name)
+{
+    size_t index;
+
+    for (index = 0; index < sizeof(testKernels) / sizeof(testKernels[0]); index++)
+    {
+        if (strcmp(testKernels[index].name, name) == 0)
+        {
+            return &testKernels[index];
+        }
+    }
+    return NULL;
+}
+
+// Function: writePanels
+// Writes the matrix into a temporary panel file and opens it for streaming
+static int writePanels(TestMatrix *m)
+{
+    smvp_panel_writer_t *writer = NULL;
+    const int *rowPtr, *colInd;
+    const double *val;
+    int *rowNnz, *localPtr, panel, first, nrows, row, fd, status;
+    long nnz;
+
+    smvp_get_csr(m->A, &rowPtr, &colInd, &val);
+    rowNnz = (int *)malloc(sizeof(int) * ((long unsigned int)m->rows + 1));
+    localPtr = (int *)malloc(sizeof(int) * ((long unsigned int)m->rows + 1));
+    for (row = 0; row < m->rows; row++)
+    {
+        rowNnz[row] = rowPtr[row + 1] - rowPtr[row];
+    }
+
+    snprintf(m->panelPath, sizeof(m->panelPath), "smvp-kernel-test-XXXXXX");
+    if ((fd = mkstemp(m->panelPath)) < 0)
+    {
+        free(rowNnz);
+        free(localPtr);
+        return SMVP_ERR_SYSTEM;
+    }
+    close(fd);
+
+    status = smvp_panels_begin(&writer, m->panelPath, m->rows, m->cols, rowNnz, TEST_PANEL_BYTES);
+    for (panel = 0; status == SMVP_SUCCESS && panel < smvp_panels_count(writer); panel++)
+    {
+        smvp_panels_span(writer, panel, &first, &nrows, &nnz);
+        for (row = 0; row <= nrows; row++)
+        {
+            localPtr[row] = rowPtr[first + row] - rowPtr[first];
+        }
+        status = smvp_panels_put(writer, panel, localPtr, colInd + rowPtr[first], val + rowPtr[first]);
+    }
+    if (writer != NULL && smvp_panels_end(writer) != SMVP_SUCCESS && status == SMVP_SUCCESS)
+    {
+        status = SMVP_ERR_SYSTEM;
+    }
+    if (status == SMVP_SUCCESS)
+    {
+        status = smvp_panels_open(&m->panels, m->panelPath);
+    }
+
+    free(rowNnz);
+    free(localPtr);
+    return status;
+}
+
+// Function: loadMatrix
+// Reads the file twice: as raw COO for the reference and straight into CSR for the handle,
+// so the reference never shares a code path with the matrix under test
+static int loadMatrix(const char *path, const TestKernel *kernel, int threads, TestMatrix *m)
+{
+    FILE *mmInputFile;
+    MM_typecode matcode;
+    int *rowPtr, *colInd, badEntry, status;
+    smvp_info_t info;
+    smvp_options_t opts;
+    double *val;
+
+    memset(m, 0, sizeof(*m));
+
+    // Every case sets its own handle options, nothing carries over from another kernel
+    smvp_options_init(&opts);
+    opts.index_limit = kernel->wide ? 0 : SMVP_INDEX_LIMIT_DEFAULT;
+    opts.acsr_split = (threads > 0) ? TEST_ACSR_SPLIT : SMVP_ACSR_SPLIT_DEFAULT;
+    opts.tile_cols = TEST_TILE_COLS;
+    opts.transpose_mode = kernel->plan;
+    if ((mmInputFile = fopen(path, "r")) == NULL || mm_read_banner(mmInputFile, &matcode) != 0 ||
+        mm_read_mtx_crd_size(mmInputFile, &m->rows, &m->cols, &m->nnz) != 0)
+    {
+        fprintf(stderr, "%s: not a readable Matrix Market file\n", path);
+        return -1;
+    }
+    m->row = (int *)malloc(sizeof(int) * ((long unsigned int)m->nnz + 1));
+    m->col = (int *)malloc(sizeof(int) * ((long unsigned int)m->nnz + 1));
+    m->val = (double *)malloc(sizeof(double) * ((long unsigned int)m->nnz + 1));
+    if (mm_read_mtx_crd_soa(mmInputFile, m->rows, m->cols, m->nnz, m->row, m->col, m->val, matcode, &badEntry) != 0)
+    {
+        fprintf(stderr, "%s: entry %d could not be read\n", path, badEntry);
+        fclose(mmInputFile);
+        return -1;
+    }
+
+    rewind(mmInputFile);
+    mm_read_banner(mmInputFile, &matcode);
+    mm_read_mtx_crd_size(mmInputFile, &m->rows, &m->cols, &m->nnz);
+    rowPtr = (int *)malloc(sizeof(int) * ((long unsigned int)m->rows + 1));
+    colInd = (int *)malloc(sizeof(int) * ((long unsigned int)m->nnz + 1));
+    val = (double *)malloc(sizeof(double) * ((long unsigned int)m->nnz + 1));
+    status = mm_read_mtx_crd_csr(mmInputFile, m->rows, m->cols, m->nnz, rowPtr, colInd, val, matcode, &badEntry);
+    fclose(mmInputFile);
+    if (status == 0)
+    {
+        status = smvp_create_csr(&m->A, m->rows, m->cols, rowPtr, colInd, val, &opts);
+    }
+    free(rowPtr);
+    free(colInd);
+    free(val);
+    if (status != 0)
+    {
+        fprintf(stderr, "%s: building the matrix failed (%d)\n", path, status);
+        return -1;
+    }
+    smvp_get_info(m->A, &info);
+    if (info.index_bits != (kernel->wide ? 64 : 32))
+    {
+        fprintf(stderr, "%s: matrix holds %d-bit offsets, kernel %s expects the other width\n", path, info.index_bits, kernel->name);
+        return -1;
+    }
+
+    if (threads > 0 && (status = smvp_pool_create(&m->pool, threads, SMVP_NUMA_OFF)) == SMVP_SUCCESS)
+    {
+        status = smvp_bind(m->A, m->pool, threads);
+    }
+    if (status == SMVP_SUCCESS && kernel->format != SMVP_FORMAT_CSR)
+    {
+        status = smvp_analyze(m->A, kernel->format);
+    }
+    else if (status == SMVP_SUCCESS && kernel->panels)
+    {
+        status = writePanels(m);
+    }
+    if (status == SMVP_SUCCESS && kernel->prefetch > 0)
+    {
+        status = smvp_set_prefetch(m->A, kernel->format, kernel->prefetch);
+    }
+    if (status != SMVP_SUCCESS)
+    {
+        fprintf(stderr, "%s: preparing kernel %s failed: %s\n", path, kernel->name, smvp_strerror(status));
+        return -1;
+    }
+    smvp_get_info(m->A, &info);
+    // AUTO kernels run whichever plan the cost model picks for the matrix
+    if (kernel->format == SMVP_FORMAT_TRANSPOSE && kernel->plan != SMVP_TRANSPOSE_AUTO && info.transpose_mode != kernel->plan)
+    {
+        fprintf(stderr, "%s: transpose plan %d, kernel %s expects %d\n", path, info.transpose_mode, kernel->name, kernel->plan);
+        return -1;
+    }
+    return 0;
+}
+
+// Function: freeMatrix
+// Releases everything loadMatrix() set up
+static void freeMatrix(TestMatrix *m)
+{
+    if (m->panels != NULL)
+    {
+        smvp_panels_close(m->panels);
+    }
+    if (m->panelPath[0] != '\0')
+    {
+        unlink(m->panelPath);
+    }
+    smvp_destroy(m->A);
+    smvp_pool_destroy(m->pool);
+    free(m->row);
+    free(m->col);
+    free(m->val);
+}
+
+// Function: runKernel
+// y = alpha*A*x + beta*y (alpha*A^T*x for the transpose kernels) through the kernel under test
+static int runKernel(const TestKernel *kernel, TestMatrix *m, double alpha, const double *x, double beta, double *y)
+{
+    smvp_stream_stats_t stats;
+
+    if (kernel->panels)
+    {
+        return smvp_panels_multiply(m->panels, alpha, x, beta, y, &stats);
+    }
+    if (kernel->format == SMVP_FORMAT_TRANSPOSE)
+    {
+        return smvp_multiply_transpose(m->A, alpha, x, beta, y);
+    }
+    return smvp_multiply(m->A, kernel->format, alpha, x, beta, y);
+}
+
+// Function: checkProduct
+// Compares y with alpha*A*x + beta*y0 (alpha*A^T*x when transpose) summed entry by entry in file order,
+// returns the entries out of tolerance
+static int checkProduct(const TestMatrix *m, int transpose, double alpha, const double *x, double beta, const double *y0, const double *y, const char *pass)
+{
+    int outLen = transpose ? m->cols : m->rows;
+    const int *out = transpose ? m->col : m->row, *in = transpose ? m->row : m->col;
+    double *ref = (double *)calloc((long unsigned int)outLen + 1, sizeof(double));
+    double *scale = (double *)calloc((long unsigned int)outLen + 1, sizeof(double));
+    int index, bad = 0;
+
+    for (index = 0; index < m->nnz; index++)
+    {
+        ref[out[index]] += alpha * m->val[index] * x[in[index]];
+        scale[out[index]] += fabs(alpha * m->val[index] * x[in[index]]);
+    }
+    for (index = 0; index < outLen; index++)
+    {
+        if (beta != 0.0)
+        {
+            ref[index] += beta * y0[index];
+            scale[index] += fabs(beta * y0[index]);
+        }
+        if (!(fabs(y[index] - ref[index]) <= TEST_TOLERANCE * scale[index]))
+        {
+            if (bad < 5)
+            {
+                fprintf(stderr, "%s: y[%d] = %.17g, reference %.17g\n", pass, index, y[index], ref[index]);
+            }
+            bad++;
+        }
+    }
+    free(ref);
+    free(scale);
+    return bad;
+}
+
+// Function: testCorrectness
+// Runs the kernel twice: beta = 0 over a NaN-filled y (must overwrite), then an update with both scalars set
+static int testCorrectness(const TestKernel *kernel, TestMatrix *m)
+{
+    int transpose = (kernel->format == SMVP_FORMAT_TRANSPOSE);
+    int inLen = transpose ? m->rows : m->cols, outLen = transpose ? m->cols : m->rows;
+    double *x = (double *)malloc(sizeof(double) * ((long unsigned int)inLen + 1));
+    double *y = (double *)malloc(sizeof(double) * ((long unsigned int)outLen + 1));
+    double *y0 = (double *)malloc(sizeof(double) * ((long unsigned int)outLen + 1));
+    int index, bad = 0;
+
+    // A non-constant x so a wrong column pairing cannot go unnoticed
+    for (index = 0; index < inLen; index++)
+    {
+        x[index] = 1.0 + (index % 17) / 16.0;
+    }
+    for (index = 0; index < outLen; index++)
+    {
+        y[index] = NAN;
+    }
+    if (runKernel(kernel, m, 1.0, x, 0.0, y) != SMVP_SUCCESS)
+    {
+        fprintf(stderr, "%s: multiply failed\n", kernel->name);
+        bad = 1;
+    }
+    else
+    {
+        bad += checkProduct(m, transpose, 1.0, x, 0.0, NULL, y, "y = A*x");
+    }
+
+    for (index = 0; index < outLen; index++)
+    {
+        y0[index] = y[index] = 0.25 * (index % 5) - 0.5;
+    }
+    if (runKernel(kernel, m, -0.5, x, 2.0, y) != SMVP_SUCCESS)
+    {
+        fprintf(stderr, "%s: multiply failed\n", kernel->name);
+        bad++;
+    }
+    else
+    {
+        bad += checkProduct(m, transpose, -0.5, x, 2.0, y0, y, "y = -0.5*A*x + 2*y");
+    }
+
+    free(x);
+    free(y);
+    free(y0);
+    printf("%s: %d rows, %d non-zeros, %s\n", kernel->name, m->rows, m->nnz, (bad == 0) ? "matches the reference" : "MISMATCH");
+    return (bad == 0) ? TEST_PASS : TEST_FAIL;
+}
+
+// Struct: _test_caller_
+// One thread of a concurrent test: its own x and y, the handle shared with every other caller
+typedef struct _test_caller_
+{
+    const TestKernel *kernel;
+    TestMatrix *m;
+    int caller;
+    int bad;
+} TestCaller;
+
+// Function: concurrentCaller
+// Thread body of a concurrent test: repeated products with an x no other caller uses, each checked
+static void *concurrentCaller(void *arg)
+{
+    TestCaller *c = (TestCaller *)arg;
+    int transpose = (c->kernel->format == SMVP_FORMAT_TRANSPOSE);
+    int inLen = transpose ? c->m->rows : c->m->cols, outLen = transpose ? c->m->cols : c->m->rows;
+    double *x = (double *)malloc(sizeof(double) * ((long unsigned int)inLen + 1));
+    double *y = (double *)malloc(sizeof(double) * ((long unsigned int)outLen + 1));
+    int index, round;
+
+    // Callers differ in every entry of x, so a product computed with another caller's scratch cannot match
+    for (index = 0; index < inLen; index++)
+    {
+        x[index] = (1.0 + ((index + 5 * c->caller) % 17) / 16.0) * (double)(c->caller + 1);
+    }
+    for (round = 0; round < CONCURRENT_ROUNDS && c->bad == 0; round++)
+    {
+        if (runKernel(c->kernel, c->m, 1.0, x, 0.0, y) != SMVP_SUCCESS)
+        {
+            fprintf(stderr, "%s: multiply failed\n", c->kernel->name);
+            c->bad = 1;
+        }
+        else
+        {
+            c->bad = checkProduct(c->m, transpose, 1.0, x, 0.0, NULL, y, "concurrent y = A*x");
+        }
+    }
+    free(x);
+    free(y);
+    return NULL;
+}
+
+// Function: testConcurrent
+// Runs CONCURRENT_CALLERS threads multiplying with the one handle at the same time
+static int testConcurrent(const TestKernel *kernel, TestMatrix *m)
+{
+    pthread_t threads[CONCURRENT_CALLERS];
+    TestCaller callers[CONCURRENT_CALLERS];
+    int index, started, bad = 0;
+
+    for (started = 0; started < CONCURRENT_CALLERS; started++)
+    {
+        callers[started].kernel = kernel;
+        callers[started].m = m;
+        callers[started].caller = started;
+        callers[started].bad = 0;
+        if (pthread_create(&threads[started], NULL, concurrentCaller, &callers[started]) != 0)
+        {
+            fprintf(stderr, "%s: starting caller %d failed\n", kernel->name, started);
+            bad = 1;
+            break;
+        }
+    }
+    for (index = 0; index < started; index++)
+    {
+        pthread_join(threads[index], NULL);
+        bad += callers[index].bad;
+    }
+    printf("%s: %d callers, %d rows, %d non-zeros, %s\n", kernel->name, CONCURRENT_CALLERS, m->rows, m->nnz, (bad == 0) ? "every product matches the reference" : "MISMATCH");
+    return (bad == 0) ? TEST_PASS : TEST_FAIL;
+}
+
+// Function: elapsedSeconds
+// Seconds between two CLOCK_MONOTONIC_RAW samples
+static double elapsedSeconds(const struct timespec *start, const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Function: compareDouble
+// qsort() comparison for ascending doubles
+static int compareDouble(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+// Function: measureMflops
+// Median throughput over PERF_BATCHES timed batches, each long enough to dwarf the clock resolution
+static double measureMflops(const TestKernel *kernel, TestMatrix *m)
+{
+    // Sized for both products, the transpose kernels read rows entries of x and write cols entries of y
+    int len = (m->rows > m->cols) ? m->rows : m->cols;
+    double *x = (double *)malloc(sizeof(double) * ((long unsigned int)len + 1));
+    double *y = (double *)malloc(sizeof(double) * ((long unsigned int)len + 1));
+    double rate[PERF_BATCHES], seconds;
+    struct timespec start, end;
+    int index, batch, reps = 1;
+
+    for (index = 0; index < len; index++)
+    {
+        x[index] = 1.0;
+    }
+    smvp_touch_rows(m->A, y);
+
+    // Warm up and grow the batch until one takes PERF_BATCH_SECONDS
+    for (;;)
+    {
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+        for (index = 0; index < reps; index++)
+        {
+            runKernel(kernel, m, 1.0, x, 0.0, y);
+        }
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+        if (elapsedSeconds(&start, &end) >= PERF_BATCH_SECONDS || reps >= (1 << 24))
+        {
+            break;
+        }
+        reps *= 2;
+    }
+
+    for (batch = 0; batch < PERF_BATCHES; batch++)
+    {
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+        for (index = 0; index < reps; index++)
+        {
+            runKernel(kernel, m, 1.0, x, 0.0, y);
+        }
+        clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+        seconds = elapsedSeconds(&start, &end);
+        // 2 flops (multiply + add) per non-zero
+        rate[batch] = 2.0 * m->nnz * reps / seconds / 1e6;
+    }
+    qsort(rate, PERF_BATCHES, sizeof(double), compareDouble);
+
+    free(x);
+    free(y);
+    return rate[PERF_BATCHES / 2];
+}
+
+// Function: readBaseline
+// Finds "<host> <kernel> <matrix> <MFLOP/s>" in the baseline file, returns the rate or a negative value
+static double readBaseline(const char *path, const char *host, const char *kernel, const char *matrix)
+{
+    char line[512], lineHost[256], lineKernel[64], lineMatrix[256];
+    double rate, found = -1;
+    FILE *baselines;
+
+    if ((baselines = fopen(path, "r")) == NULL)
+    {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), baselines) != NULL)
+    {
+        if (line[0] != '#' && sscanf(line, "%255s %63s %255s %lf", lineHost, lineKernel, lineMatrix, &rate) == 4 &&
+            strcmp(lineHost, host) == 0 && strcmp(lineKernel, kernel) == 0 && strcmp(lineMatrix, matrix) == 0)
+        {
+            found = rate;
+        }
+    }
+    fclose(baselines);
+    return found;
+}
+
+// Function: recordBaseline
+// Replaces (or adds) the line of this host, kernel and matrix through a temporary file and rename()
+static int recordBaseline(const char *path, const char *host, const char *kernel, const char *matrix, double rate)
+{
+    char line[512], lineHost[256], lineKernel[64], lineMatrix[256], *tmpPath;
+    size_t len = strlen(path) + 8;
+    FILE *baselines, *updated;
+    double lineRate;
+    int fd;
+
+    tmpPath = (char *)malloc(len);
+    snprintf(tmpPath, len, "%s.XXXXXX", path);
+    if ((fd = mkstemp(tmpPath)) < 0 || (updated = fdopen(fd, "w")) == NULL)
+    {
+        free(tmpPath);
+        return -1;
+    }
+    if ((baselines = fopen(path, "r")) != NULL)
+    {
+        while (fgets(line, sizeof(line), baselines) != NULL)
+        {
+            if (line[0] != '#' && sscanf(line, "%255s %63s %255s %lf", lineHost, lineKernel, lineMatrix, &lineRate) == 4 &&
+                strcmp(lineHost, host) == 0 && strcmp(lineKernel, kernel) == 0 && strcmp(lineMatrix, matrix) == 0)
+            {
+                continue;
+            }
+            fputs(line, updated);
+        }
+        fclose(baselines);
+    }
+    fprintf(updated, "%s %s %s %.1f\n", host, kernel, matrix, rate);
+    if (fclose(updated) != 0 || rename(tmpPath, path) != 0)
+    {
+        unlink(tmpPath);
+        free(tmpPath);
+        return -1;
+    }
+    free(tmpPath);
+    return 0;
+}
+
+// Function: testPerf
+// Passes when the kernel reaches at least baseline / slack MFLOP/s on this host
+static int testPerf(const TestKernel *kernel, TestMatrix *m, const char *matrixPath, const char *baselinePath, double slack)
+{
+    const char *record = getenv("SMVP_PERF_RECORD");
+    const char *matrix = strrchr(matrixPath, '/') ? strrchr(matrixPath, '/') + 1 : matrixPath;
+    char host[256];
+    double rate, baseline;
+
+    if (gethostname(host, sizeof(host)) != 0)
+    {
+        snprintf(host, sizeof(host), "unknown");
+    }
+    host[sizeof(host) - 1] = '\0';
+    rate = measureMflops(kernel, m);
+
+    if (record != NULL && record[0] != '\0' && strcmp(record, "0") != 0)
+    {
+        if (recordBaseline(baselinePath, host, kernel->name, matrix, rate) != 0)
+        {
+            fprintf(stderr, "unable to update %s\n", baselinePath);
+            return TEST_FAIL;
+        }
+        printf("%s on %s: %.1f MFLOP/s recorded as the baseline of %s\n", kernel->name, matrix, rate, host);
+        return TEST_PASS;
+    }
+
+    if ((baseline = readBaseline(baselinePath, host, kernel->name, matrix)) <= 0)
+    {
+        printf("%s on %s: %.1f MFLOP/s, no baseline for host %s (record one with SMVP_PERF_RECORD=1)\n", kernel->name, matrix, rate, host);
+        return TEST_SKIP;
+    }
+    printf("%s on %s: %.1f MFLOP/s, baseline %.1f, floor %.1f (slack %g)\n", kernel->name, matrix, rate, baseline, baseline / slack, slack);
+    return (rate >= baseline / slack) ? TEST_PASS : TEST_FAIL;
+}
+
+// Function: testPlan
+// Checks that the transpose plan picked for the matrix is the expected one
+static int testPlan(const TestKernel *kernel, TestMatrix *m, const char *expected)
+{
+    smvp_info_t info;
+    int plan;
+
+    if (strcmp(expected, "private") == 0)
+    {
+        plan = SMVP_TRANSPOSE_PRIVATE;
+    }
+    else if (strcmp(expected, "owner") == 0)
+    {
+        plan = SMVP_TRANSPOSE_OWNER;
+    }
+    else if (strcmp(expected, "serial") == 0)
+    {
+        plan = SMVP_TRANSPOSE_SERIAL;
+    }
+    else
+    {
+        fprintf(stderr, "unknown transpose plan %s\n", expected);
+        return TEST_FAIL;
+    }
+    smvp_get_info(m->A, &info);
+    printf("%s: %d x %d, %d non-zeros, transpose plan %d (expected %d)\n", kernel->name, m->rows, m->cols, m->nnz, info.transpose_mode, plan);
+    return (info.transpose_mode == plan) ? TEST_PASS : TEST_FAIL;
+}
+
+// Function: main
+// Parses the mode, kernel and matrix and runs the requested check
+int main(int argc, char *argv[])
+{
+    const TestKernel *kernel;
+    TestMatrix m;
+    int perf, plan, concurrent, result, threads;
+
+    perf = (argc == 6 && strcmp(argv[1], "perf") == 0);
+    plan = (argc == 5 && strcmp(argv[1], "plan") == 0);
+    concurrent = (argc == 4 && strcmp(argv[1], "concurrent") == 0);
+    if (!perf && !plan && !concurrent && !(argc == 4 && strcmp(argv[1], "correctness") == 0))
+    {
+        fprintf(stderr, "usage: %s correctness <kernel> <file.mtx>\n       %s concurrent <kernel> <file.mtx>\n"
+                "       %s perf <kernel> <file.mtx> <baselines.txt> <slack>\n       %s plan <kernel> <file.mtx> <private|owner|serial>\n",
+                argv[0], argv[0], argv[0], argv[0]);
+        return TEST_FAIL;
+    }
+    if ((kernel = findKernel(argv[2])) == NULL)
+    {
+        fprintf(stderr, "unknown kernel %s\n", argv[2]);
+        return TEST_FAIL;
+    }
+    // Perf runs never oversubscribe the host, an idle worker waiting for a CPU would be measured as the kernel
+    threads = kernel->threads;
+    if (perf && threads > sysconf(_SC_NPROCESSORS_ONLN))
+    {
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (loadMatrix(argv[3], kernel, threads, &m) != 0)
+    {
+        freeMatrix(&m);
+        return TEST_FAIL;
+    }
+
+    if (perf)
+    {
+        result = testPerf(kernel, &m, argv[3], argv[4], atof(argv[5]));
+    }
+    else if (plan)
+    {
+        result = testPlan(kernel, &m, argv[4]);
+    }
+    else
+    {
+        result = concurrent ? testConcurrent(kernel, &m) : testCorrectness(kernel, &m);
+    }
+    freeMatrix(&m);
+    return result;
+}